@@ -18,210 +18,480 @@
 */
 
 #include "LoadPLY2.hpp"
+#include <vl/MeshOptimizer.hpp>
 
 #include <string>
-#include <iostream>
+#include <vector>
 #include <sstream>
-#include <istream>
+#include <algorithm>
+#include <cmath>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
-vl::ref<vl::Geometry> LoadPLY2::loadPLY(const std::string& plyfile)
+namespace
 {
-  vl::ref<vl::Geometry> geom = new vl::Geometry;
-  vl::ref<vl::GPUArrayVec3> verts = new vl::GPUArrayVec3;
-  geom->setVertexArray( verts.get() );
-  vl::ref<vl::GPUArrayVec2> texcoords;
-  vl::ref<vl::GPUArrayVec3> normals;
+  //! Read only memory mapping of a whole file
+  class MappedFile
+  {
+  public:
+    MappedFile(const std::string& path): mData(NULL), mSize(0)
+    {
+      int fd = open( path.c_str(), O_RDONLY );
+      if (fd < 0)
+        return;
+      struct stat st;
+      if ( fstat(fd, &st) == 0 && st.st_size > 0 )
+      {
+        void* ptr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if (ptr != MAP_FAILED)
+        {
+          mData = (const char*)ptr;
+          mSize = st.st_size;
+          madvise( ptr, mSize, MADV_SEQUENTIAL );
+        }
+      }
+      close(fd);
+    }
 
-  vl::ref<vl::DrawElementsUInt> polys = new vl::DrawElementsUInt(vl::PT_TRIANGLES);
-  geom->addDrawCall( polys.get() );
+    ~MappedFile()
+    {
+      if (mData)
+        munmap( (void*)mData, mSize );
+    }
 
-  FILE* fin = fopen( plyfile.c_str(), "rt" );
-  if(fin == NULL)
-  {
-    vl::Log::error( vl::Say("Could not open file: %s\n") << plyfile );
-    return NULL;
-  }
+    bool isOpen() const { return mData != NULL; }
+    const char* begin() const { return mData; }
+    const char* end() const { return mData + mSize; }
 
-  char line[1024];
-  memset(line,0,1024); fgets(line,1023,fin);
-  if (strstr(line,"ply") == 0)
-  {
-    fclose(fin);
-    vl::Log::error( vl::Say("Not a PLY file: %s\n") << plyfile );
-    return NULL;
-  }
+  private:
+    MappedFile(const MappedFile&);
+    void operator=(const MappedFile&);
 
-  memset(line,0,1024); fgets(line,1023,fin);
-  bool ascii_format = true;
-  if (strstr(line,"format ascii 1.0"))
-    ascii_format = true;
+    const char* mData;
+    size_t mSize;
+  };
 
-  else
+  enum EPLYType { PLY_NONE, PLY_CHAR, PLY_UCHAR, PLY_SHORT, PLY_USHORT, PLY_INT, PLY_UINT, PLY_FLOAT, PLY_DOUBLE };
+
+  EPLYType plyType(const std::string& name)
   {
-    fclose(fin);
-    vl::Log::error( vl::Say("Not a PLY 1.0 file: %s\n") << plyfile );
-    return NULL;
+    if (name == "char"   || name == "int8")    return PLY_CHAR;
+    if (name == "uchar"  || name == "uint8")   return PLY_UCHAR;
+    if (name == "short"  || name == "int16")   return PLY_SHORT;
+    if (name == "ushort" || name == "uint16")  return PLY_USHORT;
+    if (name == "int"    || name == "int32")   return PLY_INT;
+    if (name == "uint"   || name == "uint32")  return PLY_UINT;
+    if (name == "float"  || name == "float32") return PLY_FLOAT;
+    if (name == "double" || name == "float64") return PLY_DOUBLE;
+    return PLY_NONE;
   }
 
-  int vert_count = 0;
-  while(!feof(fin))
+  int plyTypeSize(EPLYType type)
   {
-    fgets(line,1023,fin);
-    if (strstr(line,"element vertex") == NULL)
-      continue;
-    else
+    switch(type)
     {
-      vert_count = atoi(line+strlen("element vertex"));
-      break;
+    case PLY_CHAR:   case PLY_UCHAR:  return 1;
+    case PLY_SHORT:  case PLY_USHORT: return 2;
+    case PLY_INT:    case PLY_UINT:   case PLY_FLOAT: return 4;
+    case PLY_DOUBLE: return 8;
+    default: return 0;
     }
   }
 
-  int property_index=0;
-  int property_s=-1;
-  int property_t=-1;
-  int property_nx=-1;
-  int property_ny=-1;
-  int property_nz=-1;
+  struct PLYProperty
+  {
+    std::string mName;
+    EPLYType mType;
+    EPLYType mCountType; // PLY_NONE unless the property is a list
+  };
 
-  while(!feof(fin))
+  struct PLYElement
   {
-    fgets(line,1023,fin);
-    if (strstr(line,"property ") == NULL)
-      break;
-    else
+    std::string mName;
+    int mCount;
+    std::vector<PLYProperty> mProperties;
+  };
+
+  //! Reads the values of the data section, ASCII or binary in either byte order. Errors are sticky.
+  class PLYReader
+  {
+  public:
+    PLYReader(const char* begin, const char* end, bool ascii, bool swap): mPtr(begin), mEnd(end), mAscii(ascii), mSwap(swap), mError(false) {}
+
+    bool error() const { return mError; }
+
+    double read(EPLYType type)
     {
-      char *p=line+strlen("property ");
+      return mAscii ? readAscii() : readBinary(type);
+    }
 
-      //skip data type (should be "float")
-      while(*p!=' ')p++;
-      p++;
+  protected:
+    // strtod without locale, allocation or null terminator
+    double readAscii()
+    {
+      while( mPtr < mEnd && (*mPtr == ' ' || *mPtr == '\t' || *mPtr == '\r' || *mPtr == '\n') )
+        ++mPtr;
 
-      std::string str(p);
+      bool negative = false;
+      if ( mPtr < mEnd && (*mPtr == '-' || *mPtr == '+') )
+        negative = *mPtr++ == '-';
 
-      //truncate newline
-      if(str[str.length()-1]=='\n')str.erase(str.length()-1);
+      double mantissa = 0;
+      int exponent = 0;
+      int digits = 0;
+      for( ; mPtr < mEnd && *mPtr >= '0' && *mPtr <= '9'; ++mPtr, ++digits )
+        mantissa = mantissa * 10 + (*mPtr - '0');
+      if ( mPtr < mEnd && *mPtr == '.' )
+      {
+        for( ++mPtr; mPtr < mEnd && *mPtr >= '0' && *mPtr <= '9'; ++mPtr, ++digits, --exponent )
+          mantissa = mantissa * 10 + (*mPtr - '0');
+      }
+      if (!digits)
+      {
+        mError = true;
+        return 0;
+      }
+
+      if ( mPtr < mEnd && (*mPtr == 'e' || *mPtr == 'E') )
+      {
+        ++mPtr;
+        bool negative_exponent = false;
+        if ( mPtr < mEnd && (*mPtr == '-' || *mPtr == '+') )
+          negative_exponent = *mPtr++ == '-';
+        int e = 0;
+        for( ; mPtr < mEnd && *mPtr >= '0' && *mPtr <= '9'; ++mPtr )
+          e = e < 10000 ? e * 10 + (*mPtr - '0') : e;
+        exponent += negative_exponent ? -e : e;
+      }
 
-      std::cout << property_index << ": " << str << std::endl;
+      // powers of ten up to 1e22 are exact, so is the result for the usual 6-8 significant digits
+      static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+                                      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+      double value;
+      if (exponent < 0)
+        value = -exponent <= 22 ? mantissa / pow10[-exponent] : mantissa * pow(10.0, exponent);
+      else
+        value = exponent <= 22 ? mantissa * pow10[exponent] : mantissa * pow(10.0, exponent);
 
-      //get property indices
-      if(str=="s")property_s=property_index;
-      else if(str=="t")property_t=property_index;
-      else if(str=="nx")property_nx=property_index;
-      else if(str=="ny")property_ny=property_index;
-      else if(str=="nz")property_nz=property_index;
+      return negative ? -value : value;
+    }
 
-      property_index++;
+    double readBinary(EPLYType type)
+    {
+      int size = plyTypeSize(type);
+      if ( mEnd - mPtr < size )
+      {
+        mError = true;
+        return 0;
+      }
+
+      unsigned char bytes[8];
+      memcpy( bytes, mPtr, size );
+      mPtr += size;
+      if (mSwap)
+        std::reverse( bytes, bytes + size );
+
+      switch(type)
+      {
+      case PLY_CHAR:   { signed char v;    memcpy(&v, bytes, 1); return v; }
+      case PLY_UCHAR:  { unsigned char v;  memcpy(&v, bytes, 1); return v; }
+      case PLY_SHORT:  { short v;          memcpy(&v, bytes, 2); return v; }
+      case PLY_USHORT: { unsigned short v; memcpy(&v, bytes, 2); return v; }
+      case PLY_INT:    { int v;            memcpy(&v, bytes, 4); return v; }
+      case PLY_UINT:   { unsigned int v;   memcpy(&v, bytes, 4); return v; }
+      case PLY_FLOAT:  { float v;          memcpy(&v, bytes, 4); return v; }
+      case PLY_DOUBLE: { double v;         memcpy(&v, bytes, 8); return v; }
+      default: mError = true; return 0;
+      }
     }
+
+  protected:
+    const char* mPtr;
+    const char* mEnd;
+    bool mAscii;
+    bool mSwap;
+    bool mError;
+  };
+}
+
+vl::ref<vl::Geometry> LoadPLY2::loadPLY(const std::string& plyfile)
+{
+  MappedFile file(plyfile);
+  if (!file.isOpen())
+  {
+    vl::Log::error( vl::Say("Could not open file: %s\n") << plyfile );
+    return NULL;
   }
 
-  //create and assign property arrays
-  if(property_s!=-1)
+  // header
+
+  const char* ptr = file.begin();
+  std::vector<PLYElement> elements;
+  bool ascii_format = true;
+  bool swap_bytes = false;
+  bool end_header = false;
+
+  for(int line_number=0; ptr < file.end() && !end_header; ++line_number)
   {
-    texcoords = new vl::GPUArrayVec2;
-    geom->setTexCoordArray(0, texcoords.get());
+    const char* eol = (const char*)memchr( ptr, '\n', file.end() - ptr );
+    if (!eol)
+      eol = file.end();
+    std::istringstream line( std::string(ptr, eol) );
+    ptr = eol < file.end() ? eol + 1 : eol;
+
+    std::string keyword;
+    line >> keyword;
+
+    if (line_number == 0)
+    {
+      if (keyword != "ply")
+      {
+        vl::Log::error( vl::Say("Not a PLY file: %s\n") << plyfile );
+        return NULL;
+      }
+    }
+    else
+    if (keyword == "format")
+    {
+      std::string format, version;
+      line >> format >> version;
+
+      const unsigned short one = 1;
+      bool little_endian_host = *(const unsigned char*)&one == 1;
+
+      if (version != "1.0")
+        format.clear();
+      ascii_format = format == "ascii";
+      if (format == "binary_little_endian")
+        swap_bytes = !little_endian_host;
+      else
+      if (format == "binary_big_endian")
+        swap_bytes = little_endian_host;
+      else
+      if (!ascii_format)
+      {
+        vl::Log::error( vl::Say("Not a PLY 1.0 file: %s\n") << plyfile );
+        return NULL;
+      }
+    }
+    else
+    if (keyword == "element")
+    {
+      elements.push_back( PLYElement() );
+      line >> elements.back().mName >> elements.back().mCount;
+      if (line.fail() || elements.back().mCount < 0)
+      {
+        vl::Log::error( vl::Say("PLY: invalid element in %s\n") << plyfile );
+        return NULL;
+      }
+    }
+    else
+    if (keyword == "property")
+    {
+      std::string type;
+      PLYProperty property;
+      property.mCountType = PLY_NONE;
+      line >> type;
+      if (type == "list")
+      {
+        std::string count_type;
+        line >> count_type >> type;
+        property.mCountType = plyType(count_type);
+      }
+      property.mType = plyType(type);
+      line >> property.mName;
+
+      if ( elements.empty() || property.mType == PLY_NONE || (property.mCountType == PLY_NONE && type == "list") || line.fail() )
+      {
+        vl::Log::error( vl::Say("PLY: invalid property in %s\n") << plyfile );
+        return NULL;
+      }
+      elements.back().mProperties.push_back(property);
+    }
+    else
+    if (keyword == "end_header")
+      end_header = true;
   }
-  if(property_nx!=-1)
+
+  if (!end_header)
   {
-    normals = new vl::GPUArrayVec3;
-    geom->setNormalArray(normals.get());
+    vl::Log::error( vl::Say("PLY: missing end_header in %s\n") << plyfile );
+    return NULL;
   }
 
+  // vertex and face layout
+
+  int vert_count = 0;
   int face_count = 0;
-  while(!feof(fin))
+  bool has_texcoords = false;
+  bool has_normals = false;
+  for(unsigned i=0; i<elements.size(); i++)
   {
-    if (strstr(line,"element face") != NULL)
+    if (elements[i].mName == "vertex")
     {
-      face_count = atoi(line+strlen("element face"));
-      break;
+      vert_count = elements[i].mCount;
+      for(unsigned j=0; j<elements[i].mProperties.size(); j++)
+      {
+        const std::string& name = elements[i].mProperties[j].mName;
+        has_texcoords |= name == "s" || name == "u";
+        has_normals   |= name == "nx";
+      }
     }
-    fgets(line,1023,fin);
-    if (strstr(line,"element face") == NULL)
-      continue;
     else
-    {
-      face_count = atoi(line+strlen("element face"));
-      break;
-    }
+    if (elements[i].mName == "face")
+      face_count = elements[i].mCount;
   }
 
-  while(!feof(fin))
+  vl::ref<vl::Geometry> geom = new vl::Geometry;
+  vl::ref<vl::GPUArrayVec3> verts = new vl::GPUArrayVec3;
+  geom->setVertexArray( verts.get() );
+  vl::ref<vl::GPUArrayVec2> texcoords;
+  vl::ref<vl::GPUArrayVec3> normals;
+
+  vl::ref<vl::DrawElementsUInt> polys = new vl::DrawElementsUInt(vl::PT_TRIANGLES);
+  geom->addDrawCall( polys.get() );
+
+  //create and assign property arrays, sized up front from the header
+  verts->resize(vert_count);
+  if (has_texcoords)
+  {
+    texcoords = new vl::GPUArrayVec2;
+    texcoords->resize(vert_count);
+    geom->setTexCoordArray(0, texcoords.get());
+  }
+  if (has_normals)
   {
-    fgets(line,1023,fin);
-    if ( strstr(line,"end_header") )
-      break;
+    normals = new vl::GPUArrayVec3;
+    normals->resize(vert_count);
+    geom->setNormalArray(normals.get());
   }
+  polys->reserve(face_count*3);
 
-  if (ascii_format)
+  // data
+
+  PLYReader reader(ptr, file.end(), ascii_format, swap_bytes);
+  std::vector<GLuint> polygon;
+
+  for(unsigned i=0; i<elements.size() && !reader.error(); i++)
   {
+    const PLYElement& element = elements[i];
 
-    for(int i=0; i<vert_count; i++)
+    if (element.mName == "vertex")
     {
-      fgets(line,1023,fin);
-      vl::vec3 v;
-      sscanf( line, "%f %f %f", &v.x(), &v.y(), &v.z() );
-      verts->push_back(v);
-
-      std::stringstream ss(line);
-      float f;
-      vl::vec2 st;
-      vl::vec3 n;
-      for(int j=0;j<property_index;++j)
+      // where each property goes: x y z nx ny nz s t
+      std::vector<int> slot( element.mProperties.size(), -1 );
+      const char* names[] = { "x", "y", "z", "nx", "ny", "nz", "s", "t", "u", "v" };
+      const int   slots[] = {  0,   1,   2,   3,    4,    5,    6,   7,   6,   7  };
+      for(unsigned j=0; j<element.mProperties.size(); j++)
+        for(int k=0; k<10; k++)
+          if (element.mProperties[j].mName == names[k] && element.mProperties[j].mCountType == PLY_NONE)
+            slot[j] = slots[k];
+
+      float value[8] = { 0,0,0, 0,0,0, 0,0 };
+      vl::vec3* vert_ptr = vert_count ? verts->localBufferPtr() : NULL;
+      vl::vec3* norm_ptr = vert_count && normals ? normals->localBufferPtr() : NULL;
+      vl::vec2* texc_ptr = vert_count && texcoords ? texcoords->localBufferPtr() : NULL;
+
+      for(int v=0; v<element.mCount && !reader.error(); v++)
       {
-         ss >> f;
-         if(j==property_s)st.s()=f;
-         else if(j==property_t)st.t()=f;
-         else if(j==property_nx)n.x()=f;
-         else if(j==property_ny)n.y()=f;
-         else if(j==property_nz)n.z()=f;
+        for(unsigned j=0; j<element.mProperties.size(); j++)
+        {
+          const PLYProperty& property = element.mProperties[j];
+          if (property.mCountType != PLY_NONE)
+          {
+            int count = (int)reader.read(property.mCountType);
+            for(int k=0; k<count && !reader.error(); k++)
+              reader.read(property.mType);
+          }
+          else
+          if (slot[j] >= 0)
+            value[slot[j]] = (float)reader.read(property.mType);
+          else
+            reader.read(property.mType);
+        }
+
+        vert_ptr[v] = vl::vec3( value[0], value[1], value[2] );
+        if (norm_ptr)
+          norm_ptr[v] = vl::vec3( value[3], value[4], value[5] );
+        if (texc_ptr)
+          texc_ptr[v] = vl::vec2( value[6], value[7] );
       }
-      if(property_s!=-1)texcoords->push_back(st);
-      if(property_nx!=-1)normals->push_back(n);
     }
-
-    for(int i=0; i<face_count; i++)
+    else
+    if (element.mName == "face")
     {
-      fgets(line,1023,fin);
-      int n, a, b, c, d;
-      sscanf( line, "%d", &n);
-      if(n==3)
+      for(int f=0; f<element.mCount && !reader.error(); f++)
       {
-        sscanf( line, "%d %d %d %d", &n, &a, &b, &c );
-        /*polys->addIndex(a);
-        polys->addIndex(c);
-        polys->addIndex(b);*/
-        polys->addIndex(b);
-        polys->addIndex(c);
-        polys->addIndex(a);
+        for(unsigned j=0; j<element.mProperties.size(); j++)
+        {
+          const PLYProperty& property = element.mProperties[j];
+          if (property.mCountType == PLY_NONE)
+          {
+            reader.read(property.mType);
+            continue;
+          }
+
+          int count = (int)reader.read(property.mCountType);
+          bool indices = property.mName == "vertex_indices" || property.mName == "vertex_index";
+
+          polygon.clear();
+          for(int k=0; k<count && !reader.error(); k++)
+          {
+            double index = reader.read(property.mType);
+            if (indices)
+              polygon.push_back( (GLuint)index );
+            if ( indices && (index < 0 || index >= vert_count) )
+            {
+              vl::Log::error( vl::Say("PLY: vertex index out of range in %s\n") << plyfile );
+              return NULL;
+            }
+          }
+
+          // triangle fan around the first vertex, same winding as the polygon
+          for(int k=1; k+1<(int)polygon.size(); k++)
+          {
+            polys->addIndex(polygon[k]);
+            polys->addIndex(polygon[k+1]);
+            polys->addIndex(polygon[0]);
+          }
+        }
       }
-      else if(n==4)
+    }
+    else
+    {
+      for(int e=0; e<element.mCount && !reader.error(); e++)
       {
-        sscanf( line, "%d %d %d %d %d", &n, &a, &b, &c, &d);
-        /*polys->addIndex(a);
-        polys->addIndex(c);
-        polys->addIndex(b);
-        polys->addIndex(a);
-        polys->addIndex(d);
-        polys->addIndex(c);*/
-        polys->addIndex(b);
-        polys->addIndex(c);
-        polys->addIndex(a);
-        polys->addIndex(c);
-        polys->addIndex(d);
-        polys->addIndex(a);
+        for(unsigned j=0; j<element.mProperties.size(); j++)
+        {
+          const PLYProperty& property = element.mProperties[j];
+          int count = property.mCountType != PLY_NONE ? (int)reader.read(property.mCountType) : 1;
+          for(int k=0; k<count && !reader.error(); k++)
+            reader.read(property.mType);
+        }
       }
     }
   }
-  else
-  {
 
+  if (reader.error())
+  {
+    vl::Log::error( vl::Say("PLY: truncated or malformed data in %s\n") << plyfile );
+    return NULL;
   }
 
-  fclose(fin);
   if (vl::VERBOSITY_LEVEL > 1)
     vl::Log::info( vl::Say("PLY: verts=%n, faces=%n\n") << vert_count << face_count );
-  if (property_nx==-1)
+
+  // welded before the normals are computed, so that duplicated vertices share a smooth normal
+  vl::ref<vl::MeshOptimizer> optimizer = new vl::MeshOptimizer;
+  if (optimizer->optimize(geom.get()) && vl::VERBOSITY_LEVEL > 1)
+    vl::Log::info( vl::Say("PLY: welded verts=%n, ACMR %.3n -> %.3n\n") << optimizer->vertexCountAfter() << optimizer->acmrBefore() << optimizer->acmrAfter() );
+
+  if (!has_normals)
     geom->computeSmoothNormals();
   return geom.get();
 }
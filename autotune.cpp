@@ -0,0 +1,199 @@
+//autotuner for the gains of the old balancer.
+//every candidate of a generation flies the standard maneuvers in headless
+//simulations, all flights of a generation run in parallel on all cores.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "headless.h"
+#include "parallel.h"
+#include "cmaes.h"
+
+using namespace SimQuadCopter;
+
+//gains must not become negative
+static GainSet toGains(const std::vector<double> &x, float &penalty)
+{
+	GainSet gains;
+	penalty=0;
+	for(int i=0;i<GainSet::Count;++i)
+	{
+		if(x[i]<0.0)
+		{
+			penalty+=x[i]*x[i];
+			gains.values[i]=0.0f;
+		}
+		else
+			gains.values[i]=x[i];
+	}
+	return gains;
+}
+
+//job i flies maneuver i%Maneuver::Count of candidate i/Maneuver::Count
+class FlightJob: public ParallelJob
+{
+public:
+	FlightJob(const HeadlessFlight &flight): flight(flight) {}
+
+	virtual void run(int index, std::vector<float> &result)
+	{
+		result.push_back(flight.fly(index%Maneuver::Count,candidates[index/Maneuver::Count]));
+	}
+
+	HeadlessFlight flight;
+	std::vector<GainSet> candidates;
+};
+
+//costs[candidate*Maneuver::Count+maneuver]
+static void evaluate(ParallelRunner &runner, FlightJob &job, std::vector<float> &costs)
+{
+	std::vector< std::vector<float> > results;
+	int count=job.candidates.size()*Maneuver::Count;
+	runner.run(job,count,results);
+
+	costs.resize(count);
+	for(int i=0;i<count;++i)
+		costs[i]=results[i].empty() ? 2.0f*job.flight.crashPenalty : results[i][0];
+}
+
+static void report(FILE *f, const char *title, const GainSet &gains, const float *costs, bool writeGains)
+{
+	float total=0;
+	fprintf(f,"# %s\n",title);
+	for(int m=0;m<Maneuver::Count;++m)
+	{
+		fprintf(f,"#   %-16s %10.5f\n",Maneuver::getName(m),costs[m]);
+		total+=costs[m];
+	}
+	fprintf(f,"#   %-16s %10.5f\n","total",total);
+	if(writeGains)
+		gains.write(f);
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-g generations] [-p population] [-s sigma] [-j jobs] [-n] [-i gains] [-o gains]\n",name);
+	printf("  -g  number of generations (default 30)\n");
+	printf("  -p  candidates per generation (default 4+3ln(n))\n");
+	printf("  -s  initial step size relative to the gains (default 0.5)\n");
+	printf("  -j  parallel flights (default: number of cores)\n");
+	printf("  -n  fly with the native dynamics instead of ODE (faster, see comparedynamics)\n");
+	printf("  -i  start from the gains in this file\n");
+	printf("  -o  write tuned gains and cost report to this file (default autotune-gains.txt)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int generations=30;
+	int population=0;
+	float relativeSigma=0.5f;
+	int jobs=0;
+	const char *input=NULL;
+	const char *output="autotune-gains.txt";
+	bool native=false;
+
+	int c;
+	while((c=getopt(argc,argv,"g:p:s:j:ni:o:h"))!=-1)
+	{
+		switch(c)
+		{
+		case 'g': generations=atoi(optarg); break;
+		case 'p': population=atoi(optarg); break;
+		case 's': relativeSigma=atof(optarg); break;
+		case 'j': jobs=atoi(optarg); break;
+		case 'n': native=true; break;
+		case 'i': input=optarg; break;
+		case 'o': output=optarg; break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	GainSet initial;
+	if(input && !initial.load(input))
+	{
+		printf("could not read gains from %s\n",input);
+		return 1;
+	}
+
+	ParallelRunner runner(jobs);
+	HeadlessFlight flight;
+	if(native)
+		flight.backend=QuadCopter::BackendNative;
+	FlightJob job(flight);
+
+	std::vector<double> mean(GainSet::Count),sigmas(GainSet::Count);
+	for(int i=0;i<GainSet::Count;++i)
+	{
+		mean[i]=initial.values[i];
+		//unused terms (Ki=Kd=0) still get explored
+		sigmas[i]=relativeSigma*std::max(fabs(initial.values[i]),0.1f);
+	}
+	SepCmaEs es(mean,sigmas,population);
+
+	printf("tuning %d gains, %d candidates x %d maneuvers per generation on %d cores\n",
+		GainSet::Count,es.getLambda(),Maneuver::Count,runner.getWorkers());
+
+	std::vector<float> costs;
+	job.candidates.assign(1,initial);
+	evaluate(runner,job,costs);
+	std::vector<float> initialCosts=costs;
+
+	GainSet best=initial;
+	std::vector<float> bestCosts=costs;
+	float bestTotal=0;
+	for(int m=0;m<Maneuver::Count;++m)
+		bestTotal+=costs[m];
+	printf("initial cost %.5f\n",bestTotal);
+
+	for(int g=0;g<generations;++g)
+	{
+		const std::vector< std::vector<double> > &samples=es.sample();
+		std::vector<float> penalties(samples.size());
+
+		job.candidates.resize(samples.size());
+		for(size_t k=0;k<samples.size();++k)
+			job.candidates[k]=toGains(samples[k],penalties[k]);
+
+		evaluate(runner,job,costs);
+
+		std::vector<double> totals(samples.size());
+		for(size_t k=0;k<samples.size();++k)
+		{
+			float total=0;
+			for(int m=0;m<Maneuver::Count;++m)
+				total+=costs[k*Maneuver::Count+m];
+			totals[k]=total+penalties[k];
+
+			if(total<bestTotal)
+			{
+				bestTotal=total;
+				best=job.candidates[k];
+				bestCosts.assign(costs.begin()+k*Maneuver::Count,costs.begin()+(k+1)*Maneuver::Count);
+			}
+		}
+		es.update(totals);
+
+		printf("generation %3d: best %.5f, step size %.4f\n",g+1,bestTotal,es.getSigma());
+	}
+
+	report(stdout,"initial gains",initial,&initialCosts[0],true);
+	report(stdout,"tuned gains",best,&bestCosts[0],true);
+
+	FILE *f=fopen(output,"w");
+	if(!f)
+	{
+		printf("could not write %s\n",output);
+		return 1;
+	}
+	fprintf(f,"# simquadcopter autotune, %d generations\n",generations);
+	report(f,"initial gains",initial,&initialCosts[0],false);
+	report(f,"tuned gains",best,&bestCosts[0],true);
+	fclose(f);
+	printf("tuned gains written to %s\n",output);
+
+	return 0;
+}
@@ -0,0 +1,51 @@
+//builds the binary mesh caches of PLY models, see meshcache.h.
+//
+//usage: buildmeshcache [model.ply ...]
+//without arguments all models/*.ply are processed. up to date caches are
+//left alone, so this can run as a build step. the viewer builds missing or
+//stale caches itself, this only moves the work out of its startup.
+
+#include <stdio.h>
+#include <glob.h>
+
+#include <string>
+#include <vector>
+
+#include <vl/Log.hpp>
+
+#include "meshcache.h"
+
+using namespace SimQuadCopter;
+
+int main(int argc, char **argv)
+{
+	vl::Log::setLogger(new vl::LogPrintf);
+
+	std::vector<std::string> files;
+	for(int i=1;i<argc;++i)
+		files.push_back(argv[i]);
+	if(files.empty())
+	{
+		glob_t g;
+		if(glob("models/*.ply",0,NULL,&g)==0)
+		{
+			for(size_t i=0;i<g.gl_pathc;++i)
+				files.push_back(g.gl_pathv[i]);
+			globfree(&g);
+		}
+	}
+
+	int failed=0;
+	for(size_t i=0;i<files.size();++i)
+	{
+		bool rebuilt=false;
+		if(!MeshCache::update(files[i],&rebuilt))
+		{
+			fprintf(stderr,"%s: failed\n",files[i].c_str());
+			failed++;
+		}
+		else
+			printf("%s: %s\n",MeshCache::cacheFile(files[i]).c_str(),rebuilt ? "built" : "up to date");
+	}
+	return failed ? 1 : 0;
+}
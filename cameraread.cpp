@@ -0,0 +1,132 @@
+//reads the onboard camera of the simulator (simquadcopter-vls -c WxH) from
+//its shared memory frame ring, the way a vision process would: the pixels
+//are used in place and the result is thrown away if the simulator
+//overwrote the frame meanwhile.
+//
+//prints the frame rate, the skipped frames and the pose every second and
+//optionally saves the last frame. the per frame "work" is the mean
+//brightness, computed straight from the ring.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "framering.h"
+
+using namespace SimQuadCopter;
+
+static bool writePPM(const char *filename, const FrameRingHeader *header, const unsigned char *pixels)
+{
+	FILE *f=fopen(filename,"wb");
+	if(!f)
+		return false;
+	fprintf(f,"P6\n%u %u\n255\n",header->width,header->height);
+	for(unsigned int y=0;y<header->height;++y)
+	{
+		const unsigned char *row=pixels+y*header->stride;
+		for(unsigned int x=0;x<header->width;++x,row+=4)
+		{
+			unsigned char rgb[3]={row[2],row[1],row[0]};
+			fwrite(rgb,1,3,f);
+		}
+	}
+	return fclose(f)==0;
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-n name] [-f frames] [-o file.ppm]\n",name);
+	printf("  -n  shm_open() name of the frame ring (default: /simquadcopter-camera)\n");
+	printf("  -f  stop after this many frames (default: run until the simulator stops)\n");
+	printf("  -o  save the last frame read\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *name="/simquadcopter-camera";
+	const char *output=NULL;
+	int frames=0;
+
+	int c;
+	while((c=getopt(argc,argv,"n:f:o:h"))!=-1)
+	{
+		switch(c)
+		{
+		case 'n': name=optarg; break;
+		case 'f': frames=atoi(optarg); break;
+		case 'o': output=optarg; break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	FrameRing ring;
+	if(!ring.open(name))
+	{
+		printf("no frame ring %s, is the simulator running with -c?\n",name);
+		return 1;
+	}
+	const FrameRingHeader *header=ring.getHeader();
+	printf("%s: %ux%u, %u slots, %.0f Hz, fov %.0f deg\n",name,header->width,header->height,header->slotCount,header->rate,header->fov);
+
+	long long last=ring.latest();
+	int read=0,skipped=0,overwritten=0;
+	int reportRead=0;
+	double reportTime=-1;
+	while(frames==0 || read<frames)
+	{
+		long long frame=ring.waitNewer(last,2000);
+		if(frame<0)
+		{
+			printf("no frame for 2 seconds, the simulator stopped\n");
+			break;
+		}
+		if(last>=0 && frame>last+1)
+			skipped+=frame-last-1;
+		last=frame;
+
+		const FrameSlotHeader *slot=ring.getSlot(frame);
+		if(!slot)
+		{
+			overwritten++;
+			continue;
+		}
+
+		//the work on the frame, in place
+		double time=slot->time;
+		float position[3]={slot->position[0],slot->position[1],slot->position[2]};
+		const unsigned char *pixels=ring.getPixels(slot);
+		unsigned long long sum=0;
+		for(unsigned int y=0;y<header->height;++y)
+		{
+			const unsigned char *row=pixels+y*header->stride;
+			for(unsigned int x=0;x<header->width;++x,row+=4)
+				sum+=row[0]+row[1]+row[2];
+		}
+		if(output && (frames==0 || read==frames-1))
+			writePPM(output,header,pixels);
+
+		if(!ring.valid(slot,frame))
+		{
+			overwritten++;
+			continue;
+		}
+		read++;
+		reportRead++;
+
+		if(reportTime<0)
+			reportTime=time;
+		if(time-reportTime>=1.0)
+		{
+			double brightness=sum/(3.0*header->width*header->height);
+			printf("t=%.2fs %5.1f fps, %d skipped, %d overwritten, brightness %.1f, camera at %.2f %.2f %.2f\n",
+				time,reportRead/(time-reportTime),skipped,overwritten,brightness,position[0],position[1],position[2]);
+			reportRead=0;
+			reportTime=time;
+		}
+	}
+
+	printf("%d frames read, %d skipped, %d overwritten while read\n",read,skipped,overwritten);
+	return 0;
+}
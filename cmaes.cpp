@@ -0,0 +1,174 @@
+#include "cmaes.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace SimQuadCopter
+{
+
+struct CmaRank
+{
+	double cost;
+	int index;
+	bool operator<(const CmaRank &other) const { return cost<other.cost; }
+};
+
+SepCmaEs::SepCmaEs(const std::vector<double> &mean, const std::vector<double> &sigmas, int lambda, unsigned int seed)
+{
+	n=mean.size();
+	this->mean=mean;
+
+	if(lambda<=0)
+		lambda=4+(int)(3.0*log((double)n));
+	this->lambda=lambda;
+	mu=lambda/2;
+
+	weights.resize(mu);
+	double sum=0,sum2=0;
+	for(int i=0;i<mu;++i)
+	{
+		weights[i]=log(mu+0.5)-log(i+1.0);
+		sum+=weights[i];
+	}
+	for(int i=0;i<mu;++i)
+	{
+		weights[i]/=sum;
+		sum2+=weights[i]*weights[i];
+	}
+	mueff=1.0/sum2;
+
+	cs=(mueff+2.0)/(n+mueff+5.0);
+	ds=1.0+2.0*std::max(0.0,sqrt((mueff-1.0)/(n+1.0))-1.0)+cs;
+	cc=(4.0+mueff/n)/(n+4.0+2.0*mueff/n);
+	//the diagonal can learn faster than a full covariance matrix
+	c1=2.0/((n+1.3)*(n+1.3)+mueff)*(n+2.0)/3.0;
+	cmu=std::min(1.0-c1,2.0*(mueff-2.0+1.0/mueff)/((n+2.0)*(n+2.0)+mueff)*(n+2.0)/3.0);
+	chiN=sqrt((double)n)*(1.0-1.0/(4.0*n)+1.0/(21.0*n*n));
+
+	//sigma is the overall step size, the shape lives in diag
+	sigma=1.0;
+	diag=sigmas;
+	ps.assign(n,0.0);
+	pc.assign(n,0.0);
+	generation=0;
+
+	rng=seed ? seed : 1;
+	haveSpare=false;
+	spare=0;
+}
+
+double SepCmaEs::gaussian()
+{
+	if(haveSpare)
+	{
+		haveSpare=false;
+		return spare;
+	}
+
+	double u,v,s;
+	do
+	{
+		//xorshift32, independent of rand() which is used by the simulation
+		rng^=rng<<13; rng^=rng>>17; rng^=rng<<5;
+		u=rng/4294967296.0*2.0-1.0;
+		rng^=rng<<13; rng^=rng>>17; rng^=rng<<5;
+		v=rng/4294967296.0*2.0-1.0;
+		s=u*u+v*v;
+	}
+	while(s>=1.0 || s==0.0);
+
+	s=sqrt(-2.0*log(s)/s);
+	spare=v*s;
+	haveSpare=true;
+	return u*s;
+}
+
+const std::vector< std::vector<double> > &SepCmaEs::sample()
+{
+	y.resize(lambda);
+	population.resize(lambda);
+	for(int k=0;k<lambda;++k)
+	{
+		y[k].resize(n);
+		population[k].resize(n);
+		for(int i=0;i<n;++i)
+		{
+			y[k][i]=diag[i]*gaussian();
+			population[k][i]=mean[i]+sigma*y[k][i];
+		}
+	}
+	return population;
+}
+
+void SepCmaEs::update(const std::vector<double> &costs)
+{
+	std::vector<CmaRank> rank(lambda);
+	for(int k=0;k<lambda;++k)
+	{
+		rank[k].cost=costs[k];
+		rank[k].index=k;
+	}
+	std::sort(rank.begin(),rank.end());
+
+	//weighted mean of the best steps
+	std::vector<double> yw(n,0.0);
+	for(int j=0;j<mu;++j)
+		for(int i=0;i<n;++i)
+			yw[i]+=weights[j]*y[rank[j].index][i];
+
+	for(int i=0;i<n;++i)
+		mean[i]+=sigma*yw[i];
+
+	//evolution paths
+	double psLength=0;
+	for(int i=0;i<n;++i)
+	{
+		ps[i]=(1.0-cs)*ps[i]+sqrt(cs*(2.0-cs)*mueff)*yw[i]/diag[i];
+		psLength+=ps[i]*ps[i];
+	}
+	psLength=sqrt(psLength);
+
+	generation++;
+	double hs=psLength/sqrt(1.0-pow(1.0-cs,2.0*generation)) < (1.4+2.0/(n+1.0))*chiN ? 1.0 : 0.0;
+
+	for(int i=0;i<n;++i)
+		pc[i]=(1.0-cc)*pc[i]+hs*sqrt(cc*(2.0-cc)*mueff)*yw[i];
+
+	//rank one and rank mu update of the diagonal
+	for(int i=0;i<n;++i)
+	{
+		double c=diag[i]*diag[i];
+		double rankMu=0;
+		for(int j=0;j<mu;++j)
+		{
+			double v=y[rank[j].index][i];
+			rankMu+=weights[j]*v*v;
+		}
+		c=(1.0-c1-cmu)*c+c1*(pc[i]*pc[i]+(1.0-hs)*cc*(2.0-cc)*c)+cmu*rankMu;
+		diag[i]=sqrt(c);
+	}
+
+	sigma*=exp((cs/ds)*(psLength/chiN-1.0));
+}
+
+const std::vector<double> &SepCmaEs::getMean() const
+{
+	return mean;
+}
+
+int SepCmaEs::getLambda() const
+{
+	return lambda;
+}
+
+int SepCmaEs::getGeneration() const
+{
+	return generation;
+}
+
+double SepCmaEs::getSigma() const
+{
+	return sigma;
+}
+
+}
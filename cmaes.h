@@ -0,0 +1,55 @@
+#ifndef __CMAES_H
+#define __CMAES_H
+
+#include <vector>
+
+namespace SimQuadCopter
+{
+
+//separable CMA-ES (Ros & Hansen 2008): evolution strategy with a diagonal
+//covariance matrix. gradient free and the whole population of a generation
+//can be evaluated in parallel.
+class SepCmaEs
+{
+public:
+	//sigmas: initial standard deviation of every coordinate
+	SepCmaEs(const std::vector<double> &mean, const std::vector<double> &sigmas, int lambda=0, unsigned int seed=1);
+
+	//draws a new population
+	const std::vector< std::vector<double> > &sample();
+	//costs of the last sampled population, lower is better
+	void update(const std::vector<double> &costs);
+
+	const std::vector<double> &getMean() const;
+	int getLambda() const;
+	int getGeneration() const;
+	double getSigma() const;
+
+protected:
+	double gaussian();
+
+	int n;
+	int lambda;
+	int mu;
+	std::vector<double> weights;
+	double mueff;
+	double cs,ds,cc,c1,cmu,chiN;
+
+	std::vector<double> mean;
+	std::vector<double> diag;//standard deviation of every coordinate
+	std::vector<double> ps;
+	std::vector<double> pc;
+	double sigma;
+	int generation;
+
+	std::vector< std::vector<double> > y;//steps of the last population
+	std::vector< std::vector<double> > population;
+
+	unsigned int rng;
+	bool haveSpare;
+	double spare;
+};
+
+}
+
+#endif
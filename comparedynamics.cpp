@@ -0,0 +1,135 @@
+//validates NativeCopter against OdeCopter: both backends fly the standard
+//maneuvers with the same controller and gains, then the trajectories and the
+//simulation speed are compared.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "headless.h"
+#include "parallel.h"
+
+using namespace SimQuadCopter;
+
+static double seconds()
+{
+	struct timeval tv;
+	gettimeofday(&tv,NULL);
+	return tv.tv_sec+tv.tv_usec*1e-6;
+}
+
+enum
+{
+	SampleSize=8,//time, position, orientation
+	HeaderSize=3//cost, wall time, simulated steps
+};
+
+//job i flies maneuver i/2, even jobs with ODE, odd jobs with NativeCopter
+class CompareJob: public ParallelJob
+{
+public:
+	virtual void run(int index, std::vector<float> &result)
+	{
+		std::vector<FlightSample> samples;
+		flight.backend=index%2==0 ? QuadCopter::BackendOde : QuadCopter::BackendNative;
+		flight.samples=&samples;
+
+		double start=seconds();
+		float cost=flight.fly(index/2,gains);
+		double time=seconds()-start;
+
+		result.push_back(cost);
+		result.push_back(time);
+		result.push_back((flight.warmupTime+flight.maneuverTime)/flight.dtime);
+		for(size_t i=0;i<samples.size();++i)
+		{
+			const FlightSample &s=samples[i];
+			result.push_back(s.time);
+			result.insert(result.end(),s.position,s.position+3);
+			result.insert(result.end(),s.orientation,s.orientation+4);
+		}
+	}
+
+	HeadlessFlight flight;
+	GainSet gains;
+};
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-i gains] [-j jobs]\n",name);
+	printf("  -i  fly with the gains in this file (see autotune)\n");
+	printf("  -j  parallel flights (default: number of cores)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	CompareJob job;
+	int jobs=0;
+
+	int c;
+	while((c=getopt(argc,argv,"i:j:h"))!=-1)
+	{
+		switch(c)
+		{
+		case 'i':
+			if(!job.gains.load(optarg))
+			{
+				printf("could not read gains from %s\n",optarg);
+				return 1;
+			}
+			break;
+		case 'j': jobs=atoi(optarg); break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	ParallelRunner runner(jobs);
+	std::vector< std::vector<float> > results;
+	runner.run(job,2*Maneuver::Count,results);
+
+	printf("%-16s %10s %10s %10s %10s %10s %10s %8s\n","maneuver","cost ode","native","rms pos","max pos","rms att","us/step","speedup");
+	for(int m=0;m<Maneuver::Count;++m)
+	{
+		const std::vector<float> &ode=results[2*m];
+		const std::vector<float> &native=results[2*m+1];
+		if(ode.size()<HeaderSize || native.size()<HeaderSize)
+		{
+			printf("%-16s failed\n",Maneuver::getName(m));
+			continue;
+		}
+
+		//compare the steps both flights reached
+		int count=std::min(ode.size()-HeaderSize,native.size()-HeaderSize)/SampleSize;
+		double position2=0,positionMax=0,attitude2=0;
+		for(int i=0;i<count;++i)
+		{
+			const float *a=&ode[HeaderSize+i*SampleSize];
+			const float *b=&native[HeaderSize+i*SampleSize];
+
+			Vector3 d=Vector3(a[1],a[2],a[3])-Vector3(b[1],b[2],b[3]);
+			double e=length(d);
+			position2+=e*e;
+			positionMax=std::max(positionMax,e);
+
+			//angle between the orientations
+			float dot=fabs(a[4]*b[4]+a[5]*b[5]+a[6]*b[6]+a[7]*b[7]);
+			double angle=2.0*acos(std::min(1.0f,dot));
+			attitude2+=angle*angle;
+		}
+		double rmsPosition=count ? sqrt(position2/count) : 0;
+		double rmsAttitude=count ? sqrt(attitude2/count) : 0;
+
+		double odeStep=ode[1]/ode[2];
+		double nativeStep=native[1]/native[2];
+
+		printf("%-16s %10.5f %10.5f %9.4fm %9.4fm %7.2fdeg %4.1f/%4.1f %7.1fx\n",
+			Maneuver::getName(m),ode[0],native[0],rmsPosition,positionMax,rmsAttitude*180.0/M_PI,
+			odeStep*1e6,nativeStep*1e6,odeStep/nativeStep);
+	}
+
+	return 0;
+}
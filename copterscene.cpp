@@ -0,0 +1,189 @@
+#include "copterscene.h"
+#include "meshcache.h"
+
+#include <vl/Image.hpp>
+#include <vl/Texture.hpp>
+#include <vl/GLSL.hpp>
+#include <vl/Log.hpp>
+#include <vl/quat.hpp>
+#include <vlut/Colors.hpp>
+
+namespace SimQuadCopter
+{
+
+static vl::ref<vl::Painter> addTexturedPainter(vl::Painter *parent, const char *texture)
+{
+	vl::ref<vl::Painter> painter=new vl::Painter;
+	parent->addChild(painter.get());
+	vl::ref<vl::Image> image=vl::loadImage(texture);
+	painter->shader()->textureUnit(0)->setTexture(new vl::Texture(image.get()));
+	return painter;
+}
+
+//a model that can't be loaded (LoadPLY2 reports it) is left out, the rest of the scene still renders
+static void addModel(vl::Painter *painter, const char *file, vl::Transform *transform, double yoffset)
+{
+	vl::ref<vl::Geometry> geom=MeshCache::load(file);
+	if(!geom)
+		return;
+	if(yoffset!=0)
+		geom->transform(vl::mat4d::translation(vl::vec3d(0,yoffset,0)));
+	painter->addActor(new vl::Actor(geom.get(),transform));
+}
+
+void CopterScene::init(vlut::RenderPipeline *pipeline, bool mounted)
+{
+	body=new vl::Transform;
+	pipeline->transform()->addChild(body.get());
+
+	floor=new vl::Transform;
+	if(mounted)
+		floor->setLocalMatrix(vl::mat4d::translation(vl::vec3d(0,-50,0)));
+	pipeline->transform()->addChild(floor.get());
+
+	//base painter
+	painter=new vl::Painter;
+	pipeline->shaderNode()->addChild(painter.get());
+	painter->shader()->enable(vl::EN_DEPTH_TEST);
+	painter->shader()->enable(vl::EN_LIGHTING);
+	painter->shader()->glMaterial()->setDiffuse(vlut::white);
+	painter->shader()->glMaterial()->setAmbient(vl::vec4(0.5f,0.5f,0.5f,1.0f));
+
+	//the light stays above the floor
+	light=new vl::Light;
+	painter->shader()->addLight(light.get());
+	light->followTransform(floor.get());
+	light->setPosition(vl::vec4(0,10000,0,1));
+	light->setAmbient(vl::vec4(0.3f,0.3f,0.3f,1.0f));
+
+	addModel(painter.get(),"models/i4copter-frame.ply",body.get(),0);
+
+	//all four propellers in one instanced draw call
+	for(int i=0;i<CopterDynamics::EngineCount;++i)
+	{
+		propellerTransforms[i]=new vl::Transform;
+		pipeline->transform()->addChild(propellerTransforms[i].get());
+	}
+	vl::ref<vl::Painter> propellerpainter=addTexturedPainter(painter.get(),"textures/propeller.tga");
+	vl::ref<vl::Geometry> propeller=MeshCache::load("models/i4copter-propeller1.ply");
+	if(propeller)
+	{
+		propellers=new vl::InstancedGeometry(propeller.get());
+		for(int i=0;i<CopterDynamics::EngineCount;++i)
+			propellers->addInstance(propellerTransforms[i].get());
+		propellerpainter->addActor(new vl::Actor(propellers.get()));
+	}
+
+	vl::ref<vl::Painter> boardpainter=addTexturedPainter(painter.get(),"textures/boards.tga");
+	addModel(boardpainter.get(),"models/i4copter-boards.ply",body.get(),3.5);
+
+	vl::ref<vl::Painter> batterypainter=addTexturedPainter(painter.get(),"textures/kokam.tga");
+	addModel(batterypainter.get(),"models/i4copter-battery.ply",body.get(),-3);
+
+	vl::ref<vl::Painter> floorpainter=addTexturedPainter(painter.get(),"textures/floor2.tga");
+	addModel(floorpainter.get(),"models/floor.ply",floor.get(),0);
+
+	//trails in world coordinates: a new point every 2cm, older parts within 1cm
+	trailPainter=new vl::Painter;
+	pipeline->shaderNode()->addChild(trailPainter.get());
+	trailPainter->shader()->enable(vl::EN_DEPTH_TEST);
+	trailPainter->shader()->disable(vl::EN_LIGHTING);
+	flownTrail=new vl::Trail;
+	flownTrail->setColor(vl::vec4(0.1f,0.3f,1,1));
+	commandedTrail=new vl::Trail;
+	commandedTrail->setColor(vl::vec4(1,0.5f,0,1));
+	vl::Trail *trails[]={flownTrail.get(),commandedTrail.get()};
+	for(int i=0;i<2;++i)
+	{
+		trails[i]->setMinSpacing(2);
+		trails[i]->setTolerance(1);
+		trailPainter->addActor(new vl::Actor(trails[i]));
+	}
+
+	if(!GLEW_ARB_shading_language_100)
+	{
+		vl::Log::error("GLEW_ARB_shading_language_100 not supported.\n");
+		return;
+	}
+
+	vl::ref<vl::GLSLVertexShader> vert_perpixel=new vl::GLSLVertexShader("file://shaders.glsl","vert_perpixellight");
+	vl::ref<vl::GLSLFragmentShader> frag_perpixel=new vl::GLSLFragmentShader("file://shaders.glsl","frag_perpixellight");
+	vl::ref<vl::GLSLVertexShader> vert_perpixel_texture=new vl::GLSLVertexShader("file://shaders.glsl","vert_perpixellight_texture");
+	vl::ref<vl::GLSLFragmentShader> frag_perpixel_texture=new vl::GLSLFragmentShader("file://shaders.glsl","frag_perpixellight_texture");
+
+	vl::ref<vl::GLSLProgram> glsl=painter->shader()->glslProgram();
+	glsl->attachShader(vert_perpixel.get());
+	glsl->attachShader(frag_perpixel.get());
+
+	vl::ref<vl::GLSLProgram> glsl2=floorpainter->shader()->glslProgram();
+	glsl2->attachShader(vert_perpixel_texture.get());
+	glsl2->attachShader(frag_perpixel_texture.get());
+
+	if(GLEW_EXT_draw_instanced && GLEW_EXT_gpu_shader4)
+	{
+		vl::ref<vl::GLSLVertexShader> vert_instanced=new vl::GLSLVertexShader("file://shaders.glsl","vert_perpixellight_texture_instanced");
+		vl::ref<vl::GLSLProgram> glsl3=propellerpainter->shader()->glslProgram();
+		glsl3->attachShader(vert_instanced.get());
+		glsl3->attachShader(frag_perpixel_texture.get());
+	}
+	else
+		propellerpainter->shader()->setGLSLProgram(glsl2.get());
+	batterypainter->shader()->setGLSLProgram(glsl2.get());
+	boardpainter->shader()->setGLSLProgram(glsl2.get());
+}
+
+void CopterScene::setBodyMatrix(const vl::mat4d &m)
+{
+	body->setLocalMatrix(m);
+}
+
+void CopterScene::setPropellerMatrix(int engine, const vl::mat4d &m)
+{
+	propellerTransforms[engine]->setLocalMatrix(m);
+	if(propellers)
+		propellers->setAABBDirty(true);
+}
+
+void CopterScene::setFlightSample(const FlightSample &sample, float size, float angle)
+{
+	const float *p=sample.position;
+	const float *q=sample.orientation;
+	vl::mat4d m=vl::quat(q[0],q[1],q[2],q[3]).toMatrix();
+	m.setT(vl::vec3d(p[0],p[1],p[2])*100);
+	setBodyMatrix(m);
+
+	//engines and spin directions as set up by OdeCopter, propellers 2cm above the motors
+	const double arm=size*0.5f*100;
+	const vl::vec3d engines[CopterDynamics::EngineCount]=
+	{
+		vl::vec3d(arm,2,0),vl::vec3d(-arm,2,0),vl::vec3d(0,2,arm),vl::vec3d(0,2,-arm)
+	};
+	for(int i=0;i<CopterDynamics::EngineCount;++i)
+	{
+		double spin=i<CopterDynamics::EngineZp ? angle : -angle;
+		setPropellerMatrix(i,m*vl::mat4d::translation(engines[i])*vl::mat4d::rotation(spin,0,1,0));
+	}
+}
+
+void CopterScene::addFlownPoint(const vl::vec3d &p)
+{
+	flownTrail->addPoint(vl::vec3((float)p.x(),(float)p.y(),(float)p.z()));
+}
+
+void CopterScene::addCommandedPoint(const vl::vec3d &p)
+{
+	commandedTrail->addPoint(vl::vec3((float)p.x(),(float)p.y(),(float)p.z()));
+}
+
+void CopterScene::clearTrails()
+{
+	flownTrail->clear();
+	commandedTrail->clear();
+}
+
+vl::vec3d CopterScene::followEye(const vl::mat4d &body)
+{
+	return body.getT()-body.getZ()*60+body.getY()*10;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef __COPTERSCENE_H
+#define __COPTERSCENE_H
+
+#include <vl/Transform.hpp>
+#include <vl/Painter.hpp>
+#include <vl/InstancedGeometry.hpp>
+#include <vl/Trail.hpp>
+#include <vl/Light.hpp>
+#include <vlut/RenderPipeline.hpp>
+
+#include "headless.h"
+
+namespace SimQuadCopter
+{
+
+//the copter and the floor as drawn by the viewer, shared by the viewer and
+//renderflights. the scene is in cm, ODE and the flight samples in meters.
+//models, textures and shaders are loaded relative to the working directory.
+class CopterScene
+{
+public:
+	//adds the scene to the transforms and the painters of the pipeline.
+	//mounted lowers the floor below the mount of the test stand.
+	void init(vlut::RenderPipeline *pipeline, bool mounted);
+
+	//matrices in scene units, index by CopterDynamics::EngineXp...
+	void setBodyMatrix(const vl::mat4d &m);
+	void setPropellerMatrix(int engine, const vl::mat4d &m);
+
+	//places the copter of a recorded flight. the samples don't hold the
+	//propellers, they are turned by angle degrees on their axes.
+	void setFlightSample(const FlightSample &sample, float size, float angle);
+
+	//where the viewer follows the copter from
+	static vl::vec3d followEye(const vl::mat4d &body);
+
+	//paths in scene units, the commanded one is the setpoint of the controller
+	void addFlownPoint(const vl::vec3d &p);
+	void addCommandedPoint(const vl::vec3d &p);
+	void clearTrails();
+
+	vl::ref<vl::Transform> body;
+	vl::ref<vl::Transform> propellerTransforms[CopterDynamics::EngineCount];
+	vl::ref<vl::Transform> floor;
+	vl::ref<vl::InstancedGeometry> propellers;
+	vl::ref<vl::Painter> painter;//root of the scene painters
+	vl::ref<vl::Light> light;
+	//unlit, not part of painter so the onboard camera doesn't see them
+	vl::ref<vl::Painter> trailPainter;
+	vl::ref<vl::Trail> flownTrail;
+	vl::ref<vl::Trail> commandedTrail;
+};
+
+}
+
+#endif
@@ -4,6 +4,8 @@
 //#include "Axis.h"
 #include "flightcontrol.h"
 
+#include <vl/Trace.hpp>
+
 using namespace SimQuadCopter;
 
 //#define CONTROLTASK_PERIOD_SEC 0.018
@@ -21,6 +23,7 @@ void flightcontrol_init()
 // this code is normaly called in a loop in the original I4Copter code. thats not possible on the simulator.
 void flightcontrol_update(const SimQuadCopter::Control &control, SimQuadCopter::QuadCopter &copter)
 {
+	vl::TraceZone zone("flightcontrol_update","control");
         //while(1){
                 //receive Data
                 //i4cos_msg_recv( &port, &data, (size_t)16, O_NONBLOCK );
@@ -0,0 +1,202 @@
+#include "framering.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace SimQuadCopter
+{
+
+static const char frameRingMagic[8]="SQCCAM";
+
+enum
+{
+	FrameRingAlignment=64//slots and pixels start on their own cache lines
+};
+
+static unsigned int alignUp(unsigned int size)
+{
+	return (size+FrameRingAlignment-1)&~(FrameRingAlignment-1);
+}
+
+FrameRing::FrameRing()
+{
+	header=0;
+	mappedSize=0;
+	name[0]=0;
+	owner=false;
+}
+
+FrameRing::~FrameRing()
+{
+	close();
+}
+
+bool FrameRing::create(const char *ringname, int width, int height, int slots, float fov, float rate)
+{
+	close();
+	if(width<=0 || height<=0 || slots<2)
+		return false;
+
+	unsigned int stride=width*4;
+	unsigned int pixelOffset=alignUp(sizeof(FrameSlotHeader));
+	unsigned int slotSize=alignUp(pixelOffset+stride*height);
+	unsigned long long size=alignUp(sizeof(FrameRingHeader))+(unsigned long long)slotSize*slots;
+
+	//a new object, readers of an old ring keep their mapping of the old one
+	shm_unlink(ringname);
+	int fd=shm_open(ringname,O_RDWR|O_CREAT|O_EXCL,0644);
+	if(fd<0)
+	{
+		perror("shm_open");
+		return false;
+	}
+	if(ftruncate(fd,size)!=0)
+	{
+		perror("ftruncate");
+		::close(fd);
+		shm_unlink(ringname);
+		return false;
+	}
+	void *p=mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	::close(fd);
+	if(p==MAP_FAILED)
+	{
+		perror("mmap");
+		shm_unlink(ringname);
+		return false;
+	}
+
+	//the pages come zeroed, so every slot sequence starts at 0 (nothing published)
+	header=(FrameRingHeader*)p;
+	mappedSize=size;
+	snprintf(name,sizeof(name),"%s",ringname);
+	owner=true;
+
+	header->version=FrameRingVersion;
+	header->format=FrameFormatBGRA;
+	header->width=width;
+	header->height=height;
+	header->stride=stride;
+	header->slotCount=slots;
+	header->slotSize=slotSize;
+	header->pixelOffset=pixelOffset;
+	header->fov=fov;
+	header->rate=rate;
+	header->published=0;
+	//the magic last, a reader mapping the ring right now sees a complete header or none
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(header->magic,frameRingMagic,sizeof(header->magic));
+	return true;
+}
+
+bool FrameRing::open(const char *ringname)
+{
+	close();
+
+	int fd=shm_open(ringname,O_RDONLY,0);
+	if(fd<0)
+		return false;
+	struct stat st;
+	if(fstat(fd,&st)!=0 || st.st_size<(off_t)sizeof(FrameRingHeader))
+	{
+		::close(fd);
+		return false;
+	}
+	void *p=mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+	::close(fd);
+	if(p==MAP_FAILED)
+		return false;
+
+	const FrameRingHeader *h=(const FrameRingHeader*)p;
+	if(memcmp(h->magic,frameRingMagic,sizeof(h->magic))!=0 || h->version!=FrameRingVersion ||
+		alignUp(sizeof(FrameRingHeader))+(unsigned long long)h->slotSize*h->slotCount>(unsigned long long)st.st_size)
+	{
+		munmap(p,st.st_size);
+		return false;
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	header=(FrameRingHeader*)p;
+	mappedSize=st.st_size;
+	snprintf(name,sizeof(name),"%s",ringname);
+	owner=false;
+	return true;
+}
+
+void FrameRing::close()
+{
+	if(!header)
+		return;
+	munmap(header,mappedSize);
+	if(owner)
+		shm_unlink(name);
+	header=0;
+	mappedSize=0;
+	owner=false;
+}
+
+FrameSlotHeader *FrameRing::slotAt(unsigned long long frame) const
+{
+	char *slots=(char*)header+alignUp(sizeof(FrameRingHeader));
+	return (FrameSlotHeader*)(slots+(frame%header->slotCount)*header->slotSize);
+}
+
+FrameSlotHeader *FrameRing::beginFrame()
+{
+	unsigned long long frame=header->published;
+	FrameSlotHeader *slot=slotAt(frame);
+	//seqlock: odd while written, the pixels are stored after the mark
+	__atomic_store_n(&slot->sequence,2*frame+1,__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	slot->frame=frame;
+	return slot;
+}
+
+void FrameRing::publish(FrameSlotHeader *slot)
+{
+	__atomic_store_n(&slot->sequence,2*(slot->frame+1),__ATOMIC_RELEASE);
+	__atomic_store_n(&header->published,slot->frame+1,__ATOMIC_RELEASE);
+}
+
+long long FrameRing::latest() const
+{
+	return (long long)__atomic_load_n(&header->published,__ATOMIC_ACQUIRE)-1;
+}
+
+long long FrameRing::waitNewer(long long frame, int timeout) const
+{
+	//the simulator publishes at a few dozen Hz, polling costs nothing there
+	for(int waited=0;;waited++)
+	{
+		long long last=latest();
+		if(last>frame)
+			return last;
+		if(waited>=timeout)
+			return -1;
+		usleep(1000);
+	}
+}
+
+const FrameSlotHeader *FrameRing::getSlot(long long frame) const
+{
+	if(frame<0)
+		return NULL;
+	const FrameSlotHeader *slot=slotAt(frame);
+	//acquire: the pixels are read after this check
+	if(__atomic_load_n(&slot->sequence,__ATOMIC_ACQUIRE)!=2*(unsigned long long)(frame+1))
+		return NULL;
+	return slot;
+}
+
+bool FrameRing::valid(const FrameSlotHeader *slot, long long frame) const
+{
+	//orders the reads of the pixels before the check
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&slot->sequence,__ATOMIC_RELAXED)==2*(unsigned long long)(frame+1);
+}
+
+}
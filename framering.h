@@ -0,0 +1,106 @@
+#ifndef __FRAMERING_H
+#define __FRAMERING_H
+
+namespace SimQuadCopter
+{
+
+//camera frames in POSIX shared memory, published by the simulator
+//(OnboardCamera) and mapped read-only by any number of local readers.
+//
+//the memory (/dev/shm/<name>) is a FrameRingHeader followed by slotCount
+//slots of slotSize bytes, each one a FrameSlotHeader and the pixels at
+//pixelOffset. frame n goes to slot n%slotCount. readers work on the pixels
+//in place: every slot has a sequence counter which is odd while the slot
+//is written, a reader checks it before and after using the slot and
+//throws away what it computed if the frame got overwritten meanwhile
+//(see FrameRing::valid). with 8 slots at 30Hz a reader has more than
+//200ms per frame before that happens.
+//
+//pixels are BGRA, 8 bits per channel, the first row is the top of the
+//image. the pose is the one of the OpenGL camera in the world frame of the
+//simulation (y up, meters): the camera looks down its -z axis, x points
+//right and y up in the image.
+
+enum
+{
+	FrameRingVersion=1,
+	FrameFormatBGRA=1
+};
+
+struct FrameRingHeader
+{
+	char magic[8];              //"SQCCAM"
+	unsigned int version;       //FrameRingVersion
+	unsigned int format;        //FrameFormatBGRA
+	unsigned int width;
+	unsigned int height;
+	unsigned int stride;        //bytes per row
+	unsigned int slotCount;
+	unsigned int slotSize;      //bytes from one slot to the next
+	unsigned int pixelOffset;   //from the start of a slot to its pixels
+	float fov;                  //vertical field of view in degrees
+	float rate;                 //frames per second of simulation time
+	unsigned long long published;//frames published so far, the last one is published-1
+};
+
+struct FrameSlotHeader
+{
+	unsigned long long sequence;//odd while written, 2*(frame+1) once frame is published
+	unsigned long long frame;
+	double time;                //simulation time of the frame in seconds
+	float position[3];          //of the camera, meters
+	float orientation[4];       //of the camera, x,y,z,w
+};
+
+class FrameRing
+{
+public:
+	FrameRing();
+	~FrameRing();
+
+	//simulator side: creates the ring, replacing an old one of the same name.
+	//name is a shm_open() name like "/simquadcopter-camera"
+	bool create(const char *name, int width, int height, int slots, float fov, float rate);
+
+	//reader side: maps an existing ring read-only
+	bool open(const char *name);
+
+	//unmaps the ring, the creator also removes the name
+	void close();
+
+	bool isOpen() const { return header!=0; }
+	const FrameRingHeader *getHeader() const { return header; }
+
+	//writer: the slot of the next frame, marked as being written. fill in
+	//time, pose and pixels, then publish it.
+	FrameSlotHeader *beginFrame();
+	void publish(FrameSlotHeader *slot);
+
+	//reader: number of the newest frame, -1 if none was published yet
+	long long latest() const;
+
+	//reader: waits up to timeout milliseconds for a frame newer than frame.
+	//returns the newest frame, or -1 on timeout
+	long long waitNewer(long long frame, int timeout) const;
+
+	//reader: the slot of frame, NULL if it is not in the ring (anymore)
+	const FrameSlotHeader *getSlot(long long frame) const;
+
+	//true while the slot still holds frame. check it after using the pixels
+	bool valid(const FrameSlotHeader *slot, long long frame) const;
+
+	unsigned char *getPixels(FrameSlotHeader *slot) const { return (unsigned char*)slot+header->pixelOffset; }
+	const unsigned char *getPixels(const FrameSlotHeader *slot) const { return (const unsigned char*)slot+header->pixelOffset; }
+
+protected:
+	FrameSlotHeader *slotAt(unsigned long long frame) const;
+
+	FrameRingHeader *header;
+	unsigned long long mappedSize;
+	char name[256];
+	bool owner;
+};
+
+}
+
+#endif
@@ -11,7 +11,7 @@ SimActuator::SimActuator()
 	engine = NULL;
 }
 
-void SimActuator::init(OdeEngine *engine)
+void SimActuator::init(Engine *engine)
 {
 	this->engine=engine;
 }
@@ -9,11 +9,11 @@ namespace SimQuadCopter
 class SimActuator
 {
 private:
-	OdeEngine *engine;
+	Engine *engine;
 	
 public:
 	SimActuator();
-	void init(OdeEngine *engine);
+	void init(Engine *engine);
 
 	void setVoltage(float voltage);
 
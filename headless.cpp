@@ -0,0 +1,225 @@
+#include "headless.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+namespace SimQuadCopter
+{
+
+static const char *gainNames[GainSet::Count]=
+{
+	"balanceX.Kp","balanceX.Ki","balanceX.Kd",
+	"balanceZ.Kp","balanceZ.Ki","balanceZ.Kd",
+	"balanceY.Kp","balanceY.Ki","balanceY.Kd"
+};
+
+GainSet::GainSet()
+{
+	Balance balance;
+	BalanceHeight height;
+
+	values[BalanceXKp]=values[BalanceZKp]=balance.Kp;
+	values[BalanceXKi]=values[BalanceZKi]=balance.Ki;
+	values[BalanceXKd]=values[BalanceZKd]=balance.Kd;
+	values[BalanceYKp]=height.Kp;
+	values[BalanceYKi]=height.Ki;
+	values[BalanceYKd]=height.Kd;
+}
+
+const char *GainSet::getName(int index)
+{
+	return gainNames[index];
+}
+
+void GainSet::apply(QuadCopter &copter) const
+{
+	copter.balanceX.Kp=values[BalanceXKp];
+	copter.balanceX.Ki=values[BalanceXKi];
+	copter.balanceX.Kd=values[BalanceXKd];
+	copter.balanceZ.Kp=values[BalanceZKp];
+	copter.balanceZ.Ki=values[BalanceZKi];
+	copter.balanceZ.Kd=values[BalanceZKd];
+	copter.balanceY.Kp=values[BalanceYKp];
+	copter.balanceY.Ki=values[BalanceYKi];
+	copter.balanceY.Kd=values[BalanceYKd];
+}
+
+//format: one "name value" pair per line, '#' starts a comment
+bool GainSet::load(const char *filename)
+{
+	FILE *f=fopen(filename,"r");
+	if(!f)
+		return false;
+
+	char line[256];
+	while(fgets(line,sizeof(line),f))
+	{
+		char name[64];
+		float value;
+		if(line[0]=='#' || sscanf(line,"%63s %f",name,&value)!=2)
+			continue;
+		for(int i=0;i<Count;++i)
+			if(strcmp(name,gainNames[i])==0)
+				values[i]=value;
+	}
+	fclose(f);
+	return true;
+}
+
+void GainSet::write(FILE *f) const
+{
+	for(int i=0;i<Count;++i)
+		fprintf(f,"%s %g\n",gainNames[i],values[i]);
+}
+
+static const char *maneuverNames[Maneuver::Count]=
+{
+	"step-roll","step-pitch","hover-hold","gust-rejection"
+};
+
+const char *Maneuver::getName(int type)
+{
+	return maneuverNames[type];
+}
+
+void Maneuver::setup(int type, float t, QuadCopter &copter)
+{
+	//rate steps: half a second one way, half a second back to level
+	const float rate=0.5f;
+	float step=0.0f;
+	if(t>=1.0f && t<1.5f)
+		step=rate;
+	else if(t>=1.5f && t<2.0f)
+		step=-rate;
+
+	copter.control.roll=0;
+	copter.control.pitch=0;
+	copter.control.yaw=0;
+	copter.dynamics->externalForce=Vector3(0,0,0);
+
+	switch(type)
+	{
+	case StepRoll:
+		copter.control.roll=step;
+		break;
+	case StepPitch:
+		copter.control.pitch=step;
+		break;
+	case HoverHold:
+		break;
+	case GustRejection:
+		if(t>=1.0f && t<2.0f)
+			copter.dynamics->externalForce=Vector3(1.5f,0,0.8f);
+		break;
+	}
+}
+
+bool loadFlightLog(const char *filename, std::vector<FlightSample> &samples)
+{
+	FILE *f=fopen(filename,"r");
+	if(!f)
+		return false;
+
+	char line[256];
+	while(fgets(line,sizeof(line),f))
+	{
+		FlightSample s;
+		float *p=s.position;
+		float *q=s.orientation;
+		if(line[0]=='#' || sscanf(line,"%f %f %f %f %f %f %f %f",&s.time,&p[0],&p[1],&p[2],&q[0],&q[1],&q[2],&q[3])!=8)
+			continue;
+		samples.push_back(s);
+	}
+	fclose(f);
+	return true;
+}
+
+void writeFlightLog(FILE *f, const std::vector<FlightSample> &samples)
+{
+	for(size_t i=0;i<samples.size();++i)
+	{
+		const FlightSample &s=samples[i];
+		const float *p=s.position;
+		const float *q=s.orientation;
+		fprintf(f,"%g %g %g %g %g %g %g %g\n",s.time,p[0],p[1],p[2],q[0],q[1],q[2],q[3]);
+	}
+}
+
+HeadlessFlight::HeadlessFlight()
+{
+	dtime=0.005f;
+	warmupTime=4.0f;
+	maneuverTime=6.0f;
+	hoverAltitude=1.0f;
+	crashPenalty=1000.0f;
+	seed=1;
+	backend=QuadCopter::BackendOde;
+	samples=NULL;
+}
+
+float HeadlessFlight::fly(int maneuver, const GainSet &gains)
+{
+	//same noise and motor variance for every candidate
+	srand(seed);
+
+	QuadCopter copter(0.51f,backend);
+	copter.controlMode=QuadCopter::ControlBalance;
+	copter.holdHeight=true;
+	copter.control.throttle=hoverAltitude*0.1f;
+	gains.apply(copter);
+
+	float cost=0;
+	float t=-warmupTime;
+	float end=maneuverTime;
+	while(t<end)
+	{
+		if(t>=0)
+			Maneuver::setup(maneuver,t,copter);
+
+		copter.update(dtime);
+		t+=dtime;
+
+		float rx,rz;
+		copter.dynamics->calcRealAngles(rx,rz);
+		float altitude=copter.dynamics->getPosition().getY();
+
+		//upside down or back on the ground
+		if(fabs(rx)>1.2f || fabs(rz)>1.2f || (t>0 && altitude<0.1f))
+			return crashPenalty+(end-t);
+
+		if(t<0)
+			continue;
+
+		if(samples)
+		{
+			FlightSample sample;
+			Vector3 p=copter.dynamics->getPosition();
+			Quat q=copter.dynamics->getOrientation();
+			sample.time=t;
+			for(int i=0;i<3;++i)
+				sample.position[i]=p[i];
+			for(int i=0;i<4;++i)
+				sample.orientation[i]=q[i];
+			samples->push_back(sample);
+		}
+
+		float eRoll=-copter.gyroZ.getValue()-copter.control.roll;
+		float ePitch=-copter.gyroX.getValue()-copter.control.pitch;
+		float eAltitude=altitude-hoverAltitude;
+		float e=eRoll*eRoll+ePitch*ePitch+4.0f*eAltitude*eAltitude;
+
+		//rate steps leave the copter tilted, only rate the attitude when it should be level
+		if(maneuver==Maneuver::HoverHold || maneuver==Maneuver::GustRejection)
+			e+=rx*rx+rz*rz;
+
+		if(!(e==e))//NaN, the simulation exploded
+			return crashPenalty+(end-t);
+
+		cost+=e*dtime;
+	}
+
+	return cost/maneuverTime;
+}
+
+}
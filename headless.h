@@ -0,0 +1,92 @@
+#ifndef __HEADLESS_H
+#define __HEADLESS_H
+
+#include <stdio.h>
+#include <vector>
+
+#include "quadcopter.h"
+
+namespace SimQuadCopter
+{
+
+//gains of the old balancer (QuadCopter::ControlBalance)
+class GainSet
+{
+public:
+	enum
+	{
+		BalanceXKp,BalanceXKi,BalanceXKd,
+		BalanceZKp,BalanceZKi,BalanceZKd,
+		BalanceYKp,BalanceYKi,BalanceYKd,
+		Count
+	};
+
+	//defaults of Balance and BalanceHeight
+	GainSet();
+
+	void apply(QuadCopter &copter) const;
+
+	bool load(const char *filename);
+	void write(FILE *f) const;
+
+	static const char *getName(int index);
+
+	float values[Count];
+};
+
+//standard maneuvers flown by headless simulations
+class Maneuver
+{
+public:
+	enum Type
+	{
+		StepRoll,
+		StepPitch,
+		HoverHold,
+		GustRejection,
+		Count
+	};
+
+	static const char *getName(int type);
+
+	//set the control inputs and disturbances at time t (after warm up)
+	static void setup(int type, float t, QuadCopter &copter);
+};
+
+//state of the copter at one simulation step
+struct FlightSample
+{
+	float time;
+	float position[3];
+	float orientation[4];//x,y,z,w
+};
+
+//flight logs: one "time x y z qx qy qz qw" line per sample, '#' starts a comment
+bool loadFlightLog(const char *filename, std::vector<FlightSample> &samples);
+void writeFlightLog(FILE *f, const std::vector<FlightSample> &samples);
+
+//flies a maneuver without visualization and network and rates the flight.
+//the copter lives in the global ODE world, so fly only once per process (see ParallelRunner).
+class HeadlessFlight
+{
+public:
+	HeadlessFlight();
+
+	//returns the cost of the flight, lower is better
+	float fly(int maneuver, const GainSet &gains);
+
+	float dtime;//simulation step
+	float warmupTime;//take off and settle, not rated
+	float maneuverTime;//rated part of the flight
+	float hoverAltitude;
+	float crashPenalty;
+	unsigned int seed;//for sensor noise and motor variance
+	QuadCopter::Backend backend;
+
+	//if not NULL fly() records every step of the rated part here
+	std::vector<FlightSample> *samples;
+};
+
+}
+
+#endif
@@ -0,0 +1,351 @@
+//finds the hover trim of the copter and computes a linear state space model
+//of the OdeCopter dynamics by central finite differences.
+//
+//the copter is trimmed once, then every perturbation run is a forked copy of
+//that snapshot which perturbs one state or input and simulates a single step.
+//
+//states (20): position x y z [m], velocity [m/s] (world), attitude [rad]
+//(small rotation vector relative to the trim, world), angular velocity [rad/s]
+//(body), rotor speed [RPM] and the rotor speed filter of the motor controllers
+//[RPM/step] for the engines Xp Xm Zp Zm.
+//inputs (4): throttle of the engines Xp Xm Zp Zm.
+//
+//the result is written as an octave/matlab script with the continuous (A, B)
+//and the discrete (Ad, Bd, sample time h) model.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "quadcopter.h"
+#include "parallel.h"
+
+using namespace SimQuadCopter;
+
+enum
+{
+	StateCount=20,
+	InputCount=4,
+	EngineCount=4
+};
+
+static const char *stateNames[StateCount]=
+{
+	"x","y","z","vx","vy","vz","ax","ay","az","p","q","r",
+	"rpmXp","rpmXm","rpmZp","rpmZm","accXp","accXm","accZp","accZm"
+};
+
+static const char *inputNames[InputCount]=
+{
+	"throttleXp","throttleXm","throttleZp","throttleZm"
+};
+
+//perturbation of every state
+static const float stateDelta[StateCount]=
+{
+	0.01f,0.01f,0.01f,//position
+	0.01f,0.01f,0.01f,//velocity
+	0.01f,0.01f,0.01f,//attitude
+	0.01f,0.01f,0.01f,//angular velocity
+	//small enough to stay in the linear range of the motor controller model
+	0.1f,0.1f,0.1f,0.1f,//rotor speed
+	0.01f,0.01f,0.01f,0.01f//rotor speed filter
+};
+
+static OdeEngine *getEngine(OdeCopter &ode, int i)
+{
+	OdeEngine *engines[EngineCount]={&ode.engineXp,&ode.engineXm,&ode.engineZp,&ode.engineZm};
+	return engines[i];
+}
+
+static Vector3 getAngularVel(OdeCopter &ode)
+{
+	const dReal *w=dBodyGetAngularVel(ode.body);
+	return Vector3(w[0],w[1],w[2]);
+}
+
+static void readState(OdeCopter &ode, const Quat &trim, float *x)
+{
+	Vector3 position=ode.getPosition();
+	Vector3 speed=ode.getSpeedVector();
+
+	//rotation vector of the attitude relative to the trim
+	Quat q=ode.getOrientation();
+	Quat e=q*conj(trim);
+	if(e.getW()<0)
+		e=-e;
+	Vector3 v=e.getXYZ();
+	float s=length(v);
+	Vector3 attitude=s>1e-9f ? v*(2.0f*atan2f(s,e.getW())/s) : v*2.0f;
+
+	Vector3 rates=rotate(conj(q),getAngularVel(ode));
+
+	for(int i=0;i<3;++i)
+	{
+		x[i]=position[i];
+		x[3+i]=speed[i];
+		x[6+i]=attitude[i];
+		x[9+i]=rates[i];
+	}
+	for(int i=0;i<EngineCount;++i)
+	{
+		x[12+i]=getEngine(ode,i)->getRPM();
+		x[16+i]=getEngine(ode,i)->getAcceleration();
+	}
+}
+
+//level, not moving, at position. the propellers keep spinning.
+static void holdPose(OdeCopter &ode, const Vector3 &position)
+{
+	Quat r=conj(ode.getOrientation());
+	ode.moveRigid(position-ode.getPosition(),r,-rotate(r,ode.getSpeedVector()),-rotate(r,getAngularVel(ode)));
+}
+
+//hover trim: every rotor delivers a quarter of the weight. the throttle of the
+//motor controllers has 256 steps, so the trim is only as good as that.
+static void trim(OdeCopter &ode, const Vector3 &position, float dtime)
+{
+	float weight=ode.getMass()*9.81f;
+
+	float low=0,high=20000;
+	for(int i=0;i<50;++i)
+	{
+		float rpm=0.5f*(low+high);
+		if(4.0f*OdeEngine::forceAtRPM(rpm)<weight)
+			low=rpm;
+		else
+			high=rpm;
+	}
+	float rpm=0.5f*(low+high);
+
+	for(int i=0;i<EngineCount;++i)
+	{
+		OdeEngine *engine=getEngine(ode,i);
+		int step=(int)(rpm/engine->getMaxRPM()*255.0f+0.5f);
+		engine->setThrottle((step+0.5f)/255.0f);
+	}
+
+	//hold the copter in place until the rotors run at constant speed
+	holdPose(ode,position);
+	for(float t=0;t<30.0f;t+=dtime)
+	{
+		ode.recomputeForces();
+		ode.update(dtime);
+		holdPose(ode,position);
+
+		bool settled=t>2.0f;
+		for(int i=0;i<EngineCount;++i)
+		{
+			OdeEngine *engine=getEngine(ode,i);
+			if(engine->getAcceleration()!=0.0f || engine->getRPM()!=engine->getThrottle()*engine->getMaxRPM())
+				settled=false;
+		}
+		if(settled)
+			break;
+	}
+	ode.recomputeForces();
+
+	printf("trim: mass %.3fkg, thrust per rotor %.3fN at %.1fRPM\n",ode.getMass(),weight*0.25f,rpm);
+}
+
+//job 0: nominal step, then two jobs (+/-) for every state and every input.
+//result: state after one step followed by the applied perturbation
+class PerturbationJob: public ParallelJob
+{
+public:
+	PerturbationJob(QuadCopter &copter, float dtime): copter(copter), dtime(dtime) {}
+
+	virtual void run(int index, std::vector<float> &result)
+	{
+		OdeCopter &ode=*copter.physics;
+		Quat trim=ode.getOrientation();
+		float delta=0;
+
+		if(index>0)
+		{
+			int k=(index-1)/2;
+			float sign=(index-1)%2==0 ? 1.0f : -1.0f;
+
+			if(k<StateCount)
+			{
+				delta=sign*stateDelta[k];
+				Vector3 axis(0,0,0);
+				axis.setElem(k%3,1.0f);
+				Vector3 zero(0,0,0);
+				Quat none=Quat::identity();
+
+				if(k<3)
+					ode.moveRigid(axis*delta,none,zero,zero);
+				else if(k<6)
+					ode.moveRigid(zero,none,axis*delta,zero);
+				else if(k<9)
+					ode.moveRigid(zero,Quat::rotation(delta,axis),zero,zero);
+				else if(k<12)
+					ode.moveRigid(zero,none,zero,rotate(trim,axis*delta));
+				else if(k<16)
+					getEngine(ode,k-12)->setRPM(getEngine(ode,k-12)->getRPM()+delta);
+				else
+					getEngine(ode,k-16)->setAcceleration(getEngine(ode,k-16)->getAcceleration()+delta);
+			}
+			else
+			{
+				//one step of the motor controller
+				OdeEngine *engine=getEngine(ode,k-StateCount);
+				float throttle=engine->getThrottle();
+				int step=(int)(throttle*255.0f+0.5f);
+				engine->setThrottle((step+sign+0.5f)/255.0f);
+				delta=engine->getThrottle()-throttle;
+			}
+			ode.recomputeForces();
+		}
+
+		ode.update(dtime);
+
+		result.resize(StateCount+1);
+		readState(ode,trim,&result[0]);
+		result[StateCount]=delta;
+	}
+
+	QuadCopter &copter;
+	float dtime;
+};
+
+static void writeMatrix(FILE *f, const char *name, const std::vector<double> &m, int rows, int cols)
+{
+	fprintf(f,"%s = [\n",name);
+	for(int r=0;r<rows;++r)
+	{
+		for(int c=0;c<cols;++c)
+			fprintf(f," % .8e",m[r*cols+c]);
+		fprintf(f,";\n");
+	}
+	fprintf(f,"];\n");
+}
+
+static void writeNames(FILE *f, const char *name, const char **names, int count)
+{
+	fprintf(f,"%s = {",name);
+	for(int i=0;i<count;++i)
+		fprintf(f,"%s'%s'",i ? ", " : "",names[i]);
+	fprintf(f,"};\n");
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-a altitude] [-t step] [-s seed] [-j jobs] [-o file]\n",name);
+	printf("  -a  trim altitude in m (default 2)\n");
+	printf("  -t  simulation step in s (default 0.005)\n");
+	printf("  -s  random seed of the airframe (motor variance)\n");
+	printf("  -j  parallel runs (default: number of cores)\n");
+	printf("  -o  output file (default linearization.m)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	float altitude=2.0f;
+	float dtime=0.005f;
+	unsigned int seed=1;
+	int jobs=0;
+	const char *output="linearization.m";
+
+	int c;
+	while((c=getopt(argc,argv,"a:t:s:j:o:h"))!=-1)
+	{
+		switch(c)
+		{
+		case 'a': altitude=atof(optarg); break;
+		case 't': dtime=atof(optarg); break;
+		case 's': seed=atoi(optarg); break;
+		case 'j': jobs=atoi(optarg); break;
+		case 'o': output=optarg; break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	srand(seed);
+	QuadCopter copter(0.51f);
+	copter.controlMode=QuadCopter::ControlDirect;
+	OdeCopter &ode=*copter.physics;
+
+	trim(ode,Vector3(0,altitude,0),dtime);
+
+	float x0[StateCount];
+	readState(ode,ode.getOrientation(),x0);
+	float u0[InputCount];
+	for(int i=0;i<InputCount;++i)
+		u0[i]=getEngine(ode,i)->getThrottle();
+
+	ParallelRunner runner(jobs);
+	PerturbationJob job(copter,dtime);
+	std::vector< std::vector<float> > results;
+	int count=1+2*(StateCount+InputCount);
+	printf("%d perturbation runs on %d cores\n",count,runner.getWorkers());
+	runner.run(job,count,results);
+
+	for(int i=0;i<count;++i)
+		if(results[i].size()!=StateCount+1)
+		{
+			printf("perturbation run %d failed\n",i);
+			return 1;
+		}
+
+	//discrete model: x[k+1] = Ad x[k] + Bd u[k], continuous: A=(Ad-I)/h, B=Bd/h
+	std::vector<double> Ad(StateCount*StateCount),Bd(StateCount*InputCount);
+	std::vector<double> A(StateCount*StateCount),B(StateCount*InputCount);
+	for(int k=0;k<StateCount+InputCount;++k)
+	{
+		const std::vector<float> &plus=results[1+2*k];
+		const std::vector<float> &minus=results[2+2*k];
+		double delta=plus[StateCount]-minus[StateCount];
+
+		for(int r=0;r<StateCount;++r)
+		{
+			double d=(plus[r]-minus[r])/delta;
+			if(k<StateCount)
+			{
+				Ad[r*StateCount+k]=d;
+				A[r*StateCount+k]=(d-(r==k ? 1.0 : 0.0))/dtime;
+			}
+			else
+			{
+				Bd[r*InputCount+k-StateCount]=d;
+				B[r*InputCount+k-StateCount]=d/dtime;
+			}
+		}
+	}
+
+	//how far the trim is from an equilibrium
+	std::vector<double> residual(StateCount);
+	for(int r=0;r<StateCount;++r)
+		residual[r]=(results[0][r]-x0[r])/dtime;
+
+	FILE *f=fopen(output,"w");
+	if(!f)
+	{
+		printf("could not write %s\n",output);
+		return 1;
+	}
+	fprintf(f,"%% simquadcopter linearization around hover trim, altitude %gm, seed %u\n",altitude,seed);
+	fprintf(f,"%% x' = A (x-x0) + B (u-u0) + residual\n");
+	writeNames(f,"states",stateNames,StateCount);
+	writeNames(f,"inputs",inputNames,InputCount);
+	fprintf(f,"h = %g;\n",dtime);
+	std::vector<double> x(x0,x0+StateCount),u(u0,u0+InputCount);
+	writeMatrix(f,"x0",x,StateCount,1);
+	writeMatrix(f,"u0",u,InputCount,1);
+	writeMatrix(f,"residual",residual,StateCount,1);
+	writeMatrix(f,"A",A,StateCount,StateCount);
+	writeMatrix(f,"B",B,StateCount,InputCount);
+	writeMatrix(f,"Ad",Ad,StateCount,StateCount);
+	writeMatrix(f,"Bd",Bd,StateCount,InputCount);
+	fclose(f);
+
+	printf("trim residual: vertical acceleration %.4fm/s^2, angular acceleration %.4f %.4f %.4frad/s^2\n",
+		residual[4],residual[9],residual[10],residual[11]);
+	printf("linear model written to %s\n",output);
+
+	return 0;
+}
@@ -0,0 +1,303 @@
+#include "meshcache.h"
+#include "LoadPLY2.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <vl/Log.hpp>
+#include <vl/Say.hpp>
+
+namespace vl
+{
+	void MD5(const void *data, unsigned int len, unsigned char sum[33]);
+}
+
+namespace SimQuadCopter
+{
+
+enum
+{
+	MeshCacheVersion=2,
+	MeshCacheByteOrder=0x01020304,
+	MeshCacheAlignment=16
+};
+
+struct MeshCacheHeader
+{
+	char magic[8];               //"SQCMESH"
+	unsigned int version;
+	unsigned int byteOrder;      //MeshCacheByteOrder as written by the host
+	char sourceMD5[40];          //of the PLY file, zero terminated
+	//size and modification time of the PLY file, the file is hashed only when they change
+	unsigned long long sourceSize;
+	long long sourceMTime;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	//offsets of the blocks from the start of the file, 0 if a block is absent
+	unsigned int positionOffset; //vertexCount vl::vec3
+	unsigned int normalOffset;   //vertexCount vl::vec3
+	unsigned int texCoordOffset; //vertexCount vl::vec2
+	unsigned int indexOffset;    //indexCount GLuint, triangles
+	unsigned int fileSize;
+};
+
+static const char MeshCacheMagic[8]="SQCMESH";
+
+//maps a whole file read only, returns NULL on errors
+static const char *mapFile(const std::string &file, size_t &size)
+{
+	int fd=open(file.c_str(),O_RDONLY);
+	if(fd<0)
+		return NULL;
+	struct stat st;
+	void *data=MAP_FAILED;
+	if(fstat(fd,&st)==0 && st.st_size>0)
+	{
+		size=st.st_size;
+		data=mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+	}
+	close(fd);
+	return data==MAP_FAILED ? NULL : (const char*)data;
+}
+
+static void unmapFile(const char *data, size_t size)
+{
+	munmap((void*)data,size);
+}
+
+std::string MeshCache::cacheFile(const std::string &plyfile)
+{
+	return plyfile+".mesh";
+}
+
+bool MeshCache::stampFile(const std::string &file, unsigned long long &size, long long &mtime)
+{
+	struct stat st;
+	if(stat(file.c_str(),&st)!=0)
+		return false;
+	size=st.st_size;
+	mtime=st.st_mtime;
+	return true;
+}
+
+bool MeshCache::hashFile(const std::string &file, std::string &md5)
+{
+	size_t size=0;
+	const char *data=mapFile(file,size);
+	if(!data)
+		return false;
+	unsigned char sum[33];
+	vl::MD5(data,(unsigned int)size,sum);
+	unmapFile(data,size);
+	md5=(const char*)sum;
+	return true;
+}
+
+vl::ref<vl::Geometry> MeshCache::read(const std::string &cachefile, const std::string &plyfile)
+{
+	size_t size=0;
+	const char *data=mapFile(cachefile,size);
+	if(!data)
+		return NULL;
+
+	MeshCacheHeader h;
+	memset(&h,0,sizeof(h));
+	bool valid=size>=sizeof(h);
+	if(valid)
+	{
+		memcpy(&h,data,sizeof(h));
+		valid=memcmp(h.magic,MeshCacheMagic,sizeof(h.magic))==0 && h.version==MeshCacheVersion &&
+			h.byteOrder==MeshCacheByteOrder && h.fileSize==size;
+	}
+	//every block has to be inside the file
+	size_t vertexBytes=(size_t)h.vertexCount*sizeof(vl::vec3);
+	size_t texCoordBytes=(size_t)h.vertexCount*sizeof(vl::vec2);
+	size_t indexBytes=(size_t)h.indexCount*sizeof(GLuint);
+	if(valid)
+		valid=h.positionOffset && h.positionOffset+vertexBytes<=size &&
+			h.normalOffset && h.normalOffset+vertexBytes<=size &&
+			(!h.texCoordOffset || h.texCoordOffset+texCoordBytes<=size) &&
+			h.indexOffset && h.indexOffset+indexBytes<=size && h.indexCount%3==0;
+
+	//the cache is stale if the content of the model changed
+	if(valid)
+	{
+		unsigned long long sourceSize=0;
+		long long sourceMTime=0;
+		std::string md5;
+		valid=stampFile(plyfile,sourceSize,sourceMTime);
+		if(valid && (sourceSize!=h.sourceSize || sourceMTime!=h.sourceMTime))
+		{
+			valid=hashFile(plyfile,md5) && strncmp(h.sourceMD5,md5.c_str(),sizeof(h.sourceMD5))==0;
+			//same content, only touched: record the new stamp so the next start doesn't hash again
+			if(valid)
+			{
+				h.sourceSize=sourceSize;
+				h.sourceMTime=sourceMTime;
+				FILE *f=fopen(cachefile.c_str(),"r+b");
+				if(f)
+				{
+					fwrite(&h,sizeof(h),1,f);
+					fclose(f);
+				}
+			}
+		}
+	}
+
+	if(!valid)
+	{
+		unmapFile(data,size);
+		return NULL;
+	}
+
+	vl::ref<vl::Geometry> geom=new vl::Geometry;
+
+	vl::ref<vl::GPUArrayVec3> verts=new vl::GPUArrayVec3;
+	vl::ref<vl::GPUArrayVec3> normals=new vl::GPUArrayVec3;
+	verts->resize(h.vertexCount);
+	normals->resize(h.vertexCount);
+	if(h.vertexCount)
+	{
+		memcpy(verts->localBufferVoidPtr(),data+h.positionOffset,vertexBytes);
+		memcpy(normals->localBufferVoidPtr(),data+h.normalOffset,vertexBytes);
+	}
+	geom->setVertexArray(verts.get());
+	geom->setNormalArray(normals.get());
+
+	if(h.texCoordOffset)
+	{
+		vl::ref<vl::GPUArrayVec2> texcoords=new vl::GPUArrayVec2;
+		texcoords->resize(h.vertexCount);
+		if(h.vertexCount)
+			memcpy(texcoords->localBufferVoidPtr(),data+h.texCoordOffset,texCoordBytes);
+		geom->setTexCoordArray(0,texcoords.get());
+	}
+
+	vl::ref<vl::DrawElementsUInt> polys=new vl::DrawElementsUInt(vl::PT_TRIANGLES);
+	polys->resize(h.indexCount);
+	if(h.indexCount)
+		memcpy(polys->localPtr(),data+h.indexOffset,indexBytes);
+	geom->addDrawCall(polys.get());
+
+	unmapFile(data,size);
+	return geom;
+}
+
+static unsigned int alignBlock(unsigned int offset)
+{
+	return (offset+MeshCacheAlignment-1)&~(MeshCacheAlignment-1);
+}
+
+static bool writeBlock(FILE *f, unsigned int offset, const void *data, size_t size)
+{
+	if(size==0)
+		return true;
+	return fseek(f,offset,SEEK_SET)==0 && fwrite(data,1,size,f)==size;
+}
+
+//zero fills the file up to size, the blocks at the end may be empty
+static bool padFile(FILE *f, size_t size)
+{
+	if(fseek(f,0,SEEK_END)!=0)
+		return false;
+	for(long pos=ftell(f); pos>=0 && (size_t)pos<size; pos++)
+		if(fputc(0,f)==EOF)
+			return false;
+	return true;
+}
+
+bool MeshCache::write(const std::string &cachefile, const std::string &plyfile, vl::Geometry *geom)
+{
+	std::string md5;
+	unsigned long long sourceSize=0;
+	long long sourceMTime=0;
+	if(!stampFile(plyfile,sourceSize,sourceMTime) || !hashFile(plyfile,md5))
+		return false;
+
+	vl::GPUArrayVec3 *verts=dynamic_cast<vl::GPUArrayVec3*>(geom->vertexArray());
+	vl::GPUArrayVec3 *normals=dynamic_cast<vl::GPUArrayVec3*>(geom->normalArray());
+	vl::GPUArrayVec2 *texcoords=dynamic_cast<vl::GPUArrayVec2*>(geom->texCoordArray(0));
+	vl::DrawElementsUInt *polys=geom->drawCallCount()==1 ? dynamic_cast<vl::DrawElementsUInt*>(geom->drawCall(0)) : NULL;
+	if(!verts || !normals || !polys || polys->primitiveType()!=vl::PT_TRIANGLES)
+		return false;
+
+	MeshCacheHeader h;
+	memset(&h,0,sizeof(h));
+	memcpy(h.magic,MeshCacheMagic,sizeof(h.magic));
+	h.version=MeshCacheVersion;
+	h.byteOrder=MeshCacheByteOrder;
+	strncpy(h.sourceMD5,md5.c_str(),sizeof(h.sourceMD5)-1);
+	h.sourceSize=sourceSize;
+	h.sourceMTime=sourceMTime;
+	h.vertexCount=verts->size();
+	h.indexCount=polys->indexCount();
+
+	size_t vertexBytes=(size_t)h.vertexCount*sizeof(vl::vec3);
+	size_t texCoordBytes=(size_t)h.vertexCount*sizeof(vl::vec2);
+	size_t indexBytes=(size_t)h.indexCount*sizeof(GLuint);
+
+	h.positionOffset=alignBlock(sizeof(h));
+	h.normalOffset=alignBlock(h.positionOffset+vertexBytes);
+	unsigned int end=h.normalOffset+vertexBytes;
+	if(texcoords)
+	{
+		h.texCoordOffset=alignBlock(end);
+		end=h.texCoordOffset+texCoordBytes;
+	}
+	h.indexOffset=alignBlock(end);
+	h.fileSize=h.indexOffset+indexBytes;
+
+	//written to a temporary file and renamed, so a concurrent reader never sees half a cache
+	char tmpfile[1024];
+	snprintf(tmpfile,sizeof(tmpfile),"%s.%d.tmp",cachefile.c_str(),(int)getpid());
+	FILE *f=fopen(tmpfile,"wb");
+	if(!f)
+		return false;
+	bool ok=writeBlock(f,0,&h,sizeof(h)) &&
+		(h.vertexCount==0 || writeBlock(f,h.positionOffset,verts->localBufferPtr(),vertexBytes)) &&
+		(h.vertexCount==0 || writeBlock(f,h.normalOffset,normals->localBufferPtr(),vertexBytes)) &&
+		(!texcoords || h.vertexCount==0 || writeBlock(f,h.texCoordOffset,texcoords->localBufferPtr(),texCoordBytes)) &&
+		(h.indexCount==0 || writeBlock(f,h.indexOffset,polys->localPtr(),indexBytes));
+	ok=ok && padFile(f,h.fileSize);
+	ok=fclose(f)==0 && ok;
+	if(ok)
+		ok=rename(tmpfile,cachefile.c_str())==0;
+	if(!ok)
+		unlink(tmpfile);
+	return ok;
+}
+
+bool MeshCache::update(const std::string &plyfile, bool *rebuilt)
+{
+	if(rebuilt)
+		*rebuilt=false;
+	std::string cachefile=cacheFile(plyfile);
+	if(read(cachefile,plyfile))
+		return true;
+	vl::ref<vl::Geometry> geom=LoadPLY2::loadPLY(plyfile);
+	if(!geom || !write(cachefile,plyfile,geom.get()))
+		return false;
+	if(rebuilt)
+		*rebuilt=true;
+	return true;
+}
+
+vl::ref<vl::Geometry> MeshCache::load(const std::string &plyfile)
+{
+	std::string cachefile=cacheFile(plyfile);
+	vl::ref<vl::Geometry> geom=read(cachefile,plyfile);
+	if(geom)
+		return geom;
+
+	geom=LoadPLY2::loadPLY(plyfile);
+	if(geom && !write(cachefile,plyfile,geom.get()))
+		vl::Log::warning( vl::Say("Could not write the mesh cache %s\n") << cachefile );
+	return geom;
+}
+
+}
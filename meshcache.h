@@ -0,0 +1,46 @@
+#ifndef __MESHCACHE_H
+#define __MESHCACHE_H
+
+#include <string>
+
+#include <vl/Geometry.hpp>
+
+namespace SimQuadCopter
+{
+
+//binary copy of a PLY model that loads without parsing.
+//
+//the cache file (model.ply.mesh next to the model) holds the arrays of the
+//vl::Geometry made by LoadPLY2, smooth normals included, each one as a 16
+//byte aligned block in the layout of the GPU buffer: positions, normals,
+//texture coordinates and the triangle indices. loading maps the file and
+//copies every block into its buffer in one go.
+//
+//the cache is keyed by the MD5 of the PLY file, so it is rebuilt whenever
+//the content of the model changes. the file is hashed only if its size or
+//modification time differ from the ones recorded in the cache. the cache is
+//written in host byte order and thrown away when read on a host with a
+//different one.
+class MeshCache
+{
+public:
+	//loads plyfile through its cache, building the cache first if it is
+	//missing or stale. falls back to LoadPLY2 if the cache can't be written.
+	static vl::ref<vl::Geometry> load(const std::string &plyfile);
+
+	//builds the cache of plyfile if it is missing or stale.
+	//returns false if the model can't be loaded or the cache can't be written.
+	static bool update(const std::string &plyfile, bool *rebuilt=NULL);
+
+	static std::string cacheFile(const std::string &plyfile);
+
+private:
+	static bool stampFile(const std::string &file, unsigned long long &size, long long &mtime);
+	static bool hashFile(const std::string &file, std::string &md5);
+	static vl::ref<vl::Geometry> read(const std::string &cachefile, const std::string &plyfile);
+	static bool write(const std::string &cachefile, const std::string &plyfile, vl::Geometry *geom);
+};
+
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "nativecopter.h"
+#include "vectormath/vectormath_soa.h"
+
+#include <math.h>
+
+#include <vl/Trace.hpp>
+
+namespace SimQuadCopter
+{
+
+NativeCopter::NativeCopter(QuadCopter *copter, float size):
+	CopterDynamics(copter),
+	engineXp(Vector3(size*0.5f,0,0)),
+	engineXm(Vector3(-size*0.5f,0,0)),
+	engineZp(Vector3(0,0,size*0.5f)),
+	engineZm(Vector3(0,0,-size*0.5f))
+{
+	engineXp.direction=1;
+	engineXm.direction=1;
+	engineZp.direction=-1;
+	engineZm.direction=-1;
+
+	//same masses as OdeCopter (units in meters)
+	//frame (300g)
+	addBox(0.15f,Vector3(0,0,0),Vector3(size,size*0.1f,size*0.1f));
+	addBox(0.15f,Vector3(0,0,0),Vector3(size*0.1f,size*0.1f,size));
+	//OdeCopter positions the boards twice and leaves the battery in the frame center
+	addBox(0.3f,Vector3(0,-0.03f,0),Vector3(0.08f,0.052f,0.11f));
+	addBox(0.3f,Vector3(0,0,0),Vector3(0.142f,0.0234f,0.0425f));
+
+	//motors (cylinders along y) and propellers
+	propellerInertia=0.020f/12.0f*(0.02f*0.02f+0.2f*0.2f);
+	for(int i=0;i<EngineCount;++i)
+	{
+		const Vector3 &p=getEngine(i)->position;
+
+		Part motor;
+		motor.mass=0.070f;
+		motor.position=p;
+		float r=0.015f,l=0.04f;
+		float side=motor.mass*(3.0f*r*r+l*l)/12.0f;
+		motor.inertia=Vector3(side,motor.mass*r*r*0.5f,side);
+		parts.push_back(motor);
+
+		//the propeller spins, so x and z get the average
+		Part propeller;
+		propeller.mass=0.020f;
+		propeller.position=p+Vector3(0,0.02f,0);
+		float across=propeller.mass/12.0f*(0.005f*0.005f+0.2f*0.2f);
+		float along=propeller.mass/12.0f*(0.02f*0.02f+0.005f*0.005f);
+		propeller.inertia=Vector3(0.5f*(across+along),propellerInertia,0.5f*(across+along));
+		parts.push_back(propeller);
+	}
+
+	mass=0;
+	center=Vector3(0,0,0);
+	for(size_t i=0;i<parts.size();++i)
+	{
+		mass+=parts[i].mass;
+		center+=parts[i].position*parts[i].mass;
+	}
+	center/=mass;
+
+	//parallel axis theorem, the parts are symmetric so the tensor is diagonal
+	inertia=Vector3(0,0,0);
+	for(size_t i=0;i<parts.size();++i)
+	{
+		Vector3 d=parts[i].position-center;
+		inertia+=parts[i].inertia+Vector3(d.getY()*d.getY()+d.getZ()*d.getZ(),d.getX()*d.getX()+d.getZ()*d.getZ(),d.getX()*d.getX()+d.getY()*d.getY())*parts[i].mass;
+	}
+
+	//corners of the two collision boxes of OdeCopter
+	Vector3 boxes[2]={Vector3(size,0.082f,0.04f),Vector3(0.04f,0.082f,size)};
+	for(int i=0;i<ContactPointCount;++i)
+	{
+		const Vector3 &box=boxes[i/8];
+		contactX[i]=(i&1 ? 0.5f : -0.5f)*box.getX()-center.getX();
+		contactY[i]=(i&2 ? 0.5f : -0.5f)*box.getY()-center.getY();
+		contactZ[i]=(i&4 ? 0.5f : -0.5f)*box.getZ()-center.getZ();
+	}
+
+	contactStiffness=2000.0f;
+	contactDamping=30.0f;
+	contactFriction=0.8f;
+
+	orientation=Quat::identity();
+	velocity=Vector3(0,0,0);
+	rates=Vector3(0,0,0);
+	force=Vector3(0,0,0);
+	torque=Vector3(0,0,0);
+	lastRotorMomentum=Vector3(0,0,0);
+	setPosition(Vector3(0,1,0));
+}
+
+void NativeCopter::addBox(float m, const Vector3 &position, const Vector3 &size)
+{
+	Part part;
+	part.mass=m;
+	part.position=position;
+	float x2=size.getX()*size.getX(),y2=size.getY()*size.getY(),z2=size.getZ()*size.getZ();
+	part.inertia=Vector3(y2+z2,x2+z2,x2+y2)*(m/12.0f);
+	parts.push_back(part);
+}
+
+Vector3 NativeCopter::getPosition() const
+{
+	return position-rotate(orientation,center);
+}
+
+Quat NativeCopter::getOrientation() const
+{
+	return orientation;
+}
+
+void NativeCopter::setPosition(Vector3 v)
+{
+	position=v+rotate(orientation,center);
+}
+
+Vector3 NativeCopter::getSpeedVector() const
+{
+	//speed of the frame center
+	return velocity+cross(rotate(orientation,rates),rotate(orientation,-center));
+}
+
+Vector3 NativeCopter::getBodyRates() const
+{
+	return rates;
+}
+
+float NativeCopter::getMass() const
+{
+	return mass;
+}
+
+Engine *NativeCopter::getEngine(int index) const
+{
+	const Engine *engines[EngineCount]={&engineXp,&engineXm,&engineZp,&engineZm};
+	return const_cast<Engine*>(engines[index]);
+}
+
+//angular momentum of the spinning propellers, body coordinates
+Vector3 NativeCopter::getRotorMomentum() const
+{
+	float h=0;
+	for(int i=0;i<EngineCount;++i)
+	{
+		const Engine *engine=getEngine(i);
+		if(Engine::simulatePropellerRotation)
+			h+=propellerInertia*engine->getRPM()/60.0f*2.0f*3.14f*engine->direction;
+	}
+	return Vector3(0,h,0);
+}
+
+void NativeCopter::addContactForces()
+{
+	//rotate the corners FloatSoA::Lanes at a time
+	Vector3 corners[ContactPointCount];
+	QuatSoA q(orientation);
+	for(int i=0;i<ContactPointCount;i+=FloatSoA::Lanes)
+		rotate(q,Vector3SoA(contactX+i,contactY+i,contactZ+i)).get(corners+i);
+
+	Vector3 omega=rotate(orientation,rates);
+	for(int i=0;i<ContactPointCount;++i)
+	{
+		const Vector3 &r=corners[i];
+		Vector3 p=position+r;
+		if(p.getY()>=0.0f)
+			continue;
+
+		Vector3 v=velocity+cross(omega,r);
+		float normal=std::max(0.0f,-p.getY()*contactStiffness-v.getY()*contactDamping);
+
+		//coulomb friction, viscous near standstill
+		Vector3 slide(v.getX(),0,v.getZ());
+		Vector3 friction=-slide*contactDamping;
+		float limit=contactFriction*normal;
+		float f=length(friction);
+		if(f>limit)
+			friction*=limit/f;
+
+		Vector3 contact=Vector3(0,normal,0)+friction;
+		force+=contact;
+		torque+=rotate(conj(orientation),cross(r,contact));
+	}
+}
+
+void NativeCopter::addForces()
+{
+	force=Vector3(0,0,0);
+	torque=Vector3(0,0,0);
+
+	for(int i=0;i<EngineCount;++i)
+	{
+		const Engine *engine=getEngine(i);
+		Vector3 thrust(0,engine->currentForce(),0);
+		force+=rotate(orientation,thrust);
+		torque+=cross(engine->position-center,thrust);
+	}
+
+	force+=calcAirFrictionForce();
+	force+=externalForce;
+}
+
+void NativeCopter::update(float dtime)
+{
+	vl::TraceZone zone("NativeCopter::update","physics");
+	addContactForces();
+
+	//semi-implicit euler
+	velocity+=(force/mass+Vector3(0,-9.81f,0))*dtime;
+	position+=velocity*dtime;
+
+	Vector3 h=getRotorMomentum();
+	Vector3 momentum=mulPerElem(inertia,rates)+h;
+	rates+=divPerElem(torque-cross(rates,momentum),inertia)*dtime;
+
+	float angle=length(rates)*dtime;
+	if(angle>0.0f)
+		orientation=normalize(orientation*Quat::rotation(angle,normalize(rates)));
+
+	addForces();
+
+	engineXm.update(dtime);
+	engineXp.update(dtime);
+	engineZp.update(dtime);
+	engineZm.update(dtime);
+
+	for(int i=0;i<EngineCount;++i)
+	{
+		const Engine *engine=getEngine(i);
+		//propeller air friction on the motor
+		if(Engine::simulatePropellerAirFriction)
+			torque+=Vector3(0,engine->direction*engine->getTorque(),0);
+	}
+
+	//reaction of the motors accelerating the propellers
+	h=getRotorMomentum();
+	torque-=(h-lastRotorMomentum)/dtime;
+	lastRotorMomentum=h;
+
+	updateSensors(dtime);
+}
+
+}
@@ -0,0 +1,81 @@
+#ifndef NATIVECOPTER_H
+#define NATIVECOPTER_H
+
+#include <vector>
+
+#include "quadcopter.h"
+
+namespace SimQuadCopter
+{
+
+//physics backend without ODE: the copter is one rigid body (frame, boards,
+//battery, motors and propellers like in OdeCopter) integrated with
+//semi-implicit euler steps. the ground is the plane y=0 with spring-damper
+//contacts at the corners of the frame.
+//much cheaper than OdeCopter, meant for parameter sweeps in free flight.
+class NativeCopter: public CopterDynamics
+{
+public:
+	NativeCopter(QuadCopter *copter, float size);
+	virtual void update(float dtime);
+
+	virtual Vector3 getPosition() const;
+	virtual Quat getOrientation() const;
+	virtual void setPosition(Vector3 v);
+	virtual Vector3 getSpeedVector() const;
+	virtual Vector3 getBodyRates() const;
+	virtual float getMass() const;
+
+	virtual Engine *getEngine(int index) const;
+
+	Engine engineXp;
+	Engine engineXm;
+	Engine engineZp;
+	Engine engineZm;
+
+	//ground contact, per contact point
+	float contactStiffness;//N/m
+	float contactDamping;//Ns/m
+	float contactFriction;
+
+protected:
+	void addBox(float m, const Vector3 &position, const Vector3 &size);
+	void addContactForces();
+	void addForces();
+	Vector3 getRotorMomentum() const;
+
+	//state, the body origin is the center of mass
+	Vector3 position;//center of mass
+	Quat orientation;
+	Vector3 velocity;//of the center of mass, world coordinates
+	Vector3 rates;//angular velocity, body coordinates
+
+	float mass;
+	Vector3 inertia;//diagonal inertia tensor about the center of mass
+	Vector3 center;//center of mass in frame coordinates
+	float propellerInertia;//about the rotor axis
+
+	//accumulated for the next step like ODE does
+	Vector3 force;//world coordinates
+	Vector3 torque;//body coordinates
+	Vector3 lastRotorMomentum;
+
+	//relative to the center of mass, as float arrays for the batched rotation
+	enum { ContactPointCount=16 };
+	float contactX[ContactPointCount];
+	float contactY[ContactPointCount];
+	float contactZ[ContactPointCount];
+
+	//parts of the copter in frame coordinates, for the inertia tensor
+	struct Part
+	{
+		float mass;
+		Vector3 position;
+		Vector3 inertia;//about its own center
+	};
+	std::vector<Part> parts;
+};
+
+}
+
+#endif
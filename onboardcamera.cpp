@@ -0,0 +1,185 @@
+#include "onboardcamera.h"
+
+#include <string.h>
+
+#include <vl/FrameBufferObject.hpp>
+#include <vl/quat.hpp>
+#include <vl/Log.hpp>
+#include <vl/Say.hpp>
+
+namespace SimQuadCopter
+{
+
+OnboardCamera::OnboardCamera()
+{
+	fov=70;
+	slots=8;
+	width=0;
+	height=0;
+	rate=0;
+	nextTime=0;
+	frameCount=0;
+	pbo=0;
+	pending=false;
+	pendingTime=0;
+}
+
+OnboardCamera::~OnboardCamera()
+{
+	//the pixel buffer needs the context, only the ring is cleaned up here
+	ring.close();
+}
+
+bool OnboardCamera::init(vl::ShaderNode *scene, vl::Transform *transforms, vl::Transform *mountTransform, const char *name, int w, int h, float fps)
+{
+	if(!GLEW_EXT_framebuffer_object)
+	{
+		vl::Log::error("OnboardCamera: GL_EXT_framebuffer_object not supported.\n");
+		return false;
+	}
+	if(w<=0 || h<=0 || fps<=0)
+		return false;
+	if(!ring.create(name,w,h,slots,fov,fps))
+	{
+		vl::Log::error( vl::Say("OnboardCamera: could not create the frame ring %s\n") << name );
+		return false;
+	}
+
+	width=w;
+	height=h;
+	rate=fps;
+	mount=mountTransform;
+	nextTime=0;
+	frameCount=0;
+
+	//same actors and transforms as the viewer, its own camera and render lists
+	pipeline=new vlut::RenderPipeline;
+	pipeline->setShaderNode(scene);
+	pipeline->setTransform(transforms);
+
+	vl::ref<vl::FBORenderTarget> fbo=new vl::FBORenderTarget(width,height);
+	fbo->addColorAttachment(vl::AP_COLOR_ATTACHMENT0_EXT,new vl::FBOColorBuffer(vl::CBF_RGBA8));
+	fbo->addDepthAttachment(new vl::FBODepthBuffer(vl::DT_DEPTH_COMPONENT24));
+	fbo->setDrawBuffers(vl::RDB_COLOR_ATTACHMENT0_EXT);
+
+	vl::Camera *camera=pipeline->camera();
+	camera->setRenderTarget(fbo.get());
+	camera->setViewport(new vl::Viewport(0,0,width,height));
+	camera->viewport()->setClearColor(vl::vec4(1,1,1,1));
+	camera->setFOV(fov);
+	camera->setNearPlane(1);
+	camera->setFarPlane(10000);
+	camera->setProjectionMatrixPerspective();
+	camera->followTransform(mount.get());
+
+	if(GLEW_ARB_pixel_buffer_object)
+	{
+		glGenBuffers(1,&pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB,pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER_ARB,width*height*4,NULL,GL_STREAM_READ);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB,0);
+	}
+	else
+		pixels.resize(width*height*4);
+
+	vl::Log::print( vl::Say("Onboard camera: %nx%n at %nHz in %s\n") << width << height << rate << name );
+	return true;
+}
+
+void OnboardCamera::update(double time)
+{
+	if(!pipeline)
+		return;
+
+	//the frame rendered on the last call is in the pixel buffer by now
+	publishPending();
+
+	if(time<nextTime)
+		return;
+	//after a stall continue from now instead of catching up
+	nextTime+=1.0/rate;
+	if(nextTime<=time)
+		nextTime=time+1.0/rate;
+
+	pipeline->executeRendering();
+
+	//the camera matrix is the world matrix of the mount, in cm
+	vl::mat4d pose=pipeline->camera()->viewMatrix();
+
+	glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+	glPixelStorei(GL_PACK_ALIGNMENT,4);
+	glPixelStorei(GL_PACK_ROW_LENGTH,0);
+	glPixelStorei(GL_PACK_SKIP_PIXELS,0);
+	glPixelStorei(GL_PACK_SKIP_ROWS,0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+	if(pbo)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB,pbo);
+		glReadPixels(0,0,width,height,GL_BGRA,GL_UNSIGNED_BYTE,NULL);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB,0);
+		pending=true;
+		pendingTime=time;
+		pendingPose=pose;
+	}
+	else
+		glReadPixels(0,0,width,height,GL_BGRA,GL_UNSIGNED_BYTE,&pixels[0]);
+	glPopClientAttrib();
+
+	if(!pbo)
+		publish(&pixels[0],time,pose);
+}
+
+void OnboardCamera::publishPending()
+{
+	if(!pending)
+		return;
+	pending=false;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB,pbo);
+	const unsigned char *frame=(const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB,GL_READ_ONLY);
+	if(frame)
+	{
+		publish(frame,pendingTime,pendingPose);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+	}
+	else
+		vl::Log::error("OnboardCamera: could not map the pixel buffer, a frame is lost\n");
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB,0);
+}
+
+void OnboardCamera::publish(const unsigned char *frame, double time, const vl::mat4d &pose)
+{
+	FrameSlotHeader *slot=ring.beginFrame();
+	slot->time=time;
+	vl::vec3d t=pose.getT()*0.01;
+	vl::quat q;
+	q.fromMatrix(pose);
+	for(int i=0;i<3;++i)
+		slot->position[i]=(float)t[i];
+	for(int i=0;i<4;++i)
+		slot->orientation[i]=(float)q.xyzw()[i];
+
+	//OpenGL reads bottom up, the ring holds the image top down
+	unsigned char *dst=ring.getPixels(slot);
+	int stride=width*4;
+	for(int y=0;y<height;++y)
+		memcpy(dst+y*stride,frame+(height-1-y)*stride,stride);
+
+	ring.publish(slot);
+	frameCount++;
+}
+
+void OnboardCamera::shutdown()
+{
+	if(!pipeline)
+		return;
+	publishPending();
+	if(pbo)
+		glDeleteBuffers(1,&pbo);
+	pbo=0;
+	pipeline=NULL;
+	mount=NULL;
+	ring.close();
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef __ONBOARDCAMERA_H
+#define __ONBOARDCAMERA_H
+
+#include <vector>
+
+#include <vl/OpenGL.hpp>
+#include <vl/Transform.hpp>
+#include <vl/ShaderNode.hpp>
+#include <vlut/RenderPipeline.hpp>
+
+#include "framering.h"
+
+namespace SimQuadCopter
+{
+
+//a camera on the airframe for vision code developed against the simulator.
+//
+//renders the scene from a mount transform into a frame buffer object at a
+//fixed rate of simulation time and publishes every frame with its time and
+//pose in a FrameRing, where local processes map it without any copy,
+//encoding or socket in between.
+//
+//the frame is read into a pixel buffer object and copied into the ring on
+//the next update(), one viewer frame later, when the transfer is done. the
+//copy flips the rows so the ring holds the image top down.
+class OnboardCamera
+{
+public:
+	OnboardCamera();
+	~OnboardCamera();
+
+	//renders the actors of scene (a painter tree) placed by transforms.
+	//the camera looks down the -z axis of mount. needs the OpenGL context.
+	bool init(vl::ShaderNode *scene, vl::Transform *transforms, vl::Transform *mount, const char *name, int width, int height, float rate);
+
+	//renders a frame if one is due at simulation time time. call after
+	//placing the objects, with the OpenGL context current.
+	void update(double time);
+
+	//publishes the pending frame and removes the ring
+	void shutdown();
+
+	bool isActive() const { return pipeline.get()!=NULL; }
+	int getFrameCount() const { return frameCount; }
+
+	//set before init()
+	float fov;//vertical, degrees
+	int slots;//of the ring
+
+protected:
+	void publishPending();
+	void publish(const unsigned char *frame, double time, const vl::mat4d &pose);
+
+	vl::ref<vlut::RenderPipeline> pipeline;
+	vl::ref<vl::Transform> mount;
+	FrameRing ring;
+	int width;
+	int height;
+	float rate;
+	double nextTime;
+	int frameCount;
+
+	//the frame waiting in the pixel buffer object, without pixel buffer
+	//objects the frame is read into pixels and published right away
+	GLuint pbo;
+	std::vector<unsigned char> pixels;
+	bool pending;
+	double pendingTime;
+	vl::mat4d pendingPose;
+};
+
+}
+
+#endif
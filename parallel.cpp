@@ -0,0 +1,190 @@
+#include "parallel.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+
+namespace SimQuadCopter
+{
+
+struct ParallelChild
+{
+	pid_t pid;
+	int fd;
+	int index;
+	std::vector<char> data;
+};
+
+ParallelRunner::ParallelRunner(int workers)
+{
+	if(workers<=0)
+		workers=cpuCount();
+	this->workers=workers;
+}
+
+int ParallelRunner::getWorkers() const
+{
+	return workers;
+}
+
+int ParallelRunner::cpuCount()
+{
+	long n=sysconf(_SC_NPROCESSORS_ONLN);
+	return n>0 ? (int)n : 1;
+}
+
+static void writeAll(int fd, const char *data, size_t size)
+{
+	while(size>0)
+	{
+		ssize_t n=write(fd,data,size);
+		if(n<0)
+		{
+			if(errno==EINTR)
+				continue;
+			return;
+		}
+		data+=n;
+		size-=n;
+	}
+}
+
+void ParallelRunner::run(ParallelJob &job, int count, std::vector< std::vector<float> > &results)
+{
+	results.clear();
+	results.resize(count);
+
+	//child output goes through pipes, flush now so it is not written twice
+	fflush(stdout);
+	fflush(stderr);
+
+	std::vector<ParallelChild> children;
+	int next=0;
+
+	while(next<count || !children.empty())
+	{
+		//start new children until all cores are busy
+		while(next<count && (int)children.size()<workers)
+		{
+			int fds[2];
+			if(pipe(fds)!=0)
+			{
+				perror("pipe");
+				break;
+			}
+
+			pid_t pid=fork();
+			if(pid<0)
+			{
+				perror("fork");
+				close(fds[0]);
+				close(fds[1]);
+				break;
+			}
+			if(pid==0)
+			{
+				close(fds[0]);
+				std::vector<float> result;
+				job.run(next,result);
+				if(!result.empty())
+					writeAll(fds[1],(const char*)&result[0],result.size()*sizeof(float));
+				close(fds[1]);
+				fflush(stdout);
+				_exit(0);
+			}
+
+			close(fds[1]);
+			ParallelChild child;
+			child.pid=pid;
+			child.fd=fds[0];
+			child.index=next;
+			children.push_back(child);
+			next++;
+		}
+
+		if(children.empty())
+		{
+			//could not start anything, give up on the remaining jobs
+			break;
+		}
+
+		//collect output, children block if a pipe runs full
+		fd_set set;
+		FD_ZERO(&set);
+		int maxfd=0;
+		for(size_t i=0;i<children.size();++i)
+		{
+			FD_SET(children[i].fd,&set);
+			if(children[i].fd>maxfd)
+				maxfd=children[i].fd;
+		}
+
+		if(select(maxfd+1,&set,NULL,NULL,NULL)<0)
+		{
+			if(errno==EINTR)
+				continue;
+			perror("select");
+			//their output is lost, stop the children and reap them
+			for(size_t i=0;i<children.size();++i)
+			{
+				close(children[i].fd);
+				kill(children[i].pid,SIGKILL);
+				while(waitpid(children[i].pid,NULL,0)<0 && errno==EINTR)
+					;
+				fprintf(stderr,"job %d failed\n",children[i].index);
+			}
+			children.clear();
+			break;
+		}
+
+		for(size_t i=0;i<children.size();)
+		{
+			ParallelChild &child=children[i];
+			if(!FD_ISSET(child.fd,&set))
+			{
+				++i;
+				continue;
+			}
+
+			char buffer[4096];
+			ssize_t n=read(child.fd,buffer,sizeof(buffer));
+			if(n>0)
+			{
+				child.data.insert(child.data.end(),buffer,buffer+n);
+				++i;
+				continue;
+			}
+			if(n<0 && errno==EINTR)
+			{
+				++i;
+				continue;
+			}
+
+			//end of output
+			close(child.fd);
+			int status=0;
+			pid_t reaped;
+			while((reaped=waitpid(child.pid,&status,0))<0 && errno==EINTR)
+				;
+			if(reaped==child.pid && WIFEXITED(status) && WEXITSTATUS(status)==0)
+			{
+				std::vector<float> &result=results[child.index];
+				result.resize(child.data.size()/sizeof(float));
+				if(!result.empty())
+					memcpy(&result[0],&child.data[0],result.size()*sizeof(float));
+			}
+			else
+				fprintf(stderr,"job %d failed\n",child.index);
+
+			children.erase(children.begin()+i);
+		}
+	}
+}
+
+}
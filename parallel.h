@@ -0,0 +1,39 @@
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+#include <vector>
+
+namespace SimQuadCopter
+{
+
+//a batch of independent jobs, each one producing a vector of floats
+class ParallelJob
+{
+public:
+	virtual ~ParallelJob() {}
+	//called in a child process. the child exits after returning.
+	virtual void run(int index, std::vector<float> &result)=0;
+};
+
+//runs jobs in forked child processes, one per core.
+//the simulation uses a global ODE world and a global flightcontrol, so
+//jobs can not run in threads of the same process. forking also gives every
+//job a copy of the state the parent had at the time of run().
+class ParallelRunner
+{
+public:
+	ParallelRunner(int workers=0);
+
+	//results[i] stays empty if job i crashed
+	void run(ParallelJob &job, int count, std::vector< std::vector<float> > &results);
+
+	int getWorkers() const;
+	static int cpuCount();
+
+protected:
+	int workers;
+};
+
+}
+
+#endif
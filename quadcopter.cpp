@@ -5,14 +5,17 @@
 #include <iostream>
 #include <math.h>
 
+#include "nativecopter.h"
 #include "flightcontrol.h"
 #include "hardware/CopterHardwareConfig.h"
 
+#include <vl/Trace.hpp>
+
 namespace SimQuadCopter
 {
 
-bool OdeEngine::simulatePropellerRotation=true;
-bool OdeEngine::simulatePropellerAirFriction=true;
+bool Engine::simulatePropellerRotation=true;
+bool Engine::simulatePropellerAirFriction=true;
 
 dWorldID OdeCopter::world=0;
 dSpaceID OdeCopter::space=0;
@@ -23,10 +26,94 @@ Control::Control()
 	throttle=yaw=pitch=roll=0;
 }
 
+CopterDynamics::CopterDynamics(QuadCopter *copter)
+{
+	this->copter=copter;
+	currentAirFriction=0;
+	externalForce=Vector3(0,0,0);
+	lastSpeed=Vector3(0,0,0);
+}
+
+float CopterDynamics::getSpeed() const
+{
+	return length(getSpeedVector());
+}
+
+float CopterDynamics::getTotalThrust() const
+{
+	float thrust=0;
+	for(int i=0;i<EngineCount;++i)
+		thrust+=getEngine(i)->currentForce();
+	return thrust;
+}
+
+void CopterDynamics::calcRealAngles(float &x,float &z) const
+{
+	//this is like QuadCopter::calcAnglesFromAcceleration
+	Vector3 up=rotate(getOrientation(),Vector3(0,1,0));
+	
+	float ax=-up.getX(),ay=up.getY(),az=-up.getZ();
+	
+	//rotation about x axis
+	float gx=atan2(az,ay);
+	
+	//rotation about z axis
+	float gz=-atan2(ax,ay);
+
+	x=gx;
+	z=gz;
+}
+
+Vector3 CopterDynamics::calcAirFrictionForce()
+{
+	Vector3 v=getSpeedVector();
+	float speed=length(v);
+
+	const float cw=0.8f;//like a truck
+	const float area=0.5f*0.2f;//just a guess
+	const float density=1.2f;//air at 20 degrees celsius is 1.2kg/m^3
+
+	float force=0.5*density*cw*area*speed*speed;
+	currentAirFriction=force;
+
+	//no direction when not moving
+	if(speed==0.0f)
+		return Vector3(0,0,0);
+
+	return -(v/speed)*force;
+}
+
+void CopterDynamics::updateSensors(float dtime)
+{
+	Quat toBody=conj(getOrientation());
+
+	Vector3 rates=getBodyRates();
+	//minus sign: positive rotation in I4Copter is counter-clockwise when looking in positive direction of the axis.
+	copter->gyroX.setValue(-rates.getX());
+	copter->gyroY.setValue(-rates.getY());
+	copter->gyroZ.setValue(-rates.getZ());
+
+	Vector3 speed=rotate(toBody,getSpeedVector());
+	Vector3 accel=(speed-lastSpeed)/dtime;
+
+	// gravity
+	accel+=rotate(toBody,Vector3(0,9.81f,0));
+
+	copter->accelX.setValue(accel.getX());
+	copter->accelY.setValue(accel.getY());
+	copter->accelZ.setValue(accel.getZ());
+
+	lastSpeed=speed;
+}
+
 void OdeCopter::init()
 {
 	if(world==0)
 	{
+		//the copter is created and stepped on the simulation thread, which needs
+		//the collider data of ODE, the range sensor workers allocate their own
+		dInitODE2(0);
+		dAllocateODEDataForThread(dAllocateMaskAll);
 		world=dWorldCreate();
 		dWorldSetGravity(world,0,-9.81f,0);
 
@@ -50,13 +137,13 @@ void OdeCopter::close()
 }
 
 OdeCopter::OdeCopter(QuadCopter *copter,float size):
+	CopterDynamics(copter),
 	engineXp(Vector3(size*0.5f,0,0)),
 	engineXm(Vector3(-size*0.5f,0,0)),
 	engineZp(Vector3(0,0,size*0.5f)),
 	engineZm(Vector3(0,0,-size*0.5f))
 {
 	init();
-	this->copter=copter;
 	
 	dMass mass2;
 
@@ -103,6 +190,8 @@ OdeCopter::OdeCopter(QuadCopter *copter,float size):
 	engineZp.init(this,Vector3(0,0,size*0.5f),-1);
 	engineZm.init(this,Vector3(0,0,-size*0.5f),-1);
 
+	rangeSensors.setBody(body);
+
 	mountJoint=NULL;
 
 	//select mount type
@@ -129,15 +218,6 @@ OdeCopter::OdeCopter(QuadCopter *copter,float size):
 		dBodySetPosition(body,0,1,0);
 		dGeomID plane=dCreatePlane(space,0,1,0,0);
 	}
-
-	currentAirFriction=0;
-}
-
-float OdeCopter::getSpeed() const
-{
-	const dReal *v = dBodyGetLinearVel(body);
-	Vector3 v2(v[0],v[1],v[2]);
-	return length(v2);
 }
 
 Vector3 OdeCopter::getSpeedVector() const
@@ -229,123 +309,174 @@ void OdeCopter::setPosition(Vector3 v)
 
 void OdeCopter::update(float dtime)
 {
-	static Vector3 last_speed(0,0,0);
-
+	vl::TraceZone zone("OdeCopter::update","physics");
 	dSpaceCollide(space,NULL,&nearCallback);
 
 	dWorldStep(world,dtime);
 	dJointGroupEmpty(contactgroup);
 
-	addEngineForce(engineXp);
-	addEngineForce(engineXm);
-	addEngineForce(engineZp);
-	addEngineForce(engineZm);
+	rangeSensors.update(dtime,space);
 
-	addAirFrictionForce();
+	addForces();
 
 	engineXm.update(dtime);
 	engineXp.update(dtime);
 	engineZp.update(dtime);
 	engineZm.update(dtime);
-	
-	dVector3 dv;
 
-	const dReal *v=dBodyGetAngularVel(body);
-	dBodyVectorFromWorld(body,v[0],v[1],v[2],dv);
-	//minus sign: positive rotation in I4Copter is counter-clockwise when looking in positive direction of the axis.
-	copter->gyroX.setValue(-dv[0]);
-	copter->gyroY.setValue(-dv[1]);
-	copter->gyroZ.setValue(-dv[2]);
+	updateSensors(dtime);
+}
 
-	v=dBodyGetLinearVel(body);
+Vector3 OdeCopter::getBodyRates() const
+{
+	dVector3 dv;
+	const dReal *v=dBodyGetAngularVel(body);
 	dBodyVectorFromWorld(body,v[0],v[1],v[2],dv);
+	return Vector3(dv[0],dv[1],dv[2]);
+}
 
-	Vector3 speed(dv[0],dv[1],dv[2]);
-	Vector3 accel=(speed-last_speed)/dtime;
+Engine *OdeCopter::getEngine(int index) const
+{
+	const OdeEngine *engines[EngineCount]={&engineXp,&engineXm,&engineZp,&engineZm};
+	return const_cast<OdeEngine*>(engines[index]);
+}
 
-	// gravity
-	dBodyVectorFromWorld(body,0,9.81f,0,dv);
-	accel+=Vector3(dv[0],dv[1],dv[2]);
+void OdeCopter::addForces()
+{
+	addEngineForce(engineXp);
+	addEngineForce(engineXm);
+	addEngineForce(engineZp);
+	addEngineForce(engineZm);
 
+	addAirFrictionForce();
+	dBodyAddForce(body,externalForce.getX(),externalForce.getY(),externalForce.getZ());
+}
 
-	copter->accelX.setValue(accel.getX());
-	copter->accelY.setValue(accel.getY());
-	copter->accelZ.setValue(accel.getZ());
+int OdeCopter::getBodies(dBodyID *bodies) const
+{
+	bodies[0]=body;
+	bodies[1]=battery;
+	bodies[2]=boards;
+	bodies[3]=engineXp.motor;
+	bodies[4]=engineXp.propeller;
+	bodies[5]=engineXm.motor;
+	bodies[6]=engineXm.propeller;
+	bodies[7]=engineZp.motor;
+	bodies[8]=engineZp.propeller;
+	bodies[9]=engineZm.motor;
+	bodies[10]=engineZm.propeller;
+	return 11;
+}
 
-	last_speed=speed;
+float OdeCopter::getMass() const
+{
+	dBodyID bodies[11];
+	int count=getBodies(bodies);
+	float total=0;
+	for(int i=0;i<count;++i)
+	{
+		dMass m;
+		dBodyGetMass(bodies[i],&m);
+		total+=m.mass;
+	}
+	return total;
 }
 
-void OdeCopter::addAirFrictionForce()
+void OdeCopter::moveRigid(const Vector3 &translation, const Quat &rotation, const Vector3 &linearVel, const Vector3 &angularVel)
 {
-	double speed=getSpeed();
+	const dReal *p=dBodyGetPosition(body);
+	Vector3 center(p[0],p[1],p[2]);
+	Vector3 newCenter=center+translation;
 
-	const float cw=0.8f;//like a truck
-	const float area=0.5f*0.2f;//just a guess
-	const float density=1.2f;//air at 20 degrees celsius is 1.2kg/m^3
+	dBodyID bodies[11];
+	int count=getBodies(bodies);
+	for(int i=0;i<count;++i)
+	{
+		dBodyID b=bodies[i];
 
-	float force=0.5*density*cw*area*speed*speed;
-	currentAirFriction=force;
+		p=dBodyGetPosition(b);
+		Vector3 position=newCenter+rotate(rotation,Vector3(p[0],p[1],p[2])-center);
 
-	//calculate force vector
-	const dReal *v = dBodyGetLinearVel(body);
-	Vector3 v2(v[0],v[1],v[2]);
-	v2=-normalize(v2)*force;
-	
-	dBodyAddForce(body,v2.getX(),v2.getY(),v2.getZ());
+		//ODE quaternions are w,x,y,z
+		const dReal *q=dBodyGetQuaternion(b);
+		Quat orientation=normalize(rotation*Quat(q[1],q[2],q[3],q[0]));
+		dQuaternion dq={orientation.getW(),orientation.getX(),orientation.getY(),orientation.getZ()};
+
+		const dReal *v=dBodyGetLinearVel(b);
+		Vector3 vel=rotate(rotation,Vector3(v[0],v[1],v[2]))+linearVel+cross(angularVel,position-newCenter);
+		const dReal *w=dBodyGetAngularVel(b);
+		Vector3 angular=rotate(rotation,Vector3(w[0],w[1],w[2]))+angularVel;
+
+		dBodySetPosition(b,position.getX(),position.getY(),position.getZ());
+		dBodySetQuaternion(b,dq);
+		dBodySetLinearVel(b,vel.getX(),vel.getY(),vel.getZ());
+		dBodySetAngularVel(b,angular.getX(),angular.getY(),angular.getZ());
+	}
 }
 
-void OdeCopter::calcRealAngles(float &x,float &z) const
+void OdeCopter::recomputeForces()
 {
-	//this is like QuadCopter::calcAnglesFromAcceleration
-	dVector3 dv;
-	dBodyVectorToWorld(body,0,1,0,dv);
-	
-	float ax=-dv[0],ay=dv[1],az=-dv[2];
-	
-	//rotation about x axis
-	float gx=atan2(az,ay);
-	
-	//rotation about z axis
-	float gz=-atan2(ax,ay);
+	dBodyID bodies[11];
+	int count=getBodies(bodies);
+	for(int i=0;i<count;++i)
+	{
+		dBodySetForce(bodies[i],0,0,0);
+		dBodySetTorque(bodies[i],0,0,0);
+	}
 
-	x=gx;
-	z=gz;
+	addForces();
+	engineXp.addTorque();
+	engineXm.addTorque();
+	engineZp.addTorque();
+	engineZm.addTorque();
 }
 
-Vector3 OdeCopter::getPosition()
+void OdeCopter::addAirFrictionForce()
 {
-	const dReal *v=dBodyGetPosition(body);
-	return Vector3(v[0],v[1],v[2]);
+	Vector3 force=calcAirFrictionForce();
+	dBodyAddForce(body,force.getX(),force.getY(),force.getZ());
 }
 
-Quat OdeCopter::getOrientation()
+Vector3 OdeCopter::getPosition() const
 {
-	const dReal *v=dBodyGetQuaternion(body);
-	return Quat(v[3],v[0],v[1],v[2]);
+	const dReal *v=dBodyGetPosition(body);
+	return Vector3(v[0],v[1],v[2]);
 }
 
-float OdeCopter::getTotalThrust() const
+Quat OdeCopter::getOrientation() const
 {
-	return engineXp.currentForce()+
-		engineXm.currentForce()+
-		engineZp.currentForce()+
-		engineZm.currentForce();
+	//ODE quaternions are w,x,y,z
+	const dReal *v=dBodyGetQuaternion(body);
+	return Quat(v[1],v[2],v[3],v[0]);
 }
 
-QuadCopter::QuadCopter(float size)
+QuadCopter::QuadCopter(float size, Backend backend)
 {
 	this->size=size;
-	physics=new OdeCopter(this,size);
+	if(backend==BackendNative)
+	{
+		physics=NULL;
+		dynamics=new NativeCopter(this,size);
+	}
+	else
+	{
+		physics=new OdeCopter(this,size);
+		dynamics=physics;
+	}
 	remote=new UdpCopter(this);
 	gyroIntX = gyroIntY = gyroIntZ = 0.0f;
 
 	//hardware and flightcontrol init
-	actuatorForward.init(&physics->engineZp);
-	actuatorBackward.init(&physics->engineZm);
-	actuatorLeft.init(&physics->engineXp);
-	actuatorRight.init(&physics->engineXm);
+	actuatorForward.init(dynamics->getEngine(CopterDynamics::EngineZp));
+	actuatorBackward.init(dynamics->getEngine(CopterDynamics::EngineZm));
+	actuatorLeft.init(dynamics->getEngine(CopterDynamics::EngineXp));
+	actuatorRight.init(dynamics->getEngine(CopterDynamics::EngineXm));
+
+	controlMode=ControlFlightControl;
+	holdHeight=false;
 
 	flightControlTimer=0;
+	flightControlPeriod=0.022f;
 	flightcontrol_init();
 }
 
@@ -365,47 +496,49 @@ void QuadCopter::calcAnglesFromAcceleration(float &x, float &z)
 
 void QuadCopter::update(float dtime)
 {
+	vl::TraceZone zone("QuadCopter::update","sim");
 	gyroIntX += gyroX.getValue() * dtime;
 	gyroIntY += gyroY.getValue() * dtime;
 	gyroIntZ += gyroZ.getValue() * dtime;
 
 	flightControlTimer+=dtime;
-	if(flightControlTimer>=0.022f)
+	if(flightControlTimer>=flightControlPeriod)
 	{
-		flightControlTimer=fmod(flightControlTimer,0.022f);
-	//select here
-	switch(2)
+		vl::TraceZone tick("control tick","control");
+		flightControlTimer=fmod(flightControlTimer,flightControlPeriod);
+	switch(controlMode)
 	{
-	case 1:
+	case ControlBalance:
 	{
 		//old code
-		float throttle=control.throttle;// balanceY.update(dtime, physics->getPosition().getY(), control.throttle*10.0f);
+		float throttle=control.throttle;
+		if(holdHeight)
+			throttle=balanceY.update(flightControlPeriod, dynamics->getPosition().getY(), control.throttle*10.0f);
 
-		float roll=balanceZ.update(dtime, gyroZ.getValue(), control.roll);
-		float pitch=balanceX.update(dtime, gyroX.getValue(), control.pitch);
+		//the old balancer predates the I4Copter sign convention of the gyros
+		float roll=balanceZ.update(flightControlPeriod, -gyroZ.getValue(), control.roll);
+		float pitch=balanceX.update(flightControlPeriod, -gyroX.getValue(), control.pitch);
 
-		physics->engineXp.setThrottle(throttle+roll+control.yaw);
-		physics->engineXm.setThrottle(throttle-roll+control.yaw);
+		dynamics->getEngine(CopterDynamics::EngineXp)->setThrottle(throttle+roll+control.yaw);
+		dynamics->getEngine(CopterDynamics::EngineXm)->setThrottle(throttle-roll+control.yaw);
 	
-		physics->engineZp.setThrottle(throttle-pitch-control.yaw);
-		physics->engineZm.setThrottle(throttle+pitch-control.yaw);
+		dynamics->getEngine(CopterDynamics::EngineZp)->setThrottle(throttle-pitch-control.yaw);
+		dynamics->getEngine(CopterDynamics::EngineZm)->setThrottle(throttle+pitch-control.yaw);
 		break;
 	}
-	case 2:
-		//I4Copter flightcontrol
+	case ControlFlightControl:
 		flightcontrol_update(control,*this);
 		break;
-	case 3:
-		//no balancer, direct control
-		physics->engineXp.setThrottle(control.throttle+control.roll+control.yaw);
-		physics->engineXm.setThrottle(control.throttle-control.roll+control.yaw);
+	case ControlDirect:
+		dynamics->getEngine(CopterDynamics::EngineXp)->setThrottle(control.throttle+control.roll+control.yaw);
+		dynamics->getEngine(CopterDynamics::EngineXm)->setThrottle(control.throttle-control.roll+control.yaw);
 	
-		physics->engineZp.setThrottle(control.throttle-control.pitch-control.yaw);
-		physics->engineZm.setThrottle(control.throttle+control.pitch-control.yaw);
+		dynamics->getEngine(CopterDynamics::EngineZp)->setThrottle(control.throttle-control.pitch-control.yaw);
+		dynamics->getEngine(CopterDynamics::EngineZm)->setThrottle(control.throttle+control.pitch-control.yaw);
 	}
 	}
 
-	physics->update(dtime);
+	dynamics->update(dtime);
 	remote->update(dtime);
 }
 
@@ -425,13 +558,15 @@ float Sensor::getValue() const
 	return value + (((float)rand())/((float)RAND_MAX)-0.5f) * noise;
 }
 
-OdeEngine::OdeEngine(const Vector3& position)
+Engine::Engine(const Vector3& position)
 {
+	direction=1;
 	throttle=0;
 	this->position=position;
 	pwmThrottle=0;
 	pwmTimer=0;
 	acceleration=0;
+	currentRPM=0;
 
 	maxRPM=5000 + (((float)rand())/((float)RAND_MAX)-0.5f) * 100;
 	errorRPM=0;
@@ -439,22 +574,22 @@ OdeEngine::OdeEngine(const Vector3& position)
 	currentErrorRPM=0;
 }
 
-float OdeEngine::calcRPM(float throttle) const
+float Engine::calcRPM(float throttle) const
 {
 	//TODO: fitting function?
 	return std::max(0.0f,throttle * maxRPM + currentErrorRPM);
 }
 
-float OdeEngine::getTorque() const
+float Engine::getTorque() const
 {
 	return getRPM()/6000.0f*0.15f;
 }
-float OdeEngine::getThrottle() const
+float Engine::getThrottle() const
 {
 	return throttle;
 }
 
-void OdeEngine::setThrottle(float throttle)
+void Engine::setThrottle(float throttle)
 {
 	if(throttle>1.0f)
 		this->throttle=1.0f;
@@ -466,13 +601,13 @@ void OdeEngine::setThrottle(float throttle)
 		
 }
 
-float OdeEngine::getRPM() const
+float Engine::getRPM() const
 {
 	return currentRPM;
 	//return dJointGetHingeAngleRate(hinge) * 60.0f / 2.0f / 3.14f * direction;
 }
 
-void OdeEngine::update(float dtime)
+void Engine::update(float dtime)
 {
 	pwmTimer+=dtime;
 	if(pwmTimer>=(0.022f + 0.0f))//pwm signal length is 22ms
@@ -518,9 +653,26 @@ void OdeEngine::update(float dtime)
 
 
 	setRPM(current);
+}
 
-	if(simulatePropellerAirFriction)
-		dBodyAddRelTorque(motor,0,direction*getTorque(),0);
+void Engine::setRPM(float rpm)
+{
+	if(rpm<0.0f)
+		rpm=0.0f;
+	
+	currentRPM=rpm;
+}
+
+OdeEngine::OdeEngine(const Vector3& position):
+	Engine(position)
+{
+}
+
+void OdeEngine::update(float dtime)
+{
+	Engine::update(dtime);
+
+	addTorque();
 
 	//needed for high speed rotation
 	dVector3 v;
@@ -528,11 +680,36 @@ void OdeEngine::update(float dtime)
 	dBodySetFiniteRotationAxis(propeller,v[0],v[1],v[2]);
 }
 
-float OdeEngine::currentForce() const
+void OdeEngine::addTorque()
+{
+	if(simulatePropellerAirFriction)
+		dBodyAddRelTorque(motor,0,direction*getTorque(),0);
+}
+
+float Engine::getMaxRPM() const
+{
+	return maxRPM;
+}
+
+float Engine::getAcceleration() const
+{
+	return acceleration;
+}
+
+void Engine::setAcceleration(float acceleration)
+{
+	this->acceleration=acceleration;
+}
+
+float Engine::currentForce() const
+{
+	return forceAtRPM(getRPM());
+}
+
+float Engine::forceAtRPM(float x)
 {
 	//return throttle*5.0f;
 	//float force = std::max(0.0f,(9.9f * (throttle*100.0f) - 88.0f) * 0.01f);
-	float x=getRPM();
 	
 	//fitting functions for propellers
 	float epp=sqrt(34795*34795+x*x)-34816;
@@ -588,10 +765,8 @@ void OdeEngine::init(OdeCopter *copter,Vector3 position, float dir)
 
 void OdeEngine::setRPM(float rpm)
 {
-	if(rpm<0.0f)
-		rpm=0.0f;
-	
-	currentRPM=rpm;
+	Engine::setRPM(rpm);
+	rpm=getRPM();
 	
 	if(simulatePropellerRotation)
 		dJointSetHingeParam(hinge,dParamVel,rpm / 60.0f * 2.0f * 3.14f * direction);
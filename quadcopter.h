@@ -9,6 +9,7 @@
 #include <GL/gl.h>
 
 #include "udpremote.h"
+#include "rangesensor.h"
 
 //old balancer
 #include "balance.h"
@@ -23,6 +24,7 @@ namespace SimQuadCopter
 
 class QuadCopter;
 class OpenGL1;
+class CopterDynamics;
 class OdeCopter;
 class UdpCopter;
 
@@ -47,25 +49,30 @@ protected:
 	float value;
 };
 
-class OdeEngine
+//propeller and motor model without physics backend
+class Engine
 {
 public:
-	OdeEngine(const Vector3& position);
-	void init(OdeCopter *copter,Vector3 position, float dir);
-	
+	Engine(const Vector3& position);
+	virtual ~Engine() {}
+
 	void setThrottle(float throttle);
-	void setRPM(float rpm);
+	virtual void setRPM(float rpm);
 	float getThrottle() const;
 	
 	float currentForce() const;
 	float getTorque() const;
-	void update(float dtime);
+	virtual void update(float dtime);
 	float getRPM() const;
+	float getMaxRPM() const;
+
+	//state of the motor controller's speed filter
+	float getAcceleration() const;
+	void setAcceleration(float acceleration);
+
+	//thrust of a propeller at a given speed
+	static float forceAtRPM(float rpm);
 
-	dBodyID motor;
-	dBodyID propeller;
-	dJointID hinge;
-	dJointID fixed;//connects the engine to the quadcopter body
 	float direction;
 	Vector3 position;
 
@@ -95,35 +102,101 @@ protected:
 	float currentErrorRPM;
 };
 
-class OdeCopter
+class OdeEngine: public Engine
 {
 public:
-	OdeCopter(QuadCopter *copter, float size);
-	void update(float dtime);
+	OdeEngine(const Vector3& position);
+	void init(OdeCopter *copter,Vector3 position, float dir);
+	
+	virtual void setRPM(float rpm);
+	virtual void update(float dtime);
 
-	Vector3 getPosition();
-	Quat getOrientation();
+	//propeller air friction on the motor
+	void addTorque();
 
-	void setPosition(Vector3 v);
+	dBodyID motor;
+	dBodyID propeller;
+	dJointID hinge;
+	dJointID fixed;//connects the engine to the quadcopter body
+};
 
-	float getTotalThrust() const;
+//physics backend of a QuadCopter
+class CopterDynamics
+{
+public:
+	enum
+	{
+		EngineXp,
+		EngineXm,
+		EngineZp,
+		EngineZm,
+		EngineCount
+	};
+
+	CopterDynamics(QuadCopter *copter);
+	virtual ~CopterDynamics() {}
+
+	virtual void update(float dtime)=0;
+
+	//position of the frame center
+	virtual Vector3 getPosition() const=0;
+	virtual Quat getOrientation() const=0;
+	virtual void setPosition(Vector3 v)=0;
+	virtual Vector3 getSpeedVector() const=0;
+	//angular velocity in body coordinates
+	virtual Vector3 getBodyRates() const=0;
+	virtual float getMass() const=0;
+
+	virtual Engine *getEngine(int index) const=0;
 
-	void calcRealAngles(float &x,float &z) const;
-	
 	float getSpeed() const;
-	Vector3 getSpeedVector() const;
+	float getTotalThrust() const;
+	void calcRealAngles(float &x,float &z) const;
+
+	float currentAirFriction;
+	//constant force acting on the frame (wind, gusts), world coordinates
+	Vector3 externalForce;
+
+	QuadCopter *copter;
+
+protected:
+	//air friction for the current speed, updates currentAirFriction
+	Vector3 calcAirFrictionForce();
+	//gyro and acceleration sensors of the copter
+	void updateSensors(float dtime);
+
+	Vector3 lastSpeed;//for acceleration sensor
+};
+
+class OdeCopter: public CopterDynamics
+{
+public:
+	OdeCopter(QuadCopter *copter, float size);
+	virtual void update(float dtime);
+
+	virtual Vector3 getPosition() const;
+	virtual Quat getOrientation() const;
+	virtual void setPosition(Vector3 v);
+	virtual Vector3 getSpeedVector() const;
+	virtual Vector3 getBodyRates() const;
+	virtual float getMass() const;
+
+	virtual Engine *getEngine(int index) const;
 
 	void addAirFrictionForce();
 
+	//moves all bodies of the copter as one rigid body: rotation about the
+	//frame center, then translation. velocities (world coordinates) are
+	//added after rotating the current ones. spinning propellers keep spinning.
+	void moveRigid(const Vector3 &translation, const Quat &rotation, const Vector3 &linearVel, const Vector3 &angularVel);
+	//replaces the forces accumulated for the next step, needed after moveRigid
+	void recomputeForces();
+
 	dBodyID body;//frame body
 	dMass mass;//frame mass
 	dBodyID battery;
 	dBodyID boards;
 
-	float currentAirFriction;
-
-	QuadCopter *copter;
-	
 	OdeEngine engineXp;
 	OdeEngine engineXm;
 	OdeEngine engineZp;
@@ -132,6 +205,9 @@ public:
 	// this joint mounts the copter to the static environment for testing
 	dJointID mountJoint;
 
+	//sonars and lidars on the frame, cast against space after each step
+	RangeSensors rangeSensors;
+
 	static void init();
 	static void close();
 	static dWorldID world;
@@ -144,6 +220,9 @@ protected:
 	void mountHingeZ();
 
 	void addEngineForce(const OdeEngine& engine);
+	void addForces();
+	int getBodies(dBodyID *bodies) const;
+
 	static void nearCallback (void *data, dGeomID o1, dGeomID o2);
 };
 
@@ -160,9 +239,25 @@ public:
 class QuadCopter
 {
 public:
-	QuadCopter(float size);
+	enum Backend
+	{
+		BackendOde,
+		BackendNative//NativeCopter, no ODE bodies for the viewer
+	};
+
+	QuadCopter(float size, Backend backend=BackendOde);
+
+	enum ControlMode
+	{
+		ControlBalance=1,//old balancer
+		ControlFlightControl=2,//I4Copter flightcontrol
+		ControlDirect=3//no balancer, direct control
+	};
 
 	Control control;
+	ControlMode controlMode;
+	//only used by ControlBalance: throttle is the wanted altitude in 10m instead of raw throttle
+	bool holdHeight;
 
 	void update(float dtime);
 
@@ -180,7 +275,8 @@ public:
 	Sensor accelZ;
 
 
-	OdeCopter *physics;
+	CopterDynamics *dynamics;
+	OdeCopter *physics;//same as dynamics for BackendOde, NULL otherwise
 	UdpCopter *remote;
 
 	Balance balanceX;
@@ -189,6 +285,7 @@ public:
 
 	float size;
 	float flightControlTimer;
+	float flightControlPeriod;
 };
 
 class OpenGL1
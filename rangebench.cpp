@@ -0,0 +1,165 @@
+//measures what the range sensors cost per simulation step: the copter hovers
+//among pillars once without sensors, once with a sonar and lidars casting on
+//the simulation thread and once with the casts on worker threads.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "quadcopter.h"
+#include "parallel.h"
+
+using namespace SimQuadCopter;
+
+static double seconds()
+{
+	struct timeval tv;
+	gettimeofday(&tv,NULL);
+	return tv.tv_sec+tv.tv_usec*1e-6;
+}
+
+enum
+{
+	JobNone,
+	JobInline,
+	JobThreads,
+	JobCount
+};
+
+static const char *jobNames[JobCount]={"no sensors","inline","threads"};
+
+class RangeJob: public ParallelJob
+{
+public:
+	virtual void run(int index, std::vector<float> &result)
+	{
+		srand(1);
+		QuadCopter copter(0.51f);
+		copter.controlMode=QuadCopter::ControlBalance;
+		copter.holdHeight=true;
+		copter.control.throttle=0.1f;//1m
+
+		//pillars 4m high on circles around the start
+		for(int i=0;i<pillars;++i)
+		{
+			float a=i*2.399963f;//golden angle
+			float r=3.0f+7.0f*(i%8)/8.0f;
+			dGeomID pillar=dCreateBox(OdeCopter::space,0.3f,4,0.3f);
+			dGeomSetPosition(pillar,r*cosf(a),2,r*sinf(a));
+		}
+
+		RangeSensors &sensors=copter.physics->rangeSensors;
+		if(index!=JobNone)
+		{
+			sensors.add(RangeSensor::createSonar(Vector3(0,-0.05f,0),Vector3(0,-1,0),0.26f,6,20));
+			for(int i=0;i<lidars;++i)
+				sensors.add(RangeSensor::createLidar(Vector3(0,0.08f+0.02f*i,0),beams,30,rate));
+		}
+		if(index==JobThreads)
+			sensors.setThreads(threads);
+
+		//settle before the clock starts
+		for(float t=0;t<1;t+=dtime)
+			copter.update(dtime);
+
+		int steps=(int)(time/dtime);
+		long long rays=0;
+		double start=seconds();
+		for(int i=0;i<steps;++i)
+		{
+			copter.update(dtime);
+			rays+=sensors.lastRays;
+		}
+		double wall=seconds()-start;
+
+		float mean=0;
+		int scans=0;
+		if(index!=JobNone && lidars>0)
+		{
+			RangeSensor *lidar=sensors.get(1);
+			for(int i=0;i<lidar->getBeamCount();++i)
+				mean+=lidar->getRange(i);
+			mean/=lidar->getBeamCount();
+			scans=lidar->getScanCount();
+		}
+
+		result.push_back(wall/steps);
+		result.push_back((float)rays/steps);
+		result.push_back(mean);
+		result.push_back(scans);
+		result.push_back(copter.dynamics->getPosition().getY());
+	}
+
+	int beams;
+	float rate;
+	int lidars;
+	int threads;
+	int pillars;
+	float time;
+	float dtime;
+};
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-b beams] [-r rate] [-l lidars] [-t threads] [-o pillars] [-s seconds] [-j jobs]\n",name);
+	printf("  -b  beams per lidar scan (default: 360)\n");
+	printf("  -r  lidar scans per second (default: 20)\n");
+	printf("  -l  lidars on the copter (default: 1)\n");
+	printf("  -t  worker threads of the threaded run (default: 2)\n");
+	printf("  -o  pillars around the copter (default: 32)\n");
+	printf("  -s  simulated seconds per run (default: 20)\n");
+	printf("  -j  runs at the same time (default: 1, more disturbs the timing)\n");
+}
+
+int main(int argc, char *argv[])
+{
+	RangeJob job;
+	job.beams=360;
+	job.rate=20;
+	job.lidars=1;
+	job.threads=2;
+	job.pillars=32;
+	job.time=20;
+	job.dtime=0.005f;
+	int jobs=1;
+
+	int c;
+	while((c=getopt(argc,argv,"b:r:l:t:o:s:j:h"))!=-1)
+	{
+		switch(c)
+		{
+		case 'b': job.beams=atoi(optarg); break;
+		case 'r': job.rate=(float)atof(optarg); break;
+		case 'l': job.lidars=atoi(optarg); break;
+		case 't': job.threads=atoi(optarg); break;
+		case 'o': job.pillars=atoi(optarg); break;
+		case 's': job.time=(float)atof(optarg); break;
+		case 'j': jobs=atoi(optarg); break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	ParallelRunner runner(jobs);
+	std::vector< std::vector<float> > results;
+	runner.run(job,JobCount,results);
+
+	printf("%d lidars of %d beams at %.0f Hz, %d pillars, %.0fs at %.0f steps/s\n",job.lidars,job.beams,job.rate,job.pillars,job.time,1.0f/job.dtime);
+	printf("%-12s %10s %10s %10s %10s %8s %8s\n","run","us/step","rays/step","sensors us","mean range","scans","altitude");
+	float base=results[JobNone].size()>0 ? results[JobNone][0] : 0;
+	for(int i=0;i<JobCount;++i)
+	{
+		const std::vector<float> &r=results[i];
+		if(r.size()<5)
+		{
+			printf("%-12s failed\n",jobNames[i]);
+			continue;
+		}
+		printf("%-12s %10.1f %10.1f %10.1f %9.2fm %8.0f %7.2fm\n",jobNames[i],r[0]*1e6,r[1],(r[0]-base)*1e6,r[2],r[3],r[4]);
+	}
+
+	return 0;
+}
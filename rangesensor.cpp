@@ -0,0 +1,341 @@
+#include "rangesensor.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <vl/Trace.hpp>
+
+namespace SimQuadCopter
+{
+
+RangeSensor::RangeSensor(const Vector3 &position, float maxRange, float rate, bool scanning):
+	position(position)
+{
+	noise=0;
+	this->maxRange=maxRange;
+	this->rate=rate;
+	this->scanning=scanning;
+	budget=0;
+	nextBeam=0;
+	scans=0;
+	aimed=0;
+	frame=0;
+	seed=1;
+	space=dSimpleSpaceCreate(0);
+}
+
+RangeSensor::~RangeSensor()
+{
+	//destroys the rays too
+	dSpaceDestroy(space);
+}
+
+void RangeSensor::addBeam(const Vector3 &direction)
+{
+	directions.push_back(normalize(direction));
+	ranges.push_back(maxRange);
+}
+
+RangeSensor *RangeSensor::createSonar(const Vector3 &position, const Vector3 &direction, float coneAngle, float maxRange, float rate)
+{
+	RangeSensor *sonar=new RangeSensor(position,maxRange,rate,false);
+	Vector3 axis=normalize(direction);
+	sonar->addBeam(axis);
+	if(coneAngle<=0)
+		return sonar;
+
+	//6 beams around the axis on the edge of the cone
+	Vector3 side=cross(axis,fabs(axis.getY())<0.9f ? Vector3(0,1,0) : Vector3(1,0,0));
+	side=normalize(side);
+	Vector3 up=cross(side,axis);
+	for(int i=0;i<6;++i)
+	{
+		float a=i*(float)M_PI/3.0f;
+		Vector3 edge=side*cosf(a)+up*sinf(a);
+		sonar->addBeam(axis*cosf(coneAngle)+edge*sinf(coneAngle));
+	}
+	return sonar;
+}
+
+RangeSensor *RangeSensor::createLidar(const Vector3 &position, int beams, float maxRange, float rate)
+{
+	RangeSensor *lidar=new RangeSensor(position,maxRange,rate,true);
+	for(int i=0;i<beams;++i)
+	{
+		float a=i*2.0f*(float)M_PI/beams;
+		lidar->addBeam(Vector3(cosf(a),0,sinf(a)));
+	}
+	return lidar;
+}
+
+float RangeSensor::getRange(int beam) const
+{
+	return ranges[beam];
+}
+
+float RangeSensor::getMinRange() const
+{
+	float range=maxRange;
+	for(size_t i=0;i<ranges.size();++i)
+		if(ranges[i]<range)
+			range=ranges[i];
+	return range;
+}
+
+int RangeSensor::aim(float dtime, dBodyID body)
+{
+	int count=getBeamCount();
+	aimed=0;
+	if(count==0)
+		return 0;
+
+	budget+=dtime*rate*count;
+	int due=scanning ? (int)budget : (budget>=count ? count : 0);
+	if(due>count)
+		due=count;
+	budget-=due;
+	//after a long step don't try to catch up
+	if(budget>=count)
+		budget=0;
+	if(due==0)
+		return 0;
+
+	while((int)rays.size()<due)
+	{
+		dGeomID ray=dCreateRay(space,maxRange);
+		//the nearest hit, not the first one found (matters for trimeshes)
+		dGeomRaySetClosestHit(ray,1);
+		dGeomSetData(ray,(void*)rays.size());
+		rays.push_back(ray);
+		rayBeams.push_back(0);
+		rayHits.push_back(maxRange);
+	}
+
+	dVector3 origin;
+	dBodyGetRelPointPos(body,position.getX(),position.getY(),position.getZ(),origin);
+	for(int i=0;i<due;++i)
+	{
+		const Vector3 &d=directions[nextBeam];
+		dVector3 direction;
+		dBodyVectorToWorld(body,d.getX(),d.getY(),d.getZ(),direction);
+		dGeomRaySetLength(rays[i],maxRange);
+		dGeomRaySet(rays[i],origin[0],origin[1],origin[2],direction[0],direction[1],direction[2]);
+		dGeomEnable(rays[i]);
+		rayBeams[i]=nextBeam;
+		rayHits[i]=maxRange;
+
+		nextBeam++;
+		if(nextBeam==count)
+		{
+			nextBeam=0;
+			scans++;
+		}
+	}
+	//the rest of the pool stays out of the collision tests
+	for(size_t i=due;i<rays.size();++i)
+		dGeomDisable(rays[i]);
+
+	aimed=due;
+	return due;
+}
+
+void RangeSensor::collect(dSpaceID world, dBodyID frame)
+{
+	candidates.clear();
+	this->frame=frame;
+	dSpaceCollide2((dGeomID)space,(dGeomID)world,this,&pairCallback);
+}
+
+void RangeSensor::cast()
+{
+	vl::TraceZone zone("RangeSensor::cast","physics");
+	//for rays the depth is the distance from the origin
+	for(size_t i=0;i<candidates.size();++i)
+	{
+		int ray=candidates[i].first;
+		dContactGeom contact;
+		if(dCollide(rays[ray],candidates[i].second,1,&contact,sizeof(dContactGeom))>0 && contact.depth<rayHits[ray])
+			rayHits[ray]=contact.depth;
+	}
+
+	for(int i=0;i<aimed;++i)
+	{
+		float range=rayHits[i];
+		if(range<maxRange && noise>0)
+			range+=(((float)rand_r(&seed))/((float)RAND_MAX)-0.5f)*noise;
+		ranges[rayBeams[i]]=range;
+	}
+}
+
+void RangeSensor::pairCallback(void *data, dGeomID o1, dGeomID o2)
+{
+	//a ray against a subspace of the world, the subspace culls its geoms
+	if(dGeomIsSpace(o1) || dGeomIsSpace(o2))
+	{
+		dSpaceCollide2(o1,o2,data,&pairCallback);
+		return;
+	}
+
+	RangeSensor *sensor=(RangeSensor*)data;
+	dGeomID ray=o1;
+	dGeomID other=o2;
+	if(dGeomGetSpace(ray)!=sensor->space)
+	{
+		ray=o2;
+		other=o1;
+	}
+	if(sensor->frame && dGeomGetBody(other)==sensor->frame)
+		return;
+	sensor->candidates.push_back(std::make_pair((int)(size_t)dGeomGetData(ray),other));
+}
+
+RangeSensors::RangeSensors()
+{
+	lastRays=0;
+	body=0;
+	next=0;
+	busy=0;
+	generation=0;
+	quit=false;
+	pthread_mutex_init(&mutex,NULL);
+	pthread_cond_init(&wake,NULL);
+	pthread_cond_init(&done,NULL);
+}
+
+RangeSensors::~RangeSensors()
+{
+	stopWorkers();
+	for(size_t i=0;i<sensors.size();++i)
+		delete sensors[i];
+	pthread_cond_destroy(&done);
+	pthread_cond_destroy(&wake);
+	pthread_mutex_destroy(&mutex);
+}
+
+void RangeSensors::setBody(dBodyID b)
+{
+	body=b;
+}
+
+void RangeSensors::setThreads(int threads)
+{
+	stopWorkers();
+	startWorkers(threads);
+}
+
+RangeSensor *RangeSensors::add(RangeSensor *sensor)
+{
+	sensors.push_back(sensor);
+	return sensor;
+}
+
+void RangeSensors::update(float dtime, dSpaceID space)
+{
+	lastRays=0;
+	pending.clear();
+	for(size_t i=0;i<sensors.size();++i)
+	{
+		int rays=sensors[i]->aim(dtime,body);
+		if(rays>0)
+		{
+			pending.push_back(sensors[i]);
+			lastRays+=rays;
+		}
+	}
+	if(pending.empty())
+		return;
+
+	//the spaces update their bounds while colliding, so the broadphase
+	//stays on this thread and the workers only run dCollide
+	for(size_t i=0;i<pending.size();++i)
+		pending[i]->collect(space,body);
+
+	if(workers.empty() || pending.size()<2)
+	{
+		for(size_t i=0;i<pending.size();++i)
+			pending[i]->cast();
+		return;
+	}
+
+	pthread_mutex_lock(&mutex);
+	next=0;
+	busy=(int)pending.size();
+	generation++;
+	pthread_cond_broadcast(&wake);
+	//the calling thread casts too
+	castPending();
+	while(busy>0)
+		pthread_cond_wait(&done,&mutex);
+	pthread_mutex_unlock(&mutex);
+}
+
+void RangeSensors::castPending()
+{
+	//called with the mutex locked
+	while(next<(int)pending.size())
+	{
+		RangeSensor *sensor=pending[next++];
+		pthread_mutex_unlock(&mutex);
+		sensor->cast();
+		pthread_mutex_lock(&mutex);
+		if(--busy==0)
+			pthread_cond_broadcast(&done);
+	}
+}
+
+void RangeSensors::startWorkers(int count)
+{
+	for(int i=0;i<count;++i)
+	{
+		pthread_t thread;
+		if(pthread_create(&thread,NULL,&workerMain,this)!=0)
+		{
+			perror("pthread_create");
+			break;
+		}
+		workers.push_back(thread);
+	}
+}
+
+void RangeSensors::stopWorkers()
+{
+	pthread_mutex_lock(&mutex);
+	quit=true;
+	pthread_cond_broadcast(&wake);
+	pthread_mutex_unlock(&mutex);
+	for(size_t i=0;i<workers.size();++i)
+		pthread_join(workers[i],NULL);
+	workers.clear();
+	quit=false;
+}
+
+void *RangeSensors::workerMain(void *sensors)
+{
+	((RangeSensors*)sensors)->workerLoop();
+	return NULL;
+}
+
+void RangeSensors::workerLoop()
+{
+	//the colliders keep per thread caches
+	dAllocateODEDataForThread(dAllocateMaskAll);
+	vl::Trace::setThreadName("range sensors");
+
+	pthread_mutex_lock(&mutex);
+	int seen=generation;
+	for(;;)
+	{
+		while(!quit && generation==seen)
+			pthread_cond_wait(&wake,&mutex);
+		if(quit)
+			break;
+		seen=generation;
+		castPending();
+	}
+	pthread_mutex_unlock(&mutex);
+
+	dCleanupODEAllDataForThread();
+}
+
+}
@@ -0,0 +1,133 @@
+#ifndef __RANGESENSOR_H
+#define __RANGESENSOR_H
+
+#include <vector>
+#include <pthread.h>
+
+#include <ode/ode.h>
+#include "vectormath/vectormath_aos.h"
+
+using namespace Vectormath::Aos;
+
+namespace SimQuadCopter
+{
+
+//distance sensor on the airframe, made of beams cast as ODE rays.
+//
+//a sonar fires all its beams together rate times per second and reads the
+//nearest hit. a scanning sensor (lidar) turns once per 1/rate seconds and
+//fires its beams in order as it passes them, so the beams of a scan are
+//spread over the steps instead of all landing on one.
+//
+//the rays live in a space of their own that is never part of the world
+//space, so they don't make contacts and are only tested against the
+//environment. the space holds as many rays as beams fire in one step, they
+//are aimed at the beams due in each step. the ray space is collided with
+//the world space, so the broadphase of the world space picks the geoms
+//each ray is tested against.
+class RangeSensor
+{
+public:
+	//position and beam directions in body coordinates, ranges in meters
+	RangeSensor(const Vector3 &position, float maxRange, float rate, bool scanning);
+	~RangeSensor();
+
+	void addBeam(const Vector3 &direction);
+
+	//single beam, or a cone of beams of the given half angle (radians)
+	static RangeSensor *createSonar(const Vector3 &position, const Vector3 &direction, float coneAngle, float maxRange, float rate);
+	//beams evenly spread in the horizontal plane of the copter, starting at +x
+	static RangeSensor *createLidar(const Vector3 &position, int beams, float maxRange, float rate);
+
+	int getBeamCount() const { return (int)directions.size(); }
+	//distance of the last hit of beam, maxRange if it hit nothing
+	float getRange(int beam) const;
+	//nearest hit of all beams, the reading of a sonar
+	float getMinRange() const;
+	//completed scans (or sonar pings) so far
+	int getScanCount() const { return scans; }
+
+	float noise;
+	float maxRange;
+
+protected:
+	friend class RangeSensors;
+
+	//main thread: picks and aims the rays due in this step, returns their number
+	int aim(float dtime, dBodyID body);
+	//main thread: finds the geoms of world near the aimed rays, except the
+	//ones of frame (the rays start inside it)
+	void collect(dSpaceID world, dBodyID frame);
+	//casts the aimed rays at the collected geoms, may run on a worker thread
+	void cast();
+	static void pairCallback(void *data, dGeomID o1, dGeomID o2);
+
+	Vector3 position;
+	std::vector<Vector3> directions;
+	std::vector<float> ranges;
+	float rate;
+	bool scanning;
+	float budget;//beams that may fire
+	int nextBeam;
+	int scans;
+
+	dSpaceID space;
+	std::vector<dGeomID> rays;
+	std::vector<int> rayBeams;//beam of each ray this step
+	std::vector<float> rayHits;
+	int aimed;
+	//ray index and geom of the pairs whose bounds overlap
+	std::vector< std::pair<int,dGeomID> > candidates;
+	dBodyID frame;
+	unsigned int seed;//of the noise, rand() isn't thread safe
+};
+
+//the range sensors of one body, updated once per simulation step.
+//the broadphase runs on the calling thread, with threads>0 the sensors
+//cast their rays at the geoms it found on worker threads. see rangebench
+//for what that is worth.
+class RangeSensors
+{
+public:
+	RangeSensors();
+	~RangeSensors();
+
+	void setBody(dBodyID body);
+	void setThreads(int threads);
+
+	//takes ownership
+	RangeSensor *add(RangeSensor *sensor);
+	int getCount() const { return (int)sensors.size(); }
+	RangeSensor *get(int index) const { return sensors[index]; }
+
+	//call after the world step, with the geoms of the world in space
+	void update(float dtime, dSpaceID space);
+
+	//rays cast in the last update
+	int lastRays;
+
+protected:
+	void startWorkers(int count);
+	void stopWorkers();
+	static void *workerMain(void *sensors);
+	void workerLoop();
+	//casts the aimed sensors from index next on, shared by the workers
+	void castPending();
+
+	dBodyID body;
+	std::vector<RangeSensor*> sensors;
+
+	std::vector<pthread_t> workers;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	std::vector<RangeSensor*> pending;
+	int next;//next pending sensor to cast
+	int busy;//pending sensors not finished
+	int generation;//of the batch, wakes the workers
+	bool quit;
+};
+
+}
+
+#endif
@@ -0,0 +1,90 @@
+//measures the cost of the vl::Object reference counts.
+//
+//usage: refcountbench [threads]
+//built twice by "make refcountbench", once with the plain counts and once
+//with VL_THREAD_SAFE_REF_COUNT=1, run both to compare. every test copies
+//ref<> into a vector, one increment and one decrement per copy:
+//- private: each thread copies its own objects
+//- shared: all the threads copy the same objects, the counters bounce
+//  between the caches. only run with the atomic counts.
+//threads defaults to one per core.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include <vl/Object.hpp>
+#include <vl/Time.hpp>
+#include <vl/ThreadPool.hpp>
+
+enum
+{
+	ObjectCount=1024,
+	Rounds=4000
+};
+
+typedef std::vector< vl::ref<vl::Object> > RefVector;
+
+static void copyRefs(RefVector &copies, const RefVector &objects)
+{
+	for(int r=0;r<Rounds;r++)
+		for(int i=0;i<ObjectCount;i++)
+			copies[i]=objects[(i*7+r)%ObjectCount];
+}
+
+static RefVector makeObjects()
+{
+	RefVector objects(ObjectCount);
+	for(int i=0;i<ObjectCount;i++)
+		objects[i]=new vl::Object;
+	return objects;
+}
+
+class CopyTask: public vl::ThreadTask
+{
+public:
+	CopyTask(int threads, bool shared)
+	{
+		RefVector common=makeObjects();
+		for(int t=0;t<threads;t++)
+		{
+			objects.push_back(shared ? common : makeObjects());
+			copies.push_back(RefVector(ObjectCount));
+		}
+	}
+	virtual void run(int index)
+	{
+		copyRefs(copies[index],objects[index]);
+	}
+
+	std::vector<RefVector> objects;
+	std::vector<RefVector> copies;
+};
+
+//nanoseconds per copy of each thread
+static double runTest(vl::ThreadPool *pool, int threads, bool shared)
+{
+	CopyTask task(threads,shared);
+	double start=vl::Time::timerSeconds();
+	pool->run(&task,threads);
+	double elapsed=vl::Time::timerSeconds()-start;
+	return elapsed*1e9/((double)Rounds*ObjectCount);
+}
+
+int main(int argc, char **argv)
+{
+	int threads=argc>1 ? atoi(argv[1]) : vl::ThreadPool::cpuCount();
+	if(threads<1)
+		threads=1;
+	vl::ref<vl::ThreadPool> single=new vl::ThreadPool(1);
+	vl::ref<vl::ThreadPool> pool=new vl::ThreadPool(threads);
+
+	printf("reference counts: %s\n",vl::THREAD_SAFE_REF_COUNT ? "atomic" : "plain");
+	printf("1 thread, private objects:  %6.2f ns per copy\n",runTest(single.get(),1,false));
+	if(threads>1)
+		printf("%d threads, private objects: %6.2f ns per copy\n",threads,runTest(pool.get(),threads,false));
+	if(threads>1 && vl::THREAD_SAFE_REF_COUNT)
+		printf("%d threads, shared objects:  %6.2f ns per copy\n",threads,runTest(pool.get(),threads,true));
+	return 0;
+}
@@ -0,0 +1,226 @@
+//renders flights to videos without a window, for batch machines without
+//display or GPU. every flight renders in its own process with its own
+//offscreen context (vlEGL, Mesa's llvmpipe when there is no GPU) and the
+//viewer's scene and follow camera.
+//
+//without logs the standard maneuvers are flown like comparedynamics does,
+//with logs (see writeFlightLog) the recorded flights are rendered.
+//output: <prefix><name>.y4m, or <prefix><name>-0000.ppm... with -p.
+//-t adds a timeline of the flight and the rendering, <prefix><name>.json.
+//run from the source directory, the models and shaders are loaded from there.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <vl/VisualizationLibrary.hpp>
+#include <vl/CameraVideoCapture.hpp>
+#include <vl/Trace.hpp>
+#include <vlut/RenderPipeline.hpp>
+#include <vlEGL/EGL_Offscreen.hpp>
+
+#include "headless.h"
+#include "parallel.h"
+#include "copterscene.h"
+
+using namespace SimQuadCopter;
+
+//file name without directory and extension
+static std::string flightName(const char *path)
+{
+	const char *slash=strrchr(path,'/');
+	std::string name=slash ? slash+1 : path;
+	size_t dot=name.rfind('.');
+	if(dot!=std::string::npos && dot>0)
+		name.erase(dot);
+	return name;
+}
+
+//job i renders log i, or flies and renders maneuver i. the result is the frame count.
+class RenderJob: public ParallelJob
+{
+public:
+	RenderJob()
+	{
+		width=640;
+		height=480;
+		fps=30;
+		ppm=false;
+		record=false;
+		trace=false;
+		size=0.51f;
+		spinRate=7.0f;
+	}
+
+	virtual void run(int index, std::vector<float> &result)
+	{
+		vl::Trace::setThreadName("flight");
+		vl::Trace::setEnabled(trace);
+
+		std::vector<FlightSample> samples;
+		std::string name;
+		if(!logs.empty())
+		{
+			name=flightName(logs[index]);
+			if(!loadFlightLog(logs[index],samples))
+			{
+				printf("could not read %s\n",logs[index]);
+				return;
+			}
+		}
+		else
+		{
+			name=Maneuver::getName(index);
+			flight.samples=&samples;
+			flight.fly(index,gains);
+		}
+
+		if(record)
+		{
+			std::string file=prefix+name+".flight";
+			FILE *f=fopen(file.c_str(),"w");
+			if(f)
+			{
+				writeFlightLog(f,samples);
+				fclose(f);
+			}
+		}
+
+		if(samples.empty())
+			return;
+		result.push_back(render(samples,name));
+
+		std::string file=prefix+name+".json";
+		if(trace && !vl::Trace::writeChromeTrace(file))
+			perror(file.c_str());
+	}
+
+	int render(const std::vector<FlightSample> &samples, const std::string &name)
+	{
+		//the context can't survive a fork, every child makes its own
+		vl::visualization_library_init();
+		vl::ref<vlut::RenderPipeline> pipeline=new vlut::RenderPipeline;
+		vl::ref<vlEGL::EGL_Offscreen> context=vlEGL::open_EGL_Offscreen(pipeline.get(),width,height,vl::vec4(1,1,1,1));
+		if(!context)
+			return 0;
+		pipeline->camera()->setFOV(70);
+		pipeline->camera()->setFarPlane(10000);
+
+		CopterScene scene;
+		scene.init(pipeline.get(),false);
+
+		vl::ref<vl::CameraVideoCapture> capture=new vl::CameraVideoCapture;
+		capture->setFrameRate(fps);
+		pipeline->camera()->addRenderFinishedCallback(capture.get());
+		std::string path=ppm ? prefix+name+"-" : prefix+name+".y4m";
+		if(!capture->start(path,ppm ? vl::CapturePPMSequence : vl::CaptureY4M,0,0,width,height,vl::RDB_COLOR_ATTACHMENT0_EXT))
+			return 0;
+
+		//one frame every 1/fps seconds of flight, showing the last sample before it
+		size_t s=0;
+		for(float t=samples.front().time;t<=samples.back().time;t+=1.0f/fps)
+		{
+			while(s+1<samples.size() && samples[s+1].time<=t)
+				++s;
+			scene.setFlightSample(samples[s],size,t*spinRate*360.0f);
+
+			vl::mat4d body=scene.body->localMatrix();
+			scene.addFlownPoint(body.getT());
+			pipeline->camera()->setViewMatrixAsLookAt(CopterScene::followEye(body),body.getT(),vl::vec3d(0,1,0));
+			pipeline->executeRendering();
+		}
+		capture->stop();
+
+		printf("%s: %d frames\n",path.c_str(),capture->frameCount());
+		return capture->frameCount();
+	}
+
+	HeadlessFlight flight;
+	GainSet gains;
+	std::vector<const char*> logs;
+	std::string prefix;
+	int width,height;
+	int fps;
+	bool ppm;
+	bool record;
+	bool trace;
+	float size;//of the copter, as flown by HeadlessFlight
+	float spinRate;//propeller turns per second, slow enough to see them turn
+};
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-i gains] [-j jobs] [-s WxH] [-f fps] [-o prefix] [-p] [-r] [-t] [log...]\n",name);
+	printf("  -i  fly with the gains in this file (see autotune)\n");
+	printf("  -j  parallel renderings (default: number of cores)\n");
+	printf("  -s  frame size (default: 640x480)\n");
+	printf("  -f  frames per second of flight (default: 30)\n");
+	printf("  -o  prepended to the output files, e.g. a directory\n");
+	printf("  -p  write a PPM file per frame instead of a Y4M video\n");
+	printf("  -r  write the flown samples to <prefix><maneuver>.flight\n");
+	printf("  -t  write a Chrome trace of the simulation and the rendering to <prefix><maneuver>.json\n");
+	printf("  logs render these flights instead of flying the maneuvers\n");
+}
+
+int main(int argc, char *argv[])
+{
+	RenderJob job;
+	int jobs=0;
+
+	int c;
+	while((c=getopt(argc,argv,"i:j:s:f:o:prth"))!=-1)
+	{
+		switch(c)
+		{
+		case 'i':
+			if(!job.gains.load(optarg))
+			{
+				printf("could not read gains from %s\n",optarg);
+				return 1;
+			}
+			break;
+		case 'j': jobs=atoi(optarg); break;
+		case 's':
+			if(sscanf(optarg,"%dx%d",&job.width,&job.height)!=2 || job.width<=0 || job.height<=0)
+			{
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'f':
+			job.fps=atoi(optarg);
+			if(job.fps<=0)
+			{
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'o': job.prefix=optarg; break;
+		case 'p': job.ppm=true; break;
+		case 'r': job.record=true; break;
+		case 't': job.trace=true; break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	for(int i=optind;i<argc;++i)
+		job.logs.push_back(argv[i]);
+
+	int count=job.logs.empty() ? (int)Maneuver::Count : (int)job.logs.size();
+	ParallelRunner runner(jobs);
+	std::vector< std::vector<float> > results;
+	runner.run(job,count,results);
+
+	int failed=0;
+	for(int i=0;i<count;++i)
+		if(results[i].empty() || results[i][0]==0)
+		{
+			printf("%s failed\n",job.logs.empty() ? Maneuver::getName(i) : job.logs[i]);
+			failed++;
+		}
+	return failed ? 1 : 0;
+}
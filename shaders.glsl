@@ -84,3 +84,23 @@ void main(void)
  gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
  //gl_FrontColor = vec4(1.0,0.0,0.0,1.0);
 }
+
+
+// #SHADER <vert_perpixellight_texture_instanced> per pixel light, one matrix per instance
+#extension GL_EXT_gpu_shader4 : enable
+uniform mat4 vl_InstanceMatrix[32];
+varying vec3 N;
+varying vec4 pos;
+void main(void)
+{
+ mat4 instance = vl_InstanceMatrix[gl_InstanceID];
+ vec4 vertex = instance * gl_Vertex;
+ gl_Position = gl_ModelViewProjectionMatrix * vertex;
+
+ pos = gl_ModelViewMatrix * vertex;
+ mat3 rotation = mat3(instance[0].xyz, instance[1].xyz, instance[2].xyz);
+ N = normalize(gl_NormalMatrix * (rotation * gl_Normal));
+
+ gl_FrontColor = gl_Color;
+ gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
+}
@@ -0,0 +1,209 @@
+#include "signalplot.h"
+
+#include <math.h>
+
+#include <vl/OpenGL.hpp>
+#include <vl/GlobalState.hpp>
+
+namespace SimQuadCopter
+{
+
+SignalPlot::SignalPlot()
+{
+	window=10;
+	setArea(0,0,1,0.35f);
+	background=vl::vec4(0,0,0,0.5f);
+}
+
+int SignalPlot::addLane(const char *name, float min, float max)
+{
+	Lane lane;
+	lane.name=name;
+	lane.min=min;
+	lane.max=max;
+	lane.autoscale=min>=max;
+	lanes.push_back(lane);
+	return (int)lanes.size()-1;
+}
+
+void SignalPlot::addSignal(int lane, const SignalRing *ring, const vl::vec4 &color)
+{
+	Signal signal;
+	signal.lane=lane;
+	signal.ring=ring;
+	signal.color=color;
+	signal.columns=0;
+	signal.skipped=0;
+	signals.push_back(signal);
+}
+
+void SignalPlot::setArea(float x, float y, float width, float height)
+{
+	areaX=x;
+	areaY=y;
+	areaWidth=width;
+	areaHeight=height;
+}
+
+bool SignalPlot::decimate(Signal &signal, double start, double columnTime, int width)
+{
+	signal.columns=0;
+	signal.skipped=0;
+	if((int)signal.columnFirst.size()<width)
+	{
+		signal.vertices.resize(4*width);
+		signal.columnFirst.resize(width);
+	}
+
+	const SignalRing *ring=signal.ring;
+	long long written=ring->getWritten();
+	long long first=ring->find(start,ring->getOldest(written),written);
+	for(int c=0;c<width && first<written;++c)
+	{
+		long long last=c==width-1 ? written : ring->find(start+(c+1)*columnTime,first,written);
+		if(last==first)
+			continue;
+
+		float min,max;
+		ring->getMinMax(first,last,min,max);
+		float *v=&signal.vertices[4*signal.columns];
+		v[0]=v[2]=c+0.5f;
+		v[1]=min;
+		v[3]=max;
+		signal.columnFirst[signal.columns]=first;
+		signal.columns++;
+		first=last;
+	}
+
+	//the writer may have gone round the ring while the oldest columns were read
+	long long oldest=ring->getOldest(ring->getWritten());
+	while(signal.skipped<signal.columns && signal.columnFirst[signal.skipped]<oldest)
+		signal.skipped++;
+	return signal.skipped<signal.columns;
+}
+
+void SignalPlot::draw(vl::Actor *, int render_stream, unsigned int)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT,viewport);
+	int x=(int)(viewport[2]*areaX);
+	int y=(int)(viewport[3]*areaY);
+	int width=(int)(viewport[2]*areaWidth);
+	int height=(int)(viewport[3]*areaHeight);
+	if(width<2 || height<2*(int)lanes.size() || lanes.empty())
+		return;
+
+	//the right edge is the newest sample, columns start at multiples of the
+	//column time so they keep their samples while the plot scrolls
+	double newest=0;
+	bool any=false;
+	for(unsigned int i=0;i<signals.size();++i)
+	{
+		long long written=signals[i].ring->getWritten();
+		if(written==0)
+			continue;
+		double time=signals[i].ring->getTime(written-1);
+		if(!any || time>newest)
+			newest=time;
+		any=true;
+	}
+	double columnTime=window/width;
+	double start=(floor(newest/columnTime)+1-width)*columnTime;
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	gluOrtho2D(0,viewport[2],0,viewport[3]);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	GLboolean scissor=glIsEnabled(GL_SCISSOR_TEST);
+	GLint scissorBox[4];
+	glGetIntegerv(GL_SCISSOR_BOX,scissorBox);
+
+	glBindBuffer(GL_ARRAY_BUFFER,0);
+	glEnableClientState(GL_VERTEX_ARRAY);
+
+	glColor4fv(background.ptr());
+	glRectf((float)x,(float)y,(float)(x+width),(float)(y+height));
+
+	int drawCalls=0;
+	float laneHeight=(float)height/lanes.size();
+	for(unsigned int l=0;l<lanes.size();++l)
+	{
+		const Lane &lane=lanes[l];
+		float bottom=y+height-(l+1)*laneHeight;
+
+		float min=lane.min,max=lane.max;
+		bool found=false;
+		for(unsigned int i=0;i<signals.size();++i)
+		{
+			Signal &signal=signals[i];
+			if(signal.lane!=(int)l || !decimate(signal,start,columnTime,width))
+				continue;
+			if(!lane.autoscale)
+				continue;
+			for(int c=signal.skipped;c<signal.columns;++c)
+			{
+				const float *v=&signal.vertices[4*c];
+				if(!found || v[1]<min) min=v[1];
+				if(!found || v[3]>max) max=v[3];
+				found=true;
+			}
+		}
+		if(lane.autoscale)
+		{
+			float margin=found && max>min ? (max-min)*0.05f : 1.0f;
+			min-=margin;
+			max+=margin;
+		}
+		float scale=(laneHeight-2)/(max-min);
+		float zero=bottom+1-min*scale;
+
+		//keeps the strips in their lane, in window coordinates
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(viewport[0]+x,viewport[1]+(int)bottom,width,(int)ceil(laneHeight));
+
+		//frame, and the zero line if it is in range
+		float frame[12]={x+0.5f,bottom+0.5f, x+width-0.5f,bottom+0.5f, x+width-0.5f,bottom+laneHeight-0.5f, x+0.5f,bottom+laneHeight-0.5f, (float)x,zero, (float)(x+width),zero};
+		glColor4f(1,1,1,0.3f);
+		glVertexPointer(2,GL_FLOAT,0,frame);
+		glDrawArrays(GL_LINE_LOOP,0,4);
+		drawCalls++;
+		if(min<0 && max>0)
+		{
+			glDrawArrays(GL_LINES,4,2);
+			drawCalls++;
+		}
+
+		glPushMatrix();
+		glTranslatef((float)x,zero,0);
+		glScalef(1,scale,1);
+		for(unsigned int i=0;i<signals.size();++i)
+		{
+			const Signal &signal=signals[i];
+			if(signal.lane!=(int)l || signal.skipped>=signal.columns)
+				continue;
+			glColor4fv(signal.color.ptr());
+			glVertexPointer(2,GL_FLOAT,0,&signal.vertices[4*signal.skipped]);
+			glDrawArrays(GL_LINE_STRIP,0,2*(signal.columns-signal.skipped));
+			drawCalls++;
+		}
+		glPopMatrix();
+	}
+	vl::GlobalState::renderStream(render_stream)->stats().mDrawCalls+=drawCalls;
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glScissor(scissorBox[0],scissorBox[1],scissorBox[2],scissorBox[3]);
+	if(!scissor)
+		glDisable(GL_SCISSOR_TEST);
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	GLCHECK4()
+}
+
+}
@@ -0,0 +1,86 @@
+#ifndef __SIGNALPLOT_H
+#define __SIGNALPLOT_H
+
+#include <vector>
+#include <string>
+
+#include <vl/Drawable.hpp>
+#include <vl/vec4.hpp>
+
+#include "signalring.h"
+
+namespace SimQuadCopter
+{
+
+//strip charts of SignalRings over the 3D view, like an oscilloscope.
+//
+//the plot is split into lanes from top to bottom, each with its range of
+//values and its signals. the last window seconds are shown, the right edge
+//is the newest sample of all signals. every pixel column of a lane draws
+//the extremes of the samples falling into it as a vertical line, so a
+//10kHz signal shows its full envelope in a few hundred vertices at any
+//zoom, and a sparse one is drawn through its samples.
+//
+//draw() reads the rings like any reader (see SignalRing) and reuses its
+//vertex arrays, nothing is allocated per frame once the plot had its size.
+//draw with depth test off, the area is in fractions of the viewport.
+class SignalPlot: public vl::Drawable
+{
+public:
+	SignalPlot();
+
+	//min>=max scales the lane to what the window shows
+	int addLane(const char *name, float min, float max);
+	void addSignal(int lane, const SignalRing *ring, const vl::vec4 &color);
+
+	void setWindow(double seconds) { window=seconds; }
+	double getWindow() const { return window; }
+
+	void setArea(float x, float y, float width, float height);
+	void setBackground(const vl::vec4 &color) { background=color; }
+
+	int getLaneCount() const { return (int)lanes.size(); }
+	const char *getLaneName(int lane) const { return lanes[lane].name.c_str(); }
+
+	//drawn in screen space, never culled
+	virtual void computeAABB() {}
+	virtual void draw(vl::Actor *actor, int render_stream, unsigned int tex_units);
+
+protected:
+	struct Lane
+	{
+		std::string name;
+		float min;
+		float max;
+		bool autoscale;
+	};
+
+	struct Signal
+	{
+		int lane;
+		const SignalRing *ring;
+		vl::vec4 color;
+		//x, min, x, max of each column with samples
+		std::vector<float> vertices;
+		std::vector<long long> columnFirst;
+		int columns;
+		//leading columns overwritten while they were read
+		int skipped;
+	};
+
+	//fills the columns of a signal, returns false if it has no samples
+	bool decimate(Signal &signal, double start, double columnTime, int width);
+
+	std::vector<Lane> lanes;
+	std::vector<Signal> signals;
+	double window;
+	float areaX;
+	float areaY;
+	float areaWidth;
+	float areaHeight;
+	vl::vec4 background;
+};
+
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include "signalring.h"
+
+namespace SimQuadCopter
+{
+
+SignalRing::SignalRing(int capacity)
+{
+	int size=2*BlockSize;
+	while(size<capacity)
+		size*=2;
+	times.resize(size);
+	values.resize(size);
+	blockMin.resize(size/BlockSize);
+	blockMax.resize(size/BlockSize);
+	mask=size-1;
+	blockMask=size/BlockSize-1;
+	currentMin=currentMax=0;
+	written=0;
+}
+
+void SignalRing::push(double time, float value)
+{
+	long long index=__atomic_load_n(&written,__ATOMIC_RELAXED);
+	times[index&mask]=time;
+	values[index&mask]=value;
+
+	long long offset=index&(BlockSize-1);
+	if(offset==0)
+		currentMin=currentMax=value;
+	else if(value<currentMin)
+		currentMin=value;
+	else if(value>currentMax)
+		currentMax=value;
+	if(offset==BlockSize-1)
+	{
+		blockMin[(index>>BlockBits)&blockMask]=currentMin;
+		blockMax[(index>>BlockBits)&blockMask]=currentMax;
+	}
+
+	__atomic_store_n(&written,index+1,__ATOMIC_RELEASE);
+}
+
+long long SignalRing::getOldest(long long written) const
+{
+	//the writer may be writing over sample written-capacity right now
+	long long oldest=written-getCapacity()+1;
+	return oldest>0 ? oldest : 0;
+}
+
+long long SignalRing::find(double time, long long first, long long last) const
+{
+	while(first<last)
+	{
+		long long middle=first+(last-first)/2;
+		if(times[middle&mask]<time)
+			first=middle+1;
+		else
+			last=middle;
+	}
+	return first;
+}
+
+void SignalRing::getMinMax(long long first, long long last, float &min, float &max) const
+{
+	min=max=values[first&mask];
+	long long i=first;
+	//samples up to the first block boundary, whole blocks, the rest
+	for(;i<last && (i&(BlockSize-1))!=0;++i)
+	{
+		float v=values[i&mask];
+		if(v<min) min=v;
+		if(v>max) max=v;
+	}
+	for(;i+BlockSize<=last;i+=BlockSize)
+	{
+		long long block=(i>>BlockBits)&blockMask;
+		if(blockMin[block]<min) min=blockMin[block];
+		if(blockMax[block]>max) max=blockMax[block];
+	}
+	for(;i<last;++i)
+	{
+		float v=values[i&mask];
+		if(v<min) min=v;
+		if(v>max) max=v;
+	}
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef __SIGNALRING_H
+#define __SIGNALRING_H
+
+#include <vector>
+
+namespace SimQuadCopter
+{
+
+//the recent history of one signal (gyro, throttle...), written by the
+//simulation thread and read by one other thread (SignalPlot) without locks.
+//
+//sample n goes to slot n%capacity. the writer publishes the sample count
+//with a release store after the sample, a reader loads it with acquire and
+//reads the samples below it. the writer never waits, so the oldest samples
+//a reader uses may get overwritten meanwhile: check them with getOldest()
+//after using them and throw away what they gave.
+//
+//besides the samples the writer keeps the minimum and maximum of every
+//block of BlockSize samples, so the extremes of a long range cost one look
+//per block (see getMinMax).
+class SignalRing
+{
+public:
+	enum
+	{
+		BlockBits=6,
+		BlockSize=1<<BlockBits
+	};
+
+	//capacity in samples, rounded up to a power of 2
+	SignalRing(int capacity=65536);
+
+	//writer
+	void push(double time, float value);
+
+	//readers
+	long long getWritten() const { return __atomic_load_n(&written,__ATOMIC_ACQUIRE); }
+	//first sample not being overwritten while written samples are published
+	long long getOldest(long long written) const;
+	double getTime(long long index) const { return times[index&mask]; }
+	float getValue(long long index) const { return values[index&mask]; }
+	//first sample in [first,last) at or after time, last if there is none
+	long long find(double time, long long first, long long last) const;
+	//extremes of the samples in [first,last), first<last
+	void getMinMax(long long first, long long last, float &min, float &max) const;
+
+	int getCapacity() const { return (int)times.size(); }
+
+protected:
+	std::vector<double> times;
+	std::vector<float> values;
+	std::vector<float> blockMin;
+	std::vector<float> blockMax;
+	long long mask;
+	long long blockMask;
+
+	//writer only
+	float currentMin;
+	float currentMax;
+
+	long long written;
+};
+
+}
+
+#endif
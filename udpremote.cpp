@@ -6,6 +6,8 @@
 #include <vector>
 #include <sstream>
 
+#include <vl/Trace.hpp>
+
 using namespace std;
 
 namespace SimQuadCopter
@@ -57,6 +59,7 @@ UdpCopter::UdpCopter(QuadCopter *copter)
 {
 	this->copter=copter;
 	time=0;
+	sock=NULL;
 }
 
 void Tokenize(const string& str,
@@ -81,6 +84,11 @@ void Tokenize(const string& str,
 
 void UdpCopter::update(float dtime)
 {
+	//not initialized, e.g. headless simulation
+	if(!sock)
+		return;
+	vl::TraceZone zone("UdpCopter::update","network");
+
 	while(SDLNet_UDP_Recv(sock, in))
 	{
 		in->data[in->len]=0;
@@ -138,23 +146,23 @@ void UdpCopter::update(float dtime)
 		ss<<"accelY "<<copter->accelY.getValue()<<"\n";
 		ss<<"accelZ "<<copter->accelZ.getValue()<<"\n";
 
-		ss<<"posX "<<copter->physics->getPosition().getX()<<"\n";
-		ss<<"posY "<<copter->physics->getPosition().getY()<<"\n";
-		ss<<"posZ "<<copter->physics->getPosition().getZ()<<"\n";
+		ss<<"posX "<<copter->dynamics->getPosition().getX()<<"\n";
+		ss<<"posY "<<copter->dynamics->getPosition().getY()<<"\n";
+		ss<<"posZ "<<copter->dynamics->getPosition().getZ()<<"\n";
 		
-		ss<<"speedX "<<copter->physics->getSpeedVector().getX()<<"\n";
-		ss<<"speedY "<<copter->physics->getSpeedVector().getY()<<"\n";
-		ss<<"speedZ "<<copter->physics->getSpeedVector().getZ()<<"\n";
+		ss<<"speedX "<<copter->dynamics->getSpeedVector().getX()<<"\n";
+		ss<<"speedY "<<copter->dynamics->getSpeedVector().getY()<<"\n";
+		ss<<"speedZ "<<copter->dynamics->getSpeedVector().getZ()<<"\n";
 
-		ss<<"throttleXm "<<copter->physics->engineXm.getThrottle()<<"\n";
-		ss<<"throttleXp "<<copter->physics->engineXp.getThrottle()<<"\n";
-		ss<<"throttleZm "<<copter->physics->engineZm.getThrottle()<<"\n";
-		ss<<"throttleZp "<<copter->physics->engineZp.getThrottle()<<"\n";
+		ss<<"throttleXm "<<copter->dynamics->getEngine(CopterDynamics::EngineXm)->getThrottle()<<"\n";
+		ss<<"throttleXp "<<copter->dynamics->getEngine(CopterDynamics::EngineXp)->getThrottle()<<"\n";
+		ss<<"throttleZm "<<copter->dynamics->getEngine(CopterDynamics::EngineZm)->getThrottle()<<"\n";
+		ss<<"throttleZp "<<copter->dynamics->getEngine(CopterDynamics::EngineZp)->getThrottle()<<"\n";
 
-		ss<<"rpmXm "<<copter->physics->engineXm.getRPM()<<"\n";
-		ss<<"rpmXp "<<copter->physics->engineXp.getRPM()<<"\n";
-		ss<<"rpmZm "<<copter->physics->engineZm.getRPM()<<"\n";
-		ss<<"rpmZp "<<copter->physics->engineZp.getRPM()<<"\n";
+		ss<<"rpmXm "<<copter->dynamics->getEngine(CopterDynamics::EngineXm)->getRPM()<<"\n";
+		ss<<"rpmXp "<<copter->dynamics->getEngine(CopterDynamics::EngineXp)->getRPM()<<"\n";
+		ss<<"rpmZm "<<copter->dynamics->getEngine(CopterDynamics::EngineZm)->getRPM()<<"\n";
+		ss<<"rpmZp "<<copter->dynamics->getEngine(CopterDynamics::EngineZp)->getRPM()<<"\n";
 
 		ss<<"pitch "<<copter->control.pitch<<"\n";
 		ss<<"yaw "<<copter->control.yaw<<"\n";
@@ -164,7 +172,7 @@ void UdpCopter::update(float dtime)
 		//this is what the flightcontrol thinks (it is dependend on the acceleration of the copter)
 		copter->calcAnglesFromAcceleration(x,z);
 		//this is the actual angle
-		copter->physics->calcRealAngles(rx,rz);
+		copter->dynamics->calcRealAngles(rx,rz);
 		ss<<"angleX "<<x<<"\n";
 		ss<<"angleZ "<<z<<"\n";
  		ss<<"angleXreal "<<rx<<"\n";
@@ -173,8 +181,8 @@ void UdpCopter::update(float dtime)
 
 		ss<<"time "<<SDL_GetTicks()<<"\n";
 
-		//ss<<"angleX "<<copter->physics->getAxisAngle(Vector3(0,0,1))<<"\n";
-		//ss<<"angleZ "<<copter->physics->getAxisAngle(Vector3(1,0,0))<<"\n";
+		//ss<<"angleX "<<copter->dynamics->getAxisAngle(Vector3(0,0,1))<<"\n";
+		//ss<<"angleZ "<<copter->dynamics->getAxisAngle(Vector3(1,0,0))<<"\n";
 
 		s=ss.str();
 		out->len=s.length();
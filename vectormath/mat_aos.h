@@ -274,11 +274,19 @@ inline const Matrix3 operator *( float scalar, const Matrix3 & mat )
 
 inline const Vector3 Matrix3::operator *( const Vector3 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = vec.get128( );
+    __m128 r = _mm_mul_ps( mCol0.get128( ), _VECTORMATH_SWIZZLE( v, 0, 0, 0, 0 ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol1.get128( ), _VECTORMATH_SWIZZLE( v, 1, 1, 1, 1 ) ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol2.get128( ), _VECTORMATH_SWIZZLE( v, 2, 2, 2, 2 ) ) );
+    return Vector3( r );
+#else
     return Vector3(
         ( ( ( mCol0.getX() * vec.getX() ) + ( mCol1.getX() * vec.getY() ) ) + ( mCol2.getX() * vec.getZ() ) ),
         ( ( ( mCol0.getY() * vec.getX() ) + ( mCol1.getY() * vec.getY() ) ) + ( mCol2.getY() * vec.getZ() ) ),
         ( ( ( mCol0.getZ() * vec.getX() ) + ( mCol1.getZ() * vec.getY() ) ) + ( mCol2.getZ() * vec.getZ() ) )
     );
+#endif
 }
 
 inline const Matrix3 Matrix3::operator *( const Matrix3 & mat ) const
@@ -803,32 +811,58 @@ inline const Matrix4 operator *( float scalar, const Matrix4 & mat )
 
 inline const Vector4 Matrix4::operator *( const Vector4 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = vec.get128( );
+    __m128 r = _mm_mul_ps( mCol0.get128( ), _VECTORMATH_SWIZZLE( v, 0, 0, 0, 0 ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol1.get128( ), _VECTORMATH_SWIZZLE( v, 1, 1, 1, 1 ) ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol2.get128( ), _VECTORMATH_SWIZZLE( v, 2, 2, 2, 2 ) ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol3.get128( ), _VECTORMATH_SWIZZLE( v, 3, 3, 3, 3 ) ) );
+    return Vector4( r );
+#else
     return Vector4(
         ( ( ( ( mCol0.getX() * vec.getX() ) + ( mCol1.getX() * vec.getY() ) ) + ( mCol2.getX() * vec.getZ() ) ) + ( mCol3.getX() * vec.getW() ) ),
         ( ( ( ( mCol0.getY() * vec.getX() ) + ( mCol1.getY() * vec.getY() ) ) + ( mCol2.getY() * vec.getZ() ) ) + ( mCol3.getY() * vec.getW() ) ),
         ( ( ( ( mCol0.getZ() * vec.getX() ) + ( mCol1.getZ() * vec.getY() ) ) + ( mCol2.getZ() * vec.getZ() ) ) + ( mCol3.getZ() * vec.getW() ) ),
         ( ( ( ( mCol0.getW() * vec.getX() ) + ( mCol1.getW() * vec.getY() ) ) + ( mCol2.getW() * vec.getZ() ) ) + ( mCol3.getW() * vec.getW() ) )
     );
+#endif
 }
 
 inline const Vector4 Matrix4::operator *( const Vector3 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = vec.get128( );
+    __m128 r = _mm_mul_ps( mCol0.get128( ), _VECTORMATH_SWIZZLE( v, 0, 0, 0, 0 ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol1.get128( ), _VECTORMATH_SWIZZLE( v, 1, 1, 1, 1 ) ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol2.get128( ), _VECTORMATH_SWIZZLE( v, 2, 2, 2, 2 ) ) );
+    return Vector4( r );
+#else
     return Vector4(
         ( ( ( mCol0.getX() * vec.getX() ) + ( mCol1.getX() * vec.getY() ) ) + ( mCol2.getX() * vec.getZ() ) ),
         ( ( ( mCol0.getY() * vec.getX() ) + ( mCol1.getY() * vec.getY() ) ) + ( mCol2.getY() * vec.getZ() ) ),
         ( ( ( mCol0.getZ() * vec.getX() ) + ( mCol1.getZ() * vec.getY() ) ) + ( mCol2.getZ() * vec.getZ() ) ),
         ( ( ( mCol0.getW() * vec.getX() ) + ( mCol1.getW() * vec.getY() ) ) + ( mCol2.getW() * vec.getZ() ) )
     );
+#endif
 }
 
 inline const Vector4 Matrix4::operator *( const Point3 & pnt ) const
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = pnt.get128( );
+    __m128 r = _mm_mul_ps( mCol0.get128( ), _VECTORMATH_SWIZZLE( v, 0, 0, 0, 0 ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol1.get128( ), _VECTORMATH_SWIZZLE( v, 1, 1, 1, 1 ) ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol2.get128( ), _VECTORMATH_SWIZZLE( v, 2, 2, 2, 2 ) ) );
+    r = _mm_add_ps( r, mCol3.get128( ) );
+    return Vector4( r );
+#else
     return Vector4(
         ( ( ( ( mCol0.getX() * pnt.getX() ) + ( mCol1.getX() * pnt.getY() ) ) + ( mCol2.getX() * pnt.getZ() ) ) + mCol3.getX() ),
         ( ( ( ( mCol0.getY() * pnt.getX() ) + ( mCol1.getY() * pnt.getY() ) ) + ( mCol2.getY() * pnt.getZ() ) ) + mCol3.getY() ),
         ( ( ( ( mCol0.getZ() * pnt.getX() ) + ( mCol1.getZ() * pnt.getY() ) ) + ( mCol2.getZ() * pnt.getZ() ) ) + mCol3.getZ() ),
         ( ( ( ( mCol0.getW() * pnt.getX() ) + ( mCol1.getW() * pnt.getY() ) ) + ( mCol2.getW() * pnt.getZ() ) ) + mCol3.getW() )
     );
+#endif
 }
 
 inline const Matrix4 Matrix4::operator *( const Matrix4 & mat ) const
@@ -1307,20 +1341,37 @@ inline const Transform3 absPerElem( const Transform3 & tfrm )
 
 inline const Vector3 Transform3::operator *( const Vector3 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = vec.get128( );
+    __m128 r = _mm_mul_ps( mCol0.get128( ), _VECTORMATH_SWIZZLE( v, 0, 0, 0, 0 ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol1.get128( ), _VECTORMATH_SWIZZLE( v, 1, 1, 1, 1 ) ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol2.get128( ), _VECTORMATH_SWIZZLE( v, 2, 2, 2, 2 ) ) );
+    return Vector3( r );
+#else
     return Vector3(
         ( ( ( mCol0.getX() * vec.getX() ) + ( mCol1.getX() * vec.getY() ) ) + ( mCol2.getX() * vec.getZ() ) ),
         ( ( ( mCol0.getY() * vec.getX() ) + ( mCol1.getY() * vec.getY() ) ) + ( mCol2.getY() * vec.getZ() ) ),
         ( ( ( mCol0.getZ() * vec.getX() ) + ( mCol1.getZ() * vec.getY() ) ) + ( mCol2.getZ() * vec.getZ() ) )
     );
+#endif
 }
 
 inline const Point3 Transform3::operator *( const Point3 & pnt ) const
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = pnt.get128( );
+    __m128 r = _mm_mul_ps( mCol0.get128( ), _VECTORMATH_SWIZZLE( v, 0, 0, 0, 0 ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol1.get128( ), _VECTORMATH_SWIZZLE( v, 1, 1, 1, 1 ) ) );
+    r = _mm_add_ps( r, _mm_mul_ps( mCol2.get128( ), _VECTORMATH_SWIZZLE( v, 2, 2, 2, 2 ) ) );
+    r = _mm_add_ps( r, mCol3.get128( ) );
+    return Point3( r );
+#else
     return Point3(
         ( ( ( ( mCol0.getX() * pnt.getX() ) + ( mCol1.getX() * pnt.getY() ) ) + ( mCol2.getX() * pnt.getZ() ) ) + mCol3.getX() ),
         ( ( ( ( mCol0.getY() * pnt.getX() ) + ( mCol1.getY() * pnt.getY() ) ) + ( mCol2.getY() * pnt.getZ() ) ) + mCol3.getY() ),
         ( ( ( ( mCol0.getZ() * pnt.getX() ) + ( mCol1.getZ() * pnt.getY() ) ) + ( mCol2.getZ() * pnt.getZ() ) ) + mCol3.getZ() )
     );
+#endif
 }
 
 inline const Transform3 Transform3::operator *( const Transform3 & tfrm ) const
@@ -78,6 +78,20 @@ inline Quat::Quat( float scalar )
     mW = scalar;
 }
 
+#ifdef _VECTORMATH_SSE
+
+inline Quat::Quat( __m128 vf4 )
+{
+    _vmathStore( &mX, vf4 );
+}
+
+inline __m128 Quat::get128( ) const
+{
+    return _vmathLoad4( &mX );
+}
+
+#endif
+
 inline const Quat Quat::identity( )
 {
     return Quat( 0.0f, 0.0f, 0.0f, 1.0f );
@@ -208,32 +222,44 @@ inline float Quat::operator []( int idx ) const
 
 inline const Quat Quat::operator +( const Quat & quat ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Quat( _mm_add_ps( get128( ), quat.get128( ) ) );
+#else
     return Quat(
         ( mX + quat.mX ),
         ( mY + quat.mY ),
         ( mZ + quat.mZ ),
         ( mW + quat.mW )
     );
+#endif
 }
 
 inline const Quat Quat::operator -( const Quat & quat ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Quat( _mm_sub_ps( get128( ), quat.get128( ) ) );
+#else
     return Quat(
         ( mX - quat.mX ),
         ( mY - quat.mY ),
         ( mZ - quat.mZ ),
         ( mW - quat.mW )
     );
+#endif
 }
 
 inline const Quat Quat::operator *( float scalar ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Quat( _mm_mul_ps( get128( ), _mm_set1_ps( scalar ) ) );
+#else
     return Quat(
         ( mX * scalar ),
         ( mY * scalar ),
         ( mZ * scalar ),
         ( mW * scalar )
     );
+#endif
 }
 
 inline Quat & Quat::operator +=( const Quat & quat )
@@ -256,12 +282,16 @@ inline Quat & Quat::operator *=( float scalar )
 
 inline const Quat Quat::operator /( float scalar ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Quat( _mm_div_ps( get128( ), _mm_set1_ps( scalar ) ) );
+#else
     return Quat(
         ( mX / scalar ),
         ( mY / scalar ),
         ( mZ / scalar ),
         ( mW / scalar )
     );
+#endif
 }
 
 inline Quat & Quat::operator /=( float scalar )
@@ -272,12 +302,16 @@ inline Quat & Quat::operator /=( float scalar )
 
 inline const Quat Quat::operator -( ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Quat( _vmathNegate( get128( ) ) );
+#else
     return Quat(
         -mX,
         -mY,
         -mZ,
         -mW
     );
+#endif
 }
 
 inline const Quat operator *( float scalar, const Quat & quat )
@@ -287,22 +321,31 @@ inline const Quat operator *( float scalar, const Quat & quat )
 
 inline float dot( const Quat & quat0, const Quat & quat1 )
 {
+#ifdef _VECTORMATH_SSE
+    return _mm_cvtss_f32( _vmathDot4( quat0.get128( ), quat1.get128( ) ) );
+#else
     float result;
     result = ( quat0.getX() * quat1.getX() );
     result = ( result + ( quat0.getY() * quat1.getY() ) );
     result = ( result + ( quat0.getZ() * quat1.getZ() ) );
     result = ( result + ( quat0.getW() * quat1.getW() ) );
     return result;
+#endif
 }
 
 inline float norm( const Quat & quat )
 {
+#ifdef _VECTORMATH_SSE
+    __m128 q = quat.get128( );
+    return _mm_cvtss_f32( _vmathDot4( q, q ) );
+#else
     float result;
     result = ( quat.getX() * quat.getX() );
     result = ( result + ( quat.getY() * quat.getY() ) );
     result = ( result + ( quat.getZ() * quat.getZ() ) );
     result = ( result + ( quat.getW() * quat.getW() ) );
     return result;
+#endif
 }
 
 inline float length( const Quat & quat )
@@ -312,6 +355,11 @@ inline float length( const Quat & quat )
 
 inline const Quat normalize( const Quat & quat )
 {
+#ifdef _VECTORMATH_SSE
+    __m128 q = quat.get128( );
+    __m128 lenInv = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( _vmathDot4( q, q ) ) );
+    return Quat( _mm_mul_ps( q, lenInv ) );
+#else
     float lenSqr, lenInv;
     lenSqr = norm( quat );
     lenInv = ( 1.0f / sqrtf( lenSqr ) );
@@ -321,6 +369,7 @@ inline const Quat normalize( const Quat & quat )
         ( quat.getZ() * lenInv ),
         ( quat.getW() * lenInv )
     );
+#endif
 }
 
 inline const Quat Quat::rotation( const Vector3 & unitVec0, const Vector3 & unitVec1 )
@@ -369,12 +418,16 @@ inline const Quat Quat::rotationZ( float radians )
 
 inline const Quat Quat::operator *( const Quat & quat ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Quat( _vmathQuatMul( get128( ), quat.get128( ) ) );
+#else
     return Quat(
         ( ( ( ( mW * quat.mX ) + ( mX * quat.mW ) ) + ( mY * quat.mZ ) ) - ( mZ * quat.mY ) ),
         ( ( ( ( mW * quat.mY ) + ( mY * quat.mW ) ) + ( mZ * quat.mX ) ) - ( mX * quat.mZ ) ),
         ( ( ( ( mW * quat.mZ ) + ( mZ * quat.mW ) ) + ( mX * quat.mY ) ) - ( mY * quat.mX ) ),
         ( ( ( ( mW * quat.mW ) - ( mX * quat.mX ) ) - ( mY * quat.mY ) ) - ( mZ * quat.mZ ) )
     );
+#endif
 }
 
 inline Quat & Quat::operator *=( const Quat & quat )
@@ -385,6 +438,16 @@ inline Quat & Quat::operator *=( const Quat & quat )
 
 inline const Vector3 rotate( const Quat & quat, const Vector3 & vec )
 {
+#ifdef _VECTORMATH_SSE
+    // v + 2w(q x v) + 2q x (q x v), the w lane of the vector part is cleared
+    __m128 q = quat.get128( );
+    __m128 qxyz = _mm_and_ps( q, _vmathMaskXYZ( ) );
+    __m128 v = vec.get128( );
+    __m128 t = _vmathCross( qxyz, v );
+    t = _mm_add_ps( t, t );
+    __m128 w = _VECTORMATH_SWIZZLE( q, 3, 3, 3, 3 );
+    return Vector3( _mm_add_ps( _mm_add_ps( v, _mm_mul_ps( w, t ) ), _vmathCross( qxyz, t ) ) );
+#else
     float tmpX, tmpY, tmpZ, tmpW;
     tmpX = ( ( ( quat.getW() * vec.getX() ) + ( quat.getY() * vec.getZ() ) ) - ( quat.getZ() * vec.getY() ) );
     tmpY = ( ( ( quat.getW() * vec.getY() ) + ( quat.getZ() * vec.getX() ) ) - ( quat.getX() * vec.getZ() ) );
@@ -395,11 +458,16 @@ inline const Vector3 rotate( const Quat & quat, const Vector3 & vec )
         ( ( ( ( tmpW * quat.getY() ) + ( tmpY * quat.getW() ) ) - ( tmpZ * quat.getX() ) ) + ( tmpX * quat.getZ() ) ),
         ( ( ( ( tmpW * quat.getZ() ) + ( tmpZ * quat.getW() ) ) - ( tmpX * quat.getY() ) ) + ( tmpY * quat.getX() ) )
     );
+#endif
 }
 
 inline const Quat conj( const Quat & quat )
 {
+#ifdef _VECTORMATH_SSE
+    return Quat( _mm_xor_ps( quat.get128( ), _mm_castsi128_ps( _mm_set_epi32( 0, (int)0x80000000, (int)0x80000000, (int)0x80000000 ) ) ) );
+#else
     return Quat( -quat.getX(), -quat.getY(), -quat.getZ(), quat.getW() );
+#endif
 }
 
 inline const Quat select( const Quat & quat0, const Quat & quat1, bool select1 )
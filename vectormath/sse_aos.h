@@ -0,0 +1,113 @@
+/*
+   SSE helpers for the array-of-structures vector math classes.
+
+   The classes keep their scalar member layout (x, y, z[, w], 16 byte
+   aligned with GCC), so a 3-D vector or point is loaded as one 128-bit
+   register with the padding lane cleared and stored back as a whole.
+   Everything here is internal to vec_aos.h, quat_aos.h and mat_aos.h.
+*/
+
+#ifndef _VECTORMATH_SSE_AOS_CPP_H
+#define _VECTORMATH_SSE_AOS_CPP_H
+
+#include <emmintrin.h>
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
+namespace Vectormath {
+namespace Aos {
+
+#define _VECTORMATH_SHUF( x, y, z, w ) ( ( (w) << 6 ) | ( (z) << 4 ) | ( (y) << 2 ) | (x) )
+#define _VECTORMATH_SWIZZLE( v, x, y, z, w ) _mm_shuffle_ps( v, v, _VECTORMATH_SHUF( x, y, z, w ) )
+
+static inline __m128 _vmathMaskXYZ( )
+{
+    return _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+}
+
+// Load x, y and z, the w lane (padding of a 3-D vector) is zero
+static inline __m128 _vmathLoad3( const float * p )
+{
+    return _mm_and_ps( _mm_loadu_ps( p ), _vmathMaskXYZ( ) );
+}
+
+static inline __m128 _vmathLoad4( const float * p )
+{
+    return _mm_loadu_ps( p );
+}
+
+static inline void _vmathStore( float * p, __m128 v )
+{
+    _mm_storeu_ps( p, v );
+}
+
+// Horizontal sum, the result is splatted to all lanes
+static inline __m128 _vmathSum4( __m128 v )
+{
+    v = _mm_add_ps( v, _VECTORMATH_SWIZZLE( v, 1, 0, 3, 2 ) );
+    return _mm_add_ps( v, _VECTORMATH_SWIZZLE( v, 2, 3, 0, 1 ) );
+}
+
+// Dot product of all four lanes, splatted
+static inline __m128 _vmathDot4( __m128 a, __m128 b )
+{
+#ifdef __SSE4_1__
+    return _mm_dp_ps( a, b, 0xff );
+#else
+    return _vmathSum4( _mm_mul_ps( a, b ) );
+#endif
+}
+
+// Dot product of x, y and z, splatted; w of the inputs is ignored
+static inline __m128 _vmathDot3( __m128 a, __m128 b )
+{
+#ifdef __SSE4_1__
+    return _mm_dp_ps( a, b, 0x7f );
+#else
+    return _vmathSum4( _mm_and_ps( _mm_mul_ps( a, b ), _vmathMaskXYZ( ) ) );
+#endif
+}
+
+// Cross product of x, y and z, the w lane is zero
+static inline __m128 _vmathCross( __m128 a, __m128 b )
+{
+    __m128 ayzx = _VECTORMATH_SWIZZLE( a, 1, 2, 0, 3 );
+    __m128 byzx = _VECTORMATH_SWIZZLE( b, 1, 2, 0, 3 );
+    __m128 c = _mm_sub_ps( _mm_mul_ps( a, byzx ), _mm_mul_ps( ayzx, b ) );
+    return _mm_and_ps( _VECTORMATH_SWIZZLE( c, 1, 2, 0, 3 ), _vmathMaskXYZ( ) );
+}
+
+static inline __m128 _vmathNegate( __m128 v )
+{
+    return _mm_xor_ps( v, _mm_set1_ps( -0.0f ) );
+}
+
+static inline __m128 _vmathAbs( __m128 v )
+{
+    return _mm_andnot_ps( _mm_set1_ps( -0.0f ), v );
+}
+
+// Quaternion product, same operand order and rounding order as the scalar version
+static inline __m128 _vmathQuatMul( __m128 a, __m128 b )
+{
+    __m128 aw = _VECTORMATH_SWIZZLE( a, 3, 3, 3, 3 );
+    __m128 axyzx = _VECTORMATH_SWIZZLE( a, 0, 1, 2, 0 );
+    __m128 ayzxy = _VECTORMATH_SWIZZLE( a, 1, 2, 0, 1 );
+    __m128 azxyz = _VECTORMATH_SWIZZLE( a, 2, 0, 1, 2 );
+    __m128 bwwwx = _VECTORMATH_SWIZZLE( b, 3, 3, 3, 0 );
+    __m128 bzxyy = _VECTORMATH_SWIZZLE( b, 2, 0, 1, 1 );
+    __m128 byzxz = _VECTORMATH_SWIZZLE( b, 1, 2, 0, 2 );
+    // the w lane subtracts x*x and y*y instead of adding them
+    const __m128 signW = _mm_castsi128_ps( _mm_set_epi32( (int)0x80000000, 0, 0, 0 ) );
+    __m128 r = _mm_mul_ps( aw, b );
+    r = _mm_add_ps( r, _mm_xor_ps( _mm_mul_ps( axyzx, bwwwx ), signW ) );
+    r = _mm_add_ps( r, _mm_xor_ps( _mm_mul_ps( ayzxy, bzxyy ), signW ) );
+    r = _mm_sub_ps( r, _mm_mul_ps( azxyz, byzxz ) );
+    return r;
+}
+
+} // namespace Aos
+} // namespace Vectormath
+
+#endif
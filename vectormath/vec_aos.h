@@ -73,6 +73,20 @@ inline Vector3::Vector3( float scalar )
     mZ = scalar;
 }
 
+#ifdef _VECTORMATH_SSE
+
+inline Vector3::Vector3( __m128 vf4 )
+{
+    _vmathStore( &mX, vf4 );
+}
+
+inline __m128 Vector3::get128( ) const
+{
+    return _vmathLoad3( &mX );
+}
+
+#endif
+
 inline const Vector3 Vector3::xAxis( )
 {
     return Vector3( 1.0f, 0.0f, 0.0f );
@@ -173,38 +187,54 @@ inline float Vector3::operator []( int idx ) const
 
 inline const Vector3 Vector3::operator +( const Vector3 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _mm_add_ps( get128( ), vec.get128( ) ) );
+#else
     return Vector3(
         ( mX + vec.mX ),
         ( mY + vec.mY ),
         ( mZ + vec.mZ )
     );
+#endif
 }
 
 inline const Vector3 Vector3::operator -( const Vector3 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _mm_sub_ps( get128( ), vec.get128( ) ) );
+#else
     return Vector3(
         ( mX - vec.mX ),
         ( mY - vec.mY ),
         ( mZ - vec.mZ )
     );
+#endif
 }
 
 inline const Point3 Vector3::operator +( const Point3 & pnt ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Point3( _mm_add_ps( get128( ), pnt.get128( ) ) );
+#else
     return Point3(
         ( mX + pnt.getX() ),
         ( mY + pnt.getY() ),
         ( mZ + pnt.getZ() )
     );
+#endif
 }
 
 inline const Vector3 Vector3::operator *( float scalar ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _mm_mul_ps( get128( ), _mm_set1_ps( scalar ) ) );
+#else
     return Vector3(
         ( mX * scalar ),
         ( mY * scalar ),
         ( mZ * scalar )
     );
+#endif
 }
 
 inline Vector3 & Vector3::operator +=( const Vector3 & vec )
@@ -227,11 +257,15 @@ inline Vector3 & Vector3::operator *=( float scalar )
 
 inline const Vector3 Vector3::operator /( float scalar ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _mm_div_ps( get128( ), _mm_set1_ps( scalar ) ) );
+#else
     return Vector3(
         ( mX / scalar ),
         ( mY / scalar ),
         ( mZ / scalar )
     );
+#endif
 }
 
 inline Vector3 & Vector3::operator /=( float scalar )
@@ -242,11 +276,15 @@ inline Vector3 & Vector3::operator /=( float scalar )
 
 inline const Vector3 Vector3::operator -( ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _vmathNegate( get128( ) ) );
+#else
     return Vector3(
         -mX,
         -mY,
         -mZ
     );
+#endif
 }
 
 inline const Vector3 operator *( float scalar, const Vector3 & vec )
@@ -256,20 +294,28 @@ inline const Vector3 operator *( float scalar, const Vector3 & vec )
 
 inline const Vector3 mulPerElem( const Vector3 & vec0, const Vector3 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _mm_mul_ps( vec0.get128( ), vec1.get128( ) ) );
+#else
     return Vector3(
         ( vec0.getX() * vec1.getX() ),
         ( vec0.getY() * vec1.getY() ),
         ( vec0.getZ() * vec1.getZ() )
     );
+#endif
 }
 
 inline const Vector3 divPerElem( const Vector3 & vec0, const Vector3 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _mm_div_ps( vec0.get128( ), vec1.get128( ) ) );
+#else
     return Vector3(
         ( vec0.getX() / vec1.getX() ),
         ( vec0.getY() / vec1.getY() ),
         ( vec0.getZ() / vec1.getZ() )
     );
+#endif
 }
 
 inline const Vector3 recipPerElem( const Vector3 & vec )
@@ -301,11 +347,15 @@ inline const Vector3 rsqrtPerElem( const Vector3 & vec )
 
 inline const Vector3 absPerElem( const Vector3 & vec )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _vmathAbs( vec.get128( ) ) );
+#else
     return Vector3(
         fabsf( vec.getX() ),
         fabsf( vec.getY() ),
         fabsf( vec.getZ() )
     );
+#endif
 }
 
 inline const Vector3 copySignPerElem( const Vector3 & vec0, const Vector3 & vec1 )
@@ -319,11 +369,15 @@ inline const Vector3 copySignPerElem( const Vector3 & vec0, const Vector3 & vec1
 
 inline const Vector3 maxPerElem( const Vector3 & vec0, const Vector3 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _mm_max_ps( vec0.get128( ), vec1.get128( ) ) );
+#else
     return Vector3(
         (vec0.getX() > vec1.getX())? vec0.getX() : vec1.getX(),
         (vec0.getY() > vec1.getY())? vec0.getY() : vec1.getY(),
         (vec0.getZ() > vec1.getZ())? vec0.getZ() : vec1.getZ()
     );
+#endif
 }
 
 inline float maxElem( const Vector3 & vec )
@@ -336,11 +390,15 @@ inline float maxElem( const Vector3 & vec )
 
 inline const Vector3 minPerElem( const Vector3 & vec0, const Vector3 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _mm_min_ps( vec0.get128( ), vec1.get128( ) ) );
+#else
     return Vector3(
         (vec0.getX() < vec1.getX())? vec0.getX() : vec1.getX(),
         (vec0.getY() < vec1.getY())? vec0.getY() : vec1.getY(),
         (vec0.getZ() < vec1.getZ())? vec0.getZ() : vec1.getZ()
     );
+#endif
 }
 
 inline float minElem( const Vector3 & vec )
@@ -361,20 +419,29 @@ inline float sum( const Vector3 & vec )
 
 inline float dot( const Vector3 & vec0, const Vector3 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return _mm_cvtss_f32( _vmathDot3( vec0.get128( ), vec1.get128( ) ) );
+#else
     float result;
     result = ( vec0.getX() * vec1.getX() );
     result = ( result + ( vec0.getY() * vec1.getY() ) );
     result = ( result + ( vec0.getZ() * vec1.getZ() ) );
     return result;
+#endif
 }
 
 inline float lengthSqr( const Vector3 & vec )
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = vec.get128( );
+    return _mm_cvtss_f32( _vmathDot3( v, v ) );
+#else
     float result;
     result = ( vec.getX() * vec.getX() );
     result = ( result + ( vec.getY() * vec.getY() ) );
     result = ( result + ( vec.getZ() * vec.getZ() ) );
     return result;
+#endif
 }
 
 inline float length( const Vector3 & vec )
@@ -384,6 +451,11 @@ inline float length( const Vector3 & vec )
 
 inline const Vector3 normalize( const Vector3 & vec )
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = vec.get128( );
+    __m128 lenInv = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( _vmathDot3( v, v ) ) );
+    return Vector3( _mm_mul_ps( v, lenInv ) );
+#else
     float lenSqr, lenInv;
     lenSqr = lengthSqr( vec );
     lenInv = ( 1.0f / sqrtf( lenSqr ) );
@@ -392,15 +464,20 @@ inline const Vector3 normalize( const Vector3 & vec )
         ( vec.getY() * lenInv ),
         ( vec.getZ() * lenInv )
     );
+#endif
 }
 
 inline const Vector3 cross( const Vector3 & vec0, const Vector3 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _vmathCross( vec0.get128( ), vec1.get128( ) ) );
+#else
     return Vector3(
         ( ( vec0.getY() * vec1.getZ() ) - ( vec0.getZ() * vec1.getY() ) ),
         ( ( vec0.getZ() * vec1.getX() ) - ( vec0.getX() * vec1.getZ() ) ),
         ( ( vec0.getX() * vec1.getY() ) - ( vec0.getY() * vec1.getX() ) )
     );
+#endif
 }
 
 inline const Vector3 select( const Vector3 & vec0, const Vector3 & vec1, bool select1 )
@@ -480,6 +557,20 @@ inline Vector4::Vector4( float scalar )
     mW = scalar;
 }
 
+#ifdef _VECTORMATH_SSE
+
+inline Vector4::Vector4( __m128 vf4 )
+{
+    _vmathStore( &mX, vf4 );
+}
+
+inline __m128 Vector4::get128( ) const
+{
+    return _vmathLoad4( &mX );
+}
+
+#endif
+
 inline const Vector4 Vector4::xAxis( )
 {
     return Vector4( 1.0f, 0.0f, 0.0f, 0.0f );
@@ -610,32 +701,44 @@ inline float Vector4::operator []( int idx ) const
 
 inline const Vector4 Vector4::operator +( const Vector4 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _mm_add_ps( get128( ), vec.get128( ) ) );
+#else
     return Vector4(
         ( mX + vec.mX ),
         ( mY + vec.mY ),
         ( mZ + vec.mZ ),
         ( mW + vec.mW )
     );
+#endif
 }
 
 inline const Vector4 Vector4::operator -( const Vector4 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _mm_sub_ps( get128( ), vec.get128( ) ) );
+#else
     return Vector4(
         ( mX - vec.mX ),
         ( mY - vec.mY ),
         ( mZ - vec.mZ ),
         ( mW - vec.mW )
     );
+#endif
 }
 
 inline const Vector4 Vector4::operator *( float scalar ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _mm_mul_ps( get128( ), _mm_set1_ps( scalar ) ) );
+#else
     return Vector4(
         ( mX * scalar ),
         ( mY * scalar ),
         ( mZ * scalar ),
         ( mW * scalar )
     );
+#endif
 }
 
 inline Vector4 & Vector4::operator +=( const Vector4 & vec )
@@ -658,12 +761,16 @@ inline Vector4 & Vector4::operator *=( float scalar )
 
 inline const Vector4 Vector4::operator /( float scalar ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _mm_div_ps( get128( ), _mm_set1_ps( scalar ) ) );
+#else
     return Vector4(
         ( mX / scalar ),
         ( mY / scalar ),
         ( mZ / scalar ),
         ( mW / scalar )
     );
+#endif
 }
 
 inline Vector4 & Vector4::operator /=( float scalar )
@@ -674,12 +781,16 @@ inline Vector4 & Vector4::operator /=( float scalar )
 
 inline const Vector4 Vector4::operator -( ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _vmathNegate( get128( ) ) );
+#else
     return Vector4(
         -mX,
         -mY,
         -mZ,
         -mW
     );
+#endif
 }
 
 inline const Vector4 operator *( float scalar, const Vector4 & vec )
@@ -689,22 +800,30 @@ inline const Vector4 operator *( float scalar, const Vector4 & vec )
 
 inline const Vector4 mulPerElem( const Vector4 & vec0, const Vector4 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _mm_mul_ps( vec0.get128( ), vec1.get128( ) ) );
+#else
     return Vector4(
         ( vec0.getX() * vec1.getX() ),
         ( vec0.getY() * vec1.getY() ),
         ( vec0.getZ() * vec1.getZ() ),
         ( vec0.getW() * vec1.getW() )
     );
+#endif
 }
 
 inline const Vector4 divPerElem( const Vector4 & vec0, const Vector4 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _mm_div_ps( vec0.get128( ), vec1.get128( ) ) );
+#else
     return Vector4(
         ( vec0.getX() / vec1.getX() ),
         ( vec0.getY() / vec1.getY() ),
         ( vec0.getZ() / vec1.getZ() ),
         ( vec0.getW() / vec1.getW() )
     );
+#endif
 }
 
 inline const Vector4 recipPerElem( const Vector4 & vec )
@@ -739,12 +858,16 @@ inline const Vector4 rsqrtPerElem( const Vector4 & vec )
 
 inline const Vector4 absPerElem( const Vector4 & vec )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _vmathAbs( vec.get128( ) ) );
+#else
     return Vector4(
         fabsf( vec.getX() ),
         fabsf( vec.getY() ),
         fabsf( vec.getZ() ),
         fabsf( vec.getW() )
     );
+#endif
 }
 
 inline const Vector4 copySignPerElem( const Vector4 & vec0, const Vector4 & vec1 )
@@ -759,12 +882,16 @@ inline const Vector4 copySignPerElem( const Vector4 & vec0, const Vector4 & vec1
 
 inline const Vector4 maxPerElem( const Vector4 & vec0, const Vector4 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _mm_max_ps( vec0.get128( ), vec1.get128( ) ) );
+#else
     return Vector4(
         (vec0.getX() > vec1.getX())? vec0.getX() : vec1.getX(),
         (vec0.getY() > vec1.getY())? vec0.getY() : vec1.getY(),
         (vec0.getZ() > vec1.getZ())? vec0.getZ() : vec1.getZ(),
         (vec0.getW() > vec1.getW())? vec0.getW() : vec1.getW()
     );
+#endif
 }
 
 inline float maxElem( const Vector4 & vec )
@@ -778,12 +905,16 @@ inline float maxElem( const Vector4 & vec )
 
 inline const Vector4 minPerElem( const Vector4 & vec0, const Vector4 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return Vector4( _mm_min_ps( vec0.get128( ), vec1.get128( ) ) );
+#else
     return Vector4(
         (vec0.getX() < vec1.getX())? vec0.getX() : vec1.getX(),
         (vec0.getY() < vec1.getY())? vec0.getY() : vec1.getY(),
         (vec0.getZ() < vec1.getZ())? vec0.getZ() : vec1.getZ(),
         (vec0.getW() < vec1.getW())? vec0.getW() : vec1.getW()
     );
+#endif
 }
 
 inline float minElem( const Vector4 & vec )
@@ -806,22 +937,31 @@ inline float sum( const Vector4 & vec )
 
 inline float dot( const Vector4 & vec0, const Vector4 & vec1 )
 {
+#ifdef _VECTORMATH_SSE
+    return _mm_cvtss_f32( _vmathDot4( vec0.get128( ), vec1.get128( ) ) );
+#else
     float result;
     result = ( vec0.getX() * vec1.getX() );
     result = ( result + ( vec0.getY() * vec1.getY() ) );
     result = ( result + ( vec0.getZ() * vec1.getZ() ) );
     result = ( result + ( vec0.getW() * vec1.getW() ) );
     return result;
+#endif
 }
 
 inline float lengthSqr( const Vector4 & vec )
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = vec.get128( );
+    return _mm_cvtss_f32( _vmathDot4( v, v ) );
+#else
     float result;
     result = ( vec.getX() * vec.getX() );
     result = ( result + ( vec.getY() * vec.getY() ) );
     result = ( result + ( vec.getZ() * vec.getZ() ) );
     result = ( result + ( vec.getW() * vec.getW() ) );
     return result;
+#endif
 }
 
 inline float length( const Vector4 & vec )
@@ -831,6 +971,11 @@ inline float length( const Vector4 & vec )
 
 inline const Vector4 normalize( const Vector4 & vec )
 {
+#ifdef _VECTORMATH_SSE
+    __m128 v = vec.get128( );
+    __m128 lenInv = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( _vmathDot4( v, v ) ) );
+    return Vector4( _mm_mul_ps( v, lenInv ) );
+#else
     float lenSqr, lenInv;
     lenSqr = lengthSqr( vec );
     lenInv = ( 1.0f / sqrtf( lenSqr ) );
@@ -840,6 +985,7 @@ inline const Vector4 normalize( const Vector4 & vec )
         ( vec.getZ() * lenInv ),
         ( vec.getW() * lenInv )
     );
+#endif
 }
 
 inline const Vector4 select( const Vector4 & vec0, const Vector4 & vec1, bool select1 )
@@ -894,6 +1040,20 @@ inline Point3::Point3( float scalar )
     mZ = scalar;
 }
 
+#ifdef _VECTORMATH_SSE
+
+inline Point3::Point3( __m128 vf4 )
+{
+    _vmathStore( &mX, vf4 );
+}
+
+inline __m128 Point3::get128( ) const
+{
+    return _vmathLoad3( &mX );
+}
+
+#endif
+
 inline const Point3 lerp( float t, const Point3 & pnt0, const Point3 & pnt1 )
 {
     return ( pnt0 + ( ( pnt1 - pnt0 ) * t ) );
@@ -963,29 +1123,41 @@ inline float Point3::operator []( int idx ) const
 
 inline const Vector3 Point3::operator -( const Point3 & pnt ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Vector3( _mm_sub_ps( get128( ), pnt.get128( ) ) );
+#else
     return Vector3(
         ( mX - pnt.mX ),
         ( mY - pnt.mY ),
         ( mZ - pnt.mZ )
     );
+#endif
 }
 
 inline const Point3 Point3::operator +( const Vector3 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Point3( _mm_add_ps( get128( ), vec.get128( ) ) );
+#else
     return Point3(
         ( mX + vec.getX() ),
         ( mY + vec.getY() ),
         ( mZ + vec.getZ() )
     );
+#endif
 }
 
 inline const Point3 Point3::operator -( const Vector3 & vec ) const
 {
+#ifdef _VECTORMATH_SSE
+    return Point3( _mm_sub_ps( get128( ), vec.get128( ) ) );
+#else
     return Point3(
         ( mX - vec.getX() ),
         ( mY - vec.getY() ),
         ( mZ - vec.getZ() )
     );
+#endif
 }
 
 inline Point3 & Point3::operator +=( const Vector3 & vec )
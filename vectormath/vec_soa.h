@@ -0,0 +1,626 @@
+/*
+   Definitions for vectormath_soa.h.
+
+   With GCC the SIMD lanes use the vector extensions for arithmetic and
+   lane access (__m128 and __m256 are vector types), so the SSE and AVX
+   variants only differ in the intrinsics for sqrt, min and max.
+*/
+
+#ifndef _VECTORMATH_VEC_SOA_CPP_H
+#define _VECTORMATH_VEC_SOA_CPP_H
+
+namespace Vectormath {
+namespace Aos {
+
+#if defined(_VECTORMATH_SOA_AVX) || defined(_VECTORMATH_SOA_SSE)
+#define _VECTORMATH_SOA_OP( r, a, op, b ) r.mV = a.mV op b.mV
+#else
+#define _VECTORMATH_SOA_OP( r, a, op, b ) for( int i = 0; i < Lanes; ++i ) r.mV[i] = a.mV[i] op b.mV[i]
+#endif
+
+inline FloatSoA::FloatSoA( float scalar )
+{
+#if defined(_VECTORMATH_SOA_AVX)
+    mV = _mm256_set1_ps( scalar );
+#elif defined(_VECTORMATH_SOA_SSE)
+    mV = _mm_set1_ps( scalar );
+#else
+    for( int i = 0; i < Lanes; ++i )
+        mV[i] = scalar;
+#endif
+}
+
+inline const FloatSoA FloatSoA::load( const float * p )
+{
+    FloatSoA result;
+#if defined(_VECTORMATH_SOA_AVX)
+    result.mV = _mm256_loadu_ps( p );
+#elif defined(_VECTORMATH_SOA_SSE)
+    result.mV = _mm_loadu_ps( p );
+#else
+    for( int i = 0; i < Lanes; ++i )
+        result.mV[i] = p[i];
+#endif
+    return result;
+}
+
+inline void FloatSoA::store( float * p ) const
+{
+#if defined(_VECTORMATH_SOA_AVX)
+    _mm256_storeu_ps( p, mV );
+#elif defined(_VECTORMATH_SOA_SSE)
+    _mm_storeu_ps( p, mV );
+#else
+    for( int i = 0; i < Lanes; ++i )
+        p[i] = mV[i];
+#endif
+}
+
+inline FloatSoA & FloatSoA::setLane( int lane, float value )
+{
+    mV[lane] = value;
+    return *this;
+}
+
+inline float FloatSoA::getLane( int lane ) const
+{
+    return mV[lane];
+}
+
+inline const FloatSoA FloatSoA::operator +( const FloatSoA & f ) const
+{
+    FloatSoA result;
+    _VECTORMATH_SOA_OP( result, (*this), +, f );
+    return result;
+}
+
+inline const FloatSoA FloatSoA::operator -( const FloatSoA & f ) const
+{
+    FloatSoA result;
+    _VECTORMATH_SOA_OP( result, (*this), -, f );
+    return result;
+}
+
+inline const FloatSoA FloatSoA::operator *( const FloatSoA & f ) const
+{
+    FloatSoA result;
+    _VECTORMATH_SOA_OP( result, (*this), *, f );
+    return result;
+}
+
+inline const FloatSoA FloatSoA::operator /( const FloatSoA & f ) const
+{
+    FloatSoA result;
+    _VECTORMATH_SOA_OP( result, (*this), /, f );
+    return result;
+}
+
+inline const FloatSoA FloatSoA::operator -( ) const
+{
+    FloatSoA result;
+#if defined(_VECTORMATH_SOA_AVX) || defined(_VECTORMATH_SOA_SSE)
+    result.mV = -mV;
+#else
+    for( int i = 0; i < Lanes; ++i )
+        result.mV[i] = -mV[i];
+#endif
+    return result;
+}
+
+inline FloatSoA & FloatSoA::operator +=( const FloatSoA & f )
+{
+    *this = *this + f;
+    return *this;
+}
+
+inline FloatSoA & FloatSoA::operator -=( const FloatSoA & f )
+{
+    *this = *this - f;
+    return *this;
+}
+
+inline FloatSoA & FloatSoA::operator *=( const FloatSoA & f )
+{
+    *this = *this * f;
+    return *this;
+}
+
+inline FloatSoA & FloatSoA::operator /=( const FloatSoA & f )
+{
+    *this = *this / f;
+    return *this;
+}
+
+inline const FloatSoA sqrtPerElem( const FloatSoA & f )
+{
+    FloatSoA result;
+#if defined(_VECTORMATH_SOA_AVX)
+    result.mV = _mm256_sqrt_ps( f.mV );
+#elif defined(_VECTORMATH_SOA_SSE)
+    result.mV = _mm_sqrt_ps( f.mV );
+#else
+    for( int i = 0; i < FloatSoA::Lanes; ++i )
+        result.mV[i] = sqrtf( f.mV[i] );
+#endif
+    return result;
+}
+
+inline const FloatSoA absPerElem( const FloatSoA & f )
+{
+    FloatSoA result;
+#if defined(_VECTORMATH_SOA_AVX)
+    result.mV = _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), f.mV );
+#elif defined(_VECTORMATH_SOA_SSE)
+    result.mV = _vmathAbs( f.mV );
+#else
+    for( int i = 0; i < FloatSoA::Lanes; ++i )
+        result.mV[i] = fabsf( f.mV[i] );
+#endif
+    return result;
+}
+
+inline const FloatSoA minPerElem( const FloatSoA & f0, const FloatSoA & f1 )
+{
+    FloatSoA result;
+#if defined(_VECTORMATH_SOA_AVX)
+    result.mV = _mm256_min_ps( f0.mV, f1.mV );
+#elif defined(_VECTORMATH_SOA_SSE)
+    result.mV = _mm_min_ps( f0.mV, f1.mV );
+#else
+    for( int i = 0; i < FloatSoA::Lanes; ++i )
+        result.mV[i] = ( f0.mV[i] < f1.mV[i] )? f0.mV[i] : f1.mV[i];
+#endif
+    return result;
+}
+
+inline const FloatSoA maxPerElem( const FloatSoA & f0, const FloatSoA & f1 )
+{
+    FloatSoA result;
+#if defined(_VECTORMATH_SOA_AVX)
+    result.mV = _mm256_max_ps( f0.mV, f1.mV );
+#elif defined(_VECTORMATH_SOA_SSE)
+    result.mV = _mm_max_ps( f0.mV, f1.mV );
+#else
+    for( int i = 0; i < FloatSoA::Lanes; ++i )
+        result.mV[i] = ( f0.mV[i] > f1.mV[i] )? f0.mV[i] : f1.mV[i];
+#endif
+    return result;
+}
+
+#undef _VECTORMATH_SOA_OP
+
+inline Vector3SoA::Vector3SoA( const FloatSoA & _x, const FloatSoA & _y, const FloatSoA & _z )
+{
+    mX = _x;
+    mY = _y;
+    mZ = _z;
+}
+
+inline Vector3SoA::Vector3SoA( const Vector3 & vec )
+{
+    mX = FloatSoA( vec.getX() );
+    mY = FloatSoA( vec.getY() );
+    mZ = FloatSoA( vec.getZ() );
+}
+
+inline Vector3SoA::Vector3SoA( const Vector3 * vecs )
+{
+    for( int i = 0; i < FloatSoA::Lanes; ++i )
+        setLane( i, vecs[i] );
+}
+
+inline Vector3SoA::Vector3SoA( const float * x, const float * y, const float * z )
+{
+    mX = FloatSoA::load( x );
+    mY = FloatSoA::load( y );
+    mZ = FloatSoA::load( z );
+}
+
+inline void Vector3SoA::get( Vector3 * vecs ) const
+{
+    for( int i = 0; i < FloatSoA::Lanes; ++i )
+        vecs[i] = getLane( i );
+}
+
+inline void Vector3SoA::store( float * x, float * y, float * z ) const
+{
+    mX.store( x );
+    mY.store( y );
+    mZ.store( z );
+}
+
+inline Vector3SoA & Vector3SoA::setLane( int lane, const Vector3 & vec )
+{
+    mX.setLane( lane, vec.getX() );
+    mY.setLane( lane, vec.getY() );
+    mZ.setLane( lane, vec.getZ() );
+    return *this;
+}
+
+inline const Vector3 Vector3SoA::getLane( int lane ) const
+{
+    return Vector3( mX.getLane( lane ), mY.getLane( lane ), mZ.getLane( lane ) );
+}
+
+inline Vector3SoA & Vector3SoA::setX( const FloatSoA & _x )
+{
+    mX = _x;
+    return *this;
+}
+
+inline Vector3SoA & Vector3SoA::setY( const FloatSoA & _y )
+{
+    mY = _y;
+    return *this;
+}
+
+inline Vector3SoA & Vector3SoA::setZ( const FloatSoA & _z )
+{
+    mZ = _z;
+    return *this;
+}
+
+inline const FloatSoA Vector3SoA::getX( ) const
+{
+    return mX;
+}
+
+inline const FloatSoA Vector3SoA::getY( ) const
+{
+    return mY;
+}
+
+inline const FloatSoA Vector3SoA::getZ( ) const
+{
+    return mZ;
+}
+
+inline const Vector3SoA Vector3SoA::operator +( const Vector3SoA & vec ) const
+{
+    return Vector3SoA( ( mX + vec.mX ), ( mY + vec.mY ), ( mZ + vec.mZ ) );
+}
+
+inline const Vector3SoA Vector3SoA::operator -( const Vector3SoA & vec ) const
+{
+    return Vector3SoA( ( mX - vec.mX ), ( mY - vec.mY ), ( mZ - vec.mZ ) );
+}
+
+inline const Vector3SoA Vector3SoA::operator *( const FloatSoA & scalar ) const
+{
+    return Vector3SoA( ( mX * scalar ), ( mY * scalar ), ( mZ * scalar ) );
+}
+
+inline const Vector3SoA Vector3SoA::operator /( const FloatSoA & scalar ) const
+{
+    return Vector3SoA( ( mX / scalar ), ( mY / scalar ), ( mZ / scalar ) );
+}
+
+inline const Vector3SoA Vector3SoA::operator -( ) const
+{
+    return Vector3SoA( -mX, -mY, -mZ );
+}
+
+inline Vector3SoA & Vector3SoA::operator +=( const Vector3SoA & vec )
+{
+    *this = *this + vec;
+    return *this;
+}
+
+inline Vector3SoA & Vector3SoA::operator -=( const Vector3SoA & vec )
+{
+    *this = *this - vec;
+    return *this;
+}
+
+inline Vector3SoA & Vector3SoA::operator *=( const FloatSoA & scalar )
+{
+    *this = *this * scalar;
+    return *this;
+}
+
+inline Vector3SoA & Vector3SoA::operator /=( const FloatSoA & scalar )
+{
+    *this = *this / scalar;
+    return *this;
+}
+
+inline const Vector3SoA operator *( const FloatSoA & scalar, const Vector3SoA & vec )
+{
+    return vec * scalar;
+}
+
+inline const Vector3SoA mulPerElem( const Vector3SoA & vec0, const Vector3SoA & vec1 )
+{
+    return Vector3SoA(
+        ( vec0.getX() * vec1.getX() ),
+        ( vec0.getY() * vec1.getY() ),
+        ( vec0.getZ() * vec1.getZ() )
+    );
+}
+
+inline const FloatSoA dot( const Vector3SoA & vec0, const Vector3SoA & vec1 )
+{
+    FloatSoA result;
+    result = ( vec0.getX() * vec1.getX() );
+    result = ( result + ( vec0.getY() * vec1.getY() ) );
+    result = ( result + ( vec0.getZ() * vec1.getZ() ) );
+    return result;
+}
+
+inline const FloatSoA lengthSqr( const Vector3SoA & vec )
+{
+    return dot( vec, vec );
+}
+
+inline const FloatSoA length( const Vector3SoA & vec )
+{
+    return sqrtPerElem( lengthSqr( vec ) );
+}
+
+inline const Vector3SoA normalize( const Vector3SoA & vec )
+{
+    FloatSoA lenInv = ( FloatSoA( 1.0f ) / length( vec ) );
+    return vec * lenInv;
+}
+
+inline const Vector3SoA cross( const Vector3SoA & vec0, const Vector3SoA & vec1 )
+{
+    return Vector3SoA(
+        ( ( vec0.getY() * vec1.getZ() ) - ( vec0.getZ() * vec1.getY() ) ),
+        ( ( vec0.getZ() * vec1.getX() ) - ( vec0.getX() * vec1.getZ() ) ),
+        ( ( vec0.getX() * vec1.getY() ) - ( vec0.getY() * vec1.getX() ) )
+    );
+}
+
+inline QuatSoA::QuatSoA( const FloatSoA & _x, const FloatSoA & _y, const FloatSoA & _z, const FloatSoA & _w )
+{
+    mX = _x;
+    mY = _y;
+    mZ = _z;
+    mW = _w;
+}
+
+inline QuatSoA::QuatSoA( const Quat & quat )
+{
+    mX = FloatSoA( quat.getX() );
+    mY = FloatSoA( quat.getY() );
+    mZ = FloatSoA( quat.getZ() );
+    mW = FloatSoA( quat.getW() );
+}
+
+inline QuatSoA::QuatSoA( const Quat * quats )
+{
+    for( int i = 0; i < FloatSoA::Lanes; ++i )
+        setLane( i, quats[i] );
+}
+
+inline void QuatSoA::get( Quat * quats ) const
+{
+    for( int i = 0; i < FloatSoA::Lanes; ++i )
+        quats[i] = getLane( i );
+}
+
+inline QuatSoA & QuatSoA::setLane( int lane, const Quat & quat )
+{
+    mX.setLane( lane, quat.getX() );
+    mY.setLane( lane, quat.getY() );
+    mZ.setLane( lane, quat.getZ() );
+    mW.setLane( lane, quat.getW() );
+    return *this;
+}
+
+inline const Quat QuatSoA::getLane( int lane ) const
+{
+    return Quat( mX.getLane( lane ), mY.getLane( lane ), mZ.getLane( lane ), mW.getLane( lane ) );
+}
+
+inline QuatSoA & QuatSoA::setXYZ( const Vector3SoA & vec )
+{
+    mX = vec.getX();
+    mY = vec.getY();
+    mZ = vec.getZ();
+    return *this;
+}
+
+inline const Vector3SoA QuatSoA::getXYZ( ) const
+{
+    return Vector3SoA( mX, mY, mZ );
+}
+
+inline QuatSoA & QuatSoA::setW( const FloatSoA & _w )
+{
+    mW = _w;
+    return *this;
+}
+
+inline const FloatSoA QuatSoA::getX( ) const
+{
+    return mX;
+}
+
+inline const FloatSoA QuatSoA::getY( ) const
+{
+    return mY;
+}
+
+inline const FloatSoA QuatSoA::getZ( ) const
+{
+    return mZ;
+}
+
+inline const FloatSoA QuatSoA::getW( ) const
+{
+    return mW;
+}
+
+inline const QuatSoA QuatSoA::operator +( const QuatSoA & quat ) const
+{
+    return QuatSoA( ( mX + quat.mX ), ( mY + quat.mY ), ( mZ + quat.mZ ), ( mW + quat.mW ) );
+}
+
+inline const QuatSoA QuatSoA::operator -( const QuatSoA & quat ) const
+{
+    return QuatSoA( ( mX - quat.mX ), ( mY - quat.mY ), ( mZ - quat.mZ ), ( mW - quat.mW ) );
+}
+
+inline const QuatSoA QuatSoA::operator *( const FloatSoA & scalar ) const
+{
+    return QuatSoA( ( mX * scalar ), ( mY * scalar ), ( mZ * scalar ), ( mW * scalar ) );
+}
+
+inline const QuatSoA QuatSoA::operator -( ) const
+{
+    return QuatSoA( -mX, -mY, -mZ, -mW );
+}
+
+inline const QuatSoA QuatSoA::operator *( const QuatSoA & quat ) const
+{
+    return QuatSoA(
+        ( ( ( ( mW * quat.mX ) + ( mX * quat.mW ) ) + ( mY * quat.mZ ) ) - ( mZ * quat.mY ) ),
+        ( ( ( ( mW * quat.mY ) + ( mY * quat.mW ) ) + ( mZ * quat.mX ) ) - ( mX * quat.mZ ) ),
+        ( ( ( ( mW * quat.mZ ) + ( mZ * quat.mW ) ) + ( mX * quat.mY ) ) - ( mY * quat.mX ) ),
+        ( ( ( ( mW * quat.mW ) - ( mX * quat.mX ) ) - ( mY * quat.mY ) ) - ( mZ * quat.mZ ) )
+    );
+}
+
+inline QuatSoA & QuatSoA::operator *=( const QuatSoA & quat )
+{
+    *this = *this * quat;
+    return *this;
+}
+
+inline const FloatSoA dot( const QuatSoA & quat0, const QuatSoA & quat1 )
+{
+    FloatSoA result;
+    result = ( quat0.getX() * quat1.getX() );
+    result = ( result + ( quat0.getY() * quat1.getY() ) );
+    result = ( result + ( quat0.getZ() * quat1.getZ() ) );
+    result = ( result + ( quat0.getW() * quat1.getW() ) );
+    return result;
+}
+
+inline const FloatSoA norm( const QuatSoA & quat )
+{
+    return dot( quat, quat );
+}
+
+inline const FloatSoA length( const QuatSoA & quat )
+{
+    return sqrtPerElem( norm( quat ) );
+}
+
+inline const QuatSoA normalize( const QuatSoA & quat )
+{
+    FloatSoA lenInv = ( FloatSoA( 1.0f ) / length( quat ) );
+    return quat * lenInv;
+}
+
+inline const QuatSoA conj( const QuatSoA & quat )
+{
+    return QuatSoA( -quat.getX(), -quat.getY(), -quat.getZ(), quat.getW() );
+}
+
+inline const Vector3SoA rotate( const QuatSoA & quat, const Vector3SoA & vec )
+{
+    FloatSoA tmpX, tmpY, tmpZ, tmpW;
+    tmpX = ( ( ( quat.getW() * vec.getX() ) + ( quat.getY() * vec.getZ() ) ) - ( quat.getZ() * vec.getY() ) );
+    tmpY = ( ( ( quat.getW() * vec.getY() ) + ( quat.getZ() * vec.getX() ) ) - ( quat.getX() * vec.getZ() ) );
+    tmpZ = ( ( ( quat.getW() * vec.getZ() ) + ( quat.getX() * vec.getY() ) ) - ( quat.getY() * vec.getX() ) );
+    tmpW = ( ( ( quat.getX() * vec.getX() ) + ( quat.getY() * vec.getY() ) ) + ( quat.getZ() * vec.getZ() ) );
+    return Vector3SoA(
+        ( ( ( ( tmpW * quat.getX() ) + ( tmpX * quat.getW() ) ) - ( tmpY * quat.getZ() ) ) + ( tmpZ * quat.getY() ) ),
+        ( ( ( ( tmpW * quat.getY() ) + ( tmpY * quat.getW() ) ) - ( tmpZ * quat.getX() ) ) + ( tmpX * quat.getZ() ) ),
+        ( ( ( ( tmpW * quat.getZ() ) + ( tmpZ * quat.getW() ) ) - ( tmpX * quat.getY() ) ) + ( tmpY * quat.getX() ) )
+    );
+}
+
+inline Matrix3SoA::Matrix3SoA( const Vector3SoA & _col0, const Vector3SoA & _col1, const Vector3SoA & _col2 )
+{
+    mCol0 = _col0;
+    mCol1 = _col1;
+    mCol2 = _col2;
+}
+
+inline Matrix3SoA::Matrix3SoA( const Matrix3 & mat )
+{
+    mCol0 = Vector3SoA( mat.getCol0() );
+    mCol1 = Vector3SoA( mat.getCol1() );
+    mCol2 = Vector3SoA( mat.getCol2() );
+}
+
+inline Matrix3SoA::Matrix3SoA( const QuatSoA & unitQuat )
+{
+    FloatSoA qx, qy, qz, qw, qx2, qy2, qz2, qxqx2, qyqy2, qzqz2, qxqy2, qyqz2, qzqw2, qxqz2, qyqw2, qxqw2;
+    const FloatSoA one( 1.0f );
+    qx = unitQuat.getX();
+    qy = unitQuat.getY();
+    qz = unitQuat.getZ();
+    qw = unitQuat.getW();
+    qx2 = ( qx + qx );
+    qy2 = ( qy + qy );
+    qz2 = ( qz + qz );
+    qxqx2 = ( qx * qx2 );
+    qxqy2 = ( qx * qy2 );
+    qxqz2 = ( qx * qz2 );
+    qxqw2 = ( qw * qx2 );
+    qyqy2 = ( qy * qy2 );
+    qyqz2 = ( qy * qz2 );
+    qyqw2 = ( qw * qy2 );
+    qzqz2 = ( qz * qz2 );
+    qzqw2 = ( qw * qz2 );
+    mCol0 = Vector3SoA( ( ( one - qyqy2 ) - qzqz2 ), ( qxqy2 + qzqw2 ), ( qxqz2 - qyqw2 ) );
+    mCol1 = Vector3SoA( ( qxqy2 - qzqw2 ), ( ( one - qxqx2 ) - qzqz2 ), ( qyqz2 + qxqw2 ) );
+    mCol2 = Vector3SoA( ( qxqz2 + qyqw2 ), ( qyqz2 - qxqw2 ), ( ( one - qxqx2 ) - qyqy2 ) );
+}
+
+inline const Matrix3 Matrix3SoA::getLane( int lane ) const
+{
+    return Matrix3( mCol0.getLane( lane ), mCol1.getLane( lane ), mCol2.getLane( lane ) );
+}
+
+inline const Vector3SoA Matrix3SoA::getCol0( ) const
+{
+    return mCol0;
+}
+
+inline const Vector3SoA Matrix3SoA::getCol1( ) const
+{
+    return mCol1;
+}
+
+inline const Vector3SoA Matrix3SoA::getCol2( ) const
+{
+    return mCol2;
+}
+
+inline const Vector3SoA Matrix3SoA::operator *( const Vector3SoA & vec ) const
+{
+    return Vector3SoA(
+        ( ( ( mCol0.getX() * vec.getX() ) + ( mCol1.getX() * vec.getY() ) ) + ( mCol2.getX() * vec.getZ() ) ),
+        ( ( ( mCol0.getY() * vec.getX() ) + ( mCol1.getY() * vec.getY() ) ) + ( mCol2.getY() * vec.getZ() ) ),
+        ( ( ( mCol0.getZ() * vec.getX() ) + ( mCol1.getZ() * vec.getY() ) ) + ( mCol2.getZ() * vec.getZ() ) )
+    );
+}
+
+inline const Matrix3SoA Matrix3SoA::operator *( const Matrix3SoA & mat ) const
+{
+    return Matrix3SoA(
+        ( *this * mat.mCol0 ),
+        ( *this * mat.mCol1 ),
+        ( *this * mat.mCol2 )
+    );
+}
+
+inline const Matrix3SoA transpose( const Matrix3SoA & mat )
+{
+    return Matrix3SoA(
+        Vector3SoA( mat.getCol0().getX(), mat.getCol1().getX(), mat.getCol2().getX() ),
+        Vector3SoA( mat.getCol0().getY(), mat.getCol1().getY(), mat.getCol2().getY() ),
+        Vector3SoA( mat.getCol0().getZ(), mat.getCol1().getZ(), mat.getCol2().getZ() )
+    );
+}
+
+} // namespace Aos
+} // namespace Vectormath
+
+#endif
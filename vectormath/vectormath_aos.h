@@ -36,6 +36,13 @@
 #include <stdio.h>
 #endif
 
+// With GCC on SSE2 targets the hot operations use 128-bit vector instructions.
+// The classes keep their scalar layout, define _VECTORMATH_NO_SIMD to opt out.
+#if defined(__GNUC__) && defined(__SSE2__) && !defined(_VECTORMATH_NO_SIMD)
+#define _VECTORMATH_SSE
+#include "sse_aos.h"
+#endif
+
 namespace Vectormath {
 
 namespace Aos {
@@ -84,6 +91,17 @@ public:
     // 
     explicit inline Vector3( float scalar );
 
+#ifdef _VECTORMATH_SSE
+    // Construct a 3-D vector from a 128-bit register, the w lane is ignored
+    // 
+    explicit inline Vector3( __m128 vf4 );
+
+    // Get the elements of a 3-D vector as a 128-bit register, w is zero
+    // 
+    inline __m128 get128( ) const;
+
+#endif
+
     // Assign one 3-D vector to another
     // 
     inline Vector3 & operator =( const Vector3 & vec );
@@ -361,6 +379,17 @@ public:
     // 
     explicit inline Vector4( float scalar );
 
+#ifdef _VECTORMATH_SSE
+    // Construct a 4-D vector from a 128-bit register
+    // 
+    explicit inline Vector4( __m128 vf4 );
+
+    // Get the elements of a 4-D vector as a 128-bit register
+    // 
+    inline __m128 get128( ) const;
+
+#endif
+
     // Assign one 4-D vector to another
     // 
     inline Vector4 & operator =( const Vector4 & vec );
@@ -628,6 +657,17 @@ public:
     // 
     explicit inline Point3( float scalar );
 
+#ifdef _VECTORMATH_SSE
+    // Construct a 3-D point from a 128-bit register, the w lane is ignored
+    // 
+    explicit inline Point3( __m128 vf4 );
+
+    // Get the elements of a 3-D point as a 128-bit register, w is zero
+    // 
+    inline __m128 get128( ) const;
+
+#endif
+
     // Assign one 3-D point to another
     // 
     inline Point3 & operator =( const Point3 & pnt );
@@ -846,6 +886,17 @@ public:
     // 
     explicit inline Quat( float scalar );
 
+#ifdef _VECTORMATH_SSE
+    // Construct a quaternion from a 128-bit register
+    // 
+    explicit inline Quat( __m128 vf4 );
+
+    // Get the elements of a quaternion as a 128-bit register
+    // 
+    inline __m128 get128( ) const;
+
+#endif
+
     // Assign one quaternion to another
     // 
     inline Quat & operator =( const Quat & quat );
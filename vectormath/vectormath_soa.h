@@ -0,0 +1,353 @@
+/*
+   Structure-of-arrays counterparts of the vector math classes.
+
+   A FloatSoA holds one float per lane, a Vector3SoA, QuatSoA or Matrix3SoA
+   holds FloatSoA::Lanes independent vectors, quaternions or matrices with
+   one register per component. All lanes are processed by the same
+   instruction: 8 lanes with AVX, 4 lanes with SSE or the scalar fallback.
+
+   The AVX types want 32 byte alignment. Locals and C++17 new are fine, for
+   other storage keep the components in float arrays and use the pointer
+   constructors, which do unaligned loads.
+*/
+
+#ifndef _VECTORMATH_SOA_CPP_H
+#define _VECTORMATH_SOA_CPP_H
+
+#include "vectormath_aos.h"
+
+#if defined(__GNUC__) && defined(__AVX__) && !defined(_VECTORMATH_NO_SIMD)
+#define _VECTORMATH_SOA_AVX
+#include <immintrin.h>
+#elif defined(_VECTORMATH_SSE)
+#define _VECTORMATH_SOA_SSE
+#endif
+
+namespace Vectormath {
+
+namespace Aos {
+
+class FloatSoA;
+class Vector3SoA;
+class QuatSoA;
+class Matrix3SoA;
+
+// One float per lane
+//
+class FloatSoA
+{
+#if defined(_VECTORMATH_SOA_AVX)
+    __m256 mV;
+#elif defined(_VECTORMATH_SOA_SSE)
+    __m128 mV;
+#else
+    float mV[4];
+#endif
+
+public:
+#ifdef _VECTORMATH_SOA_AVX
+    enum { Lanes = 8 };
+#else
+    enum { Lanes = 4 };
+#endif
+
+    // Default constructor; does no initialization
+    //
+    inline FloatSoA( ) { };
+
+    // Set all lanes to the same scalar value
+    //
+    inline FloatSoA( float scalar );
+
+    // Load Lanes floats from memory, no alignment required
+    //
+    static inline const FloatSoA load( const float * p );
+
+    // Store Lanes floats to memory, no alignment required
+    //
+    inline void store( float * p ) const;
+
+    // Set one lane
+    //
+    inline FloatSoA & setLane( int lane, float value );
+
+    // Get one lane
+    //
+    inline float getLane( int lane ) const;
+
+    // Per lane arithmetic
+    //
+    inline const FloatSoA operator +( const FloatSoA & f ) const;
+    inline const FloatSoA operator -( const FloatSoA & f ) const;
+    inline const FloatSoA operator *( const FloatSoA & f ) const;
+    inline const FloatSoA operator /( const FloatSoA & f ) const;
+    inline const FloatSoA operator -( ) const;
+    inline FloatSoA & operator +=( const FloatSoA & f );
+    inline FloatSoA & operator -=( const FloatSoA & f );
+    inline FloatSoA & operator *=( const FloatSoA & f );
+    inline FloatSoA & operator /=( const FloatSoA & f );
+
+    friend inline const FloatSoA sqrtPerElem( const FloatSoA & f );
+    friend inline const FloatSoA absPerElem( const FloatSoA & f );
+    friend inline const FloatSoA minPerElem( const FloatSoA & f0, const FloatSoA & f1 );
+    friend inline const FloatSoA maxPerElem( const FloatSoA & f0, const FloatSoA & f1 );
+
+};
+
+// Square root of each lane
+//
+inline const FloatSoA sqrtPerElem( const FloatSoA & f );
+
+// Absolute value of each lane
+//
+inline const FloatSoA absPerElem( const FloatSoA & f );
+
+// Minimum of two values per lane
+//
+inline const FloatSoA minPerElem( const FloatSoA & f0, const FloatSoA & f1 );
+
+// Maximum of two values per lane
+//
+inline const FloatSoA maxPerElem( const FloatSoA & f0, const FloatSoA & f1 );
+
+// Lanes 3-D vectors in structure-of-arrays format
+//
+class Vector3SoA
+{
+    FloatSoA mX;
+    FloatSoA mY;
+    FloatSoA mZ;
+
+public:
+    // Default constructor; does no initialization
+    //
+    inline Vector3SoA( ) { };
+
+    // Construct from x, y, and z components
+    //
+    inline Vector3SoA( const FloatSoA & x, const FloatSoA & y, const FloatSoA & z );
+
+    // Set all lanes to the same 3-D vector
+    //
+    explicit inline Vector3SoA( const Vector3 & vec );
+
+    // Gather Lanes 3-D vectors
+    //
+    explicit inline Vector3SoA( const Vector3 * vecs );
+
+    // Load the components from three float arrays of Lanes elements
+    //
+    inline Vector3SoA( const float * x, const float * y, const float * z );
+
+    // Scatter to Lanes 3-D vectors
+    //
+    inline void get( Vector3 * vecs ) const;
+
+    // Store the components to three float arrays of Lanes elements
+    //
+    inline void store( float * x, float * y, float * z ) const;
+
+    // Set the 3-D vector of one lane
+    //
+    inline Vector3SoA & setLane( int lane, const Vector3 & vec );
+
+    // Get the 3-D vector of one lane
+    //
+    inline const Vector3 getLane( int lane ) const;
+
+    // Set or get the components
+    //
+    inline Vector3SoA & setX( const FloatSoA & x );
+    inline Vector3SoA & setY( const FloatSoA & y );
+    inline Vector3SoA & setZ( const FloatSoA & z );
+    inline const FloatSoA getX( ) const;
+    inline const FloatSoA getY( ) const;
+    inline const FloatSoA getZ( ) const;
+
+    // Add, subtract, negate and scale 3-D vectors per lane
+    //
+    inline const Vector3SoA operator +( const Vector3SoA & vec ) const;
+    inline const Vector3SoA operator -( const Vector3SoA & vec ) const;
+    inline const Vector3SoA operator *( const FloatSoA & scalar ) const;
+    inline const Vector3SoA operator /( const FloatSoA & scalar ) const;
+    inline const Vector3SoA operator -( ) const;
+    inline Vector3SoA & operator +=( const Vector3SoA & vec );
+    inline Vector3SoA & operator -=( const Vector3SoA & vec );
+    inline Vector3SoA & operator *=( const FloatSoA & scalar );
+    inline Vector3SoA & operator /=( const FloatSoA & scalar );
+
+};
+
+// Multiply 3-D vectors by scalars per lane
+//
+inline const Vector3SoA operator *( const FloatSoA & scalar, const Vector3SoA & vec );
+
+// Multiply two 3-D vectors per element
+//
+inline const Vector3SoA mulPerElem( const Vector3SoA & vec0, const Vector3SoA & vec1 );
+
+// Compute the dot product of two 3-D vectors per lane
+//
+inline const FloatSoA dot( const Vector3SoA & vec0, const Vector3SoA & vec1 );
+
+// Compute the square of the length of 3-D vectors
+//
+inline const FloatSoA lengthSqr( const Vector3SoA & vec );
+
+// Compute the length of 3-D vectors
+//
+inline const FloatSoA length( const Vector3SoA & vec );
+
+// Normalize 3-D vectors
+// NOTE:
+// The result is unpredictable when a vector has near-zero length.
+//
+inline const Vector3SoA normalize( const Vector3SoA & vec );
+
+// Compute the cross product of two 3-D vectors per lane
+//
+inline const Vector3SoA cross( const Vector3SoA & vec0, const Vector3SoA & vec1 );
+
+// Lanes quaternions in structure-of-arrays format
+//
+class QuatSoA
+{
+    FloatSoA mX;
+    FloatSoA mY;
+    FloatSoA mZ;
+    FloatSoA mW;
+
+public:
+    // Default constructor; does no initialization
+    //
+    inline QuatSoA( ) { };
+
+    // Construct from x, y, z, and w components
+    //
+    inline QuatSoA( const FloatSoA & x, const FloatSoA & y, const FloatSoA & z, const FloatSoA & w );
+
+    // Set all lanes to the same quaternion
+    //
+    explicit inline QuatSoA( const Quat & quat );
+
+    // Gather Lanes quaternions
+    //
+    explicit inline QuatSoA( const Quat * quats );
+
+    // Scatter to Lanes quaternions
+    //
+    inline void get( Quat * quats ) const;
+
+    // Set the quaternion of one lane
+    //
+    inline QuatSoA & setLane( int lane, const Quat & quat );
+
+    // Get the quaternion of one lane
+    //
+    inline const Quat getLane( int lane ) const;
+
+    // Set or get the components
+    //
+    inline QuatSoA & setXYZ( const Vector3SoA & vec );
+    inline const Vector3SoA getXYZ( ) const;
+    inline QuatSoA & setW( const FloatSoA & w );
+    inline const FloatSoA getX( ) const;
+    inline const FloatSoA getY( ) const;
+    inline const FloatSoA getZ( ) const;
+    inline const FloatSoA getW( ) const;
+
+    // Add, subtract, negate and scale quaternions per lane
+    //
+    inline const QuatSoA operator +( const QuatSoA & quat ) const;
+    inline const QuatSoA operator -( const QuatSoA & quat ) const;
+    inline const QuatSoA operator *( const FloatSoA & scalar ) const;
+    inline const QuatSoA operator -( ) const;
+
+    // Multiply two quaternions per lane
+    //
+    inline const QuatSoA operator *( const QuatSoA & quat ) const;
+    inline QuatSoA & operator *=( const QuatSoA & quat );
+
+};
+
+// Compute the dot product of two quaternions per lane
+//
+inline const FloatSoA dot( const QuatSoA & quat0, const QuatSoA & quat1 );
+
+// Compute the norm of quaternions
+//
+inline const FloatSoA norm( const QuatSoA & quat );
+
+// Compute the length of quaternions
+//
+inline const FloatSoA length( const QuatSoA & quat );
+
+// Normalize quaternions
+// NOTE:
+// The result is unpredictable when a quaternion has near-zero length.
+//
+inline const QuatSoA normalize( const QuatSoA & quat );
+
+// Compute the conjugate of quaternions
+//
+inline const QuatSoA conj( const QuatSoA & quat );
+
+// Use unit-length quaternions to rotate 3-D vectors per lane
+//
+inline const Vector3SoA rotate( const QuatSoA & unitQuat, const Vector3SoA & vec );
+
+// Lanes 3x3 matrices in structure-of-arrays format
+//
+class Matrix3SoA
+{
+    Vector3SoA mCol0;
+    Vector3SoA mCol1;
+    Vector3SoA mCol2;
+
+public:
+    // Default constructor; does no initialization
+    //
+    inline Matrix3SoA( ) { };
+
+    // Construct from three columns
+    //
+    inline Matrix3SoA( const Vector3SoA & col0, const Vector3SoA & col1, const Vector3SoA & col2 );
+
+    // Set all lanes to the same 3x3 matrix
+    //
+    explicit inline Matrix3SoA( const Matrix3 & mat );
+
+    // Construct rotation matrices from unit-length quaternions
+    //
+    explicit inline Matrix3SoA( const QuatSoA & unitQuat );
+
+    // Get the 3x3 matrix of one lane
+    //
+    inline const Matrix3 getLane( int lane ) const;
+
+    // Get the columns
+    //
+    inline const Vector3SoA getCol0( ) const;
+    inline const Vector3SoA getCol1( ) const;
+    inline const Vector3SoA getCol2( ) const;
+
+    // Multiply 3x3 matrices by 3-D vectors per lane
+    //
+    inline const Vector3SoA operator *( const Vector3SoA & vec ) const;
+
+    // Multiply two 3x3 matrices per lane
+    //
+    inline const Matrix3SoA operator *( const Matrix3SoA & mat ) const;
+
+};
+
+// Transpose 3x3 matrices
+//
+inline const Matrix3SoA transpose( const Matrix3SoA & mat );
+
+} // namespace Aos
+} // namespace Vectormath
+
+#include "vec_soa.h"
+
+#endif
@@ -4,6 +4,7 @@
 #include "vl/CHECK.hpp"
 #include "vl/Renderer.hpp"
 #include "vl/Geometry.hpp"
+#include "vl/InstancedGeometry.hpp"
 #include "vl/Camera.hpp"
 #include "vl/Object.hpp"
 #include "vl/ShaderNode.hpp"
@@ -15,11 +16,13 @@
 #include "vl/quat.hpp"
 #include "vl/Say.hpp"
 #include "vl/Time.hpp"
+#include "vl/Trace.hpp"
 #include "vl/FlyCameraManipulator.hpp"
 #include "vl/TrackballManipulator.hpp"
 #include "vl/GlobalState.hpp"
 #include "vl/KdTree.hpp"
 #include "vl/CameraReadPixels.hpp"
+#include "vl/CameraVideoCapture.hpp"
 #include "vl/FrameBufferObject.hpp"
 #include "vl/CopyTexSubImage.hpp"
 #include "vl/Text.hpp"
@@ -34,12 +37,17 @@
 #include "vlut/GeometricalPrimitives.hpp"
 #include "vlGLUT/GLUT_Window.hpp"
 
-//the original vl/LoadPLY.hpp sucks
-#include "LoadPLY2.hpp"
+//the original vl/LoadPLY.hpp sucks, the models are loaded by LoadPLY2 through the mesh cache
+#include "meshcache.h"
 
 #include "quadcopter.h"
+#include "copterscene.h"
+#include "onboardcamera.h"
+#include "signalplot.h"
 
 #include <iostream>
+#include <unistd.h>
+#include <ctime>
 
 SimQuadCopter::QuadCopter copter(0.51f);
 
@@ -55,16 +63,47 @@ public:
       _camera_read_pixels ->setup( 0, 0, pipeline()->camera()->viewport()->width(), pipeline()->camera()->viewport()->width(), vl::RDB_BACK_LEFT );
       pipeline()->camera()->addRenderFinishedCallback(_camera_read_pixels .get());
       _camera_read_pixels ->setRemoveAfterCall(true);
-      std::string filename = vl::Say( title() + "-%n.tif") << (int)vl::Time::timerSeconds();
+      std::string filename = captureName(".tif");
       _camera_read_pixels ->setSavePath( filename );
       vl::Log::print( vl::Say("Screenshot: '%s'\n") << filename );
     }
+    else
+    if (key == vl::Key_F11)
+    {
+      //records the view until F11 is pressed again
+      if (_video_capture->isCapturing())
+      {
+        _video_capture->stop();
+        vl::Log::print( vl::Say("Video: %n frames, %n rendered, %n waited for the writer\n") << _video_capture->videoFrameCount() << _video_capture->frameCount() << _video_capture->stallCount() );
+      }
+      else
+      {
+        std::string filename = captureName(".y4m");
+        vl::ref<vl::Viewport> viewport = pipeline()->camera()->viewport();
+        if (_video_capture->start( filename, vl::CaptureY4M, viewport->x(), viewport->y(), viewport->width(), viewport->height() ))
+          vl::Log::print( vl::Say("Video: '%s'\n") << filename );
+      }
+    }
+  }
+
+  /* title-YYYYMMDD-HHMMSS.ext, the wall clock: the timer of vl::Time starts anew at every boot */
+  std::string captureName(const char* ext)
+  {
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y%m%d-%H%M%S", localtime(&now));
+    return title() + "-" + date + ext;
   }
 
   void init()
   {
     /* screen shot grabbing */
     _camera_read_pixels = new vl::CameraReadPixels;
+    _video_capture = new vl::CameraVideoCapture;
+    _video_capture->setFrameRate(60);
+    /* the redraws come at whatever rate GLUT manages, the video keeps to the clock */
+    _video_capture->setRealTime(true);
+    pipeline()->camera()->addRenderFinishedCallback(_video_capture.get());
     setLogFPS(true);
   }
 
@@ -86,6 +125,7 @@ public:
 
 protected:
   vl::ref<vl::CameraReadPixels> _camera_read_pixels;
+  vl::ref<vl::CameraVideoCapture> _video_capture;
   vl::Time timer;
   double mMaxTime;
 };
@@ -93,8 +133,22 @@ protected:
 class CopterViewer_Program: public TestProgram
 {
 public:
-  CopterViewer_Program()  {}
-  virtual void shutdown() {}
+  CopterViewer_Program(): sonar(NULL), onboardWidth(0), onboardHeight(0), onboardRate(30), onboardName("/simquadcopter-camera")  {}
+  virtual void shutdown()
+  {
+    onboard.shutdown();
+    writeTrace();
+  }
+
+  void writeTrace()
+  {
+    if (traceName.empty())
+      return;
+    if (vl::Trace::writeChromeTrace(traceName))
+      printf("trace written to %s\n", traceName.c_str());
+    else
+      perror(traceName.c_str());
+  }
 
   vl::mat4d getOdeBodyMatrix(dBodyID body)
   {
@@ -105,12 +159,39 @@ public:
     return matrix;
   }
 
-  virtual void keyPressEvent(unsigned int, vl::EKey key)
+  virtual void keyPressEvent(unsigned int ch, vl::EKey key)
   {
     if (key == vl::Key_F2)
     {
       SimQuadCopter::OdeEngine::simulatePropellerRotation=!SimQuadCopter::OdeEngine::simulatePropellerRotation;
     }
+    else
+    if (key == vl::Key_F9)
+    {
+      scene.clearTrails();
+    }
+    else
+    if (key == vl::Key_F5)
+    {
+      plotActor->setEnabled(!plotActor->enabled());
+    }
+    else
+    if (key == vl::Key_F6)
+    {
+      plot->setWindow( std::max(0.05, plot->getWindow()/2) );
+    }
+    else
+    if (key == vl::Key_F7)
+    {
+      plot->setWindow( std::min(60.0, plot->getWindow()*2) );
+    }
+    else
+    if (key == vl::Key_F8)
+    {
+      writeTrace();
+    }
+    else
+      TestProgram::keyPressEvent(ch, key);
   }
 
   vl::vec3d eye;
@@ -129,19 +210,33 @@ public:
     int count=(int)((diff/0.005f)+1);
     //std::cout << count << " " << diff << std::endl;
     for(int i=0;i<count;++i)
+    {
     	copter.update(diff/(float)count);
+    	recordSignals(simTime+diff*(i+1)/count);
+    }
     time=now;
+    simTime+=diff;
 
     //get transforms for objects from ODE
     vl::mat4d m=getOdeBodyMatrix(copter.physics->body);
-    _Transform->setLocalMatrix( m );
-    engineXpTransform->setLocalMatrix(getOdeBodyMatrix(copter.physics->engineXp.propeller));
-    engineXmTransform->setLocalMatrix(getOdeBodyMatrix(copter.physics->engineXm.propeller));
-    engineZpTransform->setLocalMatrix(getOdeBodyMatrix(copter.physics->engineZp.propeller));
-    engineZmTransform->setLocalMatrix(getOdeBodyMatrix(copter.physics->engineZm.propeller));
+    scene.setBodyMatrix( m );
+    scene.setPropellerMatrix(SimQuadCopter::CopterDynamics::EngineXp, getOdeBodyMatrix(copter.physics->engineXp.propeller));
+    scene.setPropellerMatrix(SimQuadCopter::CopterDynamics::EngineXm, getOdeBodyMatrix(copter.physics->engineXm.propeller));
+    scene.setPropellerMatrix(SimQuadCopter::CopterDynamics::EngineZp, getOdeBodyMatrix(copter.physics->engineZp.propeller));
+    scene.setPropellerMatrix(SimQuadCopter::CopterDynamics::EngineZm, getOdeBodyMatrix(copter.physics->engineZm.propeller));
+    onboard.update(simTime);
+
+    scene.addFlownPoint(m.getT());
+    /* the balancer holding the height flies to the throttle in 10m */
+    if(copter.controlMode==SimQuadCopter::QuadCopter::ControlBalance && copter.holdHeight)
+    {
+      vl::vec3d commanded=m.getT();
+      commanded.y()=copter.control.throttle*10.0f*100.0f;
+      scene.addCommandedPoint(commanded);
+    }
 
     vl::vec3d wantedPos=m.getT();
-    vl::vec3d wantedEye=wantedPos-m.getZ()*60+m.getY()*10;
+    vl::vec3d wantedEye=SimQuadCopter::CopterScene::followEye(m);
 
     vl::vec3d dir=wantedEye-eye;
     vl::vec3d dir2=wantedPos-pos;
@@ -154,6 +249,10 @@ pos=wantedPos;
     camFollowTransform->setLocalMatrix(m);
 
 
+    //the values are unreadable when refreshed every frame anyway, and only the changed lines of the text are laid out again
+    if(now-hudTime<0.1)return;
+    hudTime=now;
+
     wchar_t text[1024];
     float x,z,rx,rz;
     //this is what the flightcontrol thinks (it is dependend on the acceleration of the copter)
@@ -168,7 +267,7 @@ pos=wantedPos;
     rz*=180.0f/M_PI;
 
 
-    swprintf(text,1024,L"angle[deg]:\nx=%.02f, real: %.02f\nz=%.02f, real: %.02f\ngyro[deg/s]:\nx=%.02f\ny=%.02f\nz=%.02f\npitch: %.02f\nroll: %.02f\nyaw: %.02f\nspeed: %.01fm/s, %.01fkm/h\nair friction: %.02fN\nthrust: %.02fN\naltitude: %.02fm\nthrottle(l,r,f,b)[%]: %02d %02d %02d %02d\nRPM(l,r,f,b): %04d %04d %04d %04d\npropeller rotation: %s"
+    swprintf(text,1024,L"angle[deg]:\nx=%.02f, real: %.02f\nz=%.02f, real: %.02f\ngyro[deg/s]:\nx=%.02f\ny=%.02f\nz=%.02f\npitch: %.02f\nroll: %.02f\nyaw: %.02f\nspeed: %.01fm/s, %.01fkm/h\nair friction: %.02fN\nthrust: %.02fN\naltitude: %.02fm, sonar: %.02fm\nthrottle(l,r,f,b)[%]: %02d %02d %02d %02d\nRPM(l,r,f,b): %04d %04d %04d %04d\npropeller rotation: %s\nplots(F5, zoom F6/F7) %.02gs: %s\nx/l red, y/r green, z/f blue, b yellow"
       ,x,rx,z,rz,copter.gyroX.getValue()*180.0f/M_PI,copter.gyroY.getValue()*180.0f/M_PI,
       copter.gyroZ.getValue()*180.0f/M_PI,
       copter.control.pitch*180.0f/M_PI,
@@ -179,6 +278,7 @@ pos=wantedPos;
       copter.physics->currentAirFriction,
       copter.physics->getTotalThrust(),
       copter.physics->getPosition().getY(),
+      sonar->getMinRange(),
       (int)(copter.physics->engineXp.getThrottle()*100.0f),
       (int)(copter.physics->engineXm.getThrottle()*100.0f),
       (int)(copter.physics->engineZp.getThrottle()*100.0f),
@@ -187,42 +287,85 @@ pos=wantedPos;
       (int)(copter.physics->engineXm.getRPM()),
       (int)(copter.physics->engineZp.getRPM()),
       (int)(copter.physics->engineZm.getRPM()),
-      SimQuadCopter::OdeEngine::simulatePropellerRotation?"ON":"OFF"
+      SimQuadCopter::OdeEngine::simulatePropellerRotation?"ON":"OFF",
+      plot->getWindow(),
+      plotLegend.c_str()
       );
     info->setText(text);
   }
 
+  /* one sample per simulation step, the plot decimates them */
+  void recordSignals(double t)
+  {
+    float toDeg=180.0f/M_PI;
+    gyroRings[0].push(t, copter.gyroX.getValue()*toDeg);
+    gyroRings[1].push(t, copter.gyroY.getValue()*toDeg);
+    gyroRings[2].push(t, copter.gyroZ.getValue()*toDeg);
+    accelRings[0].push(t, copter.accelX.getValue());
+    accelRings[1].push(t, copter.accelY.getValue());
+    accelRings[2].push(t, copter.accelZ.getValue());
+    SimQuadCopter::OdeEngine* engines[4] = { &copter.physics->engineXp, &copter.physics->engineXm, &copter.physics->engineZp, &copter.physics->engineZm };
+    for(int i=0; i<4; ++i)
+    {
+      throttleRings[i].push(t, engines[i]->getThrottle()*100.0f);
+      rpmRings[i].push(t, engines[i]->getRPM());
+    }
+  }
+
+  void initPlots(vl::Painter* painter)
+  {
+    /* x/l red, y/r green, z/f blue, b yellow */
+    vl::vec4 colors[4] = { vl::vec4(1,0.3f,0.3f,1), vl::vec4(0.3f,1,0.3f,1), vl::vec4(0.4f,0.6f,1,1), vl::vec4(1,1,0.3f,1) };
+    plot = new SimQuadCopter::SignalPlot;
+    int gyro = plot->addLane("gyro[deg/s]", -360, 360);
+    int accel = plot->addLane("accel[m/s^2]", 0, 0);
+    int throttle = plot->addLane("throttle[%]", 0, 100);
+    int rpm = plot->addLane("RPM", 0, 0);
+    for(int i=0; i<3; ++i)
+    {
+      plot->addSignal(gyro, &gyroRings[i], colors[i]);
+      plot->addSignal(accel, &accelRings[i], colors[i]);
+    }
+    for(int i=0; i<4; ++i)
+    {
+      plot->addSignal(throttle, &throttleRings[i], colors[i]);
+      plot->addSignal(rpm, &rpmRings[i], colors[i]);
+    }
+    plotActor = new vl::Actor( plot.get() );
+    painter->addActor( plotActor.get() );
+
+    for(int i=0; i<plot->getLaneCount(); ++i)
+      plotLegend += std::string(i ? ", " : "") + plot->getLaneName(i);
+  }
+
   void init()
   {
     TestProgram::init();
     time=vl::Time::timerSeconds();
+    simTime=0;
+    hudTime=0;
     copter.remote->init();
 
+    /* downward sonar under the battery, 15 degree cone */
+    sonar = copter.physics->rangeSensors.add( SimQuadCopter::RangeSensor::createSonar( Vector3(0,-0.05f,0), Vector3(0,-1,0), 0.26f, 6, 20 ) );
+
     pipeline()->camera()->setFOV( 70 );
     pipeline()->camera()->setFarPlane( 10000 );
 
-    /* bind Transform */
-    _Transform = new vl::Transform;
-    pipeline()->transform()->addChild( _Transform.get() );
-
-    engineXpTransform = new vl::Transform;
-    engineXmTransform = new vl::Transform;
-    engineZpTransform = new vl::Transform;
-    engineZmTransform = new vl::Transform;
-    floorTransform = new vl::Transform;
+    /* copter, floor and light, shared with renderflights */
+    scene.init( pipeline(), copter.physics->mountJoint!=NULL );
 
-    if(copter.physics->mountJoint!=NULL)
-      floorTransform->setLocalMatrix( vl::mat4d::translation( vl::vec3d(0,-50,0) ) );
-    pipeline()->transform()->addChild( floorTransform.get() );
-
-    
     camFollowTransform =new vl::Transform;
     camMountTransform = new vl::Transform;
 
     pipeline()->transform()->addChild( camFollowTransform.get() );
-    _Transform->addChild( camMountTransform.get() );
+    scene.body->addChild( camMountTransform.get() );
     camMountTransform->setLocalMatrix( vl::mat4d::translation( vl::vec3d(0,10,0) ) *vl::mat4d::rotation( 180, 0, 1, 0 ));
 
+    /* the onboard camera sees the scene without the texts */
+    if (onboardWidth > 0)
+      onboard.init( scene.painter.get(), pipeline()->transform(), camMountTransform.get(), onboardName.c_str(), onboardWidth, onboardHeight, onboardRate );
+
     if(1)
     {
       pipeline()->camera()->followTransform(camFollowTransform.get());
@@ -232,105 +375,6 @@ pos=wantedPos;
       pipeline()->camera()->followTransform(camMountTransform.get());
     }
 
-//base painter
-    /* bind Painter */
-    vl::ref<vl::Painter> painter = new vl::Painter;
-    pipeline()->shaderNode()->addChild(painter.get());
-
-    /* enable depth test and lighting */
-    painter->shader()->enable(vl::EN_DEPTH_TEST);
-    painter->shader()->enable(vl::EN_LIGHTING);
-    painter->shader()->glMaterial()->setDiffuse( vlut::white );
-    //painter->shader()->glMaterial()->setAmbient( vl::vec4(1.0f,1.0f,1.0f,1.0f) );
-    painter->shader()->glMaterial()->setAmbient( vl::vec4(0.5f,0.5f,0.5f,1.0f) );
-    /* since no Transform is associated to the Light it will follow the camera */
-    vl::ref<vl::Light> light = new vl::Light;
-    painter->shader()->addLight( light.get() );
-    light->followTransform(floorTransform.get());
-    light->setPosition(vl::vec4(0,10000,0,1));
-    light->setAmbient( vl::vec4(0.3f,0.3f,0.3f,1.0f) );
-    //propellerpainter->addActor( new vl::Actor( propeller.get(), engineXpTransform.get() ) );
-
-
-    vl::ref<vl::Geometry> geom = LoadPLY2::loadPLY("models/i4copter-frame.ply");
-    painter->addActor( new vl::Actor( geom.get(), _Transform.get() ) );
-
-//propeller
-    vl::ref<vl::Geometry> propeller = LoadPLY2::loadPLY("models/i4copter-propeller1.ply");
-    vl::ref<vl::Painter> propellerpainter = new vl::Painter;
-    painter->addChild(propellerpainter.get());
-
-    vl::ref<vl::Image> propellertex = vl::loadImage("textures/propeller.tga");
-    propellerpainter->shader()->textureUnit(0)->setTexture( new vl::Texture(propellertex.get() ) );
-
-
-    propellerpainter->addActor( new vl::Actor( propeller.get(), engineXpTransform.get() ) );
-    pipeline()->transform()->addChild( engineXpTransform.get() );
-    propellerpainter->addActor( new vl::Actor( propeller.get(), engineXmTransform.get() ) );
-    pipeline()->transform()->addChild( engineXmTransform.get() );
-    propellerpainter->addActor( new vl::Actor( propeller.get(), engineZpTransform.get() ) );
-    pipeline()->transform()->addChild( engineZpTransform.get() );
-    propellerpainter->addActor( new vl::Actor( propeller.get(), engineZmTransform.get() ) );
-    pipeline()->transform()->addChild( engineZmTransform.get() );
- 
-
-//boards
-    vl::ref<vl::Painter> boardpainter = new vl::Painter;
-    painter->addChild(boardpainter.get());
-
-    vl::ref<vl::Geometry> boards = LoadPLY2::loadPLY("models/i4copter-boards.ply");
-    boards->transform( vl::mat4d::translation( vl::vec3d(0,3.5,0) ) );
-    boardpainter->addActor( new vl::Actor( boards.get(), _Transform.get() ) );
-    vl::ref<vl::Image> boardtex = vl::loadImage("textures/boards.tga");
-    boardpainter->shader()->textureUnit(0)->setTexture( new vl::Texture(boardtex.get() ) );
-
-//battery
-    vl::ref<vl::Painter> batterypainter = new vl::Painter;
-    painter->addChild(batterypainter.get());
-
-    vl::ref<vl::Geometry> battery = LoadPLY2::loadPLY("models/i4copter-battery.ply");
-    battery->transform( vl::mat4d::translation( vl::vec3d(0,-3,0) ) );
-    batterypainter->addActor( new vl::Actor( battery.get(), _Transform.get() ) );
-    vl::ref<vl::Image> kokam = vl::loadImage("textures/kokam.tga");
-    batterypainter->shader()->textureUnit(0)->setTexture( new vl::Texture(kokam.get() ) );
-
-//floor
-    vl::ref<vl::Painter> floorpainter = new vl::Painter;
-    painter->addChild(floorpainter.get());
-
-
-    vl::ref<vl::Geometry> floor = LoadPLY2::loadPLY("models/floor.ply");
-    floorpainter->addActor( new vl::Actor( floor.get(), floorTransform.get() ) );
-    vl::ref<vl::Image> img1 = vl::loadImage("textures/floor2.tga");
-    floorpainter->shader()->textureUnit(0)->setTexture( new vl::Texture(img1.get() ) );
-
-
-
-
-
-    if (GLEW_ARB_shading_language_100)
-    {
-      vl::ref<vl::GLSLVertexShader> vert_perpixel = new vl::GLSLVertexShader("file://shaders.glsl","vert_perpixellight");
-      vl::ref<vl::GLSLFragmentShader> frag_perpixel = new vl::GLSLFragmentShader("file://shaders.glsl","frag_perpixellight");
-      
-      vl::ref<vl::GLSLVertexShader> vert_perpixel_texture = new vl::GLSLVertexShader("file://shaders.glsl","vert_perpixellight_texture");
-      vl::ref<vl::GLSLFragmentShader> frag_perpixel_texture = new vl::GLSLFragmentShader("file://shaders.glsl","frag_perpixellight_texture");
-
-      vl::ref<vl::GLSLProgram> glsl = painter->shader()->glslProgram();
-      glsl->attachShader( vert_perpixel.get() );
-      glsl->attachShader( frag_perpixel.get() );
-
-      vl::ref<vl::GLSLProgram> glsl2 = floorpainter->shader()->glslProgram();
-      glsl2->attachShader( vert_perpixel_texture.get() );
-      glsl2->attachShader( frag_perpixel_texture.get() );
-
-      propellerpainter->shader()->setGLSLProgram(glsl2.get());
-      batterypainter->shader()->setGLSLProgram(glsl2.get());
-      boardpainter->shader()->setGLSLProgram(glsl2.get());
-    }
-    else
-      vl::Log::error("GLEW_ARB_shading_language_100 not supported.\n");
-
 //text
 
     vl::ref<vl::Painter> name_painter = new vl::Painter;
@@ -349,7 +393,7 @@ pos=wantedPos;
     font = new vl::Font("fonts/bitstream-vera.ttf", 8);
 
     text = new vl::Text;
-    name_painter->addActor( new vl::Actor( text.get(), engineXpTransform.get() ) );
+    name_painter->addActor( new vl::Actor( text.get(), scene.propellerTransforms[SimQuadCopter::CopterDynamics::EngineXp].get() ) );
     text->setFont(font.get());
     text->setMode( vl::Text2D );
     text->setText( L"X+" );
@@ -357,7 +401,7 @@ pos=wantedPos;
     text->setAlignment(vl::AlignBottom | vl::AlignLeft );
 
     text = new vl::Text;
-    name_painter->addActor( new vl::Actor( text.get(), engineZpTransform.get() ) );
+    name_painter->addActor( new vl::Actor( text.get(), scene.propellerTransforms[SimQuadCopter::CopterDynamics::EngineZp].get() ) );
     text->setFont(font.get());
     text->setMode( vl::Text2D );
     text->setText( L"Z+" );
@@ -371,26 +415,79 @@ pos=wantedPos;
     //info->setText( L"blablabla" );
     info->setColor(vlut::red);
     info->setAlignment(vl::AlignTop | vl::AlignLeft );
+
+    /* signal plots at the bottom, drawn over the scene like the texts */
+    initPlots( name_painter.get() );
   }
 
 protected:
-  vl::ref<vl::Transform> _Transform;
-  vl::ref<vl::Transform> engineXpTransform;
-  vl::ref<vl::Transform> engineXmTransform;
-  vl::ref<vl::Transform> engineZpTransform;
-  vl::ref<vl::Transform> engineZmTransform;
-  vl::ref<vl::Transform> floorTransform;
+  SimQuadCopter::CopterScene scene;
   vl::ref<vl::Transform> camFollowTransform;
   vl::ref<vl::Transform> camMountTransform;
   double time;
+  double simTime;
+  double hudTime;
   vl::ref<vl::Text> info;
+  SimQuadCopter::OnboardCamera onboard;
+  SimQuadCopter::RangeSensor* sonar;
+  SimQuadCopter::SignalRing gyroRings[3];
+  SimQuadCopter::SignalRing accelRings[3];
+  SimQuadCopter::SignalRing throttleRings[4];
+  SimQuadCopter::SignalRing rpmRings[4];
+  vl::ref<SimQuadCopter::SignalPlot> plot;
+  vl::ref<vl::Actor> plotActor;
+  std::string plotLegend;
+
+public:
+  /* onboard camera, off if the width is 0 */
+  int onboardWidth;
+  int onboardHeight;
+  float onboardRate;
+  std::string onboardName;
+  /* Chrome trace written on exit and with F8, off if empty */
+  std::string traceName;
 };
 
+static void usage(const char *name)
+{
+  printf("usage: %s [-c WxH] [-r rate] [-n name] [-t trace]\n", name);
+  printf("  -c  render the onboard camera at this size into a shared memory frame ring\n");
+  printf("  -r  onboard camera frames per second of simulation time (default: 30)\n");
+  printf("  -n  shm_open() name of the frame ring (default: /simquadcopter-camera)\n");
+  printf("  -t  record a timeline of the simulation and the rendering, written to this Chrome trace (JSON) on exit and with F8\n");
+}
+
 int main ( int argc, char *argv[] )
 {
   int pargc = argc;
   glutInit( &pargc, argv );
 
+  CopterViewer_Program* program = new CopterViewer_Program();
+  int c;
+  while((c = getopt(pargc, argv, "c:r:n:t:h")) != -1)
+  {
+    switch(c)
+    {
+    case 'c':
+      if (sscanf(optarg, "%dx%d", &program->onboardWidth, &program->onboardHeight) != 2)
+      {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'r': program->onboardRate = (float)atof(optarg); break;
+    case 'n': program->onboardName = optarg; break;
+    case 't': program->traceName = optarg; break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+
+  /* the simulation and the rendering both run on this thread */
+  vl::Trace::setThreadName("viewer");
+  vl::Trace::setEnabled( !program->traceName.empty() );
 
   vl::visualization_library_init();
   atexit( vlGLUT::atexit_visualization_library_shutdown );
@@ -403,7 +500,7 @@ int main ( int argc, char *argv[] )
 
   vl::ref<vl::Object> owner;
 
-  owner=vlGLUT::open_GLUT_Window("simquadcopter", new CopterViewer_Program(), info, 10,10, 800, 600, vlut::white, vl::vec3d(0,500,100), vl::vec3d(0,0,0));
+  owner=vlGLUT::open_GLUT_Window("simquadcopter", program, info, 10,10, 800, 600, vlut::white, vl::vec3d(0,500,100), vl::vec3d(0,0,0));
 
   glutMainLoop();
 
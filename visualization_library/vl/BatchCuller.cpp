@@ -0,0 +1,196 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vl/BatchCuller.hpp"
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+// The plane tests have SSE and AVX versions chosen at compile time from the target flags,
+// defining VL_NO_SIMD forces the scalar code.
+#if !defined(VL_NO_SIMD)
+  #if defined(__AVX__)
+    #define VL_CULL_AVX
+    #include <immintrin.h>
+  #elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define VL_CULL_SSE
+    #include <xmmintrin.h>
+  #endif
+#endif
+
+using namespace vl;
+
+namespace
+{
+  struct CullPlane
+  {
+    // coordinates of the box corner nearest to the inside of the plane
+    const float* mX;
+    const float* mY;
+    const float* mZ;
+    float mNX, mNY, mNZ;
+    float mOrigin;
+  };
+
+  // the nearest float not above d and the nearest not below it
+  inline float floatDown(double d) { float f = (float)d; return f > d ? nextafterf(f, -FLT_MAX) : f; }
+  inline float floatUp(double d)   { float f = (float)d; return f < d ? nextafterf(f,  FLT_MAX) : f; }
+}
+
+void BatchCuller::resize(int count)
+{
+  mCount = count;
+  int padded = (count + 7) & ~7;
+  mMinX.assign(padded, -FLT_MAX); mMinY.assign(padded, -FLT_MAX); mMinZ.assign(padded, -FLT_MAX);
+  mMaxX.assign(padded,  FLT_MAX); mMaxY.assign(padded,  FLT_MAX); mMaxZ.assign(padded,  FLT_MAX);
+  mVisible.assign((padded + 31) / 32, 0);
+}
+
+void BatchCuller::setBounds(int i, double minx, double miny, double minz, double maxx, double maxy, double maxz)
+{
+  CHECK(i >= 0 && i < mCount)
+  mMinX[i] = floatDown(minx); mMinY[i] = floatDown(miny); mMinZ[i] = floatDown(minz);
+  mMaxX[i] = floatUp(maxx);   mMaxY[i] = floatUp(maxy);   mMaxZ[i] = floatUp(maxz);
+}
+
+void BatchCuller::setAABB(int i, const AABB& aabb)
+{
+  if (aabb.isEmpty())
+  {
+    // the nearest corner is at minus infinity for every plane
+    mMinX[i] = mMinY[i] = mMinZ[i] = -FLT_MAX;
+    mMaxX[i] = mMaxY[i] = mMaxZ[i] =  FLT_MAX;
+    return;
+  }
+  const vec3d& min = aabb.minCorner();
+  const vec3d& max = aabb.maxCorner();
+  setBounds(i, min.x(), min.y(), min.z(), max.x(), max.y(), max.z());
+}
+
+void BatchCuller::setAABB(int i, const AABB& aabb, const mat4d& m)
+{
+  if (aabb.isEmpty())
+  {
+    setAABB(i, aabb);
+    return;
+  }
+  // the bounds of a transformed box are the transformed center plus the extent
+  // projected on each axis, which is cheaper than transforming the eight corners
+  vec3d c = m * aabb.center();
+  vec3d e = (aabb.maxCorner() - aabb.minCorner()) * 0.5;
+  double ex = fabs(m.e(0,0))*e.x() + fabs(m.e(1,0))*e.y() + fabs(m.e(2,0))*e.z();
+  double ey = fabs(m.e(0,1))*e.x() + fabs(m.e(1,1))*e.y() + fabs(m.e(2,1))*e.z();
+  double ez = fabs(m.e(0,2))*e.x() + fabs(m.e(1,2))*e.y() + fabs(m.e(2,2))*e.z();
+  setBounds(i, c.x()-ex, c.y()-ey, c.z()-ez, c.x()+ex, c.y()+ey, c.z()+ez);
+}
+
+int BatchCuller::cull(const Frustum& frustum, int begin, int end)
+{
+  CHECK( (begin & 31) == 0 && begin >= 0 && end <= mCount )
+  if (begin >= end)
+    return 0;
+  int padded = std::min( (end + 7) & ~7, (int)mMinX.size() );
+
+  // largest coordinate magnitude of the non empty boxes, bounds the rounding error
+  float max_coord = 0;
+  for(int i=begin; i<end; i++)
+  {
+    if (mMinX[i] == -FLT_MAX && mMaxX[i] == FLT_MAX)
+      continue;
+    float coord = std::max( std::max( std::max(fabs(mMinX[i]), fabs(mMaxX[i])), std::max(fabs(mMinY[i]), fabs(mMaxY[i])) ), std::max(fabs(mMinZ[i]), fabs(mMaxZ[i])) );
+    max_coord = std::max(max_coord, coord);
+  }
+
+  CullPlane planes[6];
+  for(int p=0; p<6; p++)
+  {
+    const vec3d& n = frustum.plane(p).normal();
+    planes[p].mX = n.x() >= 0 ? &mMinX[0] : &mMaxX[0];
+    planes[p].mY = n.y() >= 0 ? &mMinY[0] : &mMaxY[0];
+    planes[p].mZ = n.z() >= 0 ? &mMinZ[0] : &mMaxZ[0];
+    planes[p].mNX = (float)n.x();
+    planes[p].mNY = (float)n.y();
+    planes[p].mNZ = (float)n.z();
+    // a box is outside if its nearest corner is in front of the plane, the margin covers the
+    // rounding of the coordinates and of the dot product in single precision
+    double origin = frustum.plane(p).origin();
+    double margin = 8 * FLT_EPSILON * ( (fabs(n.x()) + fabs(n.y()) + fabs(n.z())) * max_coord + fabs(origin) );
+    planes[p].mOrigin = (float)(origin + margin);
+  }
+
+  std::fill(mVisible.begin() + (begin >> 5), mVisible.begin() + ((padded + 31) >> 5), 0);
+  for(int i=begin; i<padded; i+=8)
+  {
+    unsigned int outside = 0;
+#if defined(VL_CULL_AVX)
+    __m256 out = _mm256_setzero_ps();
+    for(int p=0; p<6; p++)
+    {
+      const CullPlane& pl = planes[p];
+      __m256 d = _mm256_add_ps( _mm256_add_ps(
+                   _mm256_mul_ps( _mm256_set1_ps(pl.mNX), _mm256_loadu_ps(pl.mX + i) ),
+                   _mm256_mul_ps( _mm256_set1_ps(pl.mNY), _mm256_loadu_ps(pl.mY + i) ) ),
+                   _mm256_mul_ps( _mm256_set1_ps(pl.mNZ), _mm256_loadu_ps(pl.mZ + i) ) );
+      out = _mm256_or_ps( out, _mm256_cmp_ps(d, _mm256_set1_ps(pl.mOrigin), _CMP_GT_OQ) );
+    }
+    outside = _mm256_movemask_ps(out);
+#elif defined(VL_CULL_SSE)
+    for(int h=0; h<8; h+=4)
+    {
+      __m128 out = _mm_setzero_ps();
+      for(int p=0; p<6; p++)
+      {
+        const CullPlane& pl = planes[p];
+        __m128 d = _mm_add_ps( _mm_add_ps(
+                     _mm_mul_ps( _mm_set1_ps(pl.mNX), _mm_loadu_ps(pl.mX + i + h) ),
+                     _mm_mul_ps( _mm_set1_ps(pl.mNY), _mm_loadu_ps(pl.mY + i + h) ) ),
+                     _mm_mul_ps( _mm_set1_ps(pl.mNZ), _mm_loadu_ps(pl.mZ + i + h) ) );
+        out = _mm_or_ps( out, _mm_cmpgt_ps(d, _mm_set1_ps(pl.mOrigin)) );
+      }
+      outside |= _mm_movemask_ps(out) << h;
+    }
+#else
+    for(int j=0; j<8; j++)
+    {
+      for(int p=0; p<6; p++)
+      {
+        const CullPlane& pl = planes[p];
+        if ( pl.mNX*pl.mX[i+j] + pl.mNY*pl.mY[i+j] + pl.mNZ*pl.mZ[i+j] > pl.mOrigin )
+        {
+          outside |= 1 << j;
+          break;
+        }
+      }
+    }
+#endif
+    mVisible[i >> 5] |= (~outside & 0xFF) << (i & 31);
+  }
+
+  // clears the bits past the end of the range
+  if (end & 31)
+    mVisible[end >> 5] &= (1u << (end & 31)) - 1;
+
+  int visible = 0;
+  for(int w=begin >> 5; w<(end + 31) >> 5; w++)
+  {
+    for(unsigned int bits = mVisible[w]; bits; bits &= bits - 1)
+      ++visible;
+  }
+  return visible;
+}
@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BatchCuller_INCLUDE_DEFINE
+#define BatchCuller_INCLUDE_DEFINE
+
+#include "vl/AABB.hpp"
+#include "vl/Camera.hpp"
+#include <vector>
+
+namespace vl
+{
+
+  //! Frustum culling of many bounding boxes at once.
+  //! The world space boxes are stored as separate float arrays of min and max coordinates
+  //! and cull() tests 4 (SSE) or 8 (AVX) of them against each plane of the frustum, writing
+  //! one visibility bit per box. The boxes are rounded outwards and the planes moved out by
+  //! the float rounding error, so a box is never culled when Camera::frustumCull() keeps it.
+  //! Disjoint ranges of boxes starting at multiples of 32 can be set and culled by different threads.
+  class BatchCuller: public Object
+  {
+  public:
+    BatchCuller(): mCount(0) {}
+
+    //! Discards the boxes and reserves space for count of them.
+    void resize(int count);
+
+    int count() const { return mCount; }
+
+    //! Sets a world space box. Empty boxes are never culled.
+    void setAABB(int i, const AABB& aabb);
+
+    //! Sets the box of local bounds transformed by matrix, as AABB::transformed() would.
+    void setAABB(int i, const AABB& aabb, const mat4d& matrix);
+
+    //! Computes the visibility bits of all the boxes, returns the number of visible ones.
+    int cull(const Frustum& frustum) { return cull(frustum, 0, mCount); }
+
+    //! Computes the visibility bits of the boxes in [begin, end), begin must be a multiple of 32.
+    //! Returns the number of visible boxes in the range.
+    int cull(const Frustum& frustum, int begin, int end);
+
+    bool isVisible(int i) const { return ((mVisible[i >> 5] >> (i & 31)) & 1) != 0; }
+
+    //! Visibility bits, box i is bit i%32 of word i/32.
+    const std::vector<unsigned int>& visibilityMask() const { return mVisible; }
+
+  protected:
+    void setBounds(int i, double minx, double miny, double minz, double maxx, double maxy, double maxz);
+
+  protected:
+    // padded to a multiple of 8 boxes
+    std::vector<float> mMinX, mMinY, mMinZ;
+    std::vector<float> mMaxX, mMaxY, mMaxZ;
+    std::vector<unsigned int> mVisible;
+    int mCount;
+  };
+
+}
+
+#endif
@@ -0,0 +1,425 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "vl/CameraVideoCapture.hpp"
+#include "vl/OpenGL.hpp"
+#include "vl/Log.hpp"
+#include "vl/Say.hpp"
+#include "vl/Trace.hpp"
+#include "vl/Time.hpp"
+#include <cstring>
+#include <algorithm>
+
+using namespace vl;
+
+CameraVideoCapture::CameraVideoCapture()
+{
+  mFormat = CaptureY4M;
+  mX = 0;
+  mY = 0;
+  mWidth = 0;
+  mHeight = 0;
+  mReadBuffer = RDB_BACK_LEFT;
+  mFrameRate = 30;
+  mRealTime = false;
+  mStartTime = 0;
+  mVideoFrameCount = 0;
+  mRingSize = 3;
+  mMaxQueuedFrames = 8;
+  mFrameCount = 0;
+  mStallCount = 0;
+  mCapturing = false;
+  mWriterDone = false;
+  mWriteError = false;
+  mFramesWritten = 0;
+  mWriterStarted = false;
+  mFile = NULL;
+#ifndef WIN32
+  pthread_mutex_init(&mMutex, NULL);
+  pthread_cond_init(&mFrameQueued, NULL);
+  pthread_cond_init(&mFrameFreed, NULL);
+#endif
+}
+
+CameraVideoCapture::~CameraVideoCapture()
+{
+  finishWriter();
+  for(int i=0; i<(int)mFrames.size(); ++i)
+    delete mFrames[i];
+#ifndef WIN32
+  pthread_cond_destroy(&mFrameFreed);
+  pthread_cond_destroy(&mFrameQueued);
+  pthread_mutex_destroy(&mMutex);
+#endif
+}
+
+bool CameraVideoCapture::start(const std::string& path, ECaptureFormat format, int x, int y, int width, int height, EReadDrawBuffer read_buffer)
+{
+  if (mCapturing)
+    stop();
+
+  if (format == CaptureY4M)
+  {
+    width  &= ~1;
+    height &= ~1;
+  }
+  if (width <= 0 || height <= 0)
+  {
+    Log::error( Say("CameraVideoCapture: invalid frame size %nx%n\n") << width << height );
+    return false;
+  }
+
+  mPath = path;
+  mFormat = format;
+  mX = x;
+  mY = y;
+  mWidth = width;
+  mHeight = height;
+  mReadBuffer = read_buffer;
+
+  if (mFormat == CaptureY4M)
+  {
+    mFile = fopen(mPath.c_str(), "wb");
+    if (!mFile)
+    {
+      Log::error( Say("CameraVideoCapture: could not open '%s'\n") << mPath );
+      return false;
+    }
+    fprintf(mFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", mWidth, mHeight, mFrameRate);
+  }
+
+  // the frames of a previous recording can have another size
+  for(int i=0; i<(int)mFrames.size(); ++i)
+    delete mFrames[i];
+  mFrames.clear();
+  mFreeFrames.clear();
+  mQueue.clear();
+
+  mFrameCount = 0;
+  mVideoFrameCount = 0;
+  mStartTime = Time::timerSeconds();
+  mStallCount = 0;
+  mFramesWritten = 0;
+  mWriteError = false;
+  mWriterDone = false;
+
+  if (GLEW_ARB_pixel_buffer_object && mRingSize > 1)
+  {
+    mPBO.resize(mRingSize);
+    mRepeat.assign(mRingSize, 1);
+    glGenBuffers(mRingSize, &mPBO[0]); GLCHECK4()
+    for(int i=0; i<mRingSize; ++i)
+    {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, mPBO[i]); GLCHECK4()
+      glBufferData(GL_PIXEL_PACK_BUFFER_ARB, mWidth*mHeight*4, NULL, GL_STREAM_READ); GLCHECK4()
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0); GLCHECK4()
+  }
+
+#ifndef WIN32
+  mWriterStarted = pthread_create(&mThread, NULL, &CameraVideoCapture::threadMain, this) == 0;
+  if (!mWriterStarted)
+  {
+    Log::error("CameraVideoCapture: could not start the writer thread\n");
+    if (!mPBO.empty())
+      glDeleteBuffers((int)mPBO.size(), &mPBO[0]);
+    mPBO.clear();
+    finishWriter();
+    return false;
+  }
+#endif
+
+  mCapturing = true;
+  return true;
+}
+
+void CameraVideoCapture::stop()
+{
+  if (!mCapturing)
+    return;
+  mCapturing = false;
+
+  // the frames still in the ring, oldest first
+  if (!mPBO.empty())
+  {
+    int ring = (int)mPBO.size();
+    for(int i=std::max(0, mFrameCount - ring); i<mFrameCount; ++i)
+      mapFrame(i % ring);
+    glDeleteBuffers(ring, &mPBO[0]); GLCHECK4()
+    mPBO.clear();
+  }
+
+  finishWriter();
+
+  if (mWriteError)
+    Log::error( Say("CameraVideoCapture: error writing '%s', the recording is incomplete\n") << mPath );
+}
+
+void CameraVideoCapture::renderFinished(const Camera*)
+{
+  if (!mCapturing)
+    return;
+
+#ifndef WIN32
+  pthread_mutex_lock(&mMutex);
+#endif
+  bool write_error = mWriteError;
+#ifndef WIN32
+  pthread_mutex_unlock(&mMutex);
+#endif
+  if (write_error)
+  {
+    stop();
+    return;
+  }
+
+  // with realTime() this frame stands for the frame times up to now not shown yet
+  int repeat = 1;
+  if (mRealTime)
+  {
+    int due = (int)( (Time::timerSeconds() - mStartTime) * mFrameRate ) + 1;
+    repeat = due - mVideoFrameCount;
+    if (repeat <= 0)
+      return;
+  }
+  mVideoFrameCount += repeat;
+
+  if (mPBO.empty())
+  {
+    Frame* frame = freeFrame();
+    readFrame(frame);
+    queueFrame(frame, repeat);
+  }
+  else
+  {
+    // the buffer of this frame still holds the one read ringSize() frames ago
+    int slot = mFrameCount % (int)mPBO.size();
+    if (mFrameCount >= (int)mPBO.size())
+      mapFrame(slot);
+    mRepeat[slot] = repeat;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, mPBO[slot]); GLCHECK4()
+    readFrame(NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0); GLCHECK4()
+  }
+  ++mFrameCount;
+}
+
+void CameraVideoCapture::readFrame(Frame* frame)
+{
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+
+  glPixelStorei( GL_PACK_ALIGNMENT,   4 ); GLCHECK4()
+  glPixelStorei( GL_PACK_ROW_LENGTH,  0 ); GLCHECK4()
+  glPixelStorei( GL_PACK_SKIP_PIXELS, 0 ); GLCHECK4()
+  glPixelStorei( GL_PACK_SKIP_ROWS,   0 ); GLCHECK4()
+  glPixelStorei( GL_PACK_SWAP_BYTES,  0 ); GLCHECK4()
+  glPixelStorei( GL_PACK_LSB_FIRST,   0 ); GLCHECK4()
+
+  GLint prev = 0;
+  glGetIntegerv( GL_READ_BUFFER, &prev );
+  glReadBuffer( mReadBuffer ); GLCHECK4()
+  // BGRA is the layout of the frame buffer on most drivers, the read doesn't need a conversion
+  glReadPixels( mX, mY, mWidth, mHeight, GL_BGRA, GL_UNSIGNED_BYTE, frame ? &(*frame)[0] : NULL ); GLCHECK4()
+  glReadBuffer( prev ); GLCHECK4()
+
+  glPopClientAttrib();
+}
+
+void CameraVideoCapture::mapFrame(int slot)
+{
+  glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, mPBO[slot]); GLCHECK4()
+  const void* pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY); GLCHECK4()
+  if (pixels)
+  {
+    Frame* frame = freeFrame();
+    memcpy(&(*frame)[0], pixels, frame->size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB); GLCHECK4()
+    queueFrame(frame, mRepeat[slot]);
+  }
+  else
+    Log::error("CameraVideoCapture: could not map a pixel buffer, a frame is lost\n");
+  glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0); GLCHECK4()
+}
+
+CameraVideoCapture::Frame* CameraVideoCapture::freeFrame()
+{
+#ifndef WIN32
+  pthread_mutex_lock(&mMutex);
+  if ( mFreeFrames.empty() && (int)mFrames.size() >= mMaxQueuedFrames )
+  {
+    ++mStallCount;
+    while( mFreeFrames.empty() )
+      pthread_cond_wait(&mFrameFreed, &mMutex);
+  }
+#endif
+
+  Frame* frame = NULL;
+  if (!mFreeFrames.empty())
+  {
+    frame = mFreeFrames.back();
+    mFreeFrames.pop_back();
+  }
+  else
+  {
+    frame = new Frame(mWidth*mHeight*4);
+    mFrames.push_back(frame);
+  }
+
+#ifndef WIN32
+  pthread_mutex_unlock(&mMutex);
+#endif
+  return frame;
+}
+
+void CameraVideoCapture::queueFrame(Frame* frame, int repeat)
+{
+#ifndef WIN32
+  pthread_mutex_lock(&mMutex);
+  mQueue.push_back( std::make_pair(frame, repeat) );
+  pthread_cond_signal(&mFrameQueued);
+  pthread_mutex_unlock(&mMutex);
+#else
+  for(int i=0; i<repeat && !mWriteError; ++i)
+    if ( !writeFrame(*frame) )
+      mWriteError = true;
+  mFreeFrames.push_back(frame);
+#endif
+}
+
+void CameraVideoCapture::finishWriter()
+{
+#ifndef WIN32
+  if (mWriterStarted)
+  {
+    pthread_mutex_lock(&mMutex);
+    mWriterDone = true;
+    pthread_cond_signal(&mFrameQueued);
+    pthread_mutex_unlock(&mMutex);
+    pthread_join(mThread, NULL);
+    mWriterStarted = false;
+  }
+#endif
+  if (mFile)
+  {
+    if ( fclose(mFile) != 0 )
+      mWriteError = true;
+    mFile = NULL;
+  }
+}
+
+void* CameraVideoCapture::threadMain(void* capture)
+{
+  ((CameraVideoCapture*)capture)->writerLoop();
+  return NULL;
+}
+
+void CameraVideoCapture::writerLoop()
+{
+#ifndef WIN32
+  Trace::setThreadName("CameraVideoCapture writer");
+  pthread_mutex_lock(&mMutex);
+  for(;;)
+  {
+    while( mQueue.empty() && !mWriterDone )
+      pthread_cond_wait(&mFrameQueued, &mMutex);
+    if ( mQueue.empty() )
+      break;
+
+    Frame* frame = mQueue.front().first;
+    int repeat = mQueue.front().second;
+    mQueue.pop_front();
+    bool write = !mWriteError;
+    pthread_mutex_unlock(&mMutex);
+
+    // after an error the frames are only given back
+    bool ok = true;
+    for(int i=0; write && ok && i<repeat; ++i)
+      ok = writeFrame(*frame);
+
+    pthread_mutex_lock(&mMutex);
+    if (!ok)
+      mWriteError = true;
+    mFreeFrames.push_back(frame);
+    pthread_cond_signal(&mFrameFreed);
+  }
+  pthread_mutex_unlock(&mMutex);
+#endif
+}
+
+bool CameraVideoCapture::writeFrame(const Frame& frame)
+{
+  // called by the writer thread, must not use the logger or any shared object
+  TraceZone zone("CameraVideoCapture::writeFrame", "io");
+  int w = mWidth;
+  int h = mHeight;
+  int frame_number = mFramesWritten++;
+
+  if (mFormat == CaptureY4M)
+  {
+    // full range BT.601, the rows are flipped since OpenGL reads them bottom up
+    mRow.resize(w*h + 2*(w/2)*(h/2));
+    unsigned char* py = &mRow[0];
+    unsigned char* pu = py + w*h;
+    unsigned char* pv = pu + (w/2)*(h/2);
+    for(int y=0; y<h; ++y)
+    {
+      const unsigned char* src = &frame[(h-1-y)*w*4];
+      for(int x=0; x<w; ++x, src+=4)
+        *py++ = (unsigned char)( (29*src[0] + 150*src[1] + 77*src[2] + 128) >> 8 );
+    }
+    for(int y=0; y<h; y+=2)
+    {
+      const unsigned char* src0 = &frame[(h-1-y)*w*4];
+      const unsigned char* src1 = src0 - w*4;
+      for(int x=0; x<w; x+=2, src0+=8, src1+=8)
+      {
+        int b = src0[0] + src0[4] + src1[0] + src1[4];
+        int g = src0[1] + src0[5] + src1[1] + src1[5];
+        int r = src0[2] + src0[6] + src1[2] + src1[6];
+        // the sums are 4 times the average, the offsets keep the values positive
+        *pu++ = (unsigned char)std::min( 255, (128*b - 85*g - 43*r + 4*32896) >> 10 );
+        *pv++ = (unsigned char)std::min( 255, (128*r - 107*g - 21*b + 4*32896) >> 10 );
+      }
+    }
+    return fputs("FRAME\n", mFile) >= 0 && fwrite(&mRow[0], 1, mRow.size(), mFile) == mRow.size();
+  }
+  else
+  {
+    char file_name[1024];
+    snprintf(file_name, sizeof(file_name), "%s%04d.ppm", mPath.c_str(), frame_number);
+    FILE* fout = fopen(file_name, "wb");
+    if (!fout)
+      return false;
+    mRow.resize(w*3);
+    bool ok = fprintf(fout, "P6\n%d %d\n255\n", w, h) > 0;
+    for(int y=0; ok && y<h; ++y)
+    {
+      const unsigned char* src = &frame[(h-1-y)*w*4];
+      for(int x=0; x<w; ++x, src+=4)
+      {
+        mRow[x*3+0] = src[2];
+        mRow[x*3+1] = src[1];
+        mRow[x*3+2] = src[0];
+      }
+      ok = fwrite(&mRow[0], 1, mRow.size(), fout) == mRow.size();
+    }
+    return fclose(fout) == 0 && ok;
+  }
+}
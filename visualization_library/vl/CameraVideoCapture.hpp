@@ -0,0 +1,152 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CameraVideoCapture_INCLUDE_DEFINE
+#define CameraVideoCapture_INCLUDE_DEFINE
+
+#include "vl/Camera.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#ifndef WIN32
+  #include <pthread.h>
+#endif
+
+namespace vl
+{
+  typedef enum
+  {
+    //! A single uncompressed YUV4MPEG2 4:2:0 stream, the frame size is rounded down to even numbers.
+    CaptureY4M,
+    //! One binary PPM file per frame.
+    CapturePPMSequence
+  } ECaptureFormat;
+
+  //! Records every frame rendered by a camera without stalling the rendering.
+  //! Each frame is read into the next one of a ring of pixel buffer objects and mapped
+  //! only when the ring comes back to it, when the GPU has long finished the transfer.
+  //! The mapped pixels are copied into a frame queue emptied by a writer thread, which
+  //! converts and writes them. The rendering waits only if the writer falls more than
+  //! maxQueuedFrames() behind, so no frame is ever dropped.
+  //! By default every rendered frame becomes a frame of the video. With setRealTime() the
+  //! video follows Time::timerSeconds() at frameRate() instead: a rendered frame is repeated
+  //! or skipped to fill the frame times elapsed since the previous one.
+  //! Without pixel buffer objects the frames are read with a plain glReadPixels(), on
+  //! Windows they are written on the rendering thread.
+  class CameraVideoCapture: public RenderFinishedCallback
+  {
+  public:
+    CameraVideoCapture();
+    //! Waits for the queued frames to be written, the frames still in the ring are lost, see stop().
+    virtual ~CameraVideoCapture();
+
+    //! Starts recording the given area of the read buffer.
+    //! For CaptureY4M path is the file, for CapturePPMSequence it is the start of the file
+    //! names, followed by the frame number: "frame-" gives frame-0000.ppm, frame-0001.ppm...
+    bool start(const std::string& path, ECaptureFormat format, int x, int y, int width, int height, EReadDrawBuffer read_buffer = RDB_BACK_LEFT);
+
+    //! Reads the frames still in the ring, waits for the writer and closes the stream.
+    //! Must be called with the OpenGL context of the camera current.
+    void stop();
+
+    bool isCapturing() const { return mCapturing; }
+
+    virtual void renderFinished(const Camera*);
+
+    //! Frame rate written in the Y4M header.
+    void setFrameRate(int fps) { mFrameRate = fps; }
+    int frameRate() const { return mFrameRate; }
+
+    //! Whether the frames are repeated or skipped so that the video plays at the speed it was rendered.
+    //! Use it when the rendering runs at whatever rate it can rather than once every 1/frameRate() seconds.
+    void setRealTime(bool real_time) { mRealTime = real_time; }
+    bool realTime() const { return mRealTime; }
+
+    //! Number of pixel buffer objects, the frames are mapped ringSize()-1 frames after they are read.
+    void setRingSize(int size) { mRingSize = size; }
+    int ringSize() const { return mRingSize; }
+
+    void setMaxQueuedFrames(int count) { mMaxQueuedFrames = count; }
+    int maxQueuedFrames() const { return mMaxQueuedFrames; }
+
+    //! Frames read so far in the current or last recording.
+    int frameCount() const { return mFrameCount; }
+    //! Frames of the video so far, more or less than frameCount() with realTime().
+    int videoFrameCount() const { return mVideoFrameCount; }
+    //! Frames for which the rendering had to wait the writer.
+    int stallCount() const { return mStallCount; }
+
+  protected:
+    typedef std::vector<unsigned char> Frame;
+
+    void readFrame(Frame* frame);
+    void mapFrame(int slot);
+    Frame* freeFrame();
+    void queueFrame(Frame* frame, int repeat);
+    void finishWriter();
+    bool writeFrame(const Frame& frame);
+
+    static void* threadMain(void* capture);
+    void writerLoop();
+
+  protected:
+    std::string mPath;
+    ECaptureFormat mFormat;
+    int mX;
+    int mY;
+    int mWidth;
+    int mHeight;
+    EReadDrawBuffer mReadBuffer;
+    int mFrameRate;
+    bool mRealTime;
+    int mRingSize;
+    int mMaxQueuedFrames;
+
+    std::vector<GLuint> mPBO;
+    // how many times the video shows the frame read into each buffer
+    std::vector<int> mRepeat;
+    double mStartTime;
+    int mVideoFrameCount;
+    int mFrameCount;
+    int mStallCount;
+    bool mCapturing;
+
+    // shared with the writer thread
+    std::vector<Frame*> mFrames;
+    std::vector<Frame*> mFreeFrames;
+    // the frames to write and how many times
+    std::deque< std::pair<Frame*,int> > mQueue;
+    bool mWriterDone;
+    bool mWriteError;
+    int mFramesWritten;
+    bool mWriterStarted;
+    FILE* mFile;
+    std::vector<unsigned char> mRow;
+#ifndef WIN32
+    pthread_t mThread;
+    pthread_mutex_t mMutex;
+    pthread_cond_t mFrameQueued;
+    pthread_cond_t mFrameFreed;
+#endif
+  };
+}
+
+#endif
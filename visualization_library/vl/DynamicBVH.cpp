@@ -0,0 +1,344 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vl/DynamicBVH.hpp"
+#include "vl/Transform.hpp"
+#include <algorithm>
+
+using namespace vl;
+
+namespace
+{
+  const int SAHBins = 16;
+
+  // the refit merges and measures a few boxes per moving actor every frame: these skip the
+  // temporaries and the out of line calls of the AABB operators
+
+  inline bool empty(const AABB& aabb)
+  {
+    const vec3d& min = aabb.minCorner();
+    const vec3d& max = aabb.maxCorner();
+    return min.x() > max.x() || min.y() > max.y() || min.z() > max.z();
+  }
+
+  inline void merge(AABB& aabb, const AABB& other)
+  {
+    if ( empty(other) )
+      return;
+    if ( empty(aabb) )
+    {
+      aabb = other;
+      return;
+    }
+    vec3d min = aabb.minCorner();
+    vec3d max = aabb.maxCorner();
+    for(int i=0; i<3; i++)
+    {
+      min[i] = std::min( min[i], other.minCorner()[i] );
+      max[i] = std::max( max[i], other.maxCorner()[i] );
+    }
+    aabb.setMinCorner(min);
+    aabb.setMaxCorner(max);
+  }
+
+  inline double surfaceArea(const AABB& aabb)
+  {
+    if ( empty(aabb) )
+      return 0;
+    vec3d size = aabb.maxCorner() - aabb.minCorner();
+    return 2.0 * (size.x()*size.y() + size.y()*size.z() + size.z()*size.x());
+  }
+
+  class CentroidBelow
+  {
+  public:
+    CentroidBelow(const std::vector<vec3d>& centroids, int axis, double split): mCentroids(centroids), mAxis(axis), mSplit(split) {}
+    bool operator()(int i) const { return mCentroids[i][mAxis] < mSplit; }
+  protected:
+    const std::vector<vec3d>& mCentroids;
+    int mAxis;
+    double mSplit;
+  };
+
+  class CentroidLess
+  {
+  public:
+    CentroidLess(const std::vector<vec3d>& centroids, int axis): mCentroids(centroids), mAxis(axis) {}
+    bool operator()(int a, int b) const { return mCentroids[a][mAxis] < mCentroids[b][mAxis]; }
+  protected:
+    const std::vector<vec3d>& mCentroids;
+    int mAxis;
+  };
+}
+
+void DynamicBVH::setActors(const std::vector< ref<Actor> >& actors)
+{
+  mActors = actors;
+  mTreeDirty = true;
+}
+
+void DynamicBVH::addActor(Actor* actor)
+{
+  mActors.push_back(actor);
+  mTreeDirty = true;
+}
+
+bool DynamicBVH::removeActor(Actor* actor)
+{
+  for(int i=0; i<(int)mActors.size(); i++)
+  {
+    if (mActors[i] == actor)
+    {
+      mActors.erase(mActors.begin() + i);
+      mTreeDirty = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+void DynamicBVH::clear()
+{
+  mActors.clear();
+  mActorAABB.clear();
+  mActorMatrix.clear();
+  mActorLocalAABB.clear();
+  mNodes.clear();
+  mAreaSum = mBuildCost = 0;
+  mTreeDirty = true;
+}
+
+void DynamicBVH::update(int camera_slot)
+{
+  if (mTreeDirty || refit(camera_slot) > mBuildCost * mRebuildRatio)
+    compileTree(camera_slot);
+}
+
+bool DynamicBVH::updateActorAABB(int i, int camera_slot)
+{
+  Actor* actor = mActors[i].get();
+  const AABB& local = actor->drawable(0)->aabb();
+  const mat4d* matrix = actor->transform() ? &actor->transform()->localToWorldMatrix(camera_slot) : NULL;
+  if ( local.minCorner() == mActorLocalAABB[i].minCorner() && local.maxCorner() == mActorLocalAABB[i].maxCorner() &&
+       (matrix ? *matrix == mActorMatrix[i] : mActorAABB[i].minCorner() == local.minCorner() && mActorAABB[i].maxCorner() == local.maxCorner()) )
+    return false;
+  mActorLocalAABB[i] = local;
+  if (matrix)
+  {
+    mActorMatrix[i] = *matrix;
+    local.transformed( mActorAABB[i], *matrix );
+  }
+  else
+    mActorAABB[i] = local;
+  return true;
+}
+
+void DynamicBVH::compileTree(int camera_slot)
+{
+  int count = (int)mActors.size();
+  mActorAABB.resize(count);
+  mActorMatrix.resize(count);
+  mActorLocalAABB.resize(count);
+  mCentroids.resize(count);
+  std::vector<int> order(count);
+  for(int i=0; i<count; i++)
+  {
+    mActorLocalAABB[i].setEmpty();
+    updateActorAABB(i, camera_slot);
+    mCentroids[i] = mActorAABB[i].center();
+    order[i] = i;
+  }
+
+  mNodes.clear();
+  if (count)
+  {
+    mOrder.swap(order);
+    mNodes.reserve(2*count);
+    mNodes.push_back(Node());
+    buildNode(0, 0, count);
+
+    // stores the actors in leaf order so that each leaf refers to a contiguous range
+    std::vector< ref<Actor> > actors(count);
+    std::vector<AABB> aabbs(count), local_aabbs(count);
+    std::vector<mat4d> matrices(count);
+    for(int i=0; i<count; i++)
+    {
+      actors[i] = mActors[mOrder[i]];
+      aabbs[i] = mActorAABB[mOrder[i]];
+      matrices[i] = mActorMatrix[mOrder[i]];
+      local_aabbs[i] = mActorLocalAABB[mOrder[i]];
+    }
+    mActors.swap(actors);
+    mActorAABB.swap(aabbs);
+    mActorMatrix.swap(matrices);
+    mActorLocalAABB.swap(local_aabbs);
+  }
+
+  mAreaSum = 0;
+  for(int n=0; n<(int)mNodes.size(); n++)
+    mAreaSum += nodeArea(mNodes[n]);
+  mBuildCost = cost();
+  mTreeDirty = false;
+  ++mRebuildCount;
+}
+
+void DynamicBVH::buildNode(int node, int first, int count)
+{
+  AABB aabb, centroids;
+  for(int i=first; i<first+count; i++)
+  {
+    merge( aabb, mActorAABB[mOrder[i]] );
+    centroids.addPoint( mCentroids[mOrder[i]] );
+  }
+  mNodes[node].mAABB = aabb;
+
+  if (count <= mMaxLeafActors)
+  {
+    mNodes[node].mChild = -1;
+    mNodes[node].mFirstActor = first;
+    mNodes[node].mActorCount = count;
+    return;
+  }
+
+  // splits along the longest side of the bounds of the centroids
+  vec3d extent = centroids.maxCorner() - centroids.minCorner();
+  int axis = 0;
+  if (extent.y() > extent[axis]) axis = 1;
+  if (extent.z() > extent[axis]) axis = 2;
+
+  int mid = 0;
+  if (extent[axis] > 0)
+  {
+    // bins the centroids and picks the boundary between bins with the lowest SAH cost
+    AABB bin_aabb[SAHBins];
+    int bin_count[SAHBins] = { 0 };
+    double min = centroids.minCorner()[axis];
+    double scale = SAHBins / extent[axis];
+    for(int i=first; i<first+count; i++)
+    {
+      int b = std::min( SAHBins-1, (int)((mCentroids[mOrder[i]][axis] - min) * scale) );
+      merge( bin_aabb[b], mActorAABB[mOrder[i]] );
+      bin_count[b]++;
+    }
+
+    double right_area[SAHBins];
+    int right_count[SAHBins];
+    AABB right;
+    int n = 0;
+    for(int b=SAHBins-1; b>0; b--)
+    {
+      merge( right, bin_aabb[b] );
+      n += bin_count[b];
+      right_area[b] = surfaceArea(right);
+      right_count[b] = n;
+    }
+
+    AABB left;
+    n = 0;
+    double best_cost = 0;
+    int best_bin = -1;
+    for(int b=1; b<SAHBins; b++)
+    {
+      merge( left, bin_aabb[b-1] );
+      n += bin_count[b-1];
+      if ( n == 0 || right_count[b] == 0 )
+        continue;
+      double cost = surfaceArea(left) * n + right_area[b] * right_count[b];
+      if ( best_bin < 0 || cost < best_cost )
+      {
+        best_cost = cost;
+        best_bin = b;
+      }
+    }
+
+    if (best_bin > 0)
+    {
+      double split = min + best_bin / scale;
+      mid = (int)( std::partition( mOrder.begin()+first, mOrder.begin()+first+count, CentroidBelow(mCentroids, axis, split) ) - (mOrder.begin()+first) );
+    }
+  }
+
+  // coincident centroids or rounding at the bin boundaries: splits in half
+  if ( mid <= 0 || mid >= count )
+  {
+    mid = count / 2;
+    std::nth_element( mOrder.begin()+first, mOrder.begin()+first+mid, mOrder.begin()+first+count, CentroidLess(mCentroids, axis) );
+  }
+
+  int child = (int)mNodes.size();
+  mNodes.resize( child + 2 );
+  mNodes[node].mChild = child;
+  mNodes[node].mFirstActor = first;
+  mNodes[node].mActorCount = count;
+  buildNode(child,   first,     mid);
+  buildNode(child+1, first+mid, count-mid);
+}
+
+double DynamicBVH::refit(int camera_slot)
+{
+  if (mTreeDirty)
+    return cost();
+
+  // children come after their parents, visiting the nodes backwards updates them bottom up
+  mNodeChanged.resize(mNodes.size());
+  for(int n=(int)mNodes.size(); n--; )
+  {
+    Node& node = mNodes[n];
+    bool changed = false;
+    if (node.mChild < 0)
+    {
+      for(int i=node.mFirstActor; i<node.mFirstActor+node.mActorCount; i++)
+        changed |= updateActorAABB(i, camera_slot);
+      if (changed)
+      {
+        mAreaSum -= nodeArea(node);
+        node.mAABB.setEmpty();
+        for(int i=node.mFirstActor; i<node.mFirstActor+node.mActorCount; i++)
+          merge( node.mAABB, mActorAABB[i] );
+        mAreaSum += nodeArea(node);
+      }
+    }
+    else
+    {
+      changed = mNodeChanged[node.mChild] || mNodeChanged[node.mChild+1];
+      if (changed)
+      {
+        mAreaSum -= nodeArea(node);
+        node.mAABB = mNodes[node.mChild].mAABB;
+        merge( node.mAABB, mNodes[node.mChild+1].mAABB );
+        mAreaSum += nodeArea(node);
+      }
+    }
+    mNodeChanged[n] = changed;
+  }
+
+  return cost();
+}
+
+double DynamicBVH::nodeArea(const Node& node)
+{
+  // one unit per node visited and per actor tested
+  return surfaceArea(node.mAABB) * (node.mChild < 0 ? node.mActorCount : 1);
+}
+
+double DynamicBVH::cost() const
+{
+  double root_area = mNodes.empty() ? 0 : surfaceArea(mNodes[0].mAABB);
+  return root_area > 0 ? mAreaSum / root_area : 0;
+}
@@ -0,0 +1,123 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DynamicBVH_INCLUDE_DEFINE
+#define DynamicBVH_INCLUDE_DEFINE
+
+#include "vl/AABB.hpp"
+#include "vl/Actor.hpp"
+#include <vector>
+
+namespace vl
+{
+
+  //! Bounding volume hierarchy of moving actors.
+  //! The tree is built with the surface area heuristic and then refitted every frame to the
+  //! new positions of the actors, which only updates the bounds of the nodes containing an
+  //! actor that moved. An actor moved if its local to world matrix or its drawable bounds
+  //! differ from the ones of the previous refit. Refitting keeps the tree valid but not good, so the tree is rebuilt
+  //! when its cost grows beyond rebuildRatio() times the cost it had after the last build.
+  class DynamicBVH: public Object
+  {
+  public:
+    //! Nodes are stored in an array, the two children of an inner node are adjacent and
+    //! always come after their parent.
+    struct Node
+    {
+      AABB mAABB;
+      //! index of the first child, -1 for leaves
+      int mChild;
+      //! range of the actors of the subtree
+      int mFirstActor;
+      int mActorCount;
+    };
+
+    DynamicBVH(): mMaxLeafActors(4), mRebuildRatio(1.5), mBuildCost(0), mAreaSum(0), mRebuildCount(0), mTreeDirty(true) {}
+
+    void setActors(const std::vector< ref<Actor> >& actors);
+
+    //! Insertions and removals are applied by rebuilding the tree on the next update(),
+    //! the actor indices and actorAABB() are valid only after it.
+    void addActor(Actor* actor);
+
+    bool removeActor(Actor* actor);
+
+    void clear();
+
+    //! Refits the tree to the current position of the actors and rebuilds it if it's
+    //! out of date or if its quality degraded too much.
+    void update(int camera_slot);
+
+    //! Builds the tree from scratch with the surface area heuristic.
+    void compileTree(int camera_slot);
+
+    //! Updates the bounds of the actors and of the nodes that contain them, returns the new cost.
+    double refit(int camera_slot);
+
+    //! Expected cost of a ray or frustum query relative to testing the root, as estimated by
+    //! the surface area heuristic.
+    double cost() const;
+    double buildCost() const { return mBuildCost; }
+
+    //! Number of times the tree has been built.
+    int rebuildCount() const { return mRebuildCount; }
+
+    void setRebuildRatio(double ratio) { mRebuildRatio = ratio; }
+    double rebuildRatio() const { return mRebuildRatio; }
+
+    void setMaxLeafActors(int count) { mMaxLeafActors = count; mTreeDirty = true; }
+    int maxLeafActors() const { return mMaxLeafActors; }
+
+    int nodeCount() const { return (int)mNodes.size(); }
+    const Node& node(int i) const { return mNodes[i]; }
+
+    int actorCount() const { return (int)mActors.size(); }
+    Actor* actor(int i) { return mActors[i].get(); }
+    const Actor* actor(int i) const { return mActors[i].get(); }
+    //! World space bounds of an actor as of the last update.
+    const AABB& actorAABB(int i) const { return mActorAABB[i]; }
+
+  protected:
+    bool updateActorAABB(int i, int camera_slot);
+    void buildNode(int node, int first, int count);
+    static double nodeArea(const Node& node);
+
+  protected:
+    std::vector< ref<Actor> > mActors;
+    std::vector<AABB> mActorAABB;
+    // what mActorAABB was computed from
+    std::vector<mat4d> mActorMatrix;
+    std::vector<AABB> mActorLocalAABB;
+    std::vector<Node> mNodes;
+    std::vector<char> mNodeChanged;
+    // scratch buffers of compileTree()
+    std::vector<vec3d> mCentroids;
+    std::vector<int> mOrder;
+    int mMaxLeafActors;
+    double mRebuildRatio;
+    double mBuildCost;
+    // sum of the surface areas of the nodes weighted by their cost, updated by the refits
+    double mAreaSum;
+    int mRebuildCount;
+    bool mTreeDirty;
+  };
+
+}
+
+#endif
@@ -225,6 +225,7 @@ GLSLProgram::GLSLProgram()
   mSafeSetUniform = true;
   mNeedsLink = true;
   mHandle = 0;
+  mLinkCount = 0;
 }
 
 GLSLProgram::~GLSLProgram()
@@ -323,19 +324,21 @@ bool GLSLProgram::detachShader(GLSLShader* shader)
 
 bool GLSLProgram::linkProgram(bool force_relink)
 {
-  mUniformLocationMap.clear();
-  mAttribLocationMap.clear();
-
   if (GLEW_ARB_shading_language_100 == false)
     return false;
 
+  // locations and values survive as long as the program isn't linked again
   if (mNeedsLink || force_relink)
   {
+    mUniformLocationMap.clear();
+    mAttribLocationMap.clear();
+    mUniformCache.clear();
     CHECK(mHandle) // no shaders attached
     glLinkProgram(mHandle); GLCHECK4();
     if ( linkStatus() )
     {
       mNeedsLink = false;
+      ++mLinkCount;
     }
   }
 
@@ -456,6 +459,19 @@ GLint GLSLProgram::getUniformLocation(const std::string& name)
   }
 }
 
+bool GLSLProgram::isUniformCached(GLint location, const void* data, int bytes) const
+{
+  std::map< GLint, std::vector<unsigned char> >::const_iterator it = mUniformCache.find(location);
+  return it != mUniformCache.end() && (int)it->second.size() == bytes && memcmp(&it->second[0], data, bytes) == 0;
+}
+
+void GLSLProgram::cacheUniform(GLint location, const void* data, int bytes)
+{
+  std::vector<unsigned char>& value = mUniformCache[location];
+  value.resize(bytes);
+  memcpy(&value[0], data, bytes);
+}
+
 void GLSLProgram::getUniformfv(GLint location, GLfloat* params)
 {
   GLCHECK4()
@@ -507,7 +523,11 @@ void GLSLProgram::setUniform1f(GLint location, int count, const GLfloat* v0)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform1fv(location, count, v0);
 
@@ -539,7 +559,11 @@ void GLSLProgram::setUniform2f(GLint location, int count, const GLfloat* v0)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform2fv(location, count, v0);
 
@@ -571,7 +595,11 @@ void GLSLProgram::setUniform3f(GLint location, int count, const GLfloat* v0)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform3fv(location, count, v0);
 
@@ -603,7 +631,11 @@ void GLSLProgram::setUniform4f(GLint location, int count, const GLfloat* v0)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform4fv(location, count, v0);
 
@@ -635,7 +667,11 @@ void GLSLProgram::setUniform(GLint location, int count, const vec2* vec)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform2fv(location, count, vec->ptr());
 
@@ -667,7 +703,11 @@ void GLSLProgram::setUniform(GLint location, int count, const vec3* vec)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform3fv(location, count, vec->ptr());
 
@@ -699,7 +739,11 @@ void GLSLProgram::setUniform(GLint location, int count, const vec4* vec)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform4fv(location, count, vec->ptr());
 
@@ -731,7 +775,11 @@ void GLSLProgram::setUniform1i(GLint location, int count, const GLint* v0)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform1iv(location, count, v0);
 
@@ -763,7 +811,11 @@ void GLSLProgram::setUniform2i(GLint location, int count, const GLint* v0)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform2iv(location, count, v0);
 
@@ -795,7 +847,11 @@ void GLSLProgram::setUniform3i(GLint location, int count, const GLint* v0)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform3iv(location, count, v0);
 
@@ -827,7 +883,11 @@ void GLSLProgram::setUniform4i(GLint location, int count, const GLint* v0)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform4iv(location, count, v0);
 
@@ -859,7 +919,11 @@ void GLSLProgram::setUniform(GLint location, int count, const ivec2* vec)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform2iv(location, count, vec->ptr());
 
@@ -891,7 +955,11 @@ void GLSLProgram::setUniform(GLint location, int count, const ivec3* vec)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform3iv(location, count, vec->ptr());
 
@@ -923,7 +991,11 @@ void GLSLProgram::setUniform(GLint location, int count, const ivec4* vec)
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniform4iv(location, count, vec->ptr());
 
@@ -955,7 +1027,11 @@ void GLSLProgram::setUniformMatrix4f(GLint location, int count, bool transpose,
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniformMatrix4fv(location, count, transpose, mat);
 
@@ -988,7 +1064,11 @@ void GLSLProgram::setUniformMatrix3f(GLint location, int count, bool transpose,
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniformMatrix3fv(location, count, transpose, mat);
 
@@ -1020,7 +1100,11 @@ void GLSLProgram::setUniformMatrix2f(GLint location, int count, bool transpose,
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniformMatrix2fv(location, count, transpose, mat);
 
@@ -1051,7 +1135,11 @@ void GLSLProgram::setUniformMatrix(GLint location, int count, bool transpose, co
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniformMatrix4fv(location, count, transpose, mat->ptr());
 
@@ -1083,7 +1171,11 @@ void GLSLProgram::setUniformMatrix(GLint location, int count, bool transpose, co
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniformMatrix3fv(location, count, transpose, mat->ptr());
 
@@ -1116,7 +1208,11 @@ void GLSLProgram::setUniformMatrix(GLint location, int count, bool transpose, co
   if (mSafeSetUniform)
     glGetIntegerv(GL_CURRENT_PROGRAM, &cur_program);
 
-  glUseProgram(mHandle); GLCHECK4();
+  if (mSafeSetUniform)
+  {
+    glUseProgram(mHandle); GLCHECK4();
+  }
+  mUniformCache.erase(location);
 
   glUniformMatrix2fv(location, count, transpose, mat->ptr());
 
@@ -107,6 +107,9 @@ namespace vl
 
     bool linkStatus();
 
+    //! Incremented by every successful link, the locations queried before it may have changed.
+    int linkCount() const { return mLinkCount; }
+
     std::string infoLog() const;
 
     bool validateProgram();
@@ -119,6 +122,11 @@ namespace vl
 
     GLint getUniformLocation(const std::string& name);
 
+    //! Values last uploaded by Uniform::applyToGLSLProgram(), used to skip the uniforms that didn't change.
+    //! Cleared when the program is linked, the setUniform*() functions forget the location they set.
+    bool isUniformCached(GLint location, const void* data, int bytes) const;
+    void cacheUniform(GLint location, const void* data, int bytes);
+
     void getUniformfv(GLint location, GLfloat* params);
 
     void getUniformfv(const std::string& name, GLfloat* params);
@@ -203,7 +211,9 @@ namespace vl
     std::vector< ref<GLSLShader> > mShaders;
     std::map<std::string, int> mAttribLocationMap;
     std::map<std::string, int> mUniformLocationMap;
+    std::map< GLint, std::vector<unsigned char> > mUniformCache;
     GLuint mHandle;
+    int mLinkCount;
     bool mNeedsLink;
     bool mSafeSetUniform;
   };
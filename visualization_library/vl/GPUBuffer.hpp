@@ -439,7 +439,7 @@ namespace vl
     void reserve(int entry_count)
     {
 
-      mLocalBuffer.resize(entry_count*data_components);
+      mLocalBuffer.reserve(entry_count*data_components);
     }
 
     void clear(bool deep_clear = false)
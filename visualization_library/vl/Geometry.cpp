@@ -47,6 +47,7 @@ using namespace vl;
 Geometry::Geometry()
 {
   mUseVBO = true;
+  mInstances = 1;
 }
 Geometry::~Geometry()
 {
@@ -649,9 +650,10 @@ void Geometry::draw(Actor*, int render_stream, unsigned int tex_units)
 
   for(int prim=0; prim<(int)mDrawCalls.size(); prim++)
   {
-    mDrawCalls[prim]->draw(vbo_on);
+    mDrawCalls[prim]->draw(vbo_on, mInstances);
 
   }
+  GlobalState::renderStream(render_stream)->stats().mDrawCalls += (int)mDrawCalls.size();
 
   GLCHECK4()
 
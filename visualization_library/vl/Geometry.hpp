@@ -73,7 +73,8 @@ namespace vl
     void setPrimitiveType(EPrimitiveType type) { mType = type; }
     EPrimitiveType primitiveType() const { return mType; }
 
-    virtual void draw(bool use_vbo = true) = 0;
+    //! \p instances > 1 requires GL_EXT_draw_instanced
+    virtual void draw(bool use_vbo = true, int instances = 1) = 0;
 
     virtual void clearGPUBuffer() = 0;
     virtual void createLocalBufferFromGPUBuffer() = 0;
@@ -108,11 +109,17 @@ namespace vl
     virtual int indexCount() const { return count(); }
     virtual int index(int i) const { return start() + i; }
 
-    virtual void draw(bool)
+    virtual void draw(bool, int instances)
     {
       CHECK(start() >= 0)
       CHECK(count() >= 0)
-      glDrawArrays( primitiveType(), start(), count() );
+      if (instances > 1)
+      {
+        CHECK(GLEW_EXT_draw_instanced)
+        glDrawArraysInstancedEXT( primitiveType(), start(), count(), instances );
+      }
+      else
+        glDrawArrays( primitiveType(), start(), count() );
     }
 
     void setStart(int start) { mStart = start; }
@@ -173,6 +180,11 @@ namespace vl
       mIndexBuffer.resize( entry_count );
     }
 
+    void reserve(int entry_count)
+    {
+      mIndexBuffer.reserve( entry_count );
+    }
+
     const index_type* localPtr() const
     {
       return mIndexBuffer.localBufferPtr();
@@ -203,7 +215,7 @@ namespace vl
       mIndexBuffer.clearLocalBuffer();
     }
 
-    virtual void draw(bool use_vbo)
+    virtual void draw(bool use_vbo, int instances)
     {
       GLvoid* ptr = 0;
       if (use_vbo)
@@ -223,7 +235,13 @@ namespace vl
           return;
         ptr = localPtr();
       }
-      glDrawElements( mType, mIndexBuffer.localBufferObjects(), mIndexBuffer.glType(), ptr ); GLCHECK4()
+      if (instances > 1)
+      {
+        CHECK(GLEW_EXT_draw_instanced)
+        glDrawElementsInstancedEXT( mType, mIndexBuffer.localBufferObjects(), mIndexBuffer.glType(), ptr, instances ); GLCHECK4()
+      }
+      else
+        glDrawElements( mType, mIndexBuffer.localBufferObjects(), mIndexBuffer.glType(), ptr ); GLCHECK4()
       if (use_vbo)
         glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
     }
@@ -298,6 +316,10 @@ namespace vl
     void removeDrawCall( DrawElementsAbstract* draw_call );
     void removeAllDrawCalls() { mDrawCalls.clear(); }
 
+    //! Number of instances drawn by each draw call, see InstancedGeometry
+    void setInstances(int instances) { mInstances = instances; }
+    int instances() const { return mInstances; }
+
     void setUseVBO(bool use) { mUseVBO = use; }
     bool useVBO() const { return mUseVBO && GLEW_ARB_vertex_buffer_object; }
     void clearGPUBufferArrays(bool clear_primitives = true);
@@ -316,6 +338,7 @@ namespace vl
 
   protected:
     bool mUseVBO;
+    int mInstances;
     
     ref<GPUBuffer> mVertexArray;
 	  ref<GPUBuffer> mNormalArray;
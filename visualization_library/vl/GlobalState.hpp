@@ -27,6 +27,37 @@
 namespace vl
 {
 
+  //! OpenGL work of a render stream, reset at the beginning of every Renderer::draw().
+  class RenderStats
+  {
+  public:
+    RenderStats() { reset(); }
+
+    void reset()
+    {
+      mStateChanges = 0;
+      mStatesSkipped = 0;
+      mUniformUpdates = 0;
+      mUniformsSkipped = 0;
+      mDrawables = 0;
+      mDrawCalls = 0;
+      mStreamedBytes = 0;
+    }
+
+    //! GL states, texture units, enables, lights and clipping planes sent to OpenGL.
+    int mStateChanges;
+    //! States found equal to the ones already set and not sent again.
+    int mStatesSkipped;
+    int mUniformUpdates;
+    int mUniformsSkipped;
+    //! Drawables drawn by the renderer.
+    int mDrawables;
+    //! glDrawElements/glDrawArrays calls issued by the geometries.
+    int mDrawCalls;
+    //! Bytes sent with glBufferSubData() by streaming drawables like Trail.
+    int mStreamedBytes;
+  };
+
   class RenderStreamState: public Object
   {
   public:
@@ -39,11 +70,14 @@ namespace vl
     int maxTextureUnits() const { return mMaxTextureUnits; }
     void setMaxTextureUnits(int max_tex_unit) { mMaxTextureUnits = max_tex_unit; }
 
+    RenderStats& stats() { return mStats; }
+
   protected:
     ref<Shader> mDefaultShader; // default shader
     ref<Shader> mCurrentShader; // current state
     ref<Camera> mCurrentCamera; // current camera ( from which you can get vieport and render target )
     int mMaxTextureUnits;
+    RenderStats mStats;
   };
 
   class GlobalState
@@ -20,6 +20,26 @@
 #include "vl/Image.hpp"
 #include "vl/Say.hpp"
 #include "vl/Log.hpp"
+#include <vector>
+#include <algorithm>
+
+// The pixel conversions below have SSE2, SSSE3 and AVX2 versions, chosen at
+// compile time (-msse2, -mssse3, -mavx2...). Define VL_NO_SIMD to use only the
+// portable code.
+#if !defined(VL_NO_SIMD)
+  #if defined(__SSE2__)
+    #define VL_IMAGE_SSE2
+    #include <emmintrin.h>
+  #endif
+  #if defined(__SSSE3__)
+    #define VL_IMAGE_SSSE3
+    #include <tmmintrin.h>
+  #endif
+  #if defined(__AVX2__)
+    #define VL_IMAGE_AVX2
+    #include <immintrin.h>
+  #endif
+#endif
 
 using namespace vl;
 
@@ -29,10 +49,8 @@ namespace
   typedef unsigned char TPalette4x256[256*4];
   typedef unsigned short TPalette16x3x256[256*3];
 
-  unsigned long readDWord(FILE* fin, bool little_endian)
+  unsigned long getDWord(const unsigned char* bytes, bool little_endian)
   {
-    unsigned char bytes[4];
-    fread(bytes, 1, 4, fin);
     if (little_endian)
       return 
         ((unsigned long)bytes[0] << 24) +
@@ -47,10 +65,8 @@ namespace
         ((unsigned long)bytes[0] <<  0) ;
   }
 
-  unsigned short readWord(FILE* fin, bool little_endian)
+  unsigned short getWord(const unsigned char* bytes, bool little_endian)
   {
-    unsigned char bytes[2];
-    fread(bytes, 1, 2, fin);
     if (little_endian)
       return 
         ((unsigned short)bytes[0] << 8) +
@@ -61,11 +77,36 @@ namespace
         ((unsigned short)bytes[0] << 0) ;
   }
 
-  unsigned char readByte(FILE* fin)
+  unsigned long readDWord(FILE* fin, bool little_endian)
   {
-    unsigned char byte=0;
-    fread(&byte, 1, 1, fin);
-    return byte;
+    unsigned char bytes[4] = {0,0,0,0};
+    fread(bytes, 1, 4, fin);
+    return getDWord(bytes, little_endian);
+  }
+
+  unsigned short readWord(FILE* fin, bool little_endian)
+  {
+    unsigned char bytes[2] = {0,0};
+    fread(bytes, 1, 2, fin);
+    return getWord(bytes, little_endian);
+  }
+
+  //! Reads \p count WORDs (\p type_size 2) or DWORDs (\p type_size 4) with a single fread
+  void readValues(FILE* fin, bool little_endian, int type_size, unsigned long count, std::vector<unsigned long>& values)
+  {
+    // a corrupted count can't make us read past the end of the file
+    long pos = ftell(fin);
+    fseek(fin, 0, SEEK_END);
+    unsigned long available = (unsigned long)(ftell(fin) - pos) / type_size;
+    fseek(fin, pos, SEEK_SET);
+    if (count > available)
+      count = available;
+
+    std::vector<unsigned char> bytes(type_size*count);
+    if (!bytes.empty())
+      fread(&bytes[0], 1, bytes.size(), fin);
+    for(unsigned long i=0; i<count; i++)
+      values.push_back( type_size == 2 ? getWord(&bytes[i*2], little_endian) : getDWord(&bytes[i*4], little_endian) );
   }
 
   void writeDWord(unsigned long data, FILE* fout, bool little_endian=true)
@@ -109,49 +150,68 @@ namespace
     fwrite(&byte, 1, 1, fout);
   }
 
-  void internal_RGBToRGBA(void* buf, int w, int h, unsigned char alpha, int bytealign = 1) 
+  //! Removes the padding that aligns each row of \p rowbytes bytes to \p bytealign bytes
+  void internal_packRows(void* buf, int rowbytes, int h, int bytealign)
   {
-    int xbytes = w*3;
-    int pitch = (xbytes / bytealign * bytealign) + ((xbytes % bytealign)? bytealign : 0);
-
-    if(bytealign)
-    {
-
-      unsigned char *pxl1 = (unsigned char *)buf;
-      unsigned char *pxl2 = (unsigned char *)buf;
-      int count = 0;
-      for(int i=0; i<pitch*h; i++, count++)
-      {
-        if (count==pitch)
-          count = 0;
+    int pitch = (rowbytes / bytealign * bytealign) + ((rowbytes % bytealign)? bytealign : 0);
+    if (pitch == rowbytes)
+      return;
+    unsigned char* px = (unsigned char*)buf;
+    for(int y=1; y<h; y++)
+      memmove(px + y*rowbytes, px + y*pitch, rowbytes);
+  }
 
-        *pxl1 = *pxl2;
+  // The expansions to RGBA below work in place from the end of the buffer:
+  // a block of pixels is loaded before its RGBA pixels are stored and the
+  // source bytes of a block always lie before the RGBA pixels of the blocks
+  // following it, so no source byte is overwritten before it is read.
 
-        if (count < w*3)
-          pxl1 ++;
+  void internal_RGBToRGBA(void* buf, int w, int h, unsigned char alpha, int bytealign = 1) 
+  {
+    internal_packRows(buf, w*3, h, bytealign);
 
-        pxl2 ++;
-      }
-    }
+    int count = w * h;
+    int simd_count = 0;
+#if defined(VL_IMAGE_SSSE3)
+    simd_count = count & ~3;
+#endif
 
-	  unsigned char * px32 = (unsigned char*)buf + w * h * 4 - 4;
-	  unsigned char * px24 = (unsigned char*)buf + w * h * 3 - 3;
-	  for(int i=0; i<w * h; i++) 
+	  unsigned char * px32 = (unsigned char*)buf + count * 4 - 4;
+	  unsigned char * px24 = (unsigned char*)buf + count * 3 - 3;
+	  for(int i=count; i>simd_count; i--) 
     {
-		  px32[0] = px24[0];
-		  px32[1] = px24[1];
-		  px32[2] = px24[2];
+      // the first pixels overlap their RGBA pixel
+      unsigned char rgb[] = { px24[0], px24[1], px24[2] };
+		  px32[0] = rgb[0];
+		  px32[1] = rgb[1];
+		  px32[2] = rgb[2];
 		  px32[3] = alpha;
 		  px24 -= 3;
 		  px32 -= 4;
 	  }
+
+#if defined(VL_IMAGE_SSSE3)
+    unsigned char* px = (unsigned char*)buf;
+    const __m128i shuffle = _mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+    const __m128i alpha4  = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+    for(int i=simd_count-4; i>=0; i-=4)
+    {
+      __m128i rgb = _mm_loadu_si128((const __m128i*)(px + i*3));
+      _mm_storeu_si128((__m128i*)(px + i*4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha4));
+    }
+#endif
   }
 
   void internal_GrayscaleToRGBA(void* buf, int size, unsigned char alpha) 
   {
+    int simd_count = 0;
+#if defined(VL_IMAGE_SSE2)
+    simd_count = size & ~15;
+#endif
+
 	  unsigned char* px32 = (unsigned char*)buf + size * 4 - 4;
 	  unsigned char* px8  = (unsigned char*)buf + size * 1 - 1;
-	  for(int i=0; i<size; i++) 
+	  for(int i=size; i>simd_count; i--) 
     {
 		  px32[0] = *px8;
 		  px32[1] = *px8;
@@ -160,13 +220,35 @@ namespace
 		  px8 -= 1;
 		  px32 -= 4;
 	  }
+
+#if defined(VL_IMAGE_SSE2)
+    unsigned char* px = (unsigned char*)buf;
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i alpha4   = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+    for(int i=simd_count-16; i>=0; i-=16)
+    {
+      __m128i gray = _mm_loadu_si128((const __m128i*)(px + i));
+      __m128i lo = _mm_unpacklo_epi8(gray, gray);
+      __m128i hi = _mm_unpackhi_epi8(gray, gray);
+      __m128i* dst = (__m128i*)(px + i*4);
+      _mm_storeu_si128(dst+0, _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi16(lo, lo), rgb_mask), alpha4));
+      _mm_storeu_si128(dst+1, _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi16(lo, lo), rgb_mask), alpha4));
+      _mm_storeu_si128(dst+2, _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi16(hi, hi), rgb_mask), alpha4));
+      _mm_storeu_si128(dst+3, _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi16(hi, hi), rgb_mask), alpha4));
+    }
+#endif
   }
 
   void internal_A1R5G5B5ToRGBA(void* buf, int size, unsigned char alpha)
   {
+    int simd_count = 0;
+#if defined(VL_IMAGE_SSE2)
+    simd_count = size & ~7;
+#endif
+
 	  unsigned char* px32 = (unsigned char*)buf + size * 4 - 4;
 	  unsigned char* px8  = (unsigned char*)buf + size * 2 - 2;
-	  for(int i=0; i<size; i++) 
+	  for(int i=size; i>simd_count; i--) 
     {
       unsigned char r = (px8[1] << 1) & ~0x03;
       unsigned char g = ((px8[1] << 6) | (px8[0] >> 2)) & ~0x03;;
@@ -179,84 +261,71 @@ namespace
 		  px8  -= 2;
 		  px32 -= 4;
 	  }
-  }
-
-  void internal_8ToRGBA(const TPalette3x256 & palette, void* buf, int w, int h, unsigned char alpha, int bytealign = 1)
-  {
-
-    int xbytes = w;
-    int pitch = (xbytes / bytealign * bytealign) + ((xbytes % bytealign)? bytealign : 0);
 
-    if(bytealign)
+#if defined(VL_IMAGE_SSE2)
+    // same bits as above on the little endian 16 bit pixel p: r = p>>7, g = p>>2, b = p<<3
+    unsigned char* px = (unsigned char*)buf;
+    const __m128i zero   = _mm_setzero_si128();
+    const __m128i r_mask = _mm_set1_epi32(0x000000FC);
+    const __m128i g_mask = _mm_set1_epi32(0x0000FC00);
+    const __m128i b_mask = _mm_set1_epi32(0x00F80000);
+    const __m128i alpha4 = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+    for(int i=simd_count-8; i>=0; i-=8)
     {
-
-      unsigned char *pxl1 = (unsigned char *)buf;
-      unsigned char *pxl2 = (unsigned char *)buf;
-      int count = 0;
-      for(int i=0; i<pitch*h; i++, count++)
+      __m128i p16 = _mm_loadu_si128((const __m128i*)(px + i*2));
+      __m128i p32[] = { _mm_unpacklo_epi16(p16, zero), _mm_unpackhi_epi16(p16, zero) };
+      for(int k=0; k<2; k++)
       {
-        if (count==pitch)
-          count = 0;
-
-        *pxl1 = *pxl2;
-
-        if (count < w)
-          pxl1 ++;
-
-        pxl2 ++;
+        __m128i p = p32[k];
+        __m128i rgba = _mm_and_si128(_mm_srli_epi32(p, 7), r_mask);
+        rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_epi32(p, 6), g_mask));
+        rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_epi32(p, 19), b_mask));
+        _mm_storeu_si128((__m128i*)(px + i*4) + k, _mm_or_si128(rgba, alpha4));
       }
     }
-
-    unsigned char* px32 = (unsigned char*)buf + w * h * 4 - 4;
-	  unsigned char* px8  = (unsigned char*)buf + w * h * 1 - 1;
-	  for(int i=0; i<w * h; i++) 
-    {
-		  px32[0] = palette[*px8*3+0];
-		  px32[1] = palette[*px8*3+1];
-		  px32[2] = palette[*px8*3+2];
-		  px32[3] = alpha;
-		  px8  -= 1;
-		  px32 -= 4;
-	  }
+#endif
   }
 
-  void internal_8ToRGBA(const TPalette4x256 & palette, void* buf, int w, int h, int bytealign = 1)
+  //! Expands the 8 bit palette indices in \p buf to the RGBA \p table entries
+  void internal_8ToRGBA(const unsigned int table[256], void* buf, int w, int h, int bytealign)
   {
+    internal_packRows(buf, w, h, bytealign);
 
-    int xbytes = w;
-    int pitch = (xbytes / bytealign * bytealign) + ((xbytes % bytealign)? bytealign : 0);
-
-    if(bytealign)
-    {
-
-      unsigned char *pxl1 = (unsigned char *)buf;
-      unsigned char *pxl2 = (unsigned char *)buf;
-      int count = 0;
-      for(int i=0; i<pitch*h; i++, count++)
-      {
-        if (count==pitch)
-          count = 0;
+    int count = w * h;
+    int simd_count = 0;
+#if defined(VL_IMAGE_AVX2)
+    simd_count = count & ~7;
+#endif
 
-        *pxl1 = *pxl2;
+    unsigned char* px = (unsigned char*)buf;
+    for(int i=count-1; i>=simd_count; i--)
+      memcpy(px + i*4, &table[px[i]], 4);
 
-        if (count < w)
-          pxl1 ++;
-
-        pxl2 ++;
-      }
+#if defined(VL_IMAGE_AVX2)
+    for(int i=simd_count-8; i>=0; i-=8)
+    {
+      __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(px + i)));
+      _mm256_storeu_si256((__m256i*)(px + i*4), _mm256_i32gather_epi32((const int*)table, index, 4));
     }
+#endif
+  }
 
-    unsigned char * px32 = (unsigned char*)buf + w * h * 4 - 4;
-	  unsigned char * px8  = (unsigned char*)buf + w * h * 1 - 1;
-	  for(int i=0; i<w * h; i++) 
+  void internal_8ToRGBA(const TPalette3x256 & palette, void* buf, int w, int h, unsigned char alpha, int bytealign = 1)
+  {
+    unsigned int table[256];
+    for(int i=0; i<256; i++)
     {
-		  px32[0] = palette[*px8*4+0];
-		  px32[1] = palette[*px8*4+1];
-		  px32[2] = palette[*px8*4+2];
-		  px32[3] = palette[*px8*4+3];
-		  px8  -= 1;
-		  px32 -= 4;
-	  }
+      unsigned char rgba[] = { palette[i*3+0], palette[i*3+1], palette[i*3+2], alpha };
+      memcpy(&table[i], rgba, 4);
+    }
+    internal_8ToRGBA(table, buf, w, h, bytealign);
+  }
+
+  void internal_8ToRGBA(const TPalette4x256 & palette, void* buf, int w, int h, int bytealign = 1)
+  {
+    unsigned int table[256];
+    memcpy(table, palette, sizeof(table));
+    internal_8ToRGBA(table, buf, w, h, bytealign);
   }
 
   void internal_swapBytes32(void* buf, int size)
@@ -273,24 +342,80 @@ namespace
     }
   }
 
-  void internal_swapBytes32_BGRA_RGBA(void* buf, int bytecount)
-  {
-    unsigned char* p = (unsigned char*)buf;
-    unsigned char dw[4];
-    for(int i=0; i<bytecount; i+=4, p+=4)
+  //! Swaps the R and B bytes of the pixels in \p src, \p dst may be equal to \p src
+  void internal_swapBytes32_BGRA_RGBA(void* dst, const void* src, int bytecount)
+  {
+    unsigned char* d = (unsigned char*)dst;
+    const unsigned char* s = (const unsigned char*)src;
+    int i = 0;
+
+#if defined(VL_IMAGE_AVX2)
+    const __m256i shuffle8 = _mm256_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15, 2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+    for(; i+32<=bytecount; i+=32)
+      _mm256_storeu_si256((__m256i*)(d+i), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(s+i)), shuffle8));
+#endif
+
+#if defined(VL_IMAGE_SSSE3)
+    const __m128i shuffle4 = _mm_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+    for(; i+16<=bytecount; i+=16)
+      _mm_storeu_si128((__m128i*)(d+i), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s+i)), shuffle4));
+#elif defined(VL_IMAGE_SSE2)
+    const __m128i ga_mask = _mm_set1_epi32(0xFF00FF00);
+    const __m128i r_mask  = _mm_set1_epi32(0x000000FF);
+    const __m128i b_mask  = _mm_set1_epi32(0x00FF0000);
+    for(; i+16<=bytecount; i+=16)
     {
-      memcpy(dw, p, 4);
-      p[0] = dw[2];
-      p[2] = dw[0];
+      __m128i px = _mm_loadu_si128((const __m128i*)(s+i));
+      __m128i rgba = _mm_and_si128(px, ga_mask);
+      rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_srli_epi32(px, 16), r_mask));
+      rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_epi32(px, 16), b_mask));
+      _mm_storeu_si128((__m128i*)(d+i), rgba);
+    }
+#endif
+
+    for(; i<bytecount; i+=4)
+    {
+      unsigned char dw[4];
+      memcpy(dw, s+i, 4);
+      d[i+0] = dw[2];
+      d[i+1] = dw[1];
+      d[i+2] = dw[0];
+      d[i+3] = dw[3];
     }
   }
 
+  void internal_swapBytes32_BGRA_RGBA(void* buf, int bytecount)
+  {
+    internal_swapBytes32_BGRA_RGBA(buf, buf, bytecount);
+  }
+
   void internal_swapBytes24_BGR_RGB(void* buf, int bytecount)
   {
     unsigned char* p = (unsigned char*)buf;
-    unsigned char dw[4];
     int pxl = bytecount / 3;
-    for(int i=0; i<pxl; i++, p+=3)
+    int i = 0;
+
+#if defined(VL_IMAGE_SSSE3)
+    // 5 pixels per step, the 16th byte loaded belongs to the next step and is stored unchanged.
+    // The next step is loaded before the current one is stored, so no load waits on the
+    // overlapping store.
+    const __m128i shuffle = _mm_setr_epi8(2,1,0, 5,4,3, 8,7,6, 11,10,9, 14,13,12, 15);
+    if ((i+5)*3+1<=bytecount)
+    {
+      __m128i px = _mm_loadu_si128((const __m128i*)p);
+      for(; (i+10)*3+1<=bytecount; i+=5)
+      {
+        __m128i next = _mm_loadu_si128((const __m128i*)(p+(i+5)*3));
+        _mm_storeu_si128((__m128i*)(p+i*3), _mm_shuffle_epi8(px, shuffle));
+        px = next;
+      }
+      _mm_storeu_si128((__m128i*)(p+i*3), _mm_shuffle_epi8(px, shuffle));
+      i += 5;
+    }
+#endif
+
+    unsigned char dw[4];
+    for(p+=i*3; i<pxl; i++, p+=3)
     {
       memcpy(dw, p, 3);
       p[0] = dw[2];
@@ -301,7 +426,29 @@ namespace
   void internal_fillRGBA32_Alpha(void* buf, int bytecount, unsigned char alpha)
   {
     unsigned char* pxl = (unsigned char*)buf;
-    for(int i=0; i<bytecount; i+=4)
+    int i = 0;
+
+#if defined(VL_IMAGE_AVX2)
+    const __m256i rgb_mask8 = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i alpha8 = _mm256_set1_epi32((int)((unsigned int)alpha << 24));
+    for(; i+32<=bytecount; i+=32)
+    {
+      __m256i px = _mm256_loadu_si256((const __m256i*)(pxl+i));
+      _mm256_storeu_si256((__m256i*)(pxl+i), _mm256_or_si256(_mm256_and_si256(px, rgb_mask8), alpha8));
+    }
+#endif
+
+#if defined(VL_IMAGE_SSE2)
+    const __m128i rgb_mask4 = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i alpha4 = _mm_set1_epi32((int)((unsigned int)alpha << 24));
+    for(; i+16<=bytecount; i+=16)
+    {
+      __m128i px = _mm_loadu_si128((const __m128i*)(pxl+i));
+      _mm_storeu_si128((__m128i*)(pxl+i), _mm_or_si128(_mm_and_si128(px, rgb_mask4), alpha4));
+    }
+#endif
+
+    for(; i<bytecount; i+=4)
     {
       pxl[i+3] = alpha;
     }
@@ -310,11 +457,68 @@ namespace
   void internal_fillGray8Alpha8_Alpha(void* buf, int bytecount, unsigned char alpha)
   {
     unsigned char* pxl = (unsigned char*)buf;
-    for(int i=0; i<bytecount; i+=2)
+    int i = 0;
+
+#if defined(VL_IMAGE_SSE2)
+    const __m128i gray_mask = _mm_set1_epi16(0x00FF);
+    const __m128i alpha8 = _mm_set1_epi16((short)(alpha << 8));
+    for(; i+16<=bytecount; i+=16)
+    {
+      __m128i px = _mm_loadu_si128((const __m128i*)(pxl+i));
+      _mm_storeu_si128((__m128i*)(pxl+i), _mm_or_si128(_mm_and_si128(px, gray_mask), alpha8));
+    }
+#endif
+
+    for(; i<bytecount; i+=2)
     {
       pxl[i+1] = alpha;
     }
   }
+
+  //! Decodes \p pixcount RLE packed pixels of \p pixsize bytes, the packets are read from \p fin in one go
+  void internal_readTGARLE(FILE* fin, void* pixels, int pixcount, int pixsize)
+  {
+    long start = ftell(fin);
+    fseek(fin, 0, SEEK_END);
+    long size = ftell(fin) - start;
+    fseek(fin, start, SEEK_SET);
+
+    std::vector<unsigned char> packets(size > 0 ? size : 0);
+    if (!packets.empty())
+      packets.resize( fread(&packets[0], 1, packets.size(), fin) );
+
+    unsigned char* dst = (unsigned char*)pixels;
+    const unsigned char* src = packets.empty() ? NULL : &packets[0];
+    const unsigned char* end = src + packets.size();
+    int pix = 0;
+    while(pix < pixcount && src < end)
+    {
+      unsigned char header = *src++;
+      int count = (header & 0x7F) + 1;
+      if (count > pixcount - pix)
+        count = pixcount - pix;
+      if (header >= 128)
+      {
+        if (end - src < pixsize)
+          break;
+        for(int i=0; i<count; i++)
+          memcpy(dst + (pix+i)*pixsize, src, pixsize);
+        src += pixsize;
+      }
+      else
+      {
+        if (end - src < count*pixsize)
+          break;
+        memcpy(dst + pix*pixsize, src, count*pixsize);
+        src += count*pixsize;
+      }
+      pix += count;
+    }
+
+    // truncated file
+    if (pix < pixcount)
+      memset(dst + pix*pixsize, 0, (pixcount-pix)*pixsize);
+  }
 }
 
 namespace 
@@ -327,26 +531,27 @@ namespace
     char mReserved2[2]; 
     char mOffBits[4]; 
 
-    unsigned short Type() const { return *(unsigned short*)mType; }
-    unsigned long  Size() const { return *(unsigned long*)mSize; }
-    unsigned short Reserved1() const { return *(unsigned short*)mReserved1; }
-    unsigned short Reserved2() const { return *(unsigned short*)mReserved2; }
-    unsigned long  OffBits() const { return *(unsigned long*)mOffBits; }
+    unsigned short Type() const { return getWord((const unsigned char*)mType, false); }
+    unsigned long  Size() const { return getDWord((const unsigned char*)mSize, false); }
+    unsigned short Reserved1() const { return getWord((const unsigned char*)mReserved1, false); }
+    unsigned short Reserved2() const { return getWord((const unsigned char*)mReserved2, false); }
+    unsigned long  OffBits() const { return getDWord((const unsigned char*)mOffBits, false); }
   } BitmapFileHeader;
 
   typedef struct 
   {
-    unsigned long Size() { return *(unsigned long*)mSize; }
-    long Width() { return *(long*)mWidth; } 
-    long Height() { return *(long*)mHeight; } 
-    unsigned short Planes() { return *(unsigned short*)mPlanes; } 
-    unsigned short BitCount() { return *(unsigned short*)mBitCount; } 
-    unsigned long Compression() { return *(unsigned long*)mCompression; } 
-    unsigned long SizeImage() { return *(unsigned long*)mSizeImage; } 
-    long XPelsPerMeter() { return *(long*)mXPelsPerMeter; } 
-    long YPelsPerMeter() { return *(long*)mYPelsPerMeter; } 
-    unsigned long ClrUsed() { return *(unsigned long*)mClrUsed; } 
-    unsigned long ClrImportant() { return *(unsigned long*)mClrImportant; } 
+    unsigned long Size() { return getDWord((const unsigned char*)mSize, false); }
+    long Width() { return (int)getDWord((const unsigned char*)mWidth, false); } 
+    long Height() { return (int)getDWord((const unsigned char*)mHeight, false); } 
+    void setHeight(long h) { for(int i=0; i<4; i++) mHeight[i] = (char)((unsigned long)h >> (i*8)); }
+    unsigned short Planes() { return getWord((const unsigned char*)mPlanes, false); } 
+    unsigned short BitCount() { return getWord((const unsigned char*)mBitCount, false); } 
+    unsigned long Compression() { return getDWord((const unsigned char*)mCompression, false); } 
+    unsigned long SizeImage() { return getDWord((const unsigned char*)mSizeImage, false); } 
+    long XPelsPerMeter() { return (int)getDWord((const unsigned char*)mXPelsPerMeter, false); } 
+    long YPelsPerMeter() { return (int)getDWord((const unsigned char*)mYPelsPerMeter, false); } 
+    unsigned long ClrUsed() { return getDWord((const unsigned char*)mClrUsed, false); } 
+    unsigned long ClrImportant() { return getDWord((const unsigned char*)mClrImportant, false); } 
 
     char mSize[4];
     char mWidth[4]; 
@@ -398,8 +603,7 @@ vl::ref<Image> vl::loadBMP( const std::string& path )
   bool flip = false;
 	if ( bih.Height() < 0 )
   {
-    long *h = (long*)bih.mHeight;
-    *h = -*h;
+    bih.setHeight(-bih.Height());
     flip = true;
   }
 	assert( bih.Height() * bih.Width() );
@@ -485,12 +689,7 @@ vl::ref<Image> vl::loadBMP( const std::string& path )
 
 	fclose(fin); fin = NULL;
   internal_swapBytes32_BGRA_RGBA(img->pixels(), img->requiredMemory());
-
-  for(int i=0; i<img->requiredMemory(); i+=4)
-  {
-    unsigned char* px = (unsigned char*)img->pixels() + i;
-    px[3] = 0xFF;
-  }
+  internal_fillRGBA32_Alpha(img->pixels(), img->requiredMemory(), 0xFF);
 
   if (flip)
     img->flipVertically();
@@ -583,30 +782,7 @@ vl::ref<Image> vl::loadTGA( const std::string& path )
       img->allocate2D(w, h, 4, IF_RGBA, IT_UNSIGNED_BYTE);
 
       fseek(fin, pixels_offset, SEEK_SET);
-      int pixcount = w*h;
-      int pix = 0;
-      while(pix < pixcount)
-      {
-        unsigned char header = 0;
-        fread(&header, 1, 1, fin);
-        if (header >= 128)
-        {
-          int count = header - 128 + 1;
-          unsigned char bgra[4];
-          fread(bgra, 1, pixsize, fin);
-          while(count--)
-          {
-            memcpy((unsigned char*)img->pixels() + pix*pixsize, bgra, pixsize);
-            pix++;
-          }
-        }
-        else
-        {
-          int count = header + 1;
-          fread((unsigned char*)img->pixels() + pix*pixsize, 1, pixsize*count, fin);
-          pix += count;
-        }
-      }
+      internal_readTGARLE(fin, img->pixels(), w*h, pixsize);
 
       switch(header.BitsPerPixel)
       {
@@ -678,31 +854,7 @@ vl::ref<Image> vl::loadTGA( const std::string& path )
         }
         else // TGA_8BIT_UNCOMPRESSED
         {
-          int pixsize = 1;
-          int pixcount = w*h;
-          int pix = 0;
-          while(pix < pixcount)
-          {
-            unsigned char header = 0;
-            fread(&header, 1, 1, fin);
-            if (header >= 128)
-            {
-              int count = header - 128 + 1;
-              unsigned char bgra[4];
-              fread(bgra, 1, pixsize, fin);
-              while(count--)
-              {
-                memcpy((unsigned char*)img->pixels() + pix*pixsize, bgra, pixsize);
-                pix++;
-              }
-            }
-            else
-            {
-              int count = header + 1;
-              fread((unsigned char*)img->pixels() + pix*pixsize, 1, pixsize*count, fin);
-              pix += count;
-            }
-          }
+          internal_readTGARLE(fin, img->pixels(), w*h, 1);
         }
 
         internal_8ToRGBA(palette, img->pixels(), img->width(), img->height(), 0xFF);
@@ -722,31 +874,7 @@ vl::ref<Image> vl::loadTGA( const std::string& path )
         }
         else // TGA_8BIT_UNCOMPRESSED
         {
-          int pixsize = 1;
-          int pixcount = w*h;
-          int pix = 0;
-          while(pix < pixcount)
-          {
-            unsigned char header = 0;
-            fread(&header, 1, 1, fin);
-            if (header >= 128)
-            {
-              int count = header - 128 + 1;
-              unsigned char bgra[4];
-              fread(bgra, 1, pixsize, fin);
-              while(count--)
-              {
-                memcpy((unsigned char*)img->pixels() + pix*pixsize, bgra, pixsize);
-                pix++;
-              }
-            }
-            else
-            {
-              int count = header + 1;
-              fread((unsigned char*)img->pixels() + pix*pixsize, 1, pixsize*count, fin);
-              pix += count;
-            }
-          }
+          internal_readTGARLE(fin, img->pixels(), w*h, 1);
         }
 
         internal_8ToRGBA(palette, img->pixels(), img->width(), img->height());
@@ -779,31 +907,7 @@ vl::ref<Image> vl::loadTGA( const std::string& path )
       }
       else  // TGA_GRAYSCALE_COMPRESSED
       {
-        int pixsize = 1;
-        int pixcount = w*h;
-        int pix = 0;
-        while(pix < pixcount)
-        {
-          unsigned char header = 0;
-          fread(&header, 1, 1, fin);
-          if (header >= 128)
-          {
-            int count = header - 128 + 1;
-            unsigned char bgra[4];
-            fread(bgra, 1, pixsize, fin);
-            while(count--)
-            {
-              memcpy((unsigned char*)img->pixels() + pix*pixsize, bgra, pixsize);
-              pix++;
-            }
-          }
-          else
-          {
-            int count = header + 1;
-            fread((unsigned char*)img->pixels() + pix*pixsize, 1, pixsize*count, fin);
-            pix += count;
-          }
-        }
+        internal_readTGARLE(fin, img->pixels(), w*h, 1);
       }
 		}
 		else
@@ -867,12 +971,18 @@ vl::ref<Image> vl::loadTIFF(const std::string& file)
   std::vector<unsigned long> strips_offs;
   std::vector<unsigned long> strip_byte_counts;
 
-  for(int idir=0; idir<dir_count; idir++)
+  // the 12 byte directory entries are read at once
+  std::vector<unsigned char> entries(dir_count*12);
+  if (!entries.empty())
+    entries.resize( fread(&entries[0], 1, entries.size(), fin) / 12 * 12 );
+
+  for(int idir=0; idir<(int)entries.size()/12; idir++)
   {
+    const unsigned char* entry = &entries[idir*12];
 
-    unsigned short tag = readWord(fin, endianess);
+    unsigned short tag = getWord(entry+0, endianess);
 
-    unsigned short type = readWord(fin, endianess);
+    unsigned short type = getWord(entry+2, endianess);
     char* typestr = "";
     switch(type)
     {
@@ -892,34 +1002,34 @@ vl::ref<Image> vl::loadTIFF(const std::string& file)
         typestr = "*** error ***";
     }
 
-    unsigned long count = readDWord(fin, endianess);
+    unsigned long count = getDWord(entry+4, endianess);
 
     unsigned long val[] = {0,0,0,0};
     unsigned long value_offset = 0;
 
     if(type == 1 && count<=4) // BYTE
     {
-      val[0] = readByte(fin);
-      val[1] = readByte(fin);
-      val[2] = readByte(fin);
-      val[3] = readByte(fin);
+      val[0] = entry[8];
+      val[1] = entry[9];
+      val[2] = entry[10];
+      val[3] = entry[11];
     }
     else
     if(type == 3 && count<=2) // SHORT
     {
-      val[0] = readWord(fin, endianess);
-      val[1] = readWord(fin, endianess);
+      val[0] = getWord(entry+8, endianess);
+      val[1] = getWord(entry+10, endianess);
 
     }
     else
     if(type == 4 && count<=1) // LONG
     {
-      val[0] = readDWord(fin, endianess);
+      val[0] = getDWord(entry+8, endianess);
 
     }
     else
     {
-      value_offset = readDWord(fin, endianess);
+      value_offset = getDWord(entry+8, endianess);
 
     }
 
@@ -956,20 +1066,10 @@ vl::ref<Image> vl::loadTIFF(const std::string& file)
         }
 
         else
+        if (type == 3 || type == 4)
         {
-          unsigned long pos = ftell(fin);
-
           fseek(fin, value_offset, SEEK_SET);
-          for(int i=0; i<(int)count; i++)
-          {
-            if (type == 3)
-              strips_offs.push_back( readWord(fin,endianess) );
-            else
-            if (type == 4)
-              strips_offs.push_back( readDWord(fin,endianess) );
-          }
-
-          fseek(fin, pos, SEEK_SET);
+          readValues(fin, endianess, type == 3 ? 2 : 4, count, strips_offs);
         }
       break;
 
@@ -986,20 +1086,10 @@ vl::ref<Image> vl::loadTIFF(const std::string& file)
         }
 
         else
+        if (type == 3 || type == 4)
         {
-          unsigned long pos = ftell(fin);
-
           fseek(fin, value_offset, SEEK_SET);
-          for(int i=0; i<(int)count; i++)
-          {
-            if (type == 3)
-              strip_byte_counts.push_back( readWord(fin,endianess) );
-            else
-            if (type == 4)
-              strip_byte_counts.push_back( readDWord(fin,endianess) );
-          }
-
-          fseek(fin, pos, SEEK_SET);
+          readValues(fin, endianess, type == 3 ? 2 : 4, count, strip_byte_counts);
         }
       break;
 
@@ -1032,8 +1122,6 @@ vl::ref<Image> vl::loadTIFF(const std::string& file)
   if (photometric_interpretation == 2)
     bits_per_sample = 8;
 
-  readDWord(fin, endianess);
-
   if (palette_count>3*256)
   {
     Log::error( Say("TIFF file '%s' seems corrupted.\n") << file);
@@ -1089,9 +1177,11 @@ vl::ref<Image> vl::loadTIFF(const std::string& file)
 
     CHECK(palette_count*2 == sizeof(palette16))
 
+    std::vector<unsigned long> values;
     fseek(fin, palette_offset, SEEK_SET);
-    for(int i=0; i<palette_count; i++)
-      palette16[i] = readWord(fin, endianess);
+    readValues(fin, endianess, 2, palette_count, values);
+    for(int i=0; i<(int)values.size(); i++)
+      palette16[i] = (unsigned short)values[i];
 
     int colors = palette_count / 3;
     for(int i=0; i<colors; i++)
@@ -1332,6 +1422,19 @@ namespace
 
   } DDSURFACEDESC2;
 
+  //! Reads the 124 bytes of the header in one go, they are 31 little endian DWORDs
+  void readDDSHeader(FILE* fin, DDSURFACEDESC2& header)
+  {
+    unsigned char bytes[124];
+    memset(bytes, 0, sizeof(bytes));
+    fread(bytes, 1, sizeof(bytes), fin);
+
+    CHECK(sizeof(header) == 31*sizeof(unsigned long));
+    unsigned long* dword = (unsigned long*)&header;
+    for(int i=0; i<31; i++)
+      dword[i] = getDWord(bytes + i*4, false);
+  }
+
   enum 
   {
     DDS_IMAGE_NULL = 0,
@@ -1362,30 +1465,7 @@ vl::ref<Image> vl::loadDDS(const std::string& file)
   }
 
   DDSURFACEDESC2 header;
-  memset(&header, 0, sizeof(header));
-  CHECK(sizeof(header) == 124);
-
-  header.dwSize = readDWord(fin, false);
-  header.dwFlags = readDWord(fin, false);
-  header.dwHeight = readDWord(fin, false);
-  header.dwWidth = readDWord(fin, false);
-  header.dwPitchOrLinearSize = readDWord(fin, false);
-  header.dwDepth = readDWord(fin, false);
-  header.dwMipMapCount = readDWord(fin, false);
-  fread(header.dwReserved1, 1, 11*sizeof(unsigned long), fin);
-  header.ddpfPixelFormat.dwSize = readDWord(fin,false);
-  header.ddpfPixelFormat.dwFlags = readDWord(fin,false);
-  header.ddpfPixelFormat.dwFourCC = readDWord(fin,false);
-  header.ddpfPixelFormat.dwRGBBitCount = readDWord(fin,false);
-  header.ddpfPixelFormat.dwRBitMask = readDWord(fin,false);
-  header.ddpfPixelFormat.dwGBitMask = readDWord(fin,false);
-  header.ddpfPixelFormat.dwBBitMask = readDWord(fin,false);
-  header.ddpfPixelFormat.dwAlphaBitMask = readDWord(fin,false);
-  header.ddsCaps.dwCaps1 = readDWord(fin,false);
-  header.ddsCaps.dwCaps2 = readDWord(fin,false);
-  header.ddsCaps.dwReserved[0] = readDWord(fin,false);
-  header.ddsCaps.dwReserved[1] = readDWord(fin,false);
-  header.dwReserved2 = readDWord(fin,false);
+  readDDSHeader(fin, header);
 
   if( header.dwSize != 124 || header.ddpfPixelFormat.dwSize != 32 || 
       (header.dwFlags & DDS_REQUIRED_FLAGS) != DDS_REQUIRED_FLAGS || 
@@ -1812,9 +1892,15 @@ bool Image::saveTGA( const std::string& file )
 	header.Height_hi = (unsigned char)(height() >> 8);
 	header.BitsPerPixel = 32;
 	fwrite(&header, 1, sizeof(header), fout);
-  internal_swapBytes32_BGRA_RGBA(pixels(), requiredMemory());
-  fwrite(pixels(), 1, width()*height()*4, fout);
-  internal_swapBytes32_BGRA_RGBA(pixels(), requiredMemory());
+  // converted to BGRA a chunk at a time, the image is left untouched
+  std::vector<unsigned char> bgra(64*1024);
+  int bytecount = width()*height()*4;
+  for(int offset=0; offset<bytecount; offset+=(int)bgra.size())
+  {
+    int chunk = std::min((int)bgra.size(), bytecount-offset);
+    internal_swapBytes32_BGRA_RGBA(&bgra[0], pixels()+offset, chunk);
+    fwrite(&bgra[0], 1, chunk, fout);
+  }
 
   writeDWord(0, fout);
 
@@ -1983,30 +2069,7 @@ bool vl::isFormatDDS(const std::string& file)
   }
 
   DDSURFACEDESC2 header;
-  memset(&header, 0, sizeof(header));
-  CHECK(sizeof(header) == 124);
-
-  header.dwSize = readDWord(fin, false);
-  header.dwFlags = readDWord(fin, false);
-  header.dwHeight = readDWord(fin, false);
-  header.dwWidth = readDWord(fin, false);
-  header.dwPitchOrLinearSize = readDWord(fin, false);
-  header.dwDepth = readDWord(fin, false);
-  header.dwMipMapCount = readDWord(fin, false);
-  fread(header.dwReserved1, 1, 11*sizeof(unsigned long), fin);
-  header.ddpfPixelFormat.dwSize = readDWord(fin,false);
-  header.ddpfPixelFormat.dwFlags = readDWord(fin,false);
-  header.ddpfPixelFormat.dwFourCC = readDWord(fin,false);
-  header.ddpfPixelFormat.dwRGBBitCount = readDWord(fin,false);
-  header.ddpfPixelFormat.dwRBitMask = readDWord(fin,false);
-  header.ddpfPixelFormat.dwGBitMask = readDWord(fin,false);
-  header.ddpfPixelFormat.dwBBitMask = readDWord(fin,false);
-  header.ddpfPixelFormat.dwAlphaBitMask = readDWord(fin,false);
-  header.ddsCaps.dwCaps1 = readDWord(fin,false);
-  header.ddsCaps.dwCaps2 = readDWord(fin,false);
-  header.ddsCaps.dwReserved[0] = readDWord(fin,false);
-  header.ddsCaps.dwReserved[1] = readDWord(fin,false);
-  header.dwReserved2 = readDWord(fin,false);
+  readDDSHeader(fin, header);
   fclose(fin);
 
   if( header.dwSize != 124 || header.ddpfPixelFormat.dwSize != 32 || 
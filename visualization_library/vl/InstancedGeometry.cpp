@@ -0,0 +1,101 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vl/InstancedGeometry.hpp"
+#include "vl/Actor.hpp"
+#include "vl/GlobalState.hpp"
+
+using namespace vl;
+
+InstancedGeometry::InstancedGeometry(Geometry* geometry)
+{
+  mGeometry = geometry;
+  mMaxInstancesPerDraw = 32;
+  mProgramLinkCount = 0;
+  mLocation = -1;
+}
+
+void InstancedGeometry::computeAABB()
+{
+  mAABB.setEmpty();
+  if (!mGeometry)
+    return;
+  for(int i=0; i<instanceCount(); ++i)
+    mAABB += mGeometry->aabb().transformed( mInstances[i]->getComputedLocalToWorld() );
+}
+
+GLint InstancedGeometry::instanceMatrixLocation(int render_stream)
+{
+  if (!GLEW_EXT_draw_instanced)
+    return -1;
+
+  // the program the renderer applied with the shader of the actor
+  GLSLProgram* program = GlobalState::renderStream(render_stream)->currentShader()->glslProgram(false);
+  if (!program || !program->handle())
+    return -1;
+  if (program != mProgram.get() || program->linkCount() != mProgramLinkCount)
+  {
+    mProgram = program;
+    mProgramLinkCount = program->linkCount();
+    mLocation = program->getUniformLocation("vl_InstanceMatrix");
+  }
+  return mLocation;
+}
+
+void InstancedGeometry::draw(Actor* actor, int render_stream, unsigned int tex_units)
+{
+  if (!mGeometry || mInstances.empty())
+    return;
+
+  mMatrices.resize(mInstances.size());
+  for(int i=0; i<instanceCount(); ++i)
+  {
+    const GLdouble* m = mInstances[i]->localToWorldMatrix(render_stream).ptr();
+    GLfloat* f = mMatrices[i].ptr();
+    for(int j=0; j<16; ++j)
+      f[j] = (GLfloat)m[j];
+  }
+
+  GLint location = instanceMatrixLocation(render_stream);
+  if (location != -1)
+  {
+    for(int first=0; first<instanceCount(); first+=mMaxInstancesPerDraw)
+    {
+      int count = instanceCount() - first;
+      if (count > mMaxInstancesPerDraw)
+        count = mMaxInstancesPerDraw;
+      glUniformMatrix4fv(location, count, GL_FALSE, mMatrices[first].ptr());
+      mGeometry->setInstances(count);
+      mGeometry->draw(actor, render_stream, tex_units);
+    }
+    mGeometry->setInstances(1);
+  }
+  else
+  {
+    glMatrixMode(GL_MODELVIEW);
+    for(int i=0; i<instanceCount(); ++i)
+    {
+      glPushMatrix();
+      glMultMatrixf(mMatrices[i].ptr());
+      mGeometry->draw(actor, render_stream, tex_units);
+      glPopMatrix();
+    }
+  }
+  GLCHECK4()
+}
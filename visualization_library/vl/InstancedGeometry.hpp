@@ -0,0 +1,82 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef InstancedGeometry_INCLUDE_DEFINE
+#define InstancedGeometry_INCLUDE_DEFINE
+
+#include "vl/Geometry.hpp"
+#include "vl/Transform.hpp"
+#include "vl/GLSL.hpp"
+#include "vl/mat4.hpp"
+#include <vector>
+
+namespace vl
+{
+
+  /*!
+    Draws one Geometry once per instance Transform.
+
+    When GL_EXT_draw_instanced is available and the current GLSL program
+    declares "uniform mat4 vl_InstanceMatrix[N]" the instance matrices are
+    uploaded in batches of maxInstancesPerDraw() and each batch is drawn
+    with one instanced draw call, the vertex shader picks its matrix with
+    gl_InstanceID. Otherwise every instance is drawn with its matrix
+    multiplied onto the modelview matrix.
+
+    The instance matrices are local to world, so the Actor drawing this
+    should have no Transform. Call setAABBDirty(true) after moving the
+    instances.
+  */
+  class InstancedGeometry: public Drawable
+  {
+  public:
+    InstancedGeometry(Geometry* geometry = NULL);
+
+    virtual void computeAABB();
+
+    virtual void draw(Actor* actor, int render_stream, unsigned int tex_units);
+
+    void setGeometry(Geometry* geometry) { mGeometry = geometry; setAABBDirty(true); }
+    Geometry* geometry() { return mGeometry.get(); }
+
+    void addInstance(Transform* transform) { mInstances.push_back(transform); setAABBDirty(true); }
+    void removeAllInstances() { mInstances.clear(); setAABBDirty(true); }
+    Transform* instance(int i) { return mInstances[i].get(); }
+    int instanceCount() const { return (int)mInstances.size(); }
+
+    //! Must match the size of the vl_InstanceMatrix array in the vertex shader
+    void setMaxInstancesPerDraw(int count) { mMaxInstancesPerDraw = count; }
+    int maxInstancesPerDraw() const { return mMaxInstancesPerDraw; }
+
+  protected:
+    GLint instanceMatrixLocation(int render_stream);
+
+    ref<Geometry> mGeometry;
+    std::vector< ref<Transform> > mInstances;
+    std::vector<mat4> mMatrices;
+    int mMaxInstancesPerDraw;
+    // the location is valid for this program as long as it isn't linked again
+    ref<GLSLProgram> mProgram;
+    int mProgramLinkCount;
+    GLint mLocation;
+  };
+
+}
+
+#endif
@@ -26,19 +26,8 @@ void KdTreeCuller::executeCulling()
   CHECK(mActorList)
   mActorList->clear();
 
-  for (int i=0; i<(int)mDynamicActorList.size(); i++)
-  {
-    AABB taabb;
-    if ( mDynamicActorList[i]->transform() ) 
-      mDynamicActorList[i]->drawable(0)->aabb().transformed( taabb, mDynamicActorList[i]->transform()->localToWorldMatrix( camera()->renderStream() ) );
-    else
-      taabb = mDynamicActorList[i]->drawable(0)->aabb();
-
-    if ( camera()->frustumCull(taabb) == false )
-    {
-      mActorList->push_back(mDynamicActorList[i]);
-    }
-  }
+  mDynamicBVH->update( camera()->renderStream() );
+  cullDynamicBVH(mDynamicBVH.get());
 
   cullKdTree(mKdTree.get());
 
@@ -60,6 +49,38 @@ void KdTreeCuller::cullKdTree(KdTree* tree)
   }
 }
 
+void KdTreeCuller::cullDynamicBVH(DynamicBVH* bvh)
+{
+  if (!bvh->nodeCount())
+    return;
+
+  mNodeStack.clear();
+  mNodeStack.push_back(0);
+  while( !mNodeStack.empty() )
+  {
+    const DynamicBVH::Node& node = bvh->node( mNodeStack.back() );
+    mNodeStack.pop_back();
+
+    if ( camera()->frustumCull( node.mAABB ) )
+      continue;
+
+    if (node.mChild >= 0)
+    {
+      mNodeStack.push_back(node.mChild+1);
+      mNodeStack.push_back(node.mChild);
+    }
+    else
+    if (node.mActorCount == 1)
+      mActorList->push_back( bvh->actor(node.mFirstActor) );
+    else
+    {
+      for(int i=node.mFirstActor; i<node.mFirstActor+node.mActorCount; i++)
+        if ( camera()->frustumCull( bvh->actorAABB(i) ) == false )
+          mActorList->push_back( bvh->actor(i) );
+    }
+  }
+}
+
 void KdTreeCuller::clearDynamicActors()
 {
   mDynamicActors.clear();
@@ -166,5 +187,8 @@ void KdTreeCuller::prepareForCulling()
   }
 
   mKdTree->compileTree(mCamera->renderStream(), actors, mMaxDepth, mLimitVolume);
+
+  mDynamicBVH->setActors(mDynamicActorList);
+  mDynamicBVH->compileTree(mCamera->renderStream());
 }
 
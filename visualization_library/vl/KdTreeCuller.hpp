@@ -21,6 +21,7 @@
 #define KdTreeCuller_INCLUDE_DEFINE
 
 #include "vl/KdTree.hpp"
+#include "vl/DynamicBVH.hpp"
 #include "vl/Culler.hpp"
 #include "vl/Camera.hpp"
 #include "vl/ObjectVector.hpp"
@@ -28,15 +29,19 @@
 namespace vl
 {
 
+  //! Culls the static actors with a KdTree and the dynamic ones with a DynamicBVH, which is
+  //! refitted to the moving actors at every culling.
   class KdTreeCuller: public Culler
   {
   public:
-    KdTreeCuller(): mKdTree(new KdTree), mMaxDepth(100), mLimitVolume(0) { }
+    KdTreeCuller(): mKdTree(new KdTree), mDynamicBVH(new DynamicBVH), mMaxDepth(100), mLimitVolume(0) { }
 
     void executeCulling();
 
     void cullKdTree(KdTree* tree);
 
+    void cullDynamicBVH(DynamicBVH* bvh);
+
     void clearDynamicActors();
 
     void addDynamicActors(const std::vector< Actor* >& actors );
@@ -70,12 +75,16 @@ namespace vl
 
     KdTree* kdtree() { return mKdTree.get(); }
 
+    DynamicBVH* dynamicBVH() { return mDynamicBVH.get(); }
+
   protected:
     std::set< ref<Actor> > mStaticActors;
     std::set< ref<Actor> > mDynamicActors;
     std::vector< ref<Actor> > mDynamicActorList;
     ref<KdTree> mKdTree;
+    ref<DynamicBVH> mDynamicBVH;
     ref< ActorList > mActorList;
+    std::vector<int> mNodeStack;
     int mMaxDepth;
     float mLimitVolume;
   };
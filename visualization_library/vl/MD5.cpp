@@ -176,13 +176,12 @@ namespace
 
 namespace vl
 {
-  void MD5(const char *string, unsigned char sum[33])
+  void MD5(const void *data, unsigned int len, unsigned char sum[33])
   {
     Ctx context;
     unsigned char digest[16];
-    unsigned int len = (int)strlen (string);
    
-    update(&context, (unsigned char*)string, len);
+    update(&context, (unsigned char*)data, len);
     unsigned char bits[8];
     unsigned int index, padLen;
 
@@ -204,4 +203,9 @@ namespace vl
       digest[0], digest[1], digest[2],  digest[3],  digest[4],  digest[5],  digest[6],  digest[7],
       digest[8], digest[9], digest[10], digest[11], digest[12], digest[13], digest[14], digest[15] );
   }
+
+  void MD5(const char *string, unsigned char sum[33])
+  {
+    MD5(string, (unsigned int)strlen(string), sum);
+  }
 }
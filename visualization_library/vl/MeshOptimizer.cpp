@@ -0,0 +1,388 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "vl/MeshOptimizer.hpp"
+#include <cmath>
+#include <cstring>
+
+using namespace vl;
+
+namespace
+{
+  // Forsyth's scoring: the size of the modelled LRU cache and the weights of
+  // the cache position and of the number of triangles still using a vertex
+  const int   CacheSize = 32;
+  const float CacheDecayPower = 1.5f;
+  const float LastTriScore = 0.75f;
+  const float ValenceBoostScale = 2.0f;
+  const float ValenceBoostPower = 0.5f;
+  const int   MaxValence = 32;
+
+  class VertexScore
+  {
+  public:
+    VertexScore()
+    {
+      for(int i=0; i<CacheSize; i++)
+      {
+        if (i < 3)
+          mCacheScore[i] = LastTriScore;
+        else
+          mCacheScore[i] = pow(1.0f - (i-3) * (1.0f / (CacheSize-3)), CacheDecayPower);
+      }
+      mValenceScore[0] = 0;
+      for(int i=1; i<=MaxValence; i++)
+        mValenceScore[i] = ValenceBoostScale * pow((float)i, -ValenceBoostPower);
+    }
+
+    float operator()(int cache_pos, int remaining) const
+    {
+      if (remaining == 0)
+        return -1.0f;
+      float score = cache_pos < 0 ? 0.0f : mCacheScore[cache_pos];
+      if (remaining <= MaxValence)
+        score += mValenceScore[remaining];
+      else
+        score += ValenceBoostScale * pow((float)remaining, -ValenceBoostPower);
+      return score;
+    }
+
+  protected:
+    float mCacheScore[CacheSize];
+    float mValenceScore[MaxValence+1];
+  };
+
+  unsigned int hashBytes(unsigned int hash, const unsigned char* data, int count)
+  {
+    // FNV-1a
+    for(int i=0; i<count; i++)
+      hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+  }
+}
+
+float MeshOptimizer::computeACMR(const GLuint* indices, int index_count, int vertex_count, int cache_size)
+{
+  if (index_count < 3)
+    return 0;
+  // a vertex is still in the FIFO if less than cache_size misses happened since it entered it
+  std::vector<int> stamp(vertex_count, -1);
+  int misses = 0;
+  for(int i=0; i<index_count; i++)
+  {
+    int& s = stamp[indices[i]];
+    if (s < 0 || misses - s > cache_size)
+      s = misses++;
+  }
+  return (float)misses / (index_count / 3);
+}
+
+void MeshOptimizer::collectArrays(Geometry* geom, std::vector<GPUBuffer*>& arrays)
+{
+  GPUBuffer* buffers[] = { geom->vertexArray(), geom->normalArray(), geom->colorArray(), geom->secondaryColorArray(), geom->fogCoordArray() };
+  for(int i=0; i<(int)(sizeof(buffers)/sizeof(buffers[0])); i++)
+    if (buffers[i])
+      arrays.push_back(buffers[i]);
+  for(int i=0; i<MAX_TEXTURE_UNITS; i++)
+    if (geom->texCoordArray(i))
+      arrays.push_back(geom->texCoordArray(i));
+  for(int i=0; i<geom->vertexAttribInfoCount(); i++)
+    if (geom->vertexAttribInfo(i).mData)
+      arrays.push_back(geom->vertexAttribInfo(i).mData.get());
+}
+
+int MeshOptimizer::weldVertices(Geometry* geom, std::vector<GLuint>& remap)
+{
+  std::vector<GPUBuffer*> arrays;
+  collectArrays(geom, arrays);
+  int vertex_count = geom->vertexArray()->size();
+
+  std::vector<const unsigned char*> data;
+  std::vector<int> stride;
+  for(int i=0; i<(int)arrays.size(); i++)
+  {
+    data.push_back( (const unsigned char*)arrays[i]->localBufferVoidPtr() );
+    stride.push_back( arrays[i]->localBufferBytes() / vertex_count );
+  }
+
+  // open addressing hash table of the first vertex of every set of identical ones
+  int table_size = 1;
+  while(table_size < vertex_count*2)
+    table_size <<= 1;
+  std::vector<int> table(table_size, -1);
+  std::vector<unsigned int> hash(vertex_count);
+
+  remap.resize(vertex_count);
+  int unique_count = 0;
+  for(int v=0; v<vertex_count; v++)
+  {
+    unsigned int h = 2166136261u;
+    for(int a=0; a<(int)arrays.size(); a++)
+      h = hashBytes(h, data[a] + v*stride[a], stride[a]);
+    hash[v] = h;
+
+    int slot = h & (table_size-1);
+    for(; table[slot] != -1; slot = (slot+1) & (table_size-1))
+    {
+      int w = table[slot];
+      if (hash[w] != h)
+        continue;
+      bool equal = true;
+      for(int a=0; a<(int)arrays.size() && equal; a++)
+        equal = memcmp(data[a] + v*stride[a], data[a] + w*stride[a], stride[a]) == 0;
+      if (equal)
+        break;
+    }
+
+    if (table[slot] == -1)
+    {
+      table[slot] = v;
+      remap[v] = unique_count++;
+    }
+    else
+      remap[v] = remap[table[slot]];
+  }
+  return unique_count;
+}
+
+void MeshOptimizer::reorderTriangles(GLuint* indices, int index_count, int vertex_count)
+{
+  static const VertexScore vertex_score;
+  int tri_count = index_count / 3;
+  if (tri_count < 2)
+    return;
+
+  // triangles using each vertex, the ones not emitted yet are kept at the front of the list
+  std::vector<int> remaining(vertex_count, 0);
+  for(int i=0; i<index_count; i++)
+    remaining[indices[i]]++;
+  std::vector<int> offset(vertex_count+1, 0);
+  for(int v=0; v<vertex_count; v++)
+    offset[v+1] = offset[v] + remaining[v];
+  std::vector<int> adjacency(index_count);
+  std::vector<int> fill(offset.begin(), offset.end()-1);
+  for(int i=0; i<index_count; i++)
+    adjacency[fill[indices[i]]++] = i / 3;
+
+  std::vector<int> cache_pos(vertex_count, -1);
+  std::vector<float> score(vertex_count);
+  for(int v=0; v<vertex_count; v++)
+    score[v] = vertex_score(-1, remaining[v]);
+
+  std::vector<float> tri_score(tri_count);
+  std::vector<bool> emitted(tri_count, false);
+  int best = 0;
+  for(int t=0; t<tri_count; t++)
+  {
+    tri_score[t] = score[indices[t*3+0]] + score[indices[t*3+1]] + score[indices[t*3+2]];
+    if (tri_score[t] > tri_score[best])
+      best = t;
+  }
+
+  std::vector<GLuint> output;
+  output.reserve(index_count);
+  int cache[CacheSize+3];
+  int cache_count = 0;
+  int cursor = 0;
+
+  while((int)output.size() < index_count)
+  {
+    // nothing in the cache is usable, restart from the first triangle left
+    if (best < 0)
+    {
+      while(emitted[cursor])
+        cursor++;
+      best = cursor;
+    }
+
+    int t = best;
+    emitted[t] = true;
+    int new_cache[CacheSize+3];
+    int new_count = 0;
+    for(int k=0; k<3; k++)
+    {
+      int v = indices[t*3+k];
+      output.push_back(v);
+
+      int* tris = &adjacency[offset[v]];
+      for(int j=0; j<remaining[v]; j++)
+      {
+        if (tris[j] == t)
+        {
+          tris[j] = tris[remaining[v]-1];
+          break;
+        }
+      }
+      remaining[v]--;
+
+      bool present = false;
+      for(int j=0; j<new_count; j++)
+        present |= new_cache[j] == v;
+      if (!present)
+        new_cache[new_count++] = v;
+    }
+
+    // LRU update: the vertices of the emitted triangle move to the front
+    for(int i=0; i<cache_count; i++)
+    {
+      int v = cache[i];
+      if (v != (int)indices[t*3+0] && v != (int)indices[t*3+1] && v != (int)indices[t*3+2])
+        new_cache[new_count++] = v;
+    }
+
+    // rescore the vertices whose cache position changed and their triangles
+    for(int i=0; i<new_count; i++)
+    {
+      int v = new_cache[i];
+      int pos = i < CacheSize ? i : -1;
+      cache_pos[v] = pos;
+      float new_score = vertex_score(pos, remaining[v]);
+      float delta = new_score - score[v];
+      score[v] = new_score;
+      for(int j=0; j<remaining[v]; j++)
+        tri_score[adjacency[offset[v]+j]] += delta;
+    }
+
+    cache_count = new_count < CacheSize ? new_count : CacheSize;
+    memcpy(cache, new_cache, cache_count*sizeof(int));
+
+    // the next triangle is the best one touching the cache
+    best = -1;
+    float best_score = -1.0f;
+    for(int i=0; i<cache_count; i++)
+    {
+      int v = cache[i];
+      for(int j=0; j<remaining[v]; j++)
+      {
+        int tri = adjacency[offset[v]+j];
+        if (tri_score[tri] > best_score)
+        {
+          best_score = tri_score[tri];
+          best = tri;
+        }
+      }
+    }
+  }
+
+  memcpy(indices, &output[0], index_count*sizeof(GLuint));
+}
+
+void MeshOptimizer::remapArrays(Geometry* geom, const std::vector<GLuint>& remap, int new_vertex_count)
+{
+  std::vector<GPUBuffer*> arrays;
+  collectArrays(geom, arrays);
+  int vertex_count = (int)remap.size();
+
+  std::vector<unsigned char> old_data;
+  for(int a=0; a<(int)arrays.size(); a++)
+  {
+    int stride = arrays[a]->localBufferBytes() / vertex_count;
+    const unsigned char* src = (const unsigned char*)arrays[a]->localBufferVoidPtr();
+    old_data.assign(src, src + vertex_count*stride);
+    arrays[a]->resize(new_vertex_count);
+    unsigned char* dst = (unsigned char*)arrays[a]->localBufferVoidPtr();
+    for(int v=0; v<vertex_count; v++)
+      memcpy(dst + remap[v]*stride, &old_data[v*stride], stride);
+  }
+
+  for(int i=0; i<geom->drawCallCount(); i++)
+  {
+    DrawElementsUInt* de = static_cast<DrawElementsUInt*>(geom->drawCall(i));
+    GLuint* idx = de->localPtr();
+    for(int j=0; j<de->indexCount(); j++)
+      idx[j] = remap[idx[j]];
+  }
+}
+
+bool MeshOptimizer::optimize(Geometry* geom)
+{
+  if (!geom->vertexArray() || geom->vertexArray()->size() == 0)
+    return false;
+  int vertex_count = geom->vertexArray()->size();
+
+  std::vector<GPUBuffer*> arrays;
+  collectArrays(geom, arrays);
+  for(int a=0; a<(int)arrays.size(); a++)
+  {
+    if (arrays[a]->size() != vertex_count || !arrays[a]->localBufferVoidPtr())
+      return false;
+  }
+
+  int tri_count = 0;
+  for(int i=0; i<geom->drawCallCount(); i++)
+  {
+    DrawElementsUInt* de = dynamic_cast<DrawElementsUInt*>(geom->drawCall(i));
+    if (!de || de->primitiveType() != PT_TRIANGLES || de->indexCount() % 3)
+      return false;
+    for(int j=0; j<de->indexCount(); j++)
+      if ((int)de->index(j) >= vertex_count)
+        return false;
+    tri_count += de->indexCount() / 3;
+  }
+  if (tri_count == 0)
+    return false;
+
+  mVertexCountBefore = vertex_count;
+  mACMRBefore = 0;
+  for(int i=0; i<geom->drawCallCount(); i++)
+  {
+    DrawElementsUInt* de = static_cast<DrawElementsUInt*>(geom->drawCall(i));
+    mACMRBefore += computeACMR(de->localPtr(), de->indexCount(), vertex_count, mCacheSize) * de->indexCount() / 3;
+  }
+  mACMRBefore /= tri_count;
+
+  std::vector<GLuint> remap;
+  int unique_count = weldVertices(geom, remap);
+  if (unique_count != vertex_count)
+    remapArrays(geom, remap, unique_count);
+  vertex_count = unique_count;
+
+  for(int i=0; i<geom->drawCallCount(); i++)
+  {
+    DrawElementsUInt* de = static_cast<DrawElementsUInt*>(geom->drawCall(i));
+    reorderTriangles(de->localPtr(), de->indexCount(), vertex_count);
+  }
+
+  // vertices in order of first use, the unused ones go last
+  remap.assign(vertex_count, (GLuint)-1);
+  int next = 0;
+  for(int i=0; i<geom->drawCallCount(); i++)
+  {
+    DrawElementsUInt* de = static_cast<DrawElementsUInt*>(geom->drawCall(i));
+    const GLuint* idx = de->localPtr();
+    for(int j=0; j<de->indexCount(); j++)
+      if (remap[idx[j]] == (GLuint)-1)
+        remap[idx[j]] = next++;
+  }
+  for(int v=0; v<vertex_count; v++)
+    if (remap[v] == (GLuint)-1)
+      remap[v] = next++;
+  remapArrays(geom, remap, vertex_count);
+
+  mVertexCountAfter = vertex_count;
+  mACMRAfter = 0;
+  for(int i=0; i<geom->drawCallCount(); i++)
+  {
+    DrawElementsUInt* de = static_cast<DrawElementsUInt*>(geom->drawCall(i));
+    mACMRAfter += computeACMR(de->localPtr(), de->indexCount(), vertex_count, mCacheSize) * de->indexCount() / 3;
+  }
+  mACMRAfter /= tri_count;
+  return true;
+}
@@ -0,0 +1,81 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MeshOptimizer_INCLUDE_DEFINE
+#define MeshOptimizer_INCLUDE_DEFINE
+
+#include "vl/Geometry.hpp"
+#include <vector>
+
+namespace vl
+{
+
+  /*!
+    Load time optimization of indexed triangle meshes.
+
+    optimize() welds the vertices whose attributes are identical in all the
+    arrays of the Geometry, reorders the triangles of every draw call for the
+    post-transform vertex cache (Tom Forsyth's "Linear-Speed Vertex Cache
+    Optimisation") and renumbers the vertices in the order they are first
+    used, so that vertex fetches walk the arrays forward.
+
+    Only geometries whose draw calls are all DrawElementsUInt of PT_TRIANGLES
+    are optimized. Call it before the GPU buffers are created, the local
+    buffers are rewritten in place.
+  */
+  class MeshOptimizer: public Object
+  {
+  public:
+    MeshOptimizer(): mCacheSize(16), mVertexCountBefore(0), mVertexCountAfter(0), mACMRBefore(0), mACMRAfter(0) {}
+
+    //! Returns false if the geometry can't be optimized, in that case it is left untouched
+    bool optimize(Geometry* geom);
+
+    //! Size of the FIFO vertex cache used to measure the ACMR
+    void setCacheSize(int size) { mCacheSize = size; }
+    int cacheSize() const { return mCacheSize; }
+
+    int vertexCountBefore() const { return mVertexCountBefore; }
+    int vertexCountAfter() const { return mVertexCountAfter; }
+
+    //! Average cache miss ratio, transformed vertices per triangle, of the last optimize()
+    float acmrBefore() const { return mACMRBefore; }
+    float acmrAfter() const { return mACMRAfter; }
+
+    //! Transformed vertices per triangle with a FIFO vertex cache of \p cache_size entries
+    static float computeACMR(const GLuint* indices, int index_count, int vertex_count, int cache_size);
+
+  protected:
+    int weldVertices(Geometry* geom, std::vector<GLuint>& remap);
+    void reorderTriangles(GLuint* indices, int index_count, int vertex_count);
+    void remapArrays(Geometry* geom, const std::vector<GLuint>& remap, int new_vertex_count);
+    void collectArrays(Geometry* geom, std::vector<GPUBuffer*>& arrays);
+
+  protected:
+    int mCacheSize;
+    int mVertexCountBefore;
+    int mVertexCountAfter;
+    float mACMRBefore;
+    float mACMRAfter;
+  };
+
+}
+
+#endif
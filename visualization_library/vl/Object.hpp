@@ -28,6 +28,10 @@
 #include <set>
 #endif
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #include <string>
 
 namespace vl
@@ -72,14 +76,41 @@ namespace vl
 
   inline void ref_add_ref(Object * p)
   {
-    p->mRefCount++;
+    if (THREAD_SAFE_REF_COUNT)
+    {
+      // a new reference is made from an existing one, which keeps the object alive
+#if defined(_MSC_VER)
+      _InterlockedIncrement( (long*)&p->mRefCount );
+#else
+      __atomic_fetch_add( &p->mRefCount, 1, __ATOMIC_RELAXED );
+#endif
+    }
+    else
+      p->mRefCount++;
   }
 
   inline void ref_release(Object * p)
   {
-   p->mRefCount --;
-   if (p->mRefCount == 0)
-     delete p;
+    if (THREAD_SAFE_REF_COUNT)
+    {
+      // the last release must see the writes made to the object through the other references
+#if defined(_MSC_VER)
+      if ( _InterlockedDecrement( (long*)&p->mRefCount ) == 0 )
+        delete p;
+#else
+      if ( __atomic_fetch_sub( &p->mRefCount, 1, __ATOMIC_RELEASE ) == 1 )
+      {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        delete p;
+      }
+#endif
+    }
+    else
+    {
+      p->mRefCount--;
+      if (p->mRefCount == 0)
+        delete p;
+    }
   }
 
   void visualization_library_init();
@@ -24,9 +24,90 @@
 #include "vl/OpenGL.hpp"
 #include "vl/GlobalState.hpp"
 #include "vl/Time.hpp"
+#include "vl/Trace.hpp"
+#include <algorithm>
 
 using namespace vl;
 
+namespace
+{
+  // actor chunks are a multiple of 32 so that each chunk owns whole words of the visibility mask
+  const int ActorChunkSize = 256;
+  const int TokenChunkSize = 1024;
+
+  class ChunkTask: public ThreadTask
+  {
+  public:
+    typedef void (RenderListCompiler::*Method)(int chunk);
+    ChunkTask(RenderListCompiler* compiler, Method method): mCompiler(compiler), mMethod(method) {}
+    virtual void run(int index)
+    {
+      TraceZone zone("RenderListCompiler chunk", "render");
+      (mCompiler->*mMethod)(index);
+    }
+
+  protected:
+    RenderListCompiler* mCompiler;
+    Method mMethod;
+  };
+}
+
+void RenderList::sort()
+{
+  CHECK(mTokenSorter);
+  if (mTokenSorter->usesSortKey())
+    radixSort();
+  else
+    std::sort( List.begin(), List.end(), Sorter(mTokenSorter.get()) );
+}
+
+void RenderList::radixSort()
+{
+  int count = (int)List.size();
+  if (count < 2)
+    return;
+
+  mKeys.resize(count);
+  mKeysTmp.resize(count);
+  unsigned long long all_or = 0, all_and = ~0ULL;
+  for(int i=0; i<count; ++i)
+  {
+    mKeys[i].mKey = List[i].mSortKey;
+    mKeys[i].mIndex = i;
+    all_or  |= List[i].mSortKey;
+    all_and &= List[i].mSortKey;
+  }
+
+  // stable LSD sort one byte at a time, the bytes that are equal in all the keys are skipped
+  KeyIndex* src = &mKeys[0];
+  KeyIndex* dst = &mKeysTmp[0];
+  for(int shift=0; shift<64; shift+=8)
+  {
+    if ( ((all_or ^ all_and) >> shift & 0xFF) == 0 )
+      continue;
+
+    int offset[256];
+    memset(offset, 0, sizeof(offset));
+    for(int i=0; i<count; ++i)
+      ++offset[src[i].mKey >> shift & 0xFF];
+    for(int b=0, sum=0; b<256; ++b)
+    {
+      int c = offset[b];
+      offset[b] = sum;
+      sum += c;
+    }
+    for(int i=0; i<count; ++i)
+      dst[ offset[src[i].mKey >> shift & 0xFF]++ ] = src[i];
+
+    KeyIndex* tmp = src; src = dst; dst = tmp;
+  }
+
+  mSorted.resize(count);
+  for(int i=0; i<count; ++i)
+    mSorted[i] = List[ src[i].mIndex ];
+  List.swap(mSorted);
+}
+
 RenderListCompiler::RenderListCompiler()
 {
   mFrustumCullingEnabled = true;
@@ -38,11 +119,14 @@ RenderListCompiler::RenderListCompiler()
 
   mDefaultTokenSorter = new RenderListSorterLazy;
 
+  mBatchCuller = new BatchCuller;
+
   mMarkMode = DisableMarkedLists;
 }
 
 void RenderListCompiler::compileRenderLists()
 {
+  TraceZone zone("RenderListCompiler::compileRenderLists", "render");
   CHECK( camera() );
   CHECK( scede() );
   CHECK( mActorList );
@@ -74,6 +158,7 @@ void RenderListCompiler::compileRenderLists()
   compileRenderListsFromActorList();
 
   std::vector<float> unused_list;
+  mSortedLists.clear();
   for(it = mRenderListSet.begin(); it!=mRenderListSet.end(); it++) 
   {
     if ( it->second->empty() )
@@ -81,12 +166,16 @@ void RenderListCompiler::compileRenderLists()
     else 
     {
       CHECK(it->second->listSorter())
+      mSortedLists.push_back( it->second.get() );
+    }
+  }
 
-      it->second->sort(); // sort the render token 
+  runChunks( &RenderListCompiler::sortListChunk, (int)mSortedLists.size() ); // sort the render token 
 
-      if ( renderListSorter(it->first) == NULL )
-        it->second->setListSorter(NULL);
-    }
+  for(it = mRenderListSet.begin(); it!=mRenderListSet.end(); it++) 
+  {
+    if ( !it->second->empty() && renderListSorter(it->first) == NULL )
+      it->second->setListSorter(NULL);
   }
 
   for(int i=0; i<(int)unused_list.size(); i++)
@@ -135,6 +224,89 @@ void RenderListCompiler::extractActorList(ShaderNode* scede)
       mActorList->push_back(painter->actor(i));
 }
 
+void RenderListCompiler::setThreadCount(int count)
+{
+  if (count <= 0)
+    count = ThreadPool::cpuCount();
+  if (count == threadCount())
+    return;
+  mThreadPool = count > 1 ? new ThreadPool(count) : NULL;
+}
+
+void RenderListCompiler::runChunks(ChunkMethod method, int count)
+{
+  ChunkTask task(this, method);
+  if (mThreadPool)
+    mThreadPool->run(&task, count);
+  else
+  {
+    for(int i=0; i<count; ++i)
+      task.run(i);
+  }
+}
+
+void RenderListCompiler::evaluateActorChunk(int chunk)
+{
+  int begin = chunk * ActorChunkSize;
+  int end = std::min( begin + ActorChunkSize, mActorList->size() );
+
+  if ( frustumCullingEnabled() )
+  {
+    for(int iactor=begin; iactor<end; iactor++)
+    {
+      Actor* actor = mActorList->element( iactor ).get();
+      if ( !actor->enabled() )
+        continue;
+      if ( actor->transform() ) 
+        mBatchCuller->setAABB( iactor, actor->drawable()->aabb(), actor->transform()->localToWorldMatrix( camera()->renderStream() ) );
+      else
+        mBatchCuller->setAABB( iactor, actor->drawable()->aabb() );
+    }
+    mBatchCuller->cull( camera()->frustum(), begin, end );
+  }
+
+  for(int iactor=begin; iactor<end; iactor++)
+  {
+    Actor* actor = mActorList->element( iactor ).get();
+    if ( !actor->enabled() || ( frustumCullingEnabled() && !mBatchCuller->isVisible(iactor) ) )
+      continue;
+
+    Painter* painter = actor->painter();
+    if ( painter->lodEvaluator() )
+      mPainterLOD[iactor] = painter->lodEvaluator()->evaluate( actor, camera() );
+
+    if ( evaluateLOD() )
+      mActorLOD[iactor] = actor->lodEvaluator() ? actor->lodEvaluator()->evaluate( actor, camera() ) : 0;
+  }
+}
+
+void RenderListCompiler::sortKeyChunk(int chunk)
+{
+  const TokenChunk& c = mTokenChunks[chunk];
+  RenderListSorter* sorter = c.mList->listSorter();
+  for(int i=0; i<c.mCount; i++)
+  {
+    RenderToken& tok = c.mTokens[i];
+
+    if ( sorter->requiresZCameraDistance(tok) && !tok.mActor->drawable()->aabb().isEmpty() )
+    {
+      if (tok.mActor->transform())
+        tok.mCameraDistance = ( camera()->inverseViewMatrix() * tok.mActor->transform()->localToWorldMatrix(camera()->renderStream()) * tok.mActor->drawable()->aabb().center() ).lengthSquared();
+      else
+        tok.mCameraDistance = ( camera()->inverseViewMatrix() * /* I* */ tok.mActor->drawable()->aabb().center() ).lengthSquared();
+    }
+    else
+      tok.mCameraDistance = 0;
+
+    tok.mSortKey = sorter->sortKey(tok);
+  }
+}
+
+void RenderListCompiler::sortListChunk(int list)
+{
+  mSortedLists[list]->sort();
+}
+
 void RenderListCompiler::compileRenderListsFromActorList()
 {
   double internal_time = Time::timerSeconds();
@@ -154,7 +326,27 @@ void RenderListCompiler::compileRenderListsFromActorList()
 
     listenabled = isEnabled(listname);
   }
-  
+
+  // the bounds are computed on first use, which the threads below must not race on
+  if (mThreadPool)
+  {
+    for(int iactor=0; iactor<mActorList->size(); iactor++)
+    {
+      Actor* actor = mActorList->element( iactor ).get();
+      if ( !actor->enabled() )
+        continue;
+      actor->drawable()->aabb();
+      actor->drawable(0)->aabb();
+    }
+  }
+
+  // culling and LOD selection of all the actors, the loop below reads the visibility bits and the LODs
+  if ( frustumCullingEnabled() )
+    mBatchCuller->resize( mActorList->size() );
+  mPainterLOD.resize( mActorList->size() );
+  mActorLOD.resize( mActorList->size() );
+  runChunks( &RenderListCompiler::evaluateActorChunk, (mActorList->size() + ActorChunkSize - 1) / ActorChunkSize );
+
   for(int iactor=0; iactor<mActorList->size(); iactor++)
   {
     const ref<Actor>&     actor = mActorList->element( iactor );
@@ -163,27 +355,25 @@ void RenderListCompiler::compileRenderListsFromActorList()
     if ( !actor->enabled() )
       continue;
 
-    if ( frustumCullingEnabled() )
-    {
-      AABB taabb;
-      if ( actor->transform() ) 
-        actor->drawable()->aabb().transformed( taabb, actor->transform()->localToWorldMatrix( camera()->renderStream() ) );
-      else
-        taabb = actor->drawable()->aabb();
+    if ( frustumCullingEnabled() && !mBatchCuller->isVisible(iactor) )
+      continue;
 
-      if ( camera()->frustumCull(taabb) )
-        continue;
+    if ( painter->lodEvaluator() )
+    {
+      CHECK( mPainterLOD[iactor] < painter->multipassDrawLODCount() )
+      painter->setActiveLOD( mPainterLOD[iactor] );
     }
 
-    painter->evaluateLOD( mActorList->element( iactor ).get(), camera() );
-
     painter->setupShaders( camera(), shaderAnimationEnabled() ? updateTime() : -1, internal_time );
 
     if (painter->finalEnabled() == false)
       continue;
 
     if ( evaluateLOD() )
-      actor->evaluateLOD(camera());
+    {
+      actor->setActiveLOD( mActorLOD[iactor] );
+      CHECK( actor->drawable() )
+    }
 
     if ( actorAnimationEnabled() )
     {
@@ -225,7 +415,7 @@ void RenderListCompiler::compileRenderListsFromActorList()
     int pass_count = painter->multipassDrawLODCount() ? painter->multipassDrawLOD()->passCount() : 1;
     ref<Shader> final_shader = painter->finalShader();
 
-    ref<RenderToken> prev_pass = NULL;
+    RenderToken* prev_pass = NULL;
     for(int ipass=0; ipass<pass_count; ipass++)
     {
 
@@ -236,16 +426,16 @@ void RenderListCompiler::compileRenderListsFromActorList()
         CHECK(pass_count == 1)
       }
 
-      RenderToken& tok = list->newToken(prev_pass != NULL);
-
+      // linked before adding the token, which can move the previous one
       if ( prev_pass != NULL )
-        prev_pass->mNextPass = &tok;
+        prev_pass->mNextPass = list->nextMultipassIndex();
+
+      RenderToken& tok = list->newToken(prev_pass != NULL);
       prev_pass = &tok;
-      tok.mNextPass = NULL;
 
-      tok.mActor = actor;
+      tok.mActor = actor.get();
 
-      tok.mShader = final_shader;
+      tok.mShader = final_shader.get();
 
       tok.mLightCount = tok.mShader->isEnabled(EN_LIGHTING) ? tok.mShader->lightCount() : 0;
 
@@ -255,18 +445,32 @@ void RenderListCompiler::compileRenderListsFromActorList()
       }
 
       tok.mPlaneCount = tok.mShader->planeCount();
+	  }
 
-      if ( list->listSorter()->requiresZCameraDistance(tok) && !tok.mActor->drawable()->aabb().isEmpty() )
+    // the sort keys read the bounds of the active LOD
+    if (mThreadPool)
+      actor->drawable()->aabb();
+  }
+
+  // camera distances and sort keys of all the tokens
+  mTokenChunks.clear();
+  for(TRenderListMap::iterator it = mRenderListSet.begin(); it != mRenderListSet.end(); ++it)
+  {
+    RenderList* rlist = it->second.get();
+    std::vector<RenderToken>* tokens[] = { &rlist->List, &rlist->MultipassList };
+    for(int t=0; t<2; t++)
+    {
+      for(int i=0; i<(int)tokens[t]->size(); i+=TokenChunkSize)
       {
-        if (tok.mActor->transform())
-          tok.mCameraDistance = ( camera()->inverseViewMatrix() * tok.mActor->transform()->localToWorldMatrix(camera()->renderStream()) * tok.mActor->drawable()->aabb().center() ).lengthSquared();
-        else
-          tok.mCameraDistance = ( camera()->inverseViewMatrix() * /* I* */ tok.mActor->drawable()->aabb().center() ).lengthSquared();
+        TokenChunk c;
+        c.mList = rlist;
+        c.mTokens = &(*tokens[t])[i];
+        c.mCount = std::min( TokenChunkSize, (int)tokens[t]->size() - i );
+        mTokenChunks.push_back(c);
       }
-      else
-        tok.mCameraDistance = 0;
-	  }
+    }
   }
+  runChunks( &RenderListCompiler::sortKeyChunk, (int)mTokenChunks.size() );
 }
 
 Renderer::Renderer() 
@@ -279,8 +483,12 @@ Renderer::Renderer()
 
 void Renderer::draw(const TRenderListMap * renderlist)
 {
+  TraceZone zone("Renderer::draw", "render");
   GLCHECK4()
 
+  RenderStats& stats = GlobalState::renderStream( camera()->renderStream() )->stats();
+  stats.reset();
+
   GlobalState::renderStream( camera()->renderStream() )->currentShader()->reset();
 
   GlobalState::renderStream( camera()->renderStream() )->defaultShader()->applyShader( camera()->renderStream() );
@@ -288,15 +496,22 @@ void Renderer::draw(const TRenderListMap * renderlist)
   if (renderlist == NULL)
     renderlist = &mRenderListSet;
 
+  // lights and planes are switched off once here, then only the ones whose count changes are toggled
   for(int i=0; i<MAX_LIGHT_COUNT; i++)
+  {
     mActiveLights[i] = NULL;
+    glDisable(GL_LIGHT0+i);
+  }
 
-  mLightCount = MAX_LIGHT_COUNT;
+  mLightCount = 0;
 
   for(int i=0; i<MAX_CLIPPING_PLANES; i++)
+  {
     mActivePlanes[i] = NULL;
+    glDisable(GL_CLIP_PLANE0+i);
+  }
 
-  mPlaneCount = MAX_CLIPPING_PLANES;
+  mPlaneCount = 0;
 
   GLint max_tex_units = 1;
 
@@ -306,16 +521,16 @@ void Renderer::draw(const TRenderListMap * renderlist)
   GlobalState::renderStream( camera()->renderStream() )->setMaxTextureUnits( max_tex_units );
 
   TRenderListMap::const_iterator it;
-  ref<Shader> cur_shader = NULL;
+  Shader* cur_shader = NULL;
   ref<Transform> cur_transform = NULL;
   camera()->applyViewMatrix();
   for(it = renderlist->begin(); it!=renderlist->end(); it++)
   {    
     for(RenderList::iterator el = it->second->begin(); el != it->second->end(); ++el)
     {
-      ref<RenderToken> tok = *el;
+      const RenderToken* tok = &*el;
 
-      for( ; tok != NULL; tok = tok->mNextPass )
+      for( ; tok != NULL; tok = it->second->nextPass(*tok) )
       {
 
         bool pushed_matrix = false; 
@@ -323,9 +538,13 @@ void Renderer::draw(const TRenderListMap * renderlist)
         int i=0;
         for(; i<tok->mLightCount; i++)
         {
-          const ref<Shader>& fshader = tok->mShader;
+          Shader* fshader = tok->mShader;
 
-		      glEnable(GL_LIGHT0 + i);
+          if (i >= mLightCount)
+          {
+            glEnable(GL_LIGHT0 + i);
+            ++stats.mStateChanges;
+          }
 
           if ( mActiveLights[i] != fshader->light(i) )
           {
@@ -348,11 +567,15 @@ void Renderer::draw(const TRenderListMap * renderlist)
 
             fshader->light(i)->applyLight(i);
             mActiveLights[i] = fshader->light(i);
+            ++stats.mStateChanges;
           }
         }
 
         for(;i<mLightCount; i++)
+        {
           glDisable(GL_LIGHT0+i);
+          ++stats.mStateChanges;
+        }
 
         mLightCount = tok->mLightCount;
 
@@ -363,9 +586,13 @@ void Renderer::draw(const TRenderListMap * renderlist)
         i=0;
         for(; i<tok->mPlaneCount; i++)
         {
-          const ref<Shader>& fshader = tok->mShader;
+          Shader* fshader = tok->mShader;
 
-		      glEnable(GL_CLIP_PLANE0 + i);
+          if (i >= mPlaneCount)
+          {
+            glEnable(GL_CLIP_PLANE0 + i);
+            ++stats.mStateChanges;
+          }
 
           if ( mActivePlanes[i] != fshader->plane(i) )
           {
@@ -386,12 +613,14 @@ void Renderer::draw(const TRenderListMap * renderlist)
             }
             fshader->plane(i)->applyPlane(i, mat);
             mActivePlanes[i] = fshader->plane(i);
+            ++stats.mStateChanges;
           }
         }
 
         for(;i<mPlaneCount; i++)
         {
           glDisable(GL_CLIP_PLANE0+i);
+          ++stats.mStateChanges;
         }
 
         mPlaneCount = tok->mPlaneCount;
@@ -438,15 +667,24 @@ void Renderer::draw(const TRenderListMap * renderlist)
 
           if ( tok->mShader->hasGLSLProgram() && tok->mShader->glslProgram()->handle() )
           {
-            tok->mShader->glslProgram()->mSafeSetUniform = false;
+            // the uniforms can skip binding the program when the shader state says it is current
+            GLSLProgram* program = tok->mShader->glslProgram();
+            bool bound = GlobalState::renderStream( camera()->renderStream() )->currentShader()->glslProgram(false) == program && !program->needsLink();
+            program->mSafeSetUniform = !bound;
             for(int u=0; u<tok->mActor->uniformCount(); ++u)
-              tok->mActor->uniform(u)->applyToGLSLProgram( tok->mShader->glslProgram() );
-            tok->mShader->glslProgram()->mSafeSetUniform = true;
+            {
+              if ( tok->mActor->uniform(u)->applyToGLSLProgram(program) )
+                ++stats.mUniformUpdates;
+              else
+                ++stats.mUniformsSkipped;
+            }
+            program->mSafeSetUniform = true;
           }
 
           tok->mActor->prerenderCallback( camera(), tok->mShader->glslProgram(false) );
 
-          tok->mActor->drawable()->draw(tok->mActor.get(), camera()->renderStream(), tex_units); GLCHECK4()
+          tok->mActor->drawable()->draw(tok->mActor, camera()->renderStream(), tex_units); GLCHECK4()
+          ++stats.mDrawables;
         }
       }
     }
@@ -28,6 +28,8 @@
 #include "vl/Painter.hpp"
 #include "vl/ObjectVector.hpp"
 #include "vl/Actor.hpp"
+#include "vl/BatchCuller.hpp"
+#include "vl/ThreadPool.hpp"
 #include <vector>
 #include <map>
 #include <set>
@@ -37,16 +39,23 @@ namespace vl
   class RenderListSorter;
   class Camera;
 
-  class RenderToken: public Object
+  //! A single draw of an actor with one of its shaders.
+  //! Tokens are plain data stored by value in their RenderList, they don't hold references
+  //! to the actor and the shader, which are kept alive by the painters and the actor list
+  //! until the next compilation of the lists.
+  struct RenderToken
   {
-  public:
-    RenderToken(): mLightCount(0), mPlaneCount(0), mCameraDistance(0) {}
+    RenderToken(): mSortKey(0), mActor(NULL), mShader(NULL), mNextPass(-1), mLightCount(0), mPlaneCount(0), mCameraDistance(0) {}
+
+    //! Key computed by RenderListSorter::sortKey(), the tokens are drawn in increasing key order.
+    unsigned long long mSortKey;
 
-    ref<RenderToken> mNextPass;
+    Actor* mActor;
 
-    ref<Actor> mActor;
+    Shader* mShader;
 
-    ref<Shader> mShader;
+    //! Index of the next pass in RenderList::MultipassList, -1 if this is the last one.
+    int mNextPass;
 
     int mLightCount;
 
@@ -55,32 +64,59 @@ namespace vl
     double mCameraDistance;
   };
 
+  //! Defines the drawing order of the tokens of a RenderList.
+  //! The ordering is packed in a 64 bit key computed once per token by sortKey(), the list
+  //! is then sorted with a radix sort on the keys. Sorters that can't express their ordering
+  //! with a key return false from usesSortKey() and implement operator() instead.
   class RenderListSorter: public Object
   {
   public:
-    virtual bool operator()(const RenderToken& a, const RenderToken& b) = 0;
+    virtual unsigned long long sortKey(const RenderToken&) { return 0; }
+    virtual bool usesSortKey() const { return true; }
+    virtual bool operator()(const RenderToken& a, const RenderToken& b) { return a.mSortKey < b.mSortKey; }
     virtual bool requiresZCameraDistance(const RenderToken&) = 0;
+
+  protected:
+    //! Order preserving 16 bit image of a render rank. Ranks are compared with 8 bits of
+    //! mantissa, integer ranks from -256 to 256 keep their exact order.
+    static unsigned long long rankBits(float rank)
+    {
+      return orderedBits(rank) >> 16;
+    }
+
+    //! 24 bit key of a squared camera distance, far tokens get the lower keys.
+    static unsigned long long farToNearBits(double distance)
+    {
+      return (~orderedBits((float)distance) >> 8) & 0xFFFFFF;
+    }
+
+    //! Groups equal states under the same bits, two different states can collide
+    //! which costs a state change but never breaks the ordering rules above them.
+    static unsigned long long stateBits(const void* state, int bits)
+    {
+      unsigned long long h = (unsigned long long)(size_t)state >> 4;
+      h *= 0x9E3779B97F4A7C15ULL;
+      return h >> (64-bits);
+    }
+
+    static unsigned int orderedBits(float f)
+    {
+      union { float f; unsigned int u; } v;
+      v.f = f;
+      return (v.u & 0x80000000) ? ~v.u : v.u | 0x80000000;
+    }
   };
 
   class RenderTokenSortByActor: public RenderListSorter
   {
   public:
     virtual bool requiresZCameraDistance(const RenderToken&) { return false; }
-    virtual bool operator()(const RenderToken& A, const RenderToken& B)
+    virtual unsigned long long sortKey(const RenderToken& tok)
     {
-      if (A.mActor->renderRank() != B.mActor->renderRank())
-        return A.mActor->renderRank() < B.mActor->renderRank();
-      else
-
-      if (A.mShader.get() != B.mShader.get())
-        return A.mShader.get() < B.mShader.get();
-      else
-
-      if (A.mActor->painter() != B.mActor->painter())
-        return A.mActor->painter() < B.mActor->painter();
-      else
-
-        return A.mActor.get() < B.mActor.get();
+      return rankBits(tok.mActor->renderRank()) << 48 |
+             stateBits(tok.mShader, 24) << 24 |
+             stateBits(tok.mActor->painter(), 12) << 12 |
+             stateBits(tok.mActor, 12);
     }
   };
 
@@ -88,26 +124,12 @@ namespace vl
   {
   public:
     virtual bool requiresZCameraDistance(const RenderToken&) { return false; }
-    virtual bool operator()(const RenderToken& A, const RenderToken& B)
+    virtual unsigned long long sortKey(const RenderToken& tok)
     {
-
-      if (A.mActor->painter()->renderRank() != B.mActor->painter()->renderRank())
-        return A.mActor->painter()->renderRank() < B.mActor->painter()->renderRank();
-      else
-
-      if (A.mActor->renderRank() != B.mActor->renderRank())
-        return A.mActor->renderRank() < B.mActor->renderRank();
-      else
-
-      if (A.mShader.get() != B.mShader.get())
-        return A.mShader.get() < B.mShader.get();
-      else
-
-      if (A.mActor->painter() != B.mActor->painter())
-        return A.mActor->painter() < B.mActor->painter();
-      else
-
-        return A.mActor.get() < B.mActor.get();
+      return rankBits(tok.mActor->painter()->renderRank()) << 48 |
+             rankBits(tok.mActor->renderRank()) << 32 |
+             stateBits(tok.mShader, 20) << 12 |
+             stateBits(tok.mActor->painter(), 12);
     }
   };
 
@@ -116,69 +138,32 @@ namespace vl
   public:
     RenderListSorterAggressive(): mDepthSortMode(AlphaDepthSort) { }
 
-    virtual bool requiresZCameraDistance(const RenderToken& A) 
-    { return mDepthSortMode != NeverDepthSort && (mDepthSortMode == AlwaysDepthSort  || 
+    virtual bool requiresZCameraDistance(const RenderToken& A)
+    { return mDepthSortMode != NeverDepthSort && (mDepthSortMode == AlwaysDepthSort  ||
       (A.mShader->isEnabled(EN_BLEND) && (mDepthSortMode == AlphaDepthSort)) ); }
 
-    virtual bool operator()(const RenderToken& A, const RenderToken& B)
+    //! ranks (32 bits) | blend (1) | then either the camera distance (24) and the shader (7)
+    //! or depth mask (1), GLSL program (8), first texture (8), material (6), lighting (1) and shader (7).
+    virtual unsigned long long sortKey(const RenderToken& tok)
     {
-
-      if (A.mActor->painter()->renderRank() != B.mActor->painter()->renderRank())
-        return A.mActor->painter()->renderRank() < B.mActor->painter()->renderRank();
-      else
-      if (A.mActor->renderRank() != B.mActor->renderRank())
-        return A.mActor->renderRank() < B.mActor->renderRank();
-      else
-
-      if ( mDepthSortMode != AlwaysDepthSort && (A.mShader->isEnabled(EN_BLEND) != B.mShader->isEnabled(EN_BLEND)))
-      {
-        return !A.mShader->isEnabled(EN_BLEND); // first draw opaque objects
-      }
-      else // A/B.mShader->isEnabled(OGL_BLEND) are equal or AlwaysDepthSort
-      if ( requiresZCameraDistance(A) )
-      {
-        return A.mCameraDistance > B.mCameraDistance; // draw first far objects then the close ones
-      }
-      else
-
-      if (A.mShader->getDepthMask() != B.mShader->getDepthMask())
-        return A.mShader->getDepthMask(); // first draw if zwrite is on
-      else
-
-      if ( A.mShader->sortByGLSLProgram(B.mShader.get()) )
-        return true;
-      else
-      if ( B.mShader->sortByGLSLProgram(A.mShader.get()) )
-        return false; // A.mShader->sortByGLSLProgram(B.mShader) was "really" false 
-      else // both were false so they are actually equal...
-
-      if ( A.mShader->sortByTextUnits(B.mShader.get()) )
-        return true;
-      else
-      if ( B.mShader->sortByTextUnits(A.mShader.get()) )
-        return false; // A.mShader->sortByTextUnits(B.mShader) was "really" false 
-      else // both were false so they are actually equal...
-
-      if ( A.mShader->sortByMaterial(B.mShader.get()) ) 
-        return true;
-      else
-      if ( B.mShader->sortByMaterial(A.mShader.get()) ) 
-        return false; // A.mShader->sortByMaterial(B.mShader) waw "really" false
-      else // both were false so they are actually equal...
-
-      if (A.mShader->isEnabled(EN_LIGHTING) != B.mShader->isEnabled(EN_LIGHTING))
-        return A.mShader->isEnabled(EN_LIGHTING); // first draw lit objects
-      else
-
-      if (A.mShader.get() != B.mShader.get())
-        return A.mShader.get() < B.mShader.get();
-      else
-
-      if (A.mActor->painter() != B.mActor->painter())
-        return A.mActor->painter() < B.mActor->painter();
-      else
-
-        return A.mActor.get() < B.mActor.get();
+      Shader* sh = tok.mShader;
+      unsigned long long key = rankBits(tok.mActor->painter()->renderRank()) << 48 |
+                               rankBits(tok.mActor->renderRank()) << 32;
+      if ( mDepthSortMode != AlwaysDepthSort && sh->isEnabled(EN_BLEND) )
+        key |= 1ULL << 31; // first draw opaque objects
+      if ( requiresZCameraDistance(tok) )
+        return key | farToNearBits(tok.mCameraDistance) << 7 | stateBits(sh, 7);
+
+      TextureUnit* unit = sh->textureUnit(0, false);
+      const Texture* tex = unit ? unit->texture() : NULL;
+      if ( !sh->getDepthMask() )
+        key |= 1ULL << 30; // first draw if zwrite is on
+      key |= stateBits(sh->glslProgram(false), 8) << 22;
+      key |= (tex ? 1 + tex->handle() % 255 : 0) << 14;
+      key |= stateBits(sh->glMaterial(false), 6) << 8;
+      if ( !sh->isEnabled(EN_LIGHTING) )
+        key |= 1ULL << 7; // first draw lit objects
+      return key | stateBits(sh, 7);
     }
 
     EDepthSortMode depthSortMode() const { return mDepthSortMode; }
@@ -193,44 +178,25 @@ namespace vl
   public:
     RenderListSorterLazy(): mDepthSortMode(AlphaDepthSort) { }
 
-    virtual bool requiresZCameraDistance(const RenderToken& A) 
-    { return mDepthSortMode != NeverDepthSort && (mDepthSortMode == AlwaysDepthSort  || 
+    virtual bool requiresZCameraDistance(const RenderToken& A)
+    { return mDepthSortMode != NeverDepthSort && (mDepthSortMode == AlwaysDepthSort  ||
       (A.mShader->isEnabled(EN_BLEND) && (mDepthSortMode == AlphaDepthSort)) ); }
 
-    virtual bool operator()(const RenderToken& A, const RenderToken& B)
+    //! ranks (32 bits) | blend (1) | then either the camera distance (24) and the shader (7)
+    //! or depth mask (1) and shader (30).
+    virtual unsigned long long sortKey(const RenderToken& tok)
     {
-
-      if (A.mActor->painter()->renderRank() != B.mActor->painter()->renderRank())
-        return A.mActor->painter()->renderRank() < B.mActor->painter()->renderRank();
-      else
-      if (A.mActor->renderRank() != B.mActor->renderRank())
-        return A.mActor->renderRank() < B.mActor->renderRank();
-      else
-
-      if ( mDepthSortMode != AlwaysDepthSort && (A.mShader->isEnabled(EN_BLEND) != B.mShader->isEnabled(EN_BLEND)))
-      {
-        return !A.mShader->isEnabled(EN_BLEND); // first draw opaque objects
-      }
-      else // A/B.mShader->isEnabled(OGL_BLEND) are equal or AlwaysDepthSort
-      if ( requiresZCameraDistance(A) )
-      {
-        return A.mCameraDistance > B.mCameraDistance; // draw first far objects then the close ones
-      }
-      else
-
-      if (A.mShader->getDepthMask() != B.mShader->getDepthMask())
-        return A.mShader->getDepthMask(); // first draw if zwrite is on
-      else
-
-      if (A.mShader.get() != B.mShader.get())
-        return A.mShader.get() < B.mShader.get();
-      else
-
-      if (A.mActor->painter() != B.mActor->painter())
-        return A.mActor->painter() < B.mActor->painter();
-      else
-
-        return A.mActor.get() < B.mActor.get();
+      Shader* sh = tok.mShader;
+      unsigned long long key = rankBits(tok.mActor->painter()->renderRank()) << 48 |
+                               rankBits(tok.mActor->renderRank()) << 32;
+      if ( mDepthSortMode != AlwaysDepthSort && sh->isEnabled(EN_BLEND) )
+        key |= 1ULL << 31; // first draw opaque objects
+      if ( requiresZCameraDistance(tok) )
+        return key | farToNearBits(tok.mCameraDistance) << 7 | stateBits(sh, 7);
+
+      if ( !sh->getDepthMask() )
+        key |= 1ULL << 30; // first draw if zwrite is on
+      return key | stateBits(sh, 30);
     }
 
     EDepthSortMode depthSortMode() const { return mDepthSortMode; }
@@ -244,63 +210,77 @@ namespace vl
   {
   public:
 
-    typedef std::vector< ref<RenderToken> >::iterator iterator; 
+    typedef std::vector<RenderToken>::iterator iterator;
   public:
     RenderList() {}
-    virtual ~RenderList() {} 
+    virtual ~RenderList() {}
 
     RenderListSorter* listSorter() { return mTokenSorter.get(); }
 
     void setListSorter(RenderListSorter* sorter) { mTokenSorter = sorter; }
 
+    //! The returned reference is valid until the next call.
     RenderToken& newToken(bool multipass)
     {
       if (multipass)
       {
-        MultipassList.push_back( Allocator.allocate() );
-        return *MultipassList.back();
+        MultipassList.push_back( RenderToken() );
+        return MultipassList.back();
       }
       else
       {
-        List.push_back( Allocator.allocate() );
-        return *List.back();
+        List.push_back( RenderToken() );
+        return List.back();
       }
     }
 
-    void clear() { List.clear(); MultipassList.clear(); Allocator.clear(); }
-    
+    //! Index that the next multipass token will have.
+    int nextMultipassIndex() const { return (int)MultipassList.size(); }
+
+    const RenderToken* nextPass(const RenderToken& tok) const { return tok.mNextPass < 0 ? NULL : &MultipassList[tok.mNextPass]; }
+
+    void clear() { List.clear(); MultipassList.clear(); }
+
     iterator begin() { return List.begin(); }
-    
+
     iterator end() { return List.end(); }
-    
+
     bool empty() { return List.empty(); }
 
     int size() const { return (int)List.size(); }
 
-    void sort()
-    {
-      CHECK(mTokenSorter);
-      std::sort( List.begin(), List.end(), Sorter(mTokenSorter.get()) );
-    }
+    void sort();
 
   protected:
     class Sorter
     {
-      ref<RenderListSorter> mTokenSorter;
+      RenderListSorter* mTokenSorter;
     public:
       Sorter(RenderListSorter* sorter): mTokenSorter(sorter) {}
-      bool operator()(const ref<RenderToken>& a, const ref<RenderToken>& b)
+      bool operator()(const RenderToken& a, const RenderToken& b)
       {
-        CHECK(a && b);
-        return mTokenSorter->operator()(*a, *b);
+        return mTokenSorter->operator()(a, b);
       }
     };
 
+    struct KeyIndex
+    {
+      unsigned long long mKey;
+      unsigned int mIndex;
+    };
+
+    void radixSort();
+
   public:
-    QuickAllocator<RenderToken> Allocator;
-    ref<RenderListSorter> mTokenSorter;  
-    std::vector< ref<RenderToken> > List;
-    std::vector< ref<RenderToken> > MultipassList;
+    ref<RenderListSorter> mTokenSorter;
+    std::vector<RenderToken> List;
+    std::vector<RenderToken> MultipassList;
+
+  protected:
+    // scratch buffers of the radix sort, kept across frames
+    std::vector<KeyIndex> mKeys;
+    std::vector<KeyIndex> mKeysTmp;
+    std::vector<RenderToken> mSorted;
   };
 
   typedef std::map< float, ref<RenderList> > TRenderListMap;
@@ -361,11 +341,38 @@ namespace vl
     bool frustumCullingEnabled() const { return mFrustumCullingEnabled; }
     void setFrustumCullingEnabled(bool enabled) { mFrustumCullingEnabled = enabled; }
 
+    //! Number of threads compiling the render lists, the calling one included, 0 uses one thread per core.
+    //! The culling, the LOD selection, the sort keys and the sorting of the lists are split in chunks
+    //! run by a ThreadPool, so the LOD evaluators and the list sorters must be reentrant.
+    //! The shaders are set up, the actors updated and the tokens added on the calling thread,
+    //! in the order of the actor list, so the lists are the same with any number of threads.
+    void setThreadCount(int count);
+    int threadCount() const { return mThreadPool ? mThreadPool->threadCount() : 1; }
+
   protected:
     void extractActorList( ShaderNode* scede );
 
     void compileRenderListsFromActorList();
 
+    typedef void (RenderListCompiler::*ChunkMethod)(int chunk);
+
+    //! Calls method for the chunks [0, count), on the thread pool if there is one.
+    void runChunks(ChunkMethod method, int count);
+
+    //! Culls the actors of a chunk and evaluates the LODs of the visible ones.
+    void evaluateActorChunk(int chunk);
+
+    void sortKeyChunk(int chunk);
+
+    void sortListChunk(int list);
+
+    struct TokenChunk
+    {
+      RenderList* mList;
+      RenderToken* mTokens;
+      int mCount;
+    };
+
   protected:
 
     TRenderListMap mRenderListSet;
@@ -386,6 +393,17 @@ namespace vl
 
     ref<ActorList> mActorList;
 
+    ref<BatchCuller> mBatchCuller;
+
+    ref<ThreadPool> mThreadPool;
+
+    // LODs chosen by evaluateActorChunk() for each actor of the list
+    std::vector<int> mPainterLOD;
+    std::vector<int> mActorLOD;
+
+    std::vector<TokenChunk> mTokenChunks;
+    std::vector<RenderList*> mSortedLists;
+
     double mUpdateTime;
     EActorListExtraction mActorListExtraction;
     bool mFrustumCullingEnabled;
@@ -54,6 +54,55 @@ namespace {
     GL_VERTEX_PROGRAM_POINT_SIZE,
     GL_VERTEX_PROGRAM_TWO_SIDE
   };
+
+  // value comparison of the states that different shaders often set to the same values,
+  // the other states are only compared by identity
+  template <class T>
+  bool sameGLState(const T*, const T*) { return false; }
+
+  bool sameGLState(const CullFace* a, const CullFace* b) { return a->faceMode() == b->faceMode(); }
+
+  bool sameGLState(const FrontFace* a, const FrontFace* b) { return a->frontFace() == b->frontFace(); }
+
+  bool sameGLState(const DepthFunc* a, const DepthFunc* b) { return a->depthFunc() == b->depthFunc(); }
+
+  bool sameGLState(const DepthMask* a, const DepthMask* b) { return a->depthMask() == b->depthMask(); }
+
+  bool sameGLState(const DepthRange* a, const DepthRange* b) { return a->zNear() == b->zNear() && a->zFar() == b->zFar(); }
+
+  bool sameGLState(const ShadeModel* a, const ShadeModel* b) { return a->shadeModel() == b->shadeModel(); }
+
+  bool sameGLState(const BlendEquation* a, const BlendEquation* b) { return a->blendEquation() == b->blendEquation(); }
+
+  bool sameGLState(const BlendColor* a, const BlendColor* b) { return a->blendColor() == b->blendColor(); }
+
+  bool sameGLState(const BlendFunc* a, const BlendFunc* b)
+  {
+    return a->srcRGB() == b->srcRGB() && a->dstRGB() == b->dstRGB() &&
+           a->srcAlpha() == b->srcAlpha() && a->dstAlpha() == b->dstAlpha();
+  }
+
+  bool sameGLState(const AlphaFunc* a, const AlphaFunc* b) { return a->alphaFunc() == b->alphaFunc() && a->refValue() == b->refValue(); }
+
+  bool sameGLState(const ColorMask* a, const ColorMask* b)
+  {
+    return a->red() == b->red() && a->green() == b->green() && a->blue() == b->blue() && a->alpha() == b->alpha();
+  }
+
+  bool sameGLState(const PolygonOffset* a, const PolygonOffset* b) { return a->factor() == b->factor() && a->units() == b->units(); }
+
+  bool sameGLState(const LineWidth* a, const LineWidth* b) { return a->lineWidth() == b->lineWidth(); }
+
+  bool sameGLState(const PointSize* a, const PointSize* b) { return a->pointSize() == b->pointSize(); }
+
+  bool sameGLState(const Material* a, const Material* b)
+  {
+    return a->frontAmbient()  == b->frontAmbient()  && a->backAmbient()  == b->backAmbient()  &&
+           a->frontDiffuse()  == b->frontDiffuse()  && a->backDiffuse()  == b->backDiffuse()  &&
+           a->frontSpecular() == b->frontSpecular() && a->backSpecular() == b->backSpecular() &&
+           a->frontEmission() == b->frontEmission() && a->backEmission() == b->backEmission() &&
+           a->frontShininess() == b->frontShininess() && a->backShininess() == b->backShininess();
+  }
 }
 
 Shader::Shader(void)
@@ -297,7 +346,7 @@ void Shader::combine(Shader* parent)
 }
 
 template <class T>
-void Shader::applyGLState( const StateWrapper<T> state, T* default_state, ref<T>& io_cur_state ) const
+void Shader::applyGLState( const StateWrapper<T> state, T* default_state, ref<T>& io_cur_state, RenderStats& stats ) const
 {
   CHECK(default_state);
   T* final = NULL;
@@ -309,12 +358,18 @@ void Shader::applyGLState( const StateWrapper<T> state, T* default_state, ref<T>
 
   if (final != io_cur_state) // delta setup :)))
   {
-    final->applyGLState();
+    if ( io_cur_state && sameGLState(final, io_cur_state.get()) )
+      ++stats.mStatesSkipped;
+    else
+    {
+      final->applyGLState();
+      ++stats.mStateChanges;
+    }
     io_cur_state = final;
   }
 }
 
-void Shader::applyTexture( int texunit, bool enabled, const StateWrapper<TextureUnit> state, TextureUnit* default_state, ref<TextureUnit>& io_cur_state, bool& io_cur_enabled ) const
+void Shader::applyTexture( int texunit, bool enabled, const StateWrapper<TextureUnit> state, TextureUnit* default_state, ref<TextureUnit>& io_cur_state, bool& io_cur_enabled, RenderStats& stats ) const
 {
   CHECK(default_state);
   TextureUnit* final = NULL;
@@ -326,13 +381,19 @@ void Shader::applyTexture( int texunit, bool enabled, const StateWrapper<Texture
 
   if (final != io_cur_state || enabled != io_cur_enabled) // delta setup :)))
   {
-    final->applyTexture(texunit, enabled);
+    if ( io_cur_state && final->sameTexture(enabled, io_cur_state.get(), io_cur_enabled) )
+      ++stats.mStatesSkipped;
+    else
+    {
+      final->applyTexture(texunit, enabled, io_cur_state.get(), io_cur_enabled);
+      ++stats.mStateChanges;
+    }
     io_cur_state = final;
     io_cur_enabled = enabled;
   }
 }
 
-void Shader::applyEnable(int enable, Shader* thread_current, const Shader* thread_default) const
+void Shader::applyEnable(int enable, Shader* thread_current, const Shader* thread_default, RenderStats& stats) const
 {
   CHECK(enable>=0 && enable<ENABLE_COUNT)
 
@@ -351,7 +412,7 @@ void Shader::applyEnable(int enable, Shader* thread_current, const Shader* threa
       glEnable( EnablesTable[enable] );
     else
       glDisable( EnablesTable[enable] );
-
+    ++stats.mStateChanges;
   }
 }
 
@@ -361,74 +422,80 @@ void Shader::applyShader(int render_stream)
 
   Shader* thread_current = GlobalState::renderStream(render_stream)->currentShader();
   const Shader* thread_default = GlobalState::renderStream(render_stream)->defaultShader();
+  RenderStats& stats = GlobalState::renderStream(render_stream)->stats();
 
   int itex = GlobalState::renderStream(render_stream)->maxTextureUnits();
   while(itex--)
-    applyTexture( itex, textureUnitEnabled(itex), mTextureUnit[itex], thread_default->mTextureUnit[itex].mState.get(), thread_current->mTextureUnit[itex].mState, thread_current->mTextureUnitEnabled[itex] );
+    applyTexture( itex, textureUnitEnabled(itex), mTextureUnit[itex], thread_default->mTextureUnit[itex].mState.get(), thread_current->mTextureUnit[itex].mState, thread_current->mTextureUnitEnabled[itex], stats );
 
   GLCHECK4()
 
-  applyGLState(mGLSLProgram, thread_default->mGLSLProgram.mState.get(), thread_current->mGLSLProgram.mState);
-  applyGLState(mGLPixelTransfer, thread_default->mGLPixelTransfer.mState.get(), thread_current->mGLPixelTransfer.mState);
-  applyGLState(mGLHint, thread_default->mGLHint.mState.get(), thread_current->mGLHint.mState);
-  applyGLState(mGLCullFace, thread_default->mGLCullFace.mState.get(), thread_current->mGLCullFace.mState);
-  applyGLState(mGLFrontFace, thread_default->mGLFrontFace.mState.get(), thread_current->mGLFrontFace.mState);
+  applyGLState(mGLSLProgram, thread_default->mGLSLProgram.mState.get(), thread_current->mGLSLProgram.mState, stats);
+  applyGLState(mGLPixelTransfer, thread_default->mGLPixelTransfer.mState.get(), thread_current->mGLPixelTransfer.mState, stats);
+  applyGLState(mGLHint, thread_default->mGLHint.mState.get(), thread_current->mGLHint.mState, stats);
+  applyGLState(mGLCullFace, thread_default->mGLCullFace.mState.get(), thread_current->mGLCullFace.mState, stats);
+  applyGLState(mGLFrontFace, thread_default->mGLFrontFace.mState.get(), thread_current->mGLFrontFace.mState, stats);
 
-    applyGLState(mGLDepthFunc, thread_default->mGLDepthFunc.mState.get(), thread_current->mGLDepthFunc.mState);
+    applyGLState(mGLDepthFunc, thread_default->mGLDepthFunc.mState.get(), thread_current->mGLDepthFunc.mState, stats);
 
-  applyGLState(mGLDepthMask, thread_default->mGLDepthMask.mState.get(), thread_current->mGLDepthMask.mState);
-  applyGLState(mGLColorMask, thread_default->mGLColorMask.mState.get(), thread_current->mGLColorMask.mState);
-  applyGLState(mGLPolygonMode, thread_default->mGLPolygonMode.mState.get(), thread_current->mGLPolygonMode.mState);
-  applyGLState(mGLShadeModel, thread_default->mGLShadeModel.mState.get(), thread_current->mGLShadeModel.mState);
+  applyGLState(mGLDepthMask, thread_default->mGLDepthMask.mState.get(), thread_current->mGLDepthMask.mState, stats);
+  applyGLState(mGLColorMask, thread_default->mGLColorMask.mState.get(), thread_current->mGLColorMask.mState, stats);
+  applyGLState(mGLPolygonMode, thread_default->mGLPolygonMode.mState.get(), thread_current->mGLPolygonMode.mState, stats);
+  applyGLState(mGLShadeModel, thread_default->mGLShadeModel.mState.get(), thread_current->mGLShadeModel.mState, stats);
 
-  applyGLState(mGLBlendEquation, thread_default->mGLBlendEquation.mState.get(), thread_current->mGLBlendEquation.mState);
+  applyGLState(mGLBlendEquation, thread_default->mGLBlendEquation.mState.get(), thread_current->mGLBlendEquation.mState, stats);
 
-  applyGLState(mGLAlphaFunc, thread_default->mGLAlphaFunc.mState.get(), thread_current->mGLAlphaFunc.mState);
+  applyGLState(mGLAlphaFunc, thread_default->mGLAlphaFunc.mState.get(), thread_current->mGLAlphaFunc.mState, stats);
 
   {
 
-      applyGLState(mGLColorMaterial, thread_default->mGLColorMaterial.mState.get(), thread_current->mGLColorMaterial.mState);
-    applyGLState(mGLLightModel, thread_default->mGLLightModel.mState.get(), thread_current->mGLLightModel.mState);
+      applyGLState(mGLColorMaterial, thread_default->mGLColorMaterial.mState.get(), thread_current->mGLColorMaterial.mState, stats);
+    applyGLState(mGLLightModel, thread_default->mGLLightModel.mState.get(), thread_current->mGLLightModel.mState, stats);
   }
 
-    applyGLState(mGLFog, thread_default->mGLFog.mState.get(), thread_current->mGLFog.mState);
+    applyGLState(mGLFog, thread_default->mGLFog.mState.get(), thread_current->mGLFog.mState, stats);
 
-    applyGLState(mGLPolygonOffset, thread_default->mGLPolygonOffset.mState.get(), thread_current->mGLPolygonOffset.mState);
+    applyGLState(mGLPolygonOffset, thread_default->mGLPolygonOffset.mState.get(), thread_current->mGLPolygonOffset.mState, stats);
 
-    applyGLState(mGLLogicOp, thread_default->mGLLogicOp.mState.get(), thread_current->mGLLogicOp.mState);
+    applyGLState(mGLLogicOp, thread_default->mGLLogicOp.mState.get(), thread_current->mGLLogicOp.mState, stats);
 
-  applyGLState(mGLDepthRange, thread_default->mGLDepthRange.mState.get(), thread_current->mGLDepthRange.mState);
-  applyGLState(mGLLineWidth, thread_default->mGLLineWidth.mState.get(), thread_current->mGLLineWidth.mState);
-  applyGLState(mGLPointSize, thread_default->mGLPointSize.mState.get(), thread_current->mGLPointSize.mState);
+  applyGLState(mGLDepthRange, thread_default->mGLDepthRange.mState.get(), thread_current->mGLDepthRange.mState, stats);
+  applyGLState(mGLLineWidth, thread_default->mGLLineWidth.mState.get(), thread_current->mGLLineWidth.mState, stats);
+  applyGLState(mGLPointSize, thread_default->mGLPointSize.mState.get(), thread_current->mGLPointSize.mState, stats);
 
-    applyGLState(mGLLineStipple, thread_default->mGLLineStipple.mState.get(), thread_current->mGLLineStipple.mState);
+    applyGLState(mGLLineStipple, thread_default->mGLLineStipple.mState.get(), thread_current->mGLLineStipple.mState, stats);
 
-    applyGLState(mGLPolygonStipple, thread_default->mGLPolygonStipple.mState.get(), thread_current->mGLPolygonStipple.mState);
+    applyGLState(mGLPolygonStipple, thread_default->mGLPolygonStipple.mState.get(), thread_current->mGLPolygonStipple.mState, stats);
 
-  applyGLState(mGLPointParameter, thread_default->mGLPointParameter.mState.get(), thread_current->mGLPointParameter.mState);
-  applyGLState(mGLStencilFunc, thread_default->mGLStencilFunc.mState.get(), thread_current->mGLStencilFunc.mState);
+  applyGLState(mGLPointParameter, thread_default->mGLPointParameter.mState.get(), thread_current->mGLPointParameter.mState, stats);
+  applyGLState(mGLStencilFunc, thread_default->mGLStencilFunc.mState.get(), thread_current->mGLStencilFunc.mState, stats);
 
-    applyGLState(mGLStencilOp, thread_default->mGLStencilOp.mState.get(), thread_current->mGLStencilOp.mState);
+    applyGLState(mGLStencilOp, thread_default->mGLStencilOp.mState.get(), thread_current->mGLStencilOp.mState, stats);
 
-  applyGLState(mGLStencilMask, thread_default->mGLStencilMask.mState.get(), thread_current->mGLStencilMask.mState);
-  applyGLState(mGLBlendColor, thread_default->mGLBlendColor.mState.get(), thread_current->mGLBlendColor.mState);
+  applyGLState(mGLStencilMask, thread_default->mGLStencilMask.mState.get(), thread_current->mGLStencilMask.mState, stats);
+  applyGLState(mGLBlendColor, thread_default->mGLBlendColor.mState.get(), thread_current->mGLBlendColor.mState, stats);
 
-  applyGLState(mGLBlendFuncSeparate, thread_default->mGLBlendFuncSeparate.mState.get(), thread_current->mGLBlendFuncSeparate.mState);
+  applyGLState(mGLBlendFuncSeparate, thread_default->mGLBlendFuncSeparate.mState.get(), thread_current->mGLBlendFuncSeparate.mState, stats);
 
-  applyGLState(mGLScissor, thread_default->mGLScissor.mState.get(), thread_current->mGLScissor.mState);
-  applyGLState(mGLSampleCoverage, thread_default->mGLSampleCoverage.mState.get(), thread_current->mGLSampleCoverage.mState);
+  applyGLState(mGLScissor, thread_default->mGLScissor.mState.get(), thread_current->mGLScissor.mState, stats);
+  applyGLState(mGLSampleCoverage, thread_default->mGLSampleCoverage.mState.get(), thread_current->mGLSampleCoverage.mState, stats);
 
-  bool update_material = glIsEnabled(GL_COLOR_MATERIAL) == GL_TRUE;
+  // the enables of the current shader mirror the OpenGL ones once the default shader has been applied
+  bool update_material;
+  if (thread_current->mEnable[EN_COLOR_MATERIAL] == -1)
+    update_material = glIsEnabled(GL_COLOR_MATERIAL) == GL_TRUE;
+  else
+    update_material = thread_current->mEnable[EN_COLOR_MATERIAL] != 0;
 
   for (int i=0; i<ENABLE_COUNT; i++)
-    applyEnable(i, thread_current, thread_default);
+    applyEnable(i, thread_current, thread_default, stats);
 	
   CLEAR_GL_ERROR()
 
   if (update_material)
     thread_current->setMaterial(NULL);
 
-  applyGLState(mGLMaterial, thread_default->mGLMaterial.mState.get(), thread_current->mGLMaterial.mState);
+  applyGLState(mGLMaterial, thread_default->mGLMaterial.mState.get(), thread_current->mGLMaterial.mState, stats);
 }
 
 void Shader::reset()
@@ -1346,7 +1413,26 @@ TexGen* TextureUnit::glTexGen()
   return mGLTexGen.get(); 
 }
 
-void TextureUnit::applyTexture(GLint texunit, bool enabled)
+bool TextureUnit::sameTexture(bool enabled, const TextureUnit* other, bool other_enabled) const
+{
+  bool active = enabled && hasTexture();
+  bool other_active = other_enabled && other->hasTexture();
+  if (!active || !other_active)
+    return active == other_active; // both leave the unit disabled
+
+  return mTexture->handle()    == other->mTexture->handle() &&
+         mTexture->dimension() == other->mTexture->dimension() &&
+         mGLTexParameter == other->mGLTexParameter &&
+         mGLTexEnv == other->mGLTexEnv &&
+         mGLTexGen == other->mGLTexGen &&
+         mMatrix == other->mMatrix &&
+         mEnableTexGenS == other->mEnableTexGenS &&
+         mEnableTexGenT == other->mEnableTexGenT &&
+         mEnableTexGenR == other->mEnableTexGenR &&
+         mEnableTexGenQ == other->mEnableTexGenQ;
+}
+
+void TextureUnit::applyTexture(GLint texunit, bool enabled, const TextureUnit* prev, bool prev_enabled)
 {
   GLCHECK4()
 
@@ -1359,29 +1445,43 @@ void TextureUnit::applyTexture(GLint texunit, bool enabled)
   if ( texunit > 0 )
     return;
 
-  glDisable( GL_TEXTURE_1D ); GLCHECK4() 
-  glDisable( GL_TEXTURE_2D ); GLCHECK4()
-  if (GLEW_EXT_texture3D)
-  {
-    glDisable( GL_TEXTURE_3D ); GLCHECK4()
-  }
-  if (GLEW_EXT_texture_cube_map)
-  {
-    glDisable( GL_TEXTURE_CUBE_MAP ); GLCHECK4()
-  }
+  bool active = enabled && mTexture && mTexture->handle();
 
-  glBindTexture( GL_TEXTURE_1D, 0 ); GLCHECK4()
-  glBindTexture( GL_TEXTURE_2D, 0 ); GLCHECK4()
-  if (GLEW_EXT_texture3D)
+  if (prev)
   {
-    glBindTexture( GL_TEXTURE_3D, 0 ); GLCHECK4()
+    // only the target enabled by the previous unit needs to be reset
+    if ( prev_enabled && prev->hasTexture() && (!active || prev->texture()->dimension() != texture()->dimension()) )
+    {
+      glDisable( prev->texture()->dimension() ); GLCHECK4()
+      glBindTexture( prev->texture()->dimension(), 0 ); GLCHECK4()
+    }
   }
-  if (GLEW_EXT_texture_cube_map)
+  else
   {
-    glBindTexture( GL_TEXTURE_CUBE_MAP, 0 ); GLCHECK4()
+    glDisable( GL_TEXTURE_1D ); GLCHECK4() 
+    glDisable( GL_TEXTURE_2D ); GLCHECK4()
+    if (GLEW_EXT_texture3D)
+    {
+      glDisable( GL_TEXTURE_3D ); GLCHECK4()
+    }
+    if (GLEW_EXT_texture_cube_map)
+    {
+      glDisable( GL_TEXTURE_CUBE_MAP ); GLCHECK4()
+    }
+
+    glBindTexture( GL_TEXTURE_1D, 0 ); GLCHECK4()
+    glBindTexture( GL_TEXTURE_2D, 0 ); GLCHECK4()
+    if (GLEW_EXT_texture3D)
+    {
+      glBindTexture( GL_TEXTURE_3D, 0 ); GLCHECK4()
+    }
+    if (GLEW_EXT_texture_cube_map)
+    {
+      glBindTexture( GL_TEXTURE_CUBE_MAP, 0 ); GLCHECK4()
+    }
   }
 
-  if( enabled && mTexture && mTexture->handle() )
+  if( active )
   {
     CHECK(mTexture)
     CHECK(mTexture->handle())
@@ -32,6 +32,7 @@
 
 namespace vl
 {
+  class RenderStats;
 
   class GLState: public Object
   {
@@ -824,7 +825,10 @@ namespace vl
     TextureUnit(): mMatrix(NULL), mEnableTexGenS(false), mEnableTexGenT(false), mEnableTexGenR(false), mEnableTexGenQ(false) 
     {
     }
-    void applyTexture(GLint texunit, bool enabled);
+    //! prev is the unit applied last to texunit, if known only the state it left is undone.
+    void applyTexture(GLint texunit, bool enabled, const TextureUnit* prev=NULL, bool prev_enabled=false);
+    //! True if applying this unit after other would not change the OpenGL state.
+    bool sameTexture(bool enabled, const TextureUnit* other, bool other_enabled) const;
     void setTexture(Texture* texture) { mTexture = texture; }
     void set_glTexParameter(TexParameter* texpar) { mGLTexParameter = texpar; }
     void set_glTexEnv(TexEnv* texenv) { mGLTexEnv = texenv; }
@@ -1154,9 +1158,9 @@ namespace vl
     template <class T> void inherit(StateWrapper<T>& io_child, const StateWrapper<T>& parent);
 
     template <class T>
-    void applyGLState( const StateWrapper<T>, T* default_state, ref<T>& io_cur_state ) const;
-    void applyTexture( int texunit, bool enabled, const StateWrapper<TextureUnit>, TextureUnit* default_state, ref<TextureUnit>& io_cur_state, bool& io_cur_enabled ) const;
-    void applyEnable(int enable, Shader* thread_current, const Shader* thread_default) const;
+    void applyGLState( const StateWrapper<T>, T* default_state, ref<T>& io_cur_state, RenderStats& stats ) const;
+    void applyTexture( int texunit, bool enabled, const StateWrapper<TextureUnit>, TextureUnit* default_state, ref<TextureUnit>& io_cur_state, bool& io_cur_enabled, RenderStats& stats ) const;
+    void applyEnable(int enable, Shader* thread_current, const Shader* thread_default, RenderStats& stats) const;
     void inherit(int enable, Shader* parent);
 
   protected:
@@ -23,6 +23,7 @@
 #include "vl/Say.hpp"
 #include "vl/Log.hpp"
 #include "vl/Actor.hpp"
+#include <algorithm>
 
 #include "ft2build.h"
 #include FT_FREETYPE_H
@@ -55,20 +56,15 @@ namespace vl
   extern FT_Library FreeTypeLibrary;
 }
 
-Glyph::~Glyph()
-{
-  if (mTextureHandle)
-  {
-    glDeleteTextures(1, &mTextureHandle);
-    mTextureHandle = 0;
-  }
-}
-
 Font::Font()
 {
   mHeight = 0;
   mFT_Face = NULL;
   mSmooth = false;
+  mSize = 0;
+  mAtlasPageSize = 0;
+  mAtlasX = mAtlasY = mAtlasRowHeight = 0;
+  mRevision = 0;
   setSize(14);
 }
 
@@ -77,12 +73,17 @@ Font::Font(const std::string& font_file, int size )
   mHeight = 0;
   mFT_Face = NULL;
   mSmooth = false;
+  mSize = 0;
+  mAtlasPageSize = 0;
+  mAtlasX = mAtlasY = mAtlasRowHeight = 0;
+  mRevision = 0;
   setFontFile(font_file);
   setSize(size);
 }
 
 Font::~Font()
 {
+  releaseGlyphs();
   if (mFT_Face)
   {
     FT_Done_Face(mFT_Face); mFT_Face = NULL;
@@ -95,19 +96,104 @@ void Font::operator=(const Font& other)
   {
     FT_Done_Face(mFT_Face); mFT_Face = NULL;
   }
-  mGlyphMap.clear();
+  releaseGlyphs();
   mFontFile = other.mFontFile;
   mSize = other.mSize;
   mHeight = other.mHeight;
 }
 
+void Font::releaseGlyphs()
+{
+  mGlyphMap.clear();
+
+  if (!mAtlasTextures.empty())
+    glDeleteTextures( (GLsizei)mAtlasTextures.size(), &mAtlasTextures[0] );
+  mAtlasTextures.clear();
+  mAtlasPageSize = 0;
+  mAtlasX = mAtlasY = mAtlasRowHeight = 0;
+
+  mRevision++;
+}
+
+GLuint Font::allocateAtlasCell(int w, int h, int& x, int& y)
+{
+  if (!mAtlasTextures.empty())
+  {
+    // start a new shelf
+    if (mAtlasX + w > mAtlasPageSize)
+    {
+      mAtlasX = 0;
+      mAtlasY += mAtlasRowHeight;
+      mAtlasRowHeight = 0;
+    }
+  }
+
+  if ( mAtlasTextures.empty() || w > mAtlasPageSize || mAtlasY + h > mAtlasPageSize )
+  {
+    int max_tex_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_tex_size);
+
+    int size = 512;
+    while( size < w || size < h )
+      size *= 2;
+    if (max_tex_size && size > max_tex_size)
+      size = max_tex_size;
+    if (w > size || h > size)
+      return 0;
+
+    GLuint texhdl;
+    glGenTextures( 1, &texhdl );
+    glBindTexture( GL_TEXTURE_2D, texhdl );
+
+    // white with a transparent background, the glyphs are stored in the alpha channel
+    std::vector<unsigned char> blank(size*size*4, 0xFF);
+    for(size_t byte=3; byte<blank.size(); byte+=4)
+      blank[byte] = 0x0;
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, &blank[0] );
+
+    if ( smooth() )
+    {
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    }
+    else
+    {
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    }
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
+
+    if (GLEW_EXT_texture_filter_anisotropic)
+    {
+      GLfloat max_anisotropy;
+      glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_anisotropy);
+    }
+
+    GLCHECK4();
+
+    mAtlasTextures.push_back(texhdl);
+    mAtlasPageSize = size;
+    mAtlasX = mAtlasY = mAtlasRowHeight = 0;
+  }
+
+  x = mAtlasX;
+  y = mAtlasY;
+  mAtlasX += w;
+  if (h > mAtlasRowHeight)
+    mAtlasRowHeight = h;
+
+  return mAtlasTextures.back();
+}
+
 void Font::setSize(int size) 
 { 
   if(mSize != size)
   {
     mSize = size ; 
 
-    mGlyphMap.clear();
+    releaseGlyphs();
 
   }
 }
@@ -118,7 +204,7 @@ void Font::setFontFile(const std::string& font_file)
 
   mFontFile = font_file; 
 
-  mGlyphMap.clear();
+  releaseGlyphs();
 
   if (mFT_Face)
   {
@@ -265,110 +351,56 @@ Glyph* Font::glyph(int character)
       CHECK( mFT_Face->glyph->bitmap.palette_mode == 0 )
       CHECK( mFT_Face->glyph->bitmap.pitch > 0 )
 
-      GLuint texhdl;
-      glGenTextures( 1, &texhdl );
-      glyph->setTextureHandle(texhdl);
-      glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
-
-      int texsize[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 0 };
-      int max_tex_size = 0;
-      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_tex_size);
+      int margin = 1;
+      int w = glyph->width()  + margin*2;
+      int h = glyph->height() + margin*2;
+      int cell_x = 0, cell_y = 0;
 
-      int w=0, h=0, margin = 1;
-
-      for(int i=0; texsize[i]; i++)
+      GLuint texhdl = allocateAtlasCell(w, h, cell_x, cell_y);
+      if (!texhdl)
       {
-        if ( (texsize[i] >= glyph->width() + margin*2 && texsize[i] >= glyph->height() + margin*2) || texsize[i+1] > max_tex_size )
-        {
-          w = texsize[i];
-          h = texsize[i];
-          break;
-        }
+        Log::error( Say("Font::glyph() error (%s): glyph %nx%n does not fit in a texture.\n") << fontFile() << glyph->width() << glyph->height() );
+        CHECK(0);
+        return glyph.get();
       }
-      CHECK(w)
-      CHECK(h)
-
-#if(1)
-
-      glyph->setS0( 0 );
-      glyph->setT0( 1 );
-      glyph->setS1((margin*2 + glyph->width() ) /(float)(w-1) );
-      glyph->setT1( 1 -(margin*2 + glyph->height() ) /(float)(h-1) );
+      glyph->setTextureHandle(texhdl);
 
-#else
-      glyph->setS0((float)margin /(float)w);
-      glyph->setT0( 1 -(float)margin /(float)h);
-      glyph->setS1(((float)margin + glyph->width() ) /(float)w);
-      glyph->setT1( 1 -((float)margin + glyph->height() ) /(float)h);
-#endif
+      glyph->setS0( cell_x / (float)mAtlasPageSize );
+      glyph->setT0( (cell_y + h) / (float)mAtlasPageSize );
+      glyph->setS1( (cell_x + w) / (float)mAtlasPageSize );
+      glyph->setT1( cell_y / (float)mAtlasPageSize );
 
       ref<Image> img = new Image;
       img->allocate2D(w, h, 1, IF_RGBA, IT_UNSIGNED_BYTE);
 
       for(int byte=0; byte<img->requiredMemory(); byte+=4)
       {
-#if (1)
         img->pixels()[byte + 0] = 0xFF;
         img->pixels()[byte + 1] = 0xFF;
         img->pixels()[byte + 2] = 0xFF;
         img->pixels()[byte + 3] = 0x0;
-#else
-        img->pixels()[byte + 0] = 0x0;
-        img->pixels()[byte + 1] = 0x0;
-        img->pixels()[byte + 2] = 0x0;
-        img->pixels()[byte + 3] = 0xFF;
-#endif
       }
 
       for(int y=0; y<glyph->height(); y++)
       {
         for(int x=0; x<glyph->width(); x++) 
         {
-          int offset_1 = (x+margin) * 4 + (w-1-y-margin) * img->pitch();
+          int offset_1 = (x+margin) * 4 + (h-1-y-margin) * img->pitch();
           int offset_2 = 0;
           if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
             offset_2 = x / 8 + y * abs(mFT_Face->glyph->bitmap.pitch);
           else
             offset_2 = x + y * mFT_Face->glyph->bitmap.pitch;
 
-#if (1)
           if (mFT_Face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO)
             img->pixels()[ offset_1+3 ] = (mFT_Face->glyph->bitmap.buffer[ offset_2 ] >> (7-x%8)) & 0x1 ? 0xFF : 0x0;
           else
             img->pixels()[ offset_1+3 ] = mFT_Face->glyph->bitmap.buffer[ offset_2 ];
-#else
-
-          img->pixels()[ offset_1+0 ] = face->glyph->bitmap.buffer[ offset_2 ]; // 0xFF;
-          img->pixels()[ offset_1+1 ] = face->glyph->bitmap.buffer[ offset_2 ]; // 0xFF;
-          img->pixels()[ offset_1+2 ] = face->glyph->bitmap.buffer[ offset_2 ]; // 0xFF;
-          img->pixels()[ offset_1+3 ] = 0xFF; // face->glyph->bitmap.buffer[ offset_2 ];
-#endif
         }
       }
 
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img->width(), img->height(), 0, img->format(), img->type(), img->pixels() );
-
-      if ( smooth() )
-      {
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
-      }
-      else
-      {
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
-      }
-
-      if (GLEW_EXT_texture_filter_anisotropic)
-      {
-        GLfloat max_anisotropy;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_anisotropy);
-      }
+      glBindTexture( GL_TEXTURE_2D, texhdl );
+      glTexSubImage2D(GL_TEXTURE_2D, 0, cell_x, cell_y, img->width(), img->height(), img->format(), img->type(), img->pixels() );
 
       GLCHECK4();
     }
@@ -382,28 +414,19 @@ Glyph* Font::glyph(int character)
 void Font::setSmooth(bool smooth)
 {
   mSmooth = smooth;
-  std::map<int, ref<Glyph> >::iterator it = mGlyphMap.begin();
-  for( ; it != mGlyphMap.end(); ++it )
+  for(unsigned i=0; i<mAtlasTextures.size(); ++i)
   {
-    const ref<Glyph>& glyph = it->second;
-    if (glyph->textureHandle() == 0)
-      continue;
-
-    glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
+    glBindTexture( GL_TEXTURE_2D, mAtlasTextures[i] );
 
     if (smooth)
     {
       glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
       glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
     }
     else
     {
       glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
       glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
     }
   }
 }
@@ -506,6 +529,11 @@ void Text::drawText(int render_stream, Actor* actor, const vec4& color, const ve
     return;
   }
 
+  updateLayout();
+
+  if (mBatches.empty())
+    return;
+
   GLint viewport[] = {0,0,0,0};
   glGetIntegerv(GL_VIEWPORT, viewport);
   GLCHECK4()
@@ -513,107 +541,237 @@ void Text::drawText(int render_stream, Actor* actor, const vec4& color, const ve
   if (viewport[2] < 1) viewport[2] = 1;
   if (viewport[3] < 1) viewport[3] = 1;
 
-  if (mode() == Text2D)
+  // the layout is cached in text space, the rest of the transformation goes to the modelview matrix
+
+  mat4d m = mMatrix;
+
+  if ( !actor->transform() )
   {
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-    GLCHECK4();
+    if (viewportAlignment() & AlignHCenter)
+    {
+      CHECK( !(viewportAlignment() & AlignRight) )
+      CHECK( !(viewportAlignment() & AlignLeft) )
+
+      m.translate( int((viewport[2]-1.0f) / 2.0f), 0, 0);
+    }
+
+    if (viewportAlignment() & AlignRight)
+    {
+      CHECK( !(viewportAlignment() & AlignHCenter) )
+      CHECK( !(viewportAlignment() & AlignLeft) )
+
+      m.translate( int(viewport[2]-1.0f), 0, 0);
+    }
+
+    if (viewportAlignment() & AlignTop)
+    {
+      CHECK( !(viewportAlignment() & AlignBottom) )
+      CHECK( !(viewportAlignment() & AlignVCenter) )
+
+      m.translate( 0, int(viewport[3]-1.0f), 0);
+    }
+
+    if (viewportAlignment() & AlignVCenter)
+    {
+      CHECK( !(viewportAlignment() & AlignTop) )
+      CHECK( !(viewportAlignment() & AlignBottom) )
+
+      m.translate( 0, int((viewport[3]-1.0f) / 2.0f), 0);
+    }
+  }
+
+  if ( actor->transform() && mode() == Text2D )
+  {
+    vec4d v(0,0,0,1);
+    v = actor->transform()->localToWorldMatrix( render_stream ) * v;
+
+    GlobalState::renderStream( render_stream )->currentCamera()->project(v,v);
+
+    v.x() -= viewport[0];
+    v.y() -= viewport[1];
 
+    m.translate( int(v.x()), int(v.y()), 0 );
+  }
+
+  if (mode() == Text2D)
+  {
     glMatrixMode(GL_PROJECTION);
     glPushMatrix(); 
     glLoadIdentity();
     gluOrtho2D( -0.5f, viewport[2]-0.5f, -0.5f, viewport[3]-0.5f );
     GLCHECK4();
   }
- 
-#if (1)
-  AABB rbbox = rawBoundingBox( text() ); // for text alignment
-  AABB bbox = rbbox; 
-  bbox.setMaxCorner( bbox.maxCorner() + vec3d(2*margin(),2*margin(),0) );
+
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  if (mode() == Text2D)
+    glLoadIdentity();
+  glMultMatrixd( m.ptr() );
+  glTranslatef( offset.x(), offset.y(), 0 );
+  GLCHECK4();
 
 	glEnable(GL_TEXTURE_2D);
 
-  vec2 pen(0,0);
+  glColor4fv( color.ptr() );
+  glNormal3f( 0, 0, 1 );
 
-  float texc[] = { 0,0,0,0,0,0,0,0 };
   glEnableClientState( GL_TEXTURE_COORD_ARRAY );
   if (GLEW_ARB_multitexture)
     glClientActiveTexture( GL_TEXTURE0 );
-  glTexCoordPointer(2, GL_FLOAT, 0, texc);
+  glTexCoordPointer(2, GL_FLOAT, 0, mTexCoordCache[0].ptr());
 
-  vec4 cols[] = { color, color, color, color};
-  glEnableClientState( GL_COLOR_ARRAY );
-  glColorPointer(4, GL_FLOAT, 0, cols);
+  glEnableClientState( GL_VERTEX_ARRAY );
+  glVertexPointer(2, GL_FLOAT, 0, mVertexCache[0].ptr());
 
-  vec3 norms[] = { vec3(0,0,1), vec3(0,0,1), vec3(0,0,1), vec3(0,0,1) };
-  glEnableClientState( GL_NORMAL_ARRAY );
-  glNormalPointer(GL_FLOAT, 0, norms);
+  // one draw call per atlas page, usually just one
+  for(unsigned i=0; i<mBatches.size(); ++i)
+  {
+    glBindTexture( GL_TEXTURE_2D, mBatches[i].mTexture );
+    glDrawArrays( GL_QUADS, mBatches[i].mFirst, mBatches[i].mCount );
+  }
+  GlobalState::renderStream(render_stream)->stats().mDrawCalls += (int)mBatches.size();
 
-  vec2 vect[4];
-  glEnableClientState( GL_VERTEX_ARRAY );
-  glVertexPointer(2, GL_FLOAT, 0, vect[0].ptr());
+  glDisableClientState( GL_VERTEX_ARRAY );
+  glDisableClientState( GL_TEXTURE_COORD_ARRAY );
 
-  FT_Long use_kerning = FT_HAS_KERNING( font()->mFT_Face );
-  FT_UInt previous = 0;
+  GLCHECK4();
 
-  CHECK(text().length())
+  glMatrixMode(GL_MODELVIEW);
+  glPopMatrix(); GLCHECK4()
 
-  std::vector< std::wstring > lines;
-  lines.push_back( std::wstring() );
-  for(unsigned i=0; i<text().length(); i++)
+  if (mode() == Text2D)
   {
-    if (text()[i] == '\n')
-    {
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix(); GLCHECK4()
+    glMatrixMode(GL_MODELVIEW);
+  }
+}
 
-      lines.push_back( std::wstring() );
-    }
-    else
-      lines.back().push_back( text()[i] );
+void Text::updateLayout() const
+{
+  if (!mFont || !font()->mFT_Face)
+    return;
+
+  bool justify = textAlignment() == TextAlignJustify;
+
+  // these change the glyph quads of every line
+  if ( mLayoutFont != mFont.get() || mLayoutFontRevision != mFont->mRevision || mLayoutLayout != layout() || 
+       mLayoutKerning != kerningEnabled() || (mLayoutTextAlignment == TextAlignJustify) != justify )
+  {
+    mLineCache.clear();
+    mLayoutFont = mFont.get();
+    mLayoutFontRevision = mFont->mRevision;
+    mLayoutLayout = layout();
+    mLayoutKerning = kerningEnabled();
+    mLayoutDirty = true;
   }
 
-  for(unsigned iline=0; iline<lines.size(); iline++)
+  // these only move the lines
+  if ( mLayoutAlignment != alignment() || mLayoutTextAlignment != textAlignment() || mLayoutMargin != margin() )
   {
+    mLayoutAlignment = alignment();
+    mLayoutTextAlignment = textAlignment();
+    mLayoutMargin = margin();
+    mLayoutDirty = true;
+  }
 
-    if (textAlignment() == TextAlignJustify)
-    {
+  if (!mLayoutDirty)
+    return;
+  mLayoutDirty = false;
 
-      for(unsigned ch=0, skip=0; ch < lines[iline].length(); ++ch)
-      {
-        if ( lines[iline][ch] != ' ' && lines[iline][ch] != '\t' )
-        {
-          lines[iline] = &lines[iline][0] + skip;
-          break;
-        }
-        else
-          skip++;
-      }
+  // lay out again only the lines whose text changed
 
-      for(size_t ch=lines[iline].length(), skip=0; ch--; )
-      {
-        if ( lines[iline][ch] != ' ' && lines[iline][ch] != '\t' )
-        {
-          lines[iline].resize( lines[iline].length() - skip );
-          break;
-        }
-        else
-          skip++;
-      }
+  unsigned line_count = 0;
+  for(std::wstring::size_type start = 0; ; ++line_count)
+  {
+    std::wstring::size_type end = text().find( L'\n', start );
+    if (end == std::wstring::npos)
+      end = text().length();
+
+    if (line_count == mLineCache.size())
+      mLineCache.push_back( TextLine() );
+
+    TextLine& line = mLineCache[line_count];
+    if ( line.mText.compare( 0, std::wstring::npos, text(), start, end - start ) != 0 )
+      layoutLine( line, text(), start, end - start );
+
+    if (end == text().length())
+    {
+      ++line_count;
+      break;
     }
+    start = end + 1;
+  }
+  mLineCache.resize(line_count);
+
+  float line_height = mFont->mHeight ? mFont->mHeight : mFont->mSize;
+
+  mLayoutBox.setEmpty();
+  for(unsigned iline=0; iline<mLineCache.size(); iline++)
+  {
+    const AABB& box = mLineCache[iline].mBox;
+    if (box.isEmpty())
+      continue;
+    mLayoutBox.addPoint( box.minCorner() - vec3d(0, iline*line_height, 0) );
+    mLayoutBox.addPoint( box.maxCorner() - vec3d(0, iline*line_height, 0) );
+  }
+
+  const AABB& rbbox = mLayoutBox; // for text alignment
+  AABB bbox = rbbox; 
+  bbox.setMaxCorner( bbox.maxCorner() + vec3d(2*margin(),2*margin(),0) );
+
+  vec2 align(0,0);
+
+  if (alignment() & AlignHCenter)
+  {
+    CHECK( !(alignment() & AlignRight) )
+    CHECK( !(alignment() & AlignLeft) )
+    align.x() -= (int)(bbox.width() / 2.0f);
+  }
+
+  if (alignment() & AlignRight)
+  {
+    CHECK( !(alignment() & AlignHCenter) )
+    CHECK( !(alignment() & AlignLeft) )
+    align.x() -= (int)bbox.width();
+  }
 
-    AABB linebox = rawBoundingBox( lines[iline] );
+  if (alignment() & AlignTop)
+  {
+    CHECK( !(alignment() & AlignBottom) )
+    CHECK( !(alignment() & AlignVCenter) )
+    align.y() -= (int)bbox.height();
+  }
+
+  if (alignment() & AlignVCenter)
+  {
+    CHECK( !(alignment() & AlignTop) )
+    CHECK( !(alignment() & AlignBottom) )
+    align.y() -= int(bbox.height() / 2.0);
+  }
+
+  // position of each line and the justification spacing
+
+  std::vector<vec2> line_origin( mLineCache.size() );
+  std::vector<int> just_space( mLineCache.size(), 0 );
+  std::vector<int> just_remained_space( mLineCache.size(), 0 );
+  std::vector<GLuint> pages;
+
+  for(unsigned iline=0; iline<mLineCache.size(); iline++)
+  {
+    const TextLine& line = mLineCache[iline];
+    const AABB& linebox = line.mBox;
     int displace = 0;
-    int just_space = 0;
-    int just_remained_space = 0;
+
     int space_count = 0;
-    for(int c=0; c<(int)lines[iline].length(); c++)
-      if ( lines[iline][c] == ' ' )
+    for(unsigned c=0; c<line.mText.length(); c++)
+      if ( line.mText[c] == ' ' )
         space_count++;
 
-    if (space_count && textAlignment() == TextAlignJustify)
+    if (space_count && justify)
     {
-      just_space          = int(rbbox.width() - linebox.width()) / space_count;
-      just_remained_space = int(rbbox.width() - linebox.width()) % space_count;
+      just_space[iline]          = int(rbbox.width() - linebox.width()) / space_count;
+      just_remained_space[iline] = int(rbbox.width() - linebox.width()) % space_count;
     }
 
     if (layout() == RightToLeftText)
@@ -639,259 +797,152 @@ void Text::drawText(int render_stream, Actor* actor, const vec4& color, const ve
         displace = + int((rbbox.width() - linebox.width()) / 2.0f);
     }
 
-    for(int c=0; c<(int)lines[iline].length(); c++)
-    {
-      if (c == 0 && iline != 0)
-      {
-        pen.y() -= mFont->mHeight;
-        pen.x()  = 0;
+    line_origin[iline].x() = float(margin() + displace - rbbox.minCorner().x()) + align.x();
+    line_origin[iline].y() = float(margin() - iline*line_height - rbbox.minCorner().y()) + align.y();
 
-      }
+    for(unsigned q=0; q<line.mTextures.size(); q++)
+      if ( std::find( pages.begin(), pages.end(), line.mTextures[q] ) == pages.end() )
+        pages.push_back( line.mTextures[q] );
+  }
 
-      const ref<Glyph>& glyph = mFont->glyph( lines[iline][c] );
+  // gather the quads sorted by atlas page
 
-      if (!glyph)
-        continue;
+  mVertexCache.clear();
+  mTexCoordCache.clear();
+  mBatches.clear();
 
-      if ( kerningEnabled() && use_kerning && previous && glyph->glyphIndex() ) 
-      { 
-        FT_Vector delta; delta.y = 0;
-        if (layout() == LeftToRightText)
-        {
-          FT_Get_Kerning( font()->mFT_Face, previous, glyph->glyphIndex(), FT_KERNING_DEFAULT, &delta );
-          pen.x() += delta.x / 64.0f; 
-        }
-        else
-        if (layout() == RightToLeftText)
-        {
-          FT_Get_Kerning( font()->mFT_Face, glyph->glyphIndex(), previous, FT_KERNING_DEFAULT, &delta );
-          pen.x() -= delta.x / 64.0f; 
-        }
-        pen.y() += delta.y / 64.0f; 
-      }
-      previous = glyph->glyphIndex();
+  for(unsigned ipage=0; ipage<pages.size(); ipage++)
+  {
+    TextBatch batch;
+    batch.mTexture = pages[ipage];
+    batch.mFirst   = (int)mVertexCache.size();
 
-      if (glyph->textureHandle())
+    for(unsigned iline=0; iline<mLineCache.size(); iline++)
+    {
+      const TextLine& line = mLineCache[iline];
+      for(unsigned q=0; q<line.mTextures.size(); q++)
       {
-        glBindTexture( GL_TEXTURE_2D, glyph->textureHandle() );
-
-        texc[0] = glyph->s0();
-        texc[1] = glyph->t1();
-        texc[2] = glyph->s1();
-        texc[3] = glyph->t1();
-        texc[4] = glyph->s1();
-        texc[5] = glyph->t0();
-        texc[6] = glyph->s0();
-        texc[7] = glyph->t0();
-
-        int left = layout() == RightToLeftText ? -glyph->left() : +glyph->left();
+        if (line.mTextures[q] != pages[ipage])
+          continue;
 
-        vect[0].x() = pen.x() + glyph->width()*0 + left -1;
-        vect[0].y() = pen.y() + glyph->height()*0 + glyph->top() - glyph->height() -1;
-
-        vect[1].x() = pen.x() + glyph->width()*1 + left +1; 
-        vect[1].y() = pen.y() + glyph->height()*0 + glyph->top() - glyph->height() -1;
-
-        vect[2].x() = pen.x() + glyph->width()*1 + left +1; 
-        vect[2].y() = pen.y() + glyph->height()*1 + glyph->top() - glyph->height() +1;
-
-        vect[3].x() = pen.x() + glyph->width()*0 + left -1; 
-        vect[3].y() = pen.y() + glyph->height()*1 + glyph->top() - glyph->height() +1;
-
-        if (layout() == RightToLeftText)
+        vec2 origin = line_origin[iline];
+        if (just_space[iline])
         {
-  #if (1)
-          vect[0].x() -= glyph->width()-1 +2;
-          vect[1].x() -= glyph->width()-1 +2;
-          vect[2].x() -= glyph->width()-1 +2;
-          vect[3].x() -= glyph->width()-1 +2;
-  #endif
+          int spaces = line.mSpaces[q];
+          int shift  = spaces * just_space[iline] + (spaces < just_remained_space[iline] ? spaces : just_remained_space[iline]);
+          origin.x() += layout() == RightToLeftText ? -shift : +shift;
         }
 
-        vect[0].y() -= mFont->mHeight;
-        vect[1].y() -= mFont->mHeight;
-        vect[2].y() -= mFont->mHeight;
-        vect[3].y() -= mFont->mHeight;
-
-  #if (1)
-
-        vect[0] -= bbox.minCorner().to_vec3().xy();
-        vect[1] -= bbox.minCorner().to_vec3().xy();
-        vect[2] -= bbox.minCorner().to_vec3().xy();
-        vect[3] -= bbox.minCorner().to_vec3().xy();
-  #endif
-
-  #if (1)
-
-        vect[0].x() += margin() + displace;
-        vect[1].x() += margin() + displace;
-        vect[2].x() += margin() + displace;
-        vect[3].x() += margin() + displace;
-
-        vect[0].y() += margin();
-        vect[1].y() += margin();
-        vect[2].y() += margin();
-        vect[3].y() += margin();
-  #endif
-
-        vect[0] += offset;
-        vect[1] += offset;
-        vect[2] += offset;
-        vect[3] += offset;
-
         for(int i=0; i<4; i++)
         {
-          if (alignment() & AlignHCenter)
-          {
-            CHECK( !(alignment() & AlignRight) )
-            CHECK( !(alignment() & AlignLeft) )
-            vect[i].x() -= (int)(bbox.width() / 2.0f);
-          }
-
-          if (alignment() & AlignRight)
-          {
-            CHECK( !(alignment() & AlignHCenter) )
-            CHECK( !(alignment() & AlignLeft) )
-            vect[i].x() -= (int)bbox.width();
-          }
-
-          if (alignment() & AlignTop)
-          {
-            CHECK( !(alignment() & AlignBottom) )
-            CHECK( !(alignment() & AlignVCenter) )
-            vect[i].y() -= (int)bbox.height();
-          }
-
-          if (alignment() & AlignVCenter)
-          {
-            CHECK( !(alignment() & AlignTop) )
-            CHECK( !(alignment() & AlignBottom) )
-            vect[i].y() -= int(bbox.height() / 2.0);
-          }
+          mVertexCache.push_back( line.mVertices[q*4+i] + origin );
+          mTexCoordCache.push_back( line.mTexCoords[q*4+i] );
         }
+      }
+    }
 
-        mat4d m = mMatrix;
-        
-#if(1)
-        if ( !actor->transform() )
-        {
-          if (viewportAlignment() & AlignHCenter)
-          {
-            CHECK( !(viewportAlignment() & AlignRight) )
-            CHECK( !(viewportAlignment() & AlignLeft) )
-
-            m.translate( int((viewport[2]-1.0f) / 2.0f), 0, 0);
-          }
+    batch.mCount = (int)mVertexCache.size() - batch.mFirst;
+    mBatches.push_back(batch);
+  }
+}
 
-          if (viewportAlignment() & AlignRight)
-          {
-            CHECK( !(viewportAlignment() & AlignHCenter) )
-            CHECK( !(viewportAlignment() & AlignLeft) )
+void Text::layoutLine(TextLine& line, const std::wstring& text, std::wstring::size_type start, std::wstring::size_type count) const
+{
+  line.mText.assign( text, start, count );
+  line.mVertices.clear();
+  line.mTexCoords.clear();
+  line.mTextures.clear();
+  line.mSpaces.clear();
 
-            m.translate( int(viewport[2]-1.0f), 0, 0);
-          }
+  std::wstring str = line.mText;
 
-          if (viewportAlignment() & AlignTop)
-          {
-            CHECK( !(viewportAlignment() & AlignBottom) )
-            CHECK( !(viewportAlignment() & AlignVCenter) )
+  if (textAlignment() == TextAlignJustify)
+  {
+    std::wstring::size_type first = str.find_first_not_of( L" \t" );
+    std::wstring::size_type last  = str.find_last_not_of( L" \t" );
+    if (first == std::wstring::npos)
+      str.clear();
+    else
+      str = str.substr( first, last - first + 1 );
+  }
 
-            m.translate( 0, int(viewport[3]-1.0f), 0);
-          }
+  line.mBox = rawBoundingBox( str );
 
-          if (viewportAlignment() & AlignVCenter)
-          {
-            CHECK( !(viewportAlignment() & AlignTop) )
-            CHECK( !(viewportAlignment() & AlignBottom) )
+  vec2 pen(0,0);
+  vec2 vect[4];
+  int spaces = 0;
 
-            m.translate( 0, int((viewport[3]-1.0f) / 2.0f), 0);
-          }
-        }
-#endif
+  FT_Long use_kerning = FT_HAS_KERNING( font()->mFT_Face );
+  FT_UInt previous = 0;
 
-        vect[0] = (m * (vec2d)vect[0]).to_vec2();
-        vect[1] = (m * (vec2d)vect[1]).to_vec2();
-        vect[2] = (m * (vec2d)vect[2]).to_vec2();
-        vect[3] = (m * (vec2d)vect[3]).to_vec2();
+  for(int c=0; c<(int)str.length(); c++)
+  {
+    const ref<Glyph>& glyph = mFont->glyph( str[c] );
 
-        if ( actor->transform() && mode() == Text2D )
-        {
-          vec4d v(0,0,0,1);
-          v = actor->transform()->localToWorldMatrix( render_stream ) * v;
+    if (!glyph)
+      continue;
 
-          GlobalState::renderStream( render_stream )->currentCamera()->project(v,v);
+    if ( kerningEnabled() && use_kerning && previous && glyph->glyphIndex() ) 
+    { 
+      FT_Vector delta; delta.y = 0;
+      if (layout() == LeftToRightText)
+      {
+        FT_Get_Kerning( font()->mFT_Face, previous, glyph->glyphIndex(), FT_KERNING_DEFAULT, &delta );
+        pen.x() += delta.x / 64.0f; 
+      }
+      else
+      if (layout() == RightToLeftText)
+      {
+        FT_Get_Kerning( font()->mFT_Face, glyph->glyphIndex(), previous, FT_KERNING_DEFAULT, &delta );
+        pen.x() -= delta.x / 64.0f; 
+      }
+      pen.y() += delta.y / 64.0f; 
+    }
+    previous = glyph->glyphIndex();
 
-          v.x() -= viewport[0];
-          v.y() -= viewport[1];
+    if (glyph->textureHandle())
+    {
+      int left = layout() == RightToLeftText ? -glyph->left() : +glyph->left();
 
-          v.x() = int(v.x());
-          v.y() = int(v.y());
+      vect[0].x() = pen.x() + glyph->width()*0 + left -1;
+      vect[0].y() = pen.y() + glyph->height()*0 + glyph->top() - glyph->height() -1;
 
-          vect[0] += v.xy().to_vec2();
-          vect[1] += v.xy().to_vec2();
-          vect[2] += v.xy().to_vec2();
-          vect[3] += v.xy().to_vec2();
-        }
+      vect[1].x() = pen.x() + glyph->width()*1 + left +1; 
+      vect[1].y() = pen.y() + glyph->height()*0 + glyph->top() - glyph->height() -1;
 
-        glDrawArrays(GL_QUADS, 0, 4);
+      vect[2].x() = pen.x() + glyph->width()*1 + left +1; 
+      vect[2].y() = pen.y() + glyph->height()*1 + glyph->top() - glyph->height() +1;
 
-  #if (0)
-        vec4 red[] = { vec4(1,0,0,1), vec4(1,0,0,1), vec4(1,0,0,1), vec4(1,0,0,1) };
-        glDisable(GL_TEXTURE_2D);
-        glColorPointer(4, GL_FLOAT, 0, red);
-        glDrawArrays(GL_LINE_LOOP, 0, 4);
-        glColorPointer(4, GL_FLOAT, 0, cols);
-        glEnable(GL_TEXTURE_2D);
-  #endif
-      }
+      vect[3].x() = pen.x() + glyph->width()*0 + left -1; 
+      vect[3].y() = pen.y() + glyph->height()*1 + glyph->top() - glyph->height() +1;
 
-      if (just_space && lines[iline][c] == ' ' && iline != lines.size()-1)
+      for(int i=0; i<4; i++)
       {
-        if (layout() == LeftToRightText)
-        {
-          pen.x() += just_space + (just_remained_space?1:0);
-
-        }
-        else
         if (layout() == RightToLeftText)
-        {
-          pen.x() -= just_space + (just_remained_space?1:0);
+          vect[i].x() -= glyph->width()-1 +2;
 
-        }
-        if(just_remained_space) 
-          just_remained_space--;
-      }
-
-      if (layout() == LeftToRightText)
-      {
-        pen.x() += glyph->advance().x();
+        vect[i].y() -= mFont->mHeight;
 
+        line.mVertices.push_back( vect[i] );
       }
-      else
-      if (layout() == RightToLeftText)
-      {
-        pen.x() -= glyph->advance().x();
 
-      }
+      line.mTexCoords.push_back( vec2(glyph->s0(), glyph->t1()) );
+      line.mTexCoords.push_back( vec2(glyph->s1(), glyph->t1()) );
+      line.mTexCoords.push_back( vec2(glyph->s1(), glyph->t0()) );
+      line.mTexCoords.push_back( vec2(glyph->s0(), glyph->t0()) );
 
+      line.mTextures.push_back( glyph->textureHandle() );
+      line.mSpaces.push_back( spaces );
     }
-  }
 
-  glDisableClientState( GL_VERTEX_ARRAY );
-  glDisableClientState( GL_NORMAL_ARRAY );
-  glDisableClientState( GL_COLOR_ARRAY );
-  glDisableClientState( GL_TEXTURE_COORD_ARRAY );
-#endif
-
-  GLCHECK4();
-
-  if (mode() == Text2D)
-  {
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix(); GLCHECK4()
+    if (str[c] == ' ')
+      spaces++;
 
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix(); GLCHECK4()
+    if (layout() == LeftToRightText)
+      pen.x() += glyph->advance().x();
+    else
+    if (layout() == RightToLeftText)
+      pen.x() -= glyph->advance().x();
   }
 }
 
@@ -1120,13 +1171,20 @@ void Text::drawBorder(int render_stream, Actor* actor)
 
 AABB Text::boundingBox() const
 {
-  return boundingBox(text());
+  if (!mFont || !font()->mFT_Face)
+    return boundingBox(text());
+
+  updateLayout();
+  return alignedBoundingBox(mLayoutBox);
 }
 
 AABB Text::boundingBox(const std::wstring& text) const
 {
-  AABB bbox = rawBoundingBox( text );
+  return alignedBoundingBox( rawBoundingBox( text ) );
+}
 
+AABB Text::alignedBoundingBox(AABB bbox) const
+{
   bbox.setMaxCorner( bbox.maxCorner() + vec3d(2*margin(),2*margin(),0) );
 
   vec3d min = bbox.minCorner() - bbox.minCorner();
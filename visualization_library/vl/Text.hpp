@@ -23,7 +23,9 @@
 #include "vl/Drawable.hpp"
 #include "vl/vec4d.hpp"
 #include "vl/enums.hpp"
+#include "vl/AABB.hpp"
 #include <string>
+#include <vector>
 #include <map>
 
 struct FT_FaceRec_;
@@ -42,8 +44,7 @@ namespace vl
   public:
     Glyph(): mTextureHandle(0), mWidth(0), mHeight(0), mLeft(0), mTop(0), mS0(0), mT0(0), mS1(0), mT1(0),mGlyphIndex(0), mFont(NULL) {}
 
-    ~Glyph();
-
+    //! The atlas page holding the glyph, shared with the other glyphs of the Font and owned by it.
     GLuint textureHandle() const { return mTextureHandle; }
     void setTextureHandle(GLuint handle) { mTextureHandle = handle; }
 
@@ -100,7 +101,7 @@ namespace vl
     friend class Text;
   public:
     void operator=(const Font& other);
-    Font(const Font& other): Object(other) { *this = other; }
+    Font(const Font& other): Object(other), mFT_Face(NULL), mSize(0), mHeight(0), mSmooth(false), mAtlasPageSize(0), mAtlasX(0), mAtlasY(0), mAtlasRowHeight(0), mRevision(0) { *this = other; }
     Font();
     Font(const std::string& font_file, int size );
     ~Font();
@@ -113,6 +114,10 @@ namespace vl
     void setSmooth(bool smooth);
     bool smooth() const { return mSmooth; }
 
+  protected:
+    void releaseGlyphs();
+    GLuint allocateAtlasCell(int w, int h, int& x, int& y);
+
   protected:
     std::string mFontFile;
     std::map< int, ref<Glyph> > mGlyphMap;
@@ -120,6 +125,14 @@ namespace vl
     int mSize;
     float mHeight;
     bool mSmooth;
+    // glyph atlas: the glyphs are packed on shelves into a few RGBA pages
+    std::vector<GLuint> mAtlasTextures;
+    int mAtlasPageSize;
+    int mAtlasX;
+    int mAtlasY;
+    int mAtlasRowHeight;
+    // incremented every time the glyphs are released, invalidates the Text layouts
+    unsigned int mRevision;
   };
 
   class Text: public Drawable
@@ -127,10 +140,12 @@ namespace vl
   public:
     Text(): mColor(1,1,1,1), mBorderColor(0,0,0,1), mBackgroundColor(1,1,1,1), mOutlineColor(0,0,0,1), mShadowColor(0,0,0,0.5f), mShadowVector(2,-2), 
       mInterlineSpacing(5), mAlignment(AlignTop|AlignLeft), mViewportAlignment(AlignTop|AlignLeft), mMargin(5), mMode(Text2D), mLayout(LeftToRightText), mTextAlignment(TextAlignLeft), 
-      mBorderEnabled(false), mBackgroundEnabled(false), mOutlineEnabled(false), mShadowEnabled(false), mKerningEnabled(true) {}
+      mBorderEnabled(false), mBackgroundEnabled(false), mOutlineEnabled(false), mShadowEnabled(false), mKerningEnabled(true),
+      mLayoutFont(NULL), mLayoutFontRevision(0), mLayoutAlignment(0), mLayoutTextAlignment(TextAlignLeft), mLayoutMargin(0), mLayoutLayout(LeftToRightText),
+      mLayoutKerning(true), mLayoutDirty(true) {}
 
     const std::wstring& text() const { return mText; }
-    void setText(const std::wstring& text) { mText = text; }
+    void setText(const std::wstring& text) { if (text != mText) { mText = text; mLayoutDirty = true; } }
 
     const vec4& color() const { return mColor; }
     void setColor(const vec4& color) { mColor = color; }
@@ -204,10 +219,32 @@ namespace vl
     void resetMatrix();
 
   protected:
+    //! The glyph quads of one line, relative to the pen position at the start of the line
+    struct TextLine
+    {
+      std::wstring mText;
+      AABB mBox;
+      std::vector<vec2> mVertices;
+      std::vector<vec2> mTexCoords;
+      std::vector<GLuint> mTextures; // one per quad
+      std::vector<int> mSpaces;      // one per quad: spaces preceding the glyph, for justification
+    };
+
+    //! A range of the layout vertex arrays using the same atlas page
+    struct TextBatch
+    {
+      GLuint mTexture;
+      int mFirst;
+      int mCount;
+    };
+
     void drawText(int render_stream, Actor*, const vec4& color, const vec2& offset);
     void drawBackground(int render_stream, Actor* actor);
     void drawBorder(int render_stream, Actor* actor);
     AABB rawBoundingBox(const std::wstring& text) const;
+    AABB alignedBoundingBox(AABB bbox) const;
+    void updateLayout() const;
+    void layoutLine(TextLine& line, const std::wstring& text, std::wstring::size_type start, std::wstring::size_type count) const;
 
   protected:
     ref<Font> mFont;
@@ -231,6 +268,21 @@ namespace vl
     bool mOutlineEnabled;
     bool mShadowEnabled;
     bool mKerningEnabled;
+
+    // layout cache, only the lines whose text changed are laid out again
+    mutable std::vector<TextLine> mLineCache;
+    mutable std::vector<vec2> mVertexCache;
+    mutable std::vector<vec2> mTexCoordCache;
+    mutable std::vector<TextBatch> mBatches;
+    mutable AABB mLayoutBox;
+    mutable const Font* mLayoutFont;
+    mutable unsigned int mLayoutFontRevision;
+    mutable int mLayoutAlignment;
+    mutable ETextAlign mLayoutTextAlignment;
+    mutable int mLayoutMargin;
+    mutable ETextLayout mLayoutLayout;
+    mutable bool mLayoutKerning;
+    mutable bool mLayoutDirty;
   };
 
 }
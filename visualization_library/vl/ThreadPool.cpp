@@ -0,0 +1,152 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "vl/ThreadPool.hpp"
+#include "vl/Trace.hpp"
+#ifdef WIN32
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+using namespace vl;
+
+ThreadPool::ThreadPool(int thread_count)
+{
+  mTask = NULL;
+  mCount = 0;
+  mNext = 0;
+  mPending = 0;
+  mQuit = false;
+
+#ifndef WIN32
+  if (thread_count <= 0)
+    thread_count = cpuCount();
+
+  pthread_mutex_init(&mMutex, NULL);
+  pthread_cond_init(&mWorkReady, NULL);
+  pthread_cond_init(&mWorkDone, NULL);
+
+  for(int i=1; i<thread_count; ++i)
+  {
+    pthread_t thread;
+    if ( pthread_create(&thread, NULL, &ThreadPool::threadMain, this) != 0 )
+      break;
+    mThreads.push_back(thread);
+  }
+#endif
+}
+
+ThreadPool::~ThreadPool()
+{
+#ifndef WIN32
+  pthread_mutex_lock(&mMutex);
+  mQuit = true;
+  pthread_cond_broadcast(&mWorkReady);
+  pthread_mutex_unlock(&mMutex);
+
+  for(int i=0; i<(int)mThreads.size(); ++i)
+    pthread_join(mThreads[i], NULL);
+
+  pthread_cond_destroy(&mWorkDone);
+  pthread_cond_destroy(&mWorkReady);
+  pthread_mutex_destroy(&mMutex);
+#endif
+}
+
+int ThreadPool::cpuCount()
+{
+#ifdef WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int)count : 1;
+#endif
+}
+
+void ThreadPool::run(ThreadTask* task, int count)
+{
+  if (mThreads.empty() || count < 2)
+  {
+    for(int i=0; i<count; ++i)
+      task->run(i);
+    return;
+  }
+
+#ifndef WIN32
+  pthread_mutex_lock(&mMutex);
+  mTask = task;
+  mCount = count;
+  mNext = 0;
+  mPending = count;
+  pthread_cond_broadcast(&mWorkReady);
+
+  // the calling thread takes pieces like the workers
+  while(mNext < mCount)
+  {
+    int i = mNext++;
+    pthread_mutex_unlock(&mMutex);
+    task->run(i);
+    pthread_mutex_lock(&mMutex);
+    --mPending;
+  }
+
+  while(mPending > 0)
+    pthread_cond_wait(&mWorkDone, &mMutex);
+
+  mTask = NULL;
+  mCount = 0;
+  mNext = 0;
+  pthread_mutex_unlock(&mMutex);
+#endif
+}
+
+void* ThreadPool::threadMain(void* pool)
+{
+  ((ThreadPool*)pool)->work();
+  return NULL;
+}
+
+void ThreadPool::work()
+{
+#ifndef WIN32
+  Trace::setThreadName("vl::ThreadPool");
+  pthread_mutex_lock(&mMutex);
+  for(;;)
+  {
+    while(!mQuit && mNext >= mCount)
+      pthread_cond_wait(&mWorkReady, &mMutex);
+    if (mQuit)
+      break;
+
+    int i = mNext++;
+    ThreadTask* task = mTask;
+    pthread_mutex_unlock(&mMutex);
+    task->run(i);
+    pthread_mutex_lock(&mMutex);
+
+    if (--mPending == 0)
+      pthread_cond_signal(&mWorkDone);
+  }
+  pthread_mutex_unlock(&mMutex);
+#endif
+}
@@ -0,0 +1,82 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ThreadPool_INCLUDE_DEFINE
+#define ThreadPool_INCLUDE_DEFINE
+
+#include "vl/Object.hpp"
+#include <vector>
+#ifndef WIN32
+  #include <pthread.h>
+#endif
+
+namespace vl
+{
+
+  //! A job split in independent pieces, run() is called once for each piece and
+  //! possibly on several threads at the same time.
+  class ThreadTask
+  {
+  public:
+    virtual ~ThreadTask() {}
+    virtual void run(int index) = 0;
+  };
+
+  //! A set of worker threads that run the pieces of a ThreadTask together with the calling thread.
+  //! The threads are created by the constructor and wait for work until the pool is destroyed.
+  //! The pool is not reentrant, a task must not call run() on the pool running it.
+  //! On Windows the pieces are run on the calling thread.
+  class ThreadPool: public Object
+  {
+  public:
+    //! thread_count includes the calling thread, 0 creates one thread per core.
+    ThreadPool(int thread_count = 0);
+    virtual ~ThreadPool();
+
+    int threadCount() const { return (int)mThreads.size() + 1; }
+
+    //! Calls task->run(i) for i in [0, count) and returns when all of them are done.
+    void run(ThreadTask* task, int count);
+
+    static int cpuCount();
+
+  protected:
+    static void* threadMain(void* pool);
+    void work();
+
+  protected:
+#ifndef WIN32
+    std::vector<pthread_t> mThreads;
+    pthread_mutex_t mMutex;
+    pthread_cond_t mWorkReady;
+    pthread_cond_t mWorkDone;
+#else
+    std::vector<int> mThreads;
+#endif
+    ThreadTask* mTask;
+    int mCount;
+    int mNext;
+    int mPending;
+    bool mQuit;
+  };
+
+}
+
+#endif
@@ -23,7 +23,7 @@
 #ifdef WIN32
   #include <windows.h>
 #else
-  #include <sys/time.h> // gettimeofday
+  #include <time.h> // clock_gettime
 #endif
 
 using namespace vl;
@@ -44,8 +44,9 @@ Time::Time()
   mSecond = local_time.wSecond;
   mMicrosecond = local_time.wMilliseconds * 1000;
 #else
-  time_t secs;
-  time(&secs);
+  struct timespec ts;
+  clock_gettime( CLOCK_REALTIME, &ts );
+  time_t secs = ts.tv_sec;
   tm* date = localtime( &secs );
 
   mYear = date->tm_year + 1900;
@@ -55,10 +56,7 @@ Time::Time()
   mHour = date->tm_hour;
   mMinute = date->tm_min;
   mSecond = date->tm_sec;
-
-  struct timeval tv;
-  gettimeofday( &tv, NULL );
-  mMicrosecond = tv.tv_usec;
+  mMicrosecond = ts.tv_nsec / 1000;
 #endif
 }
 
@@ -79,9 +77,10 @@ double Time::timerSeconds()
     return (double)GetTickCount() / 1000.0;
   }
 #else
-  struct timeval tv;
-  gettimeofday( &tv, NULL );
-  return (double) tv.tv_sec + (double) tv.tv_usec * 0.000001;
+  // unlike the time of day it never jumps, and it has a nanosecond resolution
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 0.000000001;
 #endif
 }
 
@@ -0,0 +1,195 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vl/Trace.hpp"
+#include <cstdio>
+#include <vector>
+#ifndef WIN32
+  #include <pthread.h>
+  #include <unistd.h>
+#endif
+
+using namespace vl;
+
+namespace
+{
+  struct TraceEvent
+  {
+    const char* mName;
+    const char* mCategory;
+    double mStart;
+    double mDuration;
+  };
+
+  //! The zones of one thread, zone n is in slot n % size. The slots are
+  //! allocated with the first zone, naming a thread costs no memory.
+  struct TraceBuffer
+  {
+    std::vector<TraceEvent> mEvents;
+    long long mWritten;
+    int mThreadId;
+    std::string mThreadName;
+  };
+
+  int gBufferSize = 1 << 16;
+
+#ifndef WIN32
+  // the buffers outlive their threads, so the zones of finished threads are exported too
+  std::vector<TraceBuffer*> gBuffers;
+  pthread_mutex_t gMutex = PTHREAD_MUTEX_INITIALIZER;
+  __thread TraceBuffer* tBuffer = NULL;
+
+  TraceBuffer* threadBuffer()
+  {
+    if (!tBuffer)
+    {
+      TraceBuffer* buffer = new TraceBuffer;
+      buffer->mWritten = 0;
+      pthread_mutex_lock(&gMutex);
+      buffer->mThreadId = (int)gBuffers.size() + 1;
+      gBuffers.push_back(buffer);
+      pthread_mutex_unlock(&gMutex);
+      tBuffer = buffer;
+    }
+    return tBuffer;
+  }
+#endif
+
+  void writeString(FILE* fout, const char* str)
+  {
+    fputc('"', fout);
+    for(; *str; ++str)
+    {
+      if (*str == '"' || *str == '\\')
+        fprintf(fout, "\\%c", *str);
+      else
+      if ((unsigned char)*str < 0x20)
+        fprintf(fout, "\\u%04x", *str);
+      else
+        fputc(*str, fout);
+    }
+    fputc('"', fout);
+  }
+}
+
+int Trace::mEnabled = 0;
+
+void Trace::setEnabled(bool enabled)
+{
+#ifndef WIN32
+  __atomic_store_n(&mEnabled, enabled ? 1 : 0, __ATOMIC_RELAXED);
+#endif
+}
+
+void Trace::setBufferSize(int zones)
+{
+#ifndef WIN32
+  pthread_mutex_lock(&gMutex);
+  gBufferSize = zones < 16 ? 16 : zones;
+  pthread_mutex_unlock(&gMutex);
+#endif
+}
+
+int Trace::bufferSize()
+{
+  return gBufferSize;
+}
+
+void Trace::setThreadName(const char* name)
+{
+#ifndef WIN32
+  TraceBuffer* buffer = threadBuffer();
+  pthread_mutex_lock(&gMutex);
+  buffer->mThreadName = name;
+  pthread_mutex_unlock(&gMutex);
+#endif
+}
+
+void Trace::addZone(const char* name, const char* category, double start)
+{
+#ifndef WIN32
+  TraceBuffer* buffer = threadBuffer();
+  if (buffer->mEvents.empty())
+  {
+    pthread_mutex_lock(&gMutex);
+    buffer->mEvents.resize(gBufferSize);
+    pthread_mutex_unlock(&gMutex);
+  }
+  long long index = buffer->mWritten;
+  TraceEvent& event = buffer->mEvents[index % buffer->mEvents.size()];
+  event.mName = name;
+  event.mCategory = category;
+  event.mStart = start;
+  event.mDuration = Time::timerSeconds() - start;
+  __atomic_store_n(&buffer->mWritten, index + 1, __ATOMIC_RELEASE);
+#endif
+}
+
+bool Trace::writeChromeTrace(const std::string& path)
+{
+  FILE* fout = fopen(path.c_str(), "wb");
+  if (!fout)
+    return false;
+
+  fprintf(fout, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+#ifndef WIN32
+  int pid = (int)getpid();
+  bool first = true;
+  std::vector<TraceEvent> events;
+  pthread_mutex_lock(&gMutex);
+  for(int b=0; b<(int)gBuffers.size(); ++b)
+  {
+    const TraceBuffer* buffer = gBuffers[b];
+    long long size = (long long)buffer->mEvents.size();
+
+    // the slot of the oldest zone may be written right now
+    long long written = __atomic_load_n(&buffer->mWritten, __ATOMIC_ACQUIRE);
+    long long oldest = written - size + 1 > 0 ? written - size + 1 : 0;
+    events.assign(buffer->mEvents.begin(), buffer->mEvents.end());
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    long long now_written = __atomic_load_n(&buffer->mWritten, __ATOMIC_RELAXED);
+    if (now_written - size + 1 > oldest)
+      oldest = now_written - size + 1;
+
+    if (!buffer->mThreadName.empty())
+    {
+      fprintf(fout, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", pid, buffer->mThreadId);
+      writeString(fout, buffer->mThreadName.c_str());
+      fprintf(fout, "}}");
+      first = false;
+    }
+
+    for(long long i=oldest; i<written; ++i)
+    {
+      const TraceEvent& event = events[i % size];
+      fprintf(fout, "%s{\"name\":", first ? "" : ",\n");
+      writeString(fout, event.mName);
+      fprintf(fout, ",\"cat\":");
+      writeString(fout, event.mCategory);
+      fprintf(fout, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}", event.mStart*1e6, event.mDuration*1e6, pid, buffer->mThreadId);
+      first = false;
+    }
+  }
+  pthread_mutex_unlock(&gMutex);
+#endif
+  fprintf(fout, "\n]}\n");
+
+  bool ok = !ferror(fout);
+  return fclose(fout) == 0 && ok;
+}
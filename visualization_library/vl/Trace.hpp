@@ -0,0 +1,100 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef Trace_INCLUDE_DEFINE
+#define Trace_INCLUDE_DEFINE
+
+#include "vl/Time.hpp"
+#include <string>
+
+namespace vl
+{
+
+  /*!
+    A timeline of the zones run by the threads of a program, written in the
+    Chrome trace event format for chrome://tracing or ui.perfetto.dev.
+
+    Every thread records into a buffer of its own, registered when the
+    thread records its first zone, so recording takes no lock: the zone is
+    written into the next slot and the count of zones is published with a
+    release store. The buffer is a ring of bufferSize() zones, when it is
+    full the oldest ones are overwritten, so a long run keeps its end.
+    writeChromeTrace() can be called while the other threads record, it
+    drops the zones overwritten while it copied them.
+
+    Recording is off by default, a TraceZone then costs one load of a flag.
+    The times come from Time::timerSeconds(), the monotonic clock of the
+    system, so the traces of several processes of one run line up.
+    On Windows nothing is recorded.
+  */
+  class Trace
+  {
+  public:
+    static void setEnabled(bool enabled);
+    static bool enabled()
+    {
+#ifdef WIN32
+      return false;
+#else
+      return __atomic_load_n(&mEnabled, __ATOMIC_RELAXED) != 0;
+#endif
+    }
+
+    //! Zones kept per thread, applies to the threads recording their first zone after the call.
+    static void setBufferSize(int zones);
+    static int bufferSize();
+
+    //! Name of the calling thread in the timeline.
+    static void setThreadName(const char* name);
+
+    //! Records a zone of the calling thread from start to now, see TraceZone.
+    //! name and category are kept as pointers, they must live until the export.
+    static void addZone(const char* name, const char* category, double start);
+
+    //! Writes the zones recorded so far, returns false if the file can't be written.
+    static bool writeChromeTrace(const std::string& path);
+
+  protected:
+    static int mEnabled;
+  };
+
+  //! Records the lifetime of the object as a zone of the calling thread,
+  //! if the Trace was enabled when it was created.
+  class TraceZone
+  {
+  public:
+    TraceZone(const char* name, const char* category): mName(name), mCategory(category)
+    {
+      mStart = Trace::enabled() ? Time::timerSeconds() : -1;
+    }
+    ~TraceZone()
+    {
+      if (mStart >= 0)
+        Trace::addZone(mName, mCategory, mStart);
+    }
+
+  protected:
+    const char* mName;
+    const char* mCategory;
+    double mStart;
+  };
+
+}
+
+#endif
@@ -0,0 +1,281 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vl/Trail.hpp"
+#include "vl/GlobalState.hpp"
+
+using namespace vl;
+
+Trail::Trail(int ring_size, int history_size)
+{
+  mRingSize = ring_size < 8 ? 8 : ring_size;
+  mHistorySize = history_size < 8 ? 8 : history_size;
+  mColor = vec4(1,1,1,1);
+  mMinSpacing = 0;
+  mTolerance = 1;
+  mBuffer = new GPUArrayVec3;
+  mBuffer->resize(mHistorySize + mRingSize + 1);
+  clear();
+}
+
+void Trail::setTolerance(float tolerance)
+{
+  mTolerance = tolerance;
+  if (mHistoryCount == 0 || mHistoryTolerance < tolerance)
+    mHistoryTolerance = tolerance;
+}
+
+void Trail::clear()
+{
+  mHistoryTolerance = mTolerance;
+  mPointCount = 0;
+  mHistoryCount = 0;
+  mHistoryDirty = 0;
+  mFirst = 0;
+  mNext = 0;
+  mRingDirty = 0;
+  mAABB.setEmpty();
+  mAABBDirty = false;
+}
+
+void Trail::addPoint(const vec3& point)
+{
+  mPointCount++;
+  // simplifying only drops points, the bounds never shrink
+  mAABB.addPoint( vec3d(point) );
+
+  if (mNext - mFirst >= 2)
+  {
+    const vec3& last = (*mBuffer)[slot(mNext-2)];
+    if ( (point - last).lengthSquared() < mMinSpacing*mMinSpacing )
+    {
+      (*mBuffer)[slot(mNext-1)] = point;
+      if (mRingDirty > mNext-1)
+        mRingDirty = mNext-1;
+      return;
+    }
+  }
+
+  if (mNext - mFirst == mRingSize)
+    retireChunk();
+  (*mBuffer)[slot(mNext)] = point;
+  mNext++;
+}
+
+void Trail::retireChunk()
+{
+  // the last point of the chunk stays in the ring, it joins the history to the ring
+  int count = mRingSize/4 + 1;
+  mScratch.resize(count);
+  for(int i=0; i<count; ++i)
+    mScratch[i] = (*mBuffer)[slot(mFirst+i)];
+  mSimplified.clear();
+  simplify(&mScratch[0], count, mHistoryTolerance, mSimplified);
+
+  // the first point of the chunk is the last one of the history
+  int skip = mHistoryCount ? 1 : 0;
+  int added = (int)mSimplified.size() - skip;
+  if (mHistoryCount + added <= mHistorySize)
+  {
+    for(int i=0; i<added; ++i)
+      (*mBuffer)[mHistoryCount+i] = mSimplified[skip+i];
+    mHistoryCount += added;
+  }
+  else
+  {
+    // simplify history and chunk together until they fit in half the history
+    mScratch.resize(mHistoryCount);
+    for(int i=0; i<mHistoryCount; ++i)
+      mScratch[i] = (*mBuffer)[i];
+    mScratch.insert(mScratch.end(), mSimplified.begin()+skip, mSimplified.end());
+    mSimplified.clear();
+    simplify(&mScratch[0], (int)mScratch.size(), mHistoryTolerance, mSimplified);
+    while( (int)mSimplified.size() > mHistorySize/2 )
+    {
+      mHistoryTolerance *= 2;
+      mSimplified.clear();
+      simplify(&mScratch[0], (int)mScratch.size(), mHistoryTolerance, mSimplified);
+    }
+
+    mHistoryCount = (int)mSimplified.size();
+    for(int i=0; i<mHistoryCount; ++i)
+      (*mBuffer)[i] = mSimplified[i];
+    mHistoryDirty = 0;
+  }
+
+  mFirst += count-1;
+}
+
+void Trail::simplify(const vec3* points, int count, float tolerance, std::vector<vec3>& out)
+{
+  if (count <= 2)
+  {
+    out.insert(out.end(), points, points+count);
+    return;
+  }
+
+  std::vector<char> keep(count, 0);
+  keep[0] = keep[count-1] = 1;
+  std::vector< std::pair<int,int> > stack;
+  stack.push_back( std::make_pair(0, count-1) );
+
+  float tolerance2 = tolerance*tolerance;
+  while(!stack.empty())
+  {
+    int a = stack.back().first;
+    int b = stack.back().second;
+    stack.pop_back();
+
+    // the point farthest from the segment a-b
+    vec3 ab = points[b] - points[a];
+    float len2 = ab.lengthSquared();
+    float max_dist2 = 0;
+    int max_i = -1;
+    for(int i=a+1; i<b; ++i)
+    {
+      vec3 ap = points[i] - points[a];
+      float dist2;
+      if (len2 > 0)
+      {
+        float t = dot(ap, ab) / len2;
+        if (t < 0) t = 0;
+        if (t > 1) t = 1;
+        dist2 = (ap - ab*t).lengthSquared();
+      }
+      else
+        dist2 = ap.lengthSquared();
+      if (dist2 > max_dist2)
+      {
+        max_dist2 = dist2;
+        max_i = i;
+      }
+    }
+
+    if (max_dist2 > tolerance2)
+    {
+      keep[max_i] = 1;
+      stack.push_back( std::make_pair(a, max_i) );
+      stack.push_back( std::make_pair(max_i, b) );
+    }
+  }
+
+  for(int i=0; i<count; ++i)
+    if (keep[i])
+      out.push_back(points[i]);
+}
+
+void Trail::computeAABB()
+{
+  mAABB.setEmpty();
+  for(int i=0; i<mHistoryCount; ++i)
+    mAABB.addPoint( vec3d((*mBuffer)[i]) );
+  for(int seq=mFirst; seq<mNext; ++seq)
+    mAABB.addPoint( vec3d((*mBuffer)[slot(seq)]) );
+}
+
+int Trail::upload(int first, int count)
+{
+  int offset = first * (int)sizeof(vec3);
+  int bytes = count * (int)sizeof(vec3);
+  mBuffer->updateGPUBufferFromLocalBuffer(offset, offset, bytes);
+  return bytes;
+}
+
+void Trail::draw(Actor*, int render_stream, unsigned int)
+{
+  int ring_count = mNext - mFirst;
+  if (mHistoryCount + ring_count < 2)
+    return;
+
+  bool vbo_on = GLEW_ARB_vertex_buffer_object != 0;
+  GLvoid* vertex_pointer = 0;
+  if (vbo_on)
+  {
+    if (mBuffer->handle() == 0)
+    {
+      mBuffer->createGPUBuffer(mBuffer->localBufferEntries(), BUF_DYNAMIC_DRAW);
+      mHistoryDirty = 0;
+      mRingDirty = mFirst;
+    }
+
+    // only what changed since the last frame
+    int bytes = 0;
+    if (mHistoryDirty < mHistoryCount)
+      bytes += upload(mHistoryDirty, mHistoryCount - mHistoryDirty);
+    mHistoryDirty = mHistoryCount;
+
+    int seq = mRingDirty > mFirst ? mRingDirty : mFirst;
+    while(seq < mNext)
+    {
+      int first = seq % mRingSize;
+      int count = mNext - seq;
+      if (first + count > mRingSize)
+        count = mRingSize - first;
+      bytes += upload(mHistorySize + first, count);
+      if (first == 0)
+      {
+        (*mBuffer)[wrapSlot()] = (*mBuffer)[mHistorySize];
+        bytes += upload(wrapSlot(), 1);
+      }
+      seq += count;
+    }
+    mRingDirty = mNext;
+    GlobalState::renderStream(render_stream)->stats().mStreamedBytes += bytes;
+
+    glBindBuffer(GL_ARRAY_BUFFER, mBuffer->handle());
+  }
+  else
+  {
+    (*mBuffer)[wrapSlot()] = (*mBuffer)[mHistorySize];
+    vertex_pointer = mBuffer->localBufferVoidPtr();
+  }
+
+  glVertexPointer(3, GL_FLOAT, 0, vertex_pointer);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glColor4fv(mColor.ptr());
+
+  int draw_calls = 0;
+  if (mHistoryCount > 1)
+  {
+    glDrawArrays(GL_LINE_STRIP, 0, mHistoryCount);
+    draw_calls++;
+  }
+  if (ring_count > 1)
+  {
+    int first = mFirst % mRingSize;
+    if (first + ring_count <= mRingSize)
+    {
+      glDrawArrays(GL_LINE_STRIP, mHistorySize + first, ring_count);
+      draw_calls++;
+    }
+    else
+    {
+      // the first strip ends on the copy of slot 0, where the second one starts
+      glDrawArrays(GL_LINE_STRIP, mHistorySize + first, mRingSize - first + 1);
+      glDrawArrays(GL_LINE_STRIP, mHistorySize, first + ring_count - mRingSize);
+      draw_calls += 2;
+    }
+  }
+  GlobalState::renderStream(render_stream)->stats().mDrawCalls += draw_calls;
+
+  glDisableClientState(GL_VERTEX_ARRAY);
+  if (vbo_on)
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  GLCHECK4()
+}
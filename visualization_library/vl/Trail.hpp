@@ -0,0 +1,119 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef Trail_INCLUDE_DEFINE
+#define Trail_INCLUDE_DEFINE
+
+#include "vl/Drawable.hpp"
+#include "vl/Geometry.hpp"
+#include "vl/vec3.hpp"
+#include "vl/vec4.hpp"
+#include <vector>
+
+namespace vl
+{
+
+  /*!
+    A line strip growing at its head, like the path flown by a vehicle.
+
+    The vertices live in one vertex buffer object made of two regions. The
+    ring region holds the newest points at full resolution; addPoint()
+    writes one vertex there and draw() sends only the vertices written
+    since the last frame with glBufferSubData(). When the ring is full its
+    oldest quarter is simplified (Douglas-Peucker with historyTolerance())
+    and appended to the history region. When the history is full it is
+    simplified again, doubling the tolerance until it fits in half the
+    history, and sent as a whole, which happens a few times in an hour of
+    flight. The passes add up to less than twice historyTolerance().
+
+    So the vertex count stays below ringSize()+historySize() and a frame
+    uploads one vertex per added point, plus a quarter ring now and then.
+
+    Points closer than minSpacing() to the last one move it instead of
+    adding a new one, so the head follows the vehicle and a hover adds
+    nothing. Points are in world coordinates, the Actor drawing the trail
+    should have no Transform. Draws with the current color, see setColor().
+  */
+  class Trail: public Drawable
+  {
+  public:
+    Trail(int ring_size = 1024, int history_size = 4096);
+
+    void addPoint(const vec3& point);
+    void clear();
+
+    void setColor(const vec4& color) { mColor = color; }
+    const vec4& color() const { return mColor; }
+
+    void setMinSpacing(float spacing) { mMinSpacing = spacing; }
+    float minSpacing() const { return mMinSpacing; }
+
+    //! Error bound of the simplification after clear(), in world units.
+    void setTolerance(float tolerance);
+    float tolerance() const { return mTolerance; }
+    //! Error bound used now, it doubles each time the history fills up.
+    float historyTolerance() const { return mHistoryTolerance; }
+
+    int ringSize() const { return mRingSize; }
+    int historySize() const { return mHistorySize; }
+    //! Vertices drawn, history and ring.
+    int vertexCount() const { return mHistoryCount + (mNext - mFirst); }
+    //! Points added since clear(), including the ones moving the head.
+    int pointCount() const { return mPointCount; }
+
+    virtual void computeAABB();
+
+    virtual void draw(Actor* actor, int render_stream, unsigned int tex_units);
+
+    //! Iterative Douglas-Peucker, keeps the first and the last point.
+    static void simplify(const vec3* points, int count, float tolerance, std::vector<vec3>& out);
+
+  protected:
+    int slot(int seq) const { return mHistorySize + seq % mRingSize; }
+    void retireChunk();
+    int upload(int first, int count);
+    //! Local buffer index of the copy of slot 0 after the last slot, joins the strips of a wrapped ring.
+    int wrapSlot() const { return mHistorySize + mRingSize; }
+
+    ref<GPUArrayVec3> mBuffer;
+    vec4 mColor;
+    float mMinSpacing;
+    float mTolerance;
+    float mHistoryTolerance;
+    int mRingSize;
+    int mHistorySize;
+    int mPointCount;
+
+    //! Vertices of the history region, the ones from mHistoryDirty on are not uploaded yet.
+    int mHistoryCount;
+    int mHistoryDirty;
+
+    //! Points in the ring by sequence number, point s is in slot s % mRingSize.
+    int mFirst;
+    int mNext;
+    //! First sequence number not uploaded yet.
+    int mRingDirty;
+
+    std::vector<vec3> mScratch;
+    std::vector<vec3> mSimplified;
+  };
+
+}
+
+#endif
@@ -23,6 +23,11 @@
 
 using namespace vl;
 
+namespace
+{
+  const mat4d IdentityMatrix;
+}
+
 Transform::~Transform()
 {
   detachFromParent();
@@ -55,6 +60,8 @@ void Transform::setChild(int index, Transform* child)
 {
   CHECK( index < (int)mChildren.size() )
   mChildren[index] = child;
+  child->setDirty();
+  invalidateHierarchy();
 }
 
 void Transform::addChild(Transform* child)
@@ -64,6 +71,8 @@ void Transform::addChild(Transform* child)
   CHECK(std::find(mChildren.begin(), mChildren.end(), child) == mChildren.end());
   mChildren.push_back(child);
   child->mParent = this;
+  child->setDirty();
+  invalidateHierarchy();
 }
 
 void Transform::removeChild(Transform* child)
@@ -75,7 +84,9 @@ void Transform::removeChild(Transform* child)
   if (it != mChildren.end())
   {
     (*it)->mParent = NULL;
+    (*it)->setDirty();
     mChildren.erase(it);
+    invalidateHierarchy();
   }
 }
 
@@ -87,13 +98,18 @@ void Transform::removeChildren(int index, int count)
     mChildren[j] = mChildren[i];
 
   mChildren.resize( mChildren.size() - count );
+  invalidateHierarchy();
 }
 
 void Transform::removeAllChildren()
 {
   for(int i=0; i<(int)mChildren.size(); i++)
+  {
     mChildren[i]->mParent = NULL;
+    mChildren[i]->setDirty();
+  }
   mChildren.clear();
+  invalidateHierarchy();
 }
 
 void Transform::removeAllChildrenRecursive()
@@ -102,8 +118,10 @@ void Transform::removeAllChildrenRecursive()
   {
     mChildren[i]->removeAllChildrenRecursive();
     mChildren[i]->mParent = NULL;
+    mChildren[i]->setDirty();
   }
   mChildren.clear();
+  invalidateHierarchy();
 }
 
 void Transform::setName(std::string n) 
@@ -121,7 +139,7 @@ void Transform::computeLocalToWorldMatrix(Camera* camera)
   mat4d m;
   if( parent() )
     m = parent()->localToWorldMatrix(camera ? camera->renderStream() : 0);
-  m = m * localMatrix();
+  m = m * mLocalMatrix->mMatrix;
   setLocalToWorldMatrix(m, camera ? camera->renderStream() : 0);
 }
 
@@ -134,8 +152,9 @@ void Transform::setLocalToWorldMatrix(const mat4d& matrix, int thread_slot)
 
 const mat4d& Transform::localToWorldMatrix(int thread_slot)
 { 
+  // doesn't create the matrix, so that the render list compiler threads can read it
   if (!mLocalToWorldMatrix[thread_slot]) 
-    mLocalToWorldMatrix[thread_slot] = new MatrixObject;
+    return IdentityMatrix;
   return mLocalToWorldMatrix[thread_slot]->mMatrix; 
 }
 
@@ -148,30 +167,82 @@ MatrixObject* Transform::localToWorldMatrixPtr(int thread_slot)
 
 void Transform::setLocalMatrix(const mat4d& matrix) 
 { 
-  if (!mLocalMatrix) 
-    mLocalMatrix = new MatrixObject; 
   mLocalMatrix->mMatrix = matrix; 
+  setDirty();
 }
 
 mat4d& Transform::localMatrix()
 { 
-  if (!mLocalMatrix) 
-    mLocalMatrix = new MatrixObject;
+  setDirty();
   return mLocalMatrix->mMatrix; 
 }
 
 mat4d Transform::getComputedLocalToWorld()
 {
-  mat4d world = localMatrix();
-  ref<Transform> par = parent();
+  mat4d world = mLocalMatrix->mMatrix;
+  Transform* par = parent();
   while(par)
   {
-    world = par->localMatrix() * world;
+    world = par->mLocalMatrix->mMatrix * world;
     par = par->parent();
   }
   return world;
 }
 
+void Transform::setDirty()
+{
+  mDirtySlots = AllSlots;
+  mSubtreeDirtySlots = AllSlots;
+  // if a node has a subtree bit set all its ancestors have it too
+  for(Transform* tr = parent(); tr && tr->mSubtreeDirtySlots != AllSlots; tr = tr->parent())
+    tr->mSubtreeDirtySlots = AllSlots;
+}
+
+void Transform::invalidateHierarchy()
+{
+  // every ancestor holding a flattened copy of this node must rebuild it
+  for(Transform* tr = this; tr; tr = tr->parent())
+    tr->mFlatDirty = true;
+}
+
+void Transform::flattenHierarchy()
+{
+  mFlatNodes.clear();
+  mFlatParents.clear();
+  std::vector< std::pair<Transform*,int> > stack;
+  stack.push_back( std::make_pair(this, -1) );
+  while( !stack.empty() )
+  {
+    Transform* tr = stack.back().first;
+    int parent = stack.back().second;
+    stack.pop_back();
+    int index = (int)mFlatNodes.size();
+    mFlatNodes.push_back(tr);
+    mFlatParents.push_back(parent);
+    for(int i=(int)tr->mChildren.size(); i--; )
+      stack.push_back( std::make_pair(tr->mChildren[i].get(), index) );
+  }
+
+  // a subtree ends where its last descendant does, children come after their parents
+  int count = (int)mFlatNodes.size();
+  mFlatSubtreeEnd.resize(count);
+  mFlatCameraDependent.resize(count);
+  for(int i=0; i<count; i++)
+  {
+    mFlatSubtreeEnd[i] = i+1;
+    mFlatCameraDependent[i] = mFlatNodes[i]->dependsOnCamera();
+  }
+  for(int i=count; --i > 0; )
+  {
+    int parent = mFlatParents[i];
+    mFlatSubtreeEnd[parent] = std::max(mFlatSubtreeEnd[parent], mFlatSubtreeEnd[i]);
+    mFlatCameraDependent[parent] |= mFlatCameraDependent[i];
+  }
+
+  mFlatChanged.resize(count);
+  mFlatDirty = false;
+}
+
 Billboard::Billboard()
 {
   setAxis(vec3d(0,1,0));
@@ -180,7 +251,7 @@ Billboard::Billboard()
 
 vec3d Billboard::position()
 {
-  return localMatrix().getT();
+  return mLocalMatrix->mMatrix.getT();
 }
 
 void Billboard::setPosition(const vec3d& pos)
@@ -228,8 +299,38 @@ void Billboard::computeLocalToWorldMatrix(Camera* camera)
 
 void Transform::computeLocalToWorldMatrixRecursive(Camera* camera)
 {
+  if (mFlatDirty)
+    flattenHierarchy();
+
+  int slot = camera ? camera->renderStream() : 0;
+  unsigned int bit = 1 << slot;
+
+  // the parent of the root is not part of the subtree: the root is always recomputed and
+  // its descendants are updated only if its matrix actually changed.
+  mat4d prev_world = localToWorldMatrix(slot);
+  bool root_dirty = isDirty(slot) || dependsOnCamera();
   computeLocalToWorldMatrix(camera);
-  for(int i=0; i<(int)mChildren.size(); i++)
-    mChildren[i]->computeLocalToWorldMatrixRecursive(camera);
+  mDirtySlots &= ~bit;
+  mSubtreeDirtySlots &= ~bit;
+  mFlatChanged[0] = root_dirty || prev_world != localToWorldMatrix(slot);
+
+  for(int i=1; i<(int)mFlatNodes.size(); )
+  {
+    Transform* tr = mFlatNodes[i];
+    bool parent_changed = mFlatChanged[mFlatParents[i]] != 0;
+    if ( !parent_changed && !(tr->mSubtreeDirtySlots & bit) && !mFlatCameraDependent[i] )
+    {
+      // nothing changed in this subtree
+      i = mFlatSubtreeEnd[i];
+      continue;
+    }
+    bool changed = parent_changed || (tr->mDirtySlots & bit) || (mFlatCameraDependent[i] && tr->dependsOnCamera());
+    if (changed)
+      tr->computeLocalToWorldMatrix(camera);
+    tr->mDirtySlots &= ~bit;
+    tr->mSubtreeDirtySlots &= ~bit;
+    mFlatChanged[i] = changed;
+    i++;
+  }
 }
 
@@ -35,11 +35,17 @@ namespace vl
     SphericalBillboard = 2
   } EBillboardType;
 
+  //! Node of a transform hierarchy.
+  //! The local to world matrices are updated by computeLocalToWorldMatrixRecursive(), which walks
+  //! a flattened copy of the subtree (nodes in depth first order with the index of their parent)
+  //! and recomputes only the nodes whose local matrix changed and their descendants. Subtrees
+  //! without changes are skipped as a whole. The flattened copy is rebuilt only when the
+  //! hierarchy changes.
   class Transform: public Object
   {
   public:
-    Transform(): mParent(NULL) { }
-    Transform(const mat4d& matrix): mParent(NULL) { setLocalMatrix(matrix); }
+    Transform(): mLocalMatrix(new MatrixObject), mParent(NULL), mDirtySlots(AllSlots), mSubtreeDirtySlots(AllSlots), mFlatDirty(true) { }
+    Transform(const mat4d& matrix): mLocalMatrix(new MatrixObject), mParent(NULL), mDirtySlots(AllSlots), mSubtreeDirtySlots(AllSlots), mFlatDirty(true) { setLocalMatrix(matrix); }
     virtual ~Transform();
 
 	  void setName(std::string n);
@@ -60,18 +66,44 @@ namespace vl
 
     virtual void computeLocalToWorldMatrix(Camera* camera);
     void computeLocalToWorldMatrixRecursive(Camera* camera);
+    //! The identity if the matrix of the slot was never computed.
     const mat4d& localToWorldMatrix(int thread_slot);
     MatrixObject* localToWorldMatrixPtr(int thread_slot);
     void setLocalMatrix(const mat4d& matrix);
+    //! Marks the transform as changed since the returned matrix can be modified.
     mat4d& localMatrix();
+    const mat4d& localMatrix() const { return mLocalMatrix->mMatrix; }
+
+    //! Forces the recomputation of the local to world matrix on the next update.
+    void setDirty();
+    bool isDirty(int thread_slot) const { return (mDirtySlots & (1 << thread_slot)) != 0; }
+
+    //! Transforms whose matrix depends on the camera are recomputed at every update.
+    virtual bool dependsOnCamera() const { return false; }
 
   protected:
+    enum { AllSlots = (1 << MAX_CAMERA_THREAD_SLOTS) - 1 };
+
     void setLocalToWorldMatrix(const mat4d& matrix, int thread_slot);
+    void invalidateHierarchy();
+    void flattenHierarchy();
 
     ref<MatrixObject> mLocalToWorldMatrix[MAX_CAMERA_THREAD_SLOTS]; 
     ref<MatrixObject> mLocalMatrix; // local to parent matrix
     std::vector< ref<Transform> > mChildren;
     Transform* mParent;
+    // one bit per camera thread slot whose local to world matrix is out of date
+    unsigned int mDirtySlots;
+    // same bits set if this node or one of its descendants is out of date
+    unsigned int mSubtreeDirtySlots;
+
+    // flattened subtree, valid until mFlatDirty is set by a change of the hierarchy
+    std::vector<Transform*> mFlatNodes;
+    std::vector<int> mFlatParents;
+    std::vector<int> mFlatSubtreeEnd;
+    std::vector<char> mFlatCameraDependent; // the subtree contains a camera dependent node
+    std::vector<char> mFlatChanged;
+    bool mFlatDirty;
   };
 
   class Billboard: public Transform
@@ -83,6 +115,7 @@ namespace vl
     void setAxis(const vec3d& axis) { mAxis = axis; mAxis.normalize(); }
     const vec3d& axis() const { return mAxis; }
     virtual void computeLocalToWorldMatrix(Camera* camera);
+    virtual bool dependsOnCamera() const { return true; }
     EBillboardType type() const { return mType; }
     void setType(EBillboardType type) { mType = type; }
 
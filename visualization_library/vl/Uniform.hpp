@@ -62,40 +62,56 @@ namespace vl
     const std::string& name() const { return mName; }
     void setName(const std::string& name) { mName = name; }
 
-    void applyToGLSLProgram(GLSLProgram* glslprogram)
+    //! Uploads the value unless the program already holds it, returns false if nothing was sent.
+    bool applyToGLSLProgram(GLSLProgram* glslprogram)
     {
+      if (mType == NONE || (mFloatData.empty() && mIntData.empty()))
+        return false;
+
+      GLint location = glslprogram->getUniformLocation(name());
+      if (location == -1)
+        return false;
+
+      const void* data = mFloatData.empty() ? (const void*)&mIntData[0] : (const void*)&mFloatData[0];
+      int bytes = mFloatData.empty() ? (int)(mIntData.size()*sizeof(mIntData[0])) : (int)(mFloatData.size()*sizeof(mFloatData[0]));
+      if ( glslprogram->isUniformCached(location, data, bytes) )
+        return false;
+
       if (mType == FLOAT)
-        glslprogram->setUniform1f(name().c_str(), (int)mFloatData.size(), &mFloatData[0]);
+        glslprogram->setUniform1f(location, (int)mFloatData.size(), &mFloatData[0]);
       else
       if (mType == VEC2)
-        glslprogram->setUniform2f(name().c_str(), (int)mFloatData.size() / 2, &mFloatData[0]);
+        glslprogram->setUniform2f(location, (int)mFloatData.size() / 2, &mFloatData[0]);
       else
       if (mType == VEC3)
-        glslprogram->setUniform3f(name().c_str(), (int)mFloatData.size() / 3, &mFloatData[0]);
+        glslprogram->setUniform3f(location, (int)mFloatData.size() / 3, &mFloatData[0]);
       else
       if (mType == VEC4)
-        glslprogram->setUniform4f(name().c_str(), (int)mFloatData.size() / 4, &mFloatData[0]);
+        glslprogram->setUniform4f(location, (int)mFloatData.size() / 4, &mFloatData[0]);
       else
       if (mType == MAT2)
-        glslprogram->setUniformMatrix2f(name().c_str(), (int)mFloatData.size() / 4, false, &mFloatData[0]);
+        glslprogram->setUniformMatrix2f(location, (int)mFloatData.size() / 4, false, &mFloatData[0]);
       else
       if (mType == MAT3)
-        glslprogram->setUniformMatrix3f(name().c_str(), (int)mFloatData.size() / 9, false, &mFloatData[0]);
+        glslprogram->setUniformMatrix3f(location, (int)mFloatData.size() / 9, false, &mFloatData[0]);
       else
       if (mType == MAT4)
-        glslprogram->setUniformMatrix4f(name().c_str(), (int)mFloatData.size() / 16, false, &mFloatData[0]);
+        glslprogram->setUniformMatrix4f(location, (int)mFloatData.size() / 16, false, &mFloatData[0]);
       else
       if (mType == INT)
-        glslprogram->setUniform1i(name().c_str(), (int)mIntData.size(), &mIntData[0]);
+        glslprogram->setUniform1i(location, (int)mIntData.size(), &mIntData[0]);
       else
       if (mType == IVEC2)
-        glslprogram->setUniform2i(name().c_str(), (int)mIntData.size() / 2, &mIntData[0]);
+        glslprogram->setUniform2i(location, (int)mIntData.size() / 2, &mIntData[0]);
       else
       if (mType == IVEC3)
-        glslprogram->setUniform3i(name().c_str(), (int)mIntData.size() / 3, &mIntData[0]);
+        glslprogram->setUniform3i(location, (int)mIntData.size() / 3, &mIntData[0]);
       else
       if (mType == IVEC4)
-        glslprogram->setUniform4i(name().c_str(), (int)mIntData.size() / 4, &mIntData[0]);
+        glslprogram->setUniform4i(location, (int)mIntData.size() / 4, &mIntData[0]);
+
+      glslprogram->cacheUniform(location, data, bytes);
+      return true;
     }
 
   protected:
@@ -20,6 +20,11 @@
 #ifndef CONFIG_INCLUDE_DEFINE
 #define CONFIG_INCLUDE_DEFINE
 
+//! Build with VL_THREAD_SAFE_REF_COUNT=1 to share objects between threads, see THREAD_SAFE_REF_COUNT.
+#ifndef VL_THREAD_SAFE_REF_COUNT
+  #define VL_THREAD_SAFE_REF_COUNT 0
+#endif
+
 namespace vl
 { 
   const int VERBOSITY_LEVEL = 2;
@@ -33,6 +38,10 @@ namespace vl
   const int MAX_TEXTURE_UNITS = 4; 
 
   const int MAX_CAMERA_THREAD_SLOTS = 4;
+
+  //! Reference counts updated with atomic operations, so that ref<> can point to the same
+  //! object from several threads. The library and the application must be built with the same value.
+  const bool THREAD_SAFE_REF_COUNT = VL_THREAD_SAFE_REF_COUNT != 0;
 };
 
 #endif
@@ -0,0 +1,167 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "vlEGL/EGL_Offscreen.hpp"
+#include "vlut/RenderPipeline.hpp"
+#include "vl/OpenGL.hpp"
+#include "vl/Log.hpp"
+#include "vl/Say.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+using namespace vlEGL;
+
+namespace
+{
+  EGLDisplay surfacelessDisplay()
+  {
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display)
+      return get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#endif
+    return EGL_NO_DISPLAY;
+  }
+}
+
+bool EGL_Offscreen::create()
+{
+  destroy();
+
+  EGLint major = 0, minor = 0;
+  EGLDisplay display = surfacelessDisplay();
+  if ( display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor) )
+  {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if ( display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor) )
+    {
+      vl::Log::error("EGL_Offscreen: no EGL display available.\n");
+      return false;
+    }
+  }
+  mDisplay = display;
+
+  if ( !eglBindAPI(EGL_OPENGL_API) )
+  {
+    vl::Log::error("EGL_Offscreen: the EGL display does not support desktop OpenGL.\n");
+    destroy();
+    return false;
+  }
+
+  const EGLint config_attribs[] =
+  {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint config_count = 0;
+  if ( !eglChooseConfig(display, config_attribs, &config, 1, &config_count) || config_count == 0 )
+  {
+    vl::Log::error("EGL_Offscreen: no suitable EGL configuration.\n");
+    destroy();
+    return false;
+  }
+
+  EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+  if (context == EGL_NO_CONTEXT)
+  {
+    vl::Log::error( vl::Say("EGL_Offscreen: eglCreateContext() failed (0x%h).\n") << (int)eglGetError() );
+    destroy();
+    return false;
+  }
+  mContext = context;
+
+  // without EGL_KHR_surfaceless_context the context needs a surface to become current
+  if ( !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) )
+  {
+    const EGLint pbuffer_attribs[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+    if (surface == EGL_NO_SURFACE)
+    {
+      vl::Log::error( vl::Say("EGL_Offscreen: eglCreatePbufferSurface() failed (0x%h).\n") << (int)eglGetError() );
+      destroy();
+      return false;
+    }
+    mSurface = surface;
+  }
+
+  if ( !makeCurrent() )
+  {
+    vl::Log::error( vl::Say("EGL_Offscreen: eglMakeCurrent() failed (0x%h).\n") << (int)eglGetError() );
+    destroy();
+    return false;
+  }
+
+  vl::Log::print( vl::Say("EGL %n.%n: %s\n") << major << minor << eglQueryString(display, EGL_VENDOR) );
+  vl::init_glew();
+
+  return true;
+}
+
+void EGL_Offscreen::destroy()
+{
+  if (!mDisplay)
+    return;
+  eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (mSurface)
+    eglDestroySurface(mDisplay, mSurface);
+  if (mContext)
+    eglDestroyContext(mDisplay, mContext);
+  eglTerminate(mDisplay);
+  mDisplay = NULL;
+  mContext = NULL;
+  mSurface = NULL;
+}
+
+bool EGL_Offscreen::makeCurrent()
+{
+  if (!mContext)
+    return false;
+  EGLSurface surface = mSurface ? mSurface : EGL_NO_SURFACE;
+  return eglMakeCurrent(mDisplay, surface, surface, mContext) == EGL_TRUE;
+}
+
+vl::ref<vlEGL::EGL_Offscreen> vlEGL::open_EGL_Offscreen(vlut::RenderPipeline* pipeline, int width, int height, vl::vec4 bkcolor)
+{
+  vl::ref<vlEGL::EGL_Offscreen> context = new vlEGL::EGL_Offscreen;
+  if ( !context->create() )
+    return NULL;
+
+  if (!GLEW_EXT_framebuffer_object)
+  {
+    vl::Log::error("open_EGL_Offscreen: GL_EXT_framebuffer_object not supported.\n");
+    return NULL;
+  }
+
+  vl::ref<vl::FBORenderTarget> fbo = new vl::FBORenderTarget(width, height);
+  fbo->addColorAttachment( vl::AP_COLOR_ATTACHMENT0_EXT, new vl::FBOColorBuffer(vl::CBF_RGBA8) );
+  fbo->addDepthAttachment( new vl::FBODepthBuffer(vl::DT_DEPTH_COMPONENT24) );
+  fbo->setDrawBuffers( vl::RDB_COLOR_ATTACHMENT0_EXT );
+
+  pipeline->camera()->setRenderTarget( fbo.get() );
+  pipeline->camera()->setViewport( new vl::Viewport(0, 0, width, height) );
+  pipeline->camera()->viewport()->setClearColor( bkcolor );
+  pipeline->camera()->setProjectionMatrixPerspective();
+
+  return context;
+}
@@ -0,0 +1,72 @@
+/*
+  Copyright (C) 2008 Michele Bosi
+
+  This file is part of Visualization Library.
+
+  Visualization Library is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Visualization Library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Visualization Library. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef EGL_Offscreen_INCLUDE_DEFINE
+#define EGL_Offscreen_INCLUDE_DEFINE
+
+#include "vl/Object.hpp"
+#include "vl/vec4.hpp"
+#include "vl/FrameBufferObject.hpp"
+
+namespace vlut
+{
+  class RenderPipeline;
+}
+
+namespace vlEGL
+{
+  //! OpenGL context without window and without display, for batch jobs on machines without X or GPU.
+  //! Uses the surfaceless platform of Mesa when available, which renders with llvmpipe,
+  //! otherwise a small pbuffer of the default display. Since the context has no usable
+  //! frame buffer the frames are rendered in a frame buffer object, see open_EGL_Offscreen().
+  //! A context can not be shared with a forked process, create it in the process that renders.
+  class EGL_Offscreen: public vl::Object
+  {
+  public:
+    EGL_Offscreen(): mDisplay(NULL), mContext(NULL), mSurface(NULL) {}
+
+    ~EGL_Offscreen()
+    {
+      destroy();
+    }
+
+    //! Creates the context, makes it current and initializes GLEW.
+    bool create();
+
+    void destroy();
+
+    bool makeCurrent();
+
+    bool isValid() const { return mContext != NULL; }
+
+  protected:
+    // EGLDisplay, EGLContext and EGLSurface, the EGL headers are only included by the .cpp
+    void* mDisplay;
+    void* mContext;
+    void* mSurface;
+  };
+
+  //! Creates an offscreen context and sets up the pipeline to render into a frame buffer object
+  //! of width x height pixels with RGBA8 color and 24 bits depth. The rendered frames are read
+  //! back from vl::RDB_COLOR_ATTACHMENT0_EXT. Returns NULL if no context can be created.
+  vl::ref<vlEGL::EGL_Offscreen> open_EGL_Offscreen(vlut::RenderPipeline* pipeline, int width, int height, vl::vec4 bkcolor);
+}
+
+#endif
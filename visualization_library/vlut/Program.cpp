@@ -22,6 +22,7 @@
 #include "vl/Time.hpp"
 #include "vl/Say.hpp"
 #include "vl/Log.hpp"
+#include "vl/GlobalState.hpp"
 #include "vlut/RenderPipeline.hpp"
 
 using namespace vlut;
@@ -126,7 +127,17 @@ void Program::renderEvent()
     std::string str = title() + " - " + fps;
     openglWidget()->setWindowTitle(str);
     if (logFPS())
+    {
       vl::Log::print(fps + "\n");
+      // counters of the last frame drawn by the first pipeline
+      if (!mPipeline.empty())
+      {
+        const vl::RenderStats& stats = vl::GlobalState::renderStream( mPipeline[0]->camera()->renderStream() )->stats();
+        vl::Log::print( vl::Say("  %n state changes (%n skipped), %n uniforms (%n skipped), %n drawables, %n draw calls\n")
+          << stats.mStateChanges << stats.mStatesSkipped << stats.mUniformUpdates << stats.mUniformsSkipped
+          << stats.mDrawables << stats.mDrawCalls );
+      }
+    }
 
     _framecount = 0;
     _start = vl::Time::timerSeconds();